@@ -0,0 +1,34 @@
+#!/usr/bin/env bash
+
+# O(N log N) scaling and thread sweep of the host backend; compares with the fixed baseline (if any), which is only
+# replaced by the results of this run if the script is called with --update-baseline
+
+UPDATE_BASELINE=0
+for arg in "$@"
+do
+	case ${arg} in
+		--update-baseline) UPDATE_BASELINE=1 ;;
+		*) echo "usage: $0 [--update-baseline]"; exit 1 ;;
+	esac
+done
+
+cd "$(dirname "$0")/../../src"
+mkdir -p results
+
+BASELINE=results/cpu_scaling_baseline.csv
+OUTPUT=results/cpu_scaling_$(date +%Y%m%d_%H%M%S)
+
+ARGS="--distribution uniform,halton,clustered,sphere --points 16384,32768,65536,131072,262144 --dim 2,3 --threads 1,$(nproc) --csv ${OUTPUT}.csv --json ${OUTPUT}.json"
+
+if [ ${UPDATE_BASELINE} -eq 1 ]
+then
+	./host_benchmark ${ARGS} || exit 1
+	cp ${OUTPUT}.csv ${BASELINE}
+	echo "Baseline ${BASELINE} updated from ${OUTPUT}.csv"
+elif [ -f ${BASELINE} ]
+then
+	./host_benchmark ${ARGS} --baseline ${BASELINE}
+else
+	./host_benchmark ${ARGS} || exit 1
+	echo "No baseline ${BASELINE} yet, run $0 --update-baseline to keep these results as the baseline"
+fi
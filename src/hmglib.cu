@@ -15,7 +15,10 @@
 // You should have received a copy of the GNU Lesser General Public License
 // along with hmglib.  If not, see <http://www.gnu.org/licenses/>.
 
+// GPU backend of the API, see hmglib_gpu.h; the API itself and the host backend are in hmglib_host.cpp
+
 #include <stdio.h>
+#include <string.h>
 #include "morton.h"
 #include <thrust/device_ptr.h>
 #include <thrust/extrema.h>
@@ -24,14 +27,21 @@
 #include "tree.h"
 #include "linear_algebra.h"
 #include <thrust/inner_product.h>
+#include <thrust/transform.h>
+#include <thrust/equal.h>
 #include "helper.h"
+#include "host_morton.h"
+#include "host_tree.h"
+#include "krylov.h"
+#include "profiling.h"
 
 #include "hmglib.h"
+#include "hmglib_gpu.h"
 
-cudaEvent_t hmglib_start, hmglib_stop;
-float hmglib_milliseconds;
-#define TIME_start // {cudaEventCreate(&hmglib_start); cudaEventCreate(&hmglib_stop); cudaEventRecord(hmglib_start);}
-#define TIME_stop(a) // {cudaEventRecord(hmglib_stop); cudaEventSynchronize(hmglib_stop); cudaEventElapsedTime(&hmglib_milliseconds, hmglib_start, hmglib_stop); printf("%s: Elapsed time: %lf ms\n", a, hmglib_milliseconds); }
+// the wall time of a phase is recorded in data->profile if profiling is enabled (see enable_h_matrix_profiling); the
+// GPU is synchronized at the phase boundaries then
+#define TIME_start(phase) { if (data->profile!=0) { cudaDeviceSynchronize(); profile_phase_begin(data->profile, phase); } }
+#define TIME_stop(phase) { if (data->profile!=0) { cudaDeviceSynchronize(); profile_phase_end(data->profile, phase); } }
 
 __global__ void init_point_set(struct point_set* points, double** coords_device, unsigned int* point_ids_d, int dim, double* max_per_dim, double* min_per_dim, int size)
 {
@@ -65,11 +75,8 @@ __global__ void init_morton_code(struct morton_code* morton, uint64_t* code, int
 	return;
 }
 
-void init_h_matrix_data(struct h_matrix_data* data, int point_count[2], int dim, int bits)
+void init_h_matrix_data_on_gpu(struct h_matrix_data* data, int point_count[2], int dim, int bits)
 {
-	data->dim = dim;
-	data->bits = bits;
-
 	for (int i=0; i<2; i++)
 	{
 		// copying point_count
@@ -110,11 +117,6 @@ void init_h_matrix_data(struct h_matrix_data* data, int point_count[2], int dim,
 		checkCUDAError("init_morton_code");
 	}
 
-	// initialize fields for precomputation
-	data->U = 0;
-	data->V = 0;	
-	data->dA = 0;
-
 	// initialize magma
         magma_init();
         magma_int_t dev = 0;
@@ -122,46 +124,116 @@ void init_h_matrix_data(struct h_matrix_data* data, int point_count[2], int dim,
         magma_queue_create( dev, &(data->magma_queue));
 }
 
-void setup_h_matrix(struct h_matrix_data* data)
+void get_block_list_on_gpu(struct block_list* blocks, struct h_matrix_data* data)
 {
-	TIME_start;
+	int total_count = data->mat_vec_info.total_count;
+
+	struct work_item* work_items_h = new struct work_item[total_count];
+	cudaMemcpy(work_items_h, *(data->mat_vec_data), total_count*sizeof(struct work_item), cudaMemcpyDeviceToHost);
+	checkCUDAError("cudaMemcpy");
+
+	host_get_block_list(blocks, work_items_h, total_count);
+	delete [] work_items_h;
+}
+
+// generates the Morton codes of point set i on the host for dim / bits combinations not supported on the GPU
+void get_morton_code_on_host(struct h_matrix_data* data, int i)
+{
+	int dim = data->dim;
+	int point_count = data->point_count[i];
+
+	struct point_set points_h;
+	points_h.dim = dim;
+	points_h.size = point_count;
+	points_h.coords = new double*[dim];
+	points_h.max_per_dim = new double[dim];
+	points_h.min_per_dim = new double[dim];
+	points_h.point_ids = 0;
+
+	for (int d=0; d<dim; d++)
+	{
+		points_h.coords[d] = new double[point_count];
+		cudaMemcpy(points_h.coords[d], data->coords_d[i][d], point_count*sizeof(double), cudaMemcpyDeviceToHost);
+	}
+	cudaMemcpy(points_h.max_per_dim, data->max_per_dim_d[i], dim*sizeof(double), cudaMemcpyDeviceToHost);
+	cudaMemcpy(points_h.min_per_dim, data->min_per_dim_d[i], dim*sizeof(double), cudaMemcpyDeviceToHost);
+	checkCUDAError("cudaMemcpy");
+
+	struct morton_code morton_h;
+	morton_h.code = new uint64_t[point_count];
+	morton_h.dim = dim;
+	morton_h.bits = data->bits;
+	morton_h.size = point_count;
+	morton_h.max_values = 0;
+	morton_h.min_values = 0;
+
+	host_get_morton_code(&points_h, &morton_h);
+
+	cudaMemcpy(data->code_d[i], morton_h.code, point_count*sizeof(uint64_t), cudaMemcpyHostToDevice);
+	checkCUDAError("cudaMemcpy");
+
+	delete [] morton_h.code;
+	for (int d=0; d<dim; d++)
+		delete [] points_h.coords[d];
+	delete [] points_h.coords;
+	delete [] points_h.max_per_dim;
+	delete [] points_h.min_per_dim;
+}
+
+void setup_h_matrix_on_gpu(struct h_matrix_data* data)
+{
+	if (data->symmetric)
+	{
+		printf("Symmetric mode is only supported for BACKEND_HOST. Exiting...\n");
+		exit(1);
+	}
 
 	// compute extremal values for the point set
+	TIME_start(PROFILE_MINMAX);
 	compute_minmax(data->points_d[0]);
 	compute_minmax(data->points_d[1]);
+	TIME_stop(PROFILE_MINMAX);
 	
 	// calculate GPU thread configuration	
 	int block_size = 512;
 	int grid_size = (max(data->point_count[0],data->point_count[1]) + (block_size - 1)) / block_size;
 
 	// generate morton codes
-	get_morton_code(data->points_d[0], data->morton_d[0], grid_size, block_size);
-	get_morton_code(data->points_d[1], data->morton_d[1], grid_size, block_size);
+	TIME_start(PROFILE_MORTON_ENCODING);
+	if (get_morton_code_is_supported(data->dim, data->bits))
+	{
+		get_morton_code(data->points_d[0], data->morton_d[0], grid_size, block_size);
+		get_morton_code(data->points_d[1], data->morton_d[1], grid_size, block_size);
+	}
+	else
+	{
+		get_morton_code_on_host(data, 0);
+		get_morton_code_on_host(data, 1);
+	}
 	checkCUDAError("get_morton_code");
+	TIME_stop(PROFILE_MORTON_ENCODING);
 
 //	print_points_with_morton_codes(data->points_d[0], data->morton_d[0]);
 
 
 	// find ordering of points following Z curve
+	TIME_start(PROFILE_SORT);
 	cudaMalloc((void**)&(data->order[0]), data->point_count[0]*sizeof(uint64_t));
 	cudaMalloc((void**)&(data->order[1]), data->point_count[1]*sizeof(uint64_t));
 	checkCUDAError("cuda_malloc");
 
 	get_morton_ordering(data->points_d[0], data->morton_d[0], data->order[0]);
 	get_morton_ordering(data->points_d[1], data->morton_d[1], data->order[1]);
+	TIME_stop(PROFILE_SORT);
 
 //	print_points_with_morton_codes(data->points_d, data->morton_d);
 
 	// reorder points following the morton code order
-//	TIME_start;
+	TIME_start(PROFILE_POINT_REORDER);
 	reorder_point_set(data->points_d[0], data->order[0]);
 	reorder_point_set(data->points_d[1], data->order[1]);
-//	TIME_stop("reorder_point_set");
+	TIME_stop(PROFILE_POINT_REORDER);
 
-	TIME_stop("data structure setup");
-
-
-	TIME_start;
 	
 	struct work_item root_h;
 	root_h.set1_l = 0;
@@ -194,11 +266,19 @@ void setup_h_matrix(struct h_matrix_data* data)
 	data->max_elements_in_array = -1; // TODO
 	data->max_elements_in_mat_vec_data_array = -1; // TODO
 
+	double* level_seconds = new double[data->max_level];
+	int level_count;
+
+	TIME_start(PROFILE_TREE_TRAVERSAL);
 	data->mat_vec_data = new struct work_item*[1];
 	data->mat_vec_data_array_size = 1048576;
 	cudaMalloc((void**)data->mat_vec_data, data->mat_vec_data_array_size*sizeof(struct work_item));
 
-	traverse_with_dynamic_arrays_dynamic_output(root_h, data->mat_vec_data, &(data->mat_vec_data_count), &(data->mat_vec_data_array_size), data->morton_d[0], data->morton_d[1], data->points_d[0], data->points_d[1], data->eta, data->max_level, data->c_leaf, data->max_elements_in_array);
+	traverse_with_dynamic_arrays_dynamic_output(root_h, data->mat_vec_data, &(data->mat_vec_data_count), &(data->mat_vec_data_array_size), data->morton_d[0], data->morton_d[1], data->points_d[0], data->points_d[1], data->eta, data->max_level, data->c_leaf, data->max_elements_in_array, level_seconds, &level_count);
+	TIME_stop(PROFILE_TREE_TRAVERSAL);
+
+	profile_add_traversal_level_seconds(data->profile, level_seconds, level_count);
+	delete [] level_seconds;
 
 //	printf("mat_vec_data_count: %d\n", mat_vec_data_count);
 //	print_work_items(*mat_vec_data, mat_vec_data_count);
@@ -206,8 +286,11 @@ void setup_h_matrix(struct h_matrix_data* data)
 //	sprintf(file_name, "mat_vec_data.txt");
 //	write_work_items(file_name, *mat_vec_data, mat_vec_data_count);
 
+	TIME_start(PROFILE_ORGANIZE);
 	organize_mat_vec_data(*(data->mat_vec_data), data->mat_vec_data_count, &(data->mat_vec_info));
+	TIME_stop(PROFILE_ORGANIZE);
 
+	TIME_start(PROFILE_BATCHING);
 	int predicted_max_batched_dense_size;
 
 	predict_precomputing_memory_requirements(*(data->mat_vec_data), &(data->mat_vec_info), &predicted_max_batched_dense_size);
@@ -217,33 +300,45 @@ void setup_h_matrix(struct h_matrix_data* data)
 	printf("WARNING: Overriding provided max_batched_dense_size by predicted value + 5 percent!!!\n");
 
 	precompute_work_sizes(&(data->dense_work_size), &(data->aca_work_size), &(data->dense_batch_count), &(data->aca_batch_count), *(data->mat_vec_data), &(data->mat_vec_info), data->max_batched_dense_size, data->max_batched_aca_size);
+	TIME_stop(PROFILE_BATCHING);
 
-
-
-	TIME_stop("tree construction and traversal");
-
+	// handle, index maps and scratch memory of the MVPs, sized for the batches found above
+	data->workspace = new struct mvp_workspace;
+	init_mvp_workspace_on_gpu(data->workspace, data->points_d[0], 0);
+	reserve_mvp_workspace_on_gpu(data->workspace, *(data->mat_vec_data), &(data->mat_vec_info), data->k, data->max_batched_dense_size, data->dense_work_size, data->aca_work_size, data->dense_batch_count, data->aca_batch_count, false, false);
+	data->workspace->profile = data->profile;
 }
 
-
-void precompute_aca(struct h_matrix_data* data)
+void precompute_aca_on_gpu(struct h_matrix_data* data)
 {
-        TIME_start; 
+	TIME_start(PROFILE_ACA);
 
 	if (data->aca_work_size[0]>0)
 		precompute_aca_for_h_matrix_mvp(*(data->mat_vec_data), &(data->mat_vec_info), data->points_d[0], data->points_d[1], data->eta, data->epsilon, data->k, &(data->U), &(data->V), data->assem);
 
-        TIME_stop("precompute_aca");
-}
+	// the precomputed low rank blocks are applied in a single batch
+	reserve_mvp_workspace_on_gpu(data->workspace, *(data->mat_vec_data), &(data->mat_vec_info), data->k, data->max_batched_dense_size, data->dense_work_size, data->aca_work_size, data->dense_batch_count, data->aca_batch_count, data->U!=0, data->dA!=0);
 
+	TIME_stop(PROFILE_ACA);
+}
 
-void precompute_dense(struct h_matrix_data* data)
+void precompute_dense_on_gpu(struct h_matrix_data* data)
 {
-	TIME_start;
+	TIME_start(PROFILE_DENSE_ASSEMBLY);
 
+	// without precomputed data, the MVP assembles the dense blocks on the fly
 	if ((data->dense_batch_count > 2) || ((data->dense_batch_count == 2) && (data->dense_work_size[1]>0)))
 	{
-		printf("Dense block does not fit into memory provided by 'max_batched_dense_size'. Therefore, precomputing the dense blocks is impossible. Exiting ...\n");
-		exit(1);
+		printf("Dense block does not fit into memory provided by 'max_batched_dense_size'. Dense blocks will be assembled on the fly.\n");
+		TIME_stop(PROFILE_DENSE_ASSEMBLY);
+		return;
+	}
+
+	if ((data->memory_budget>0) && (sizeof(double)*data->max_batched_dense_size > data->memory_budget))
+	{
+		printf("Dense blocks exceed the memory budget of %lf MB. Dense blocks will be assembled on the fly.\n", (double)data->memory_budget/(1024.0*1024.0));
+		TIME_stop(PROFILE_DENSE_ASSEMBLY);
+		return;
 	}
 
 //	size_t free_mem;
@@ -254,41 +349,48 @@ void precompute_dense(struct h_matrix_data* data)
 	
 	cudaMalloc((void**)&(data->dA), sizeof(double)*data->max_batched_dense_size);
 
-	cublasStatus_t stat;
-	cublasHandle_t handle;
-	stat = cublasCreate(&handle);
+	cublasStatus_t stat = CUBLAS_STATUS_SUCCESS;
+	cublasHandle_t handle = (cublasHandle_t)data->workspace->cublas_handle;
 
 	precompute_batched_dense_magma(*(data->mat_vec_data), data->dense_work_size[0], data->points_d[0], data->points_d[1], stat, handle,data->assem, &(data->magma_queue), data->dA);
 
-	TIME_stop("precompute_dense");	
+	reserve_mvp_workspace_on_gpu(data->workspace, *(data->mat_vec_data), &(data->mat_vec_info), data->k, data->max_batched_dense_size, data->dense_work_size, data->aca_work_size, data->dense_batch_count, data->aca_batch_count, data->U!=0, data->dA!=0);
+
+	TIME_stop(PROFILE_DENSE_ASSEMBLY);
 
 //	cudaMemGetInfo(&free_mem, &total_mem);
 //	printf("Memory free: %d / %d MB\n", (int)(free_mem/1024/1024), (int)(total_mem/1024/1024));
 
 }
 
-
-void apply_h_matrix_mvp(double* x, double* y, struct h_matrix_data* data)
+void apply_h_matrix_mvp_in_z_order_on_gpu(double* x, double* y, struct h_matrix_data* data)
 {
-	TIME_start;
-
-	reorder_vector(x, data->point_count[1], data->order[1]);	
+	TIME_start(PROFILE_MVP);
 
 	bool use_precomputed_aca = data->U==0 ? false : true;
 	bool use_precomputed_dense = data->dA==0 ? false : true;
-	
-	h_matrix_mvp(x, y, *(data->mat_vec_data), &(data->mat_vec_info), data->points_d[0], data->points_d[1], data->eta, data->epsilon, data->k, data->dA, data->U, data->V, data->assem, data->max_batched_dense_size, data->dense_batching_ratio, data->max_batched_aca_size, data->magma_queue, data->dense_work_size, data->aca_work_size, data->dense_batch_count, data->aca_batch_count, use_precomputed_aca, use_precomputed_dense);
 
-	reorder_back_vector(x, data->point_count[1], data->order[1]);
-	reorder_back_vector(y, data->point_count[0], data->order[0]);
+	h_matrix_mvp(x, y, *(data->mat_vec_data), &(data->mat_vec_info), data->points_d[0], data->points_d[1], data->eta, data->epsilon, data->k, data->dA, data->U, data->V, data->assem, data->max_batched_dense_size, data->dense_batching_ratio, data->max_batched_aca_size, data->magma_queue, data->dense_work_size, data->aca_work_size, data->dense_batch_count, data->aca_batch_count, use_precomputed_aca, use_precomputed_dense, data->workspace);
 
-        TIME_stop("apply_h_matrix_mvp");
+	TIME_stop(PROFILE_MVP);
 }
 
-void apply_h_matrix_mvp_without_batching(double* x, double* y, struct h_matrix_data* data)
+void apply_h_matrix_mvp_on_gpu(double* x, double* y, struct h_matrix_data* data)
 {
-        TIME_start;
+	TIME_start(PROFILE_VECTOR_REORDER);
+	reorder_vector(x, data->point_count[1], data->order[1]);	
+	TIME_stop(PROFILE_VECTOR_REORDER);
 
+	apply_h_matrix_mvp_in_z_order_on_gpu(x, y, data);
+
+	TIME_start(PROFILE_VECTOR_REORDER);
+	reorder_back_vector(x, data->point_count[1], data->order[1]);
+	reorder_back_vector(y, data->point_count[0], data->order[0]);
+	TIME_stop(PROFILE_VECTOR_REORDER);
+}
+
+void apply_h_matrix_mvp_without_batching_on_gpu(double* x, double* y, struct h_matrix_data* data)
+{
         reorder_vector(x, data->point_count[1], data->order[1]);
 
         // ignoring precomputed data
@@ -296,16 +398,26 @@ void apply_h_matrix_mvp_without_batching(double* x, double* y, struct h_matrix_d
 
         reorder_back_vector(x, data->point_count[1], data->order[1]);
         reorder_back_vector(y, data->point_count[0], data->order[0]);
-
-        TIME_stop("apply_h_matrix_mvp_without_batching");
 }
 
-
-
-void destroy_h_matrix_data(struct h_matrix_data* data)
+void destroy_h_matrix_data_on_gpu(struct h_matrix_data* data)
 {
 	cudaFree(*(data->mat_vec_data));
 
+	if (data->workspace!=0)
+	{
+		destroy_mvp_workspace_on_gpu(data->workspace);
+		delete data->workspace;
+		data->workspace = 0;
+	}
+
+	if (data->profile!=0)
+	{
+		destroy_h_matrix_profile(data->profile);
+		delete data->profile;
+		data->profile = 0;
+	}
+
 	for (int i=0; i<2; i++)
 	{
 		cudaFree(data->order[i]);
@@ -347,11 +459,9 @@ void destroy_h_matrix_data(struct h_matrix_data* data)
 	magma_finalize();
 }
 
-
-void apply_full_mvp(double* x, double* y, struct h_matrix_data* data)
+void apply_full_mvp_on_gpu(double* x, double* y, struct h_matrix_data* data)
 {
         // generate some necessary data structure
-	TIME_start;
         struct work_item test_mat_vec_data;
         test_mat_vec_data.set1_l = 0;
         test_mat_vec_data.set1_u = data->point_count[0] - 1;
@@ -390,7 +500,6 @@ void apply_full_mvp(double* x, double* y, struct h_matrix_data* data)
                 exit(1);
         }
 	cublasDestroy(handle);
-	TIME_stop("dense_mvp");
 
 	// recover original variable order
         reorder_back_vector(x,data->point_count[1],data->order[1]);
@@ -417,7 +526,7 @@ __global__ void gen_gaussian_kernel_rhs(double* rhs, double** points, int dim, i
         }
 }
 
-void set_gaussian_kernel_rhs(double* b, struct h_matrix_data* data)
+void set_gaussian_kernel_rhs_on_gpu(double* b, struct h_matrix_data* data)
 {
         int block_size = 1024;
         int grid_size = (data->point_count[0] + block_size -1)/block_size;
@@ -438,4 +547,103 @@ void set_gaussian_kernel_rhs(double* b, struct h_matrix_data* data)
 		
 }
 
+// vector operations of the Krylov solvers for the GPU backend
+
+struct krylov_axpy_functor
+{
+	const double alpha;
+
+	krylov_axpy_functor(double _alpha) : alpha(_alpha) {}
+
+	__host__ __device__ double operator()(const double& x, const double& y) const
+	{
+		return alpha*x + y;
+	}
+};
+
+struct krylov_scale_functor
+{
+	const double alpha;
+
+	krylov_scale_functor(double _alpha) : alpha(_alpha) {}
+
+	__host__ __device__ double operator()(const double& x) const
+	{
+		return alpha*x;
+	}
+};
+
+double krylov_dot_on_gpu(double* a, double* b, int n)
+{
+	thrust::device_ptr<double> a_ptr(a);
+	thrust::device_ptr<double> b_ptr(b);
+	return thrust::inner_product(a_ptr, a_ptr+n, b_ptr, 0.0);
+}
+
+void krylov_axpy_on_gpu(double alpha, double* x, double* y, int n)
+{
+	thrust::device_ptr<double> x_ptr(x);
+	thrust::device_ptr<double> y_ptr(y);
+	thrust::transform(x_ptr, x_ptr+n, y_ptr, y_ptr, krylov_axpy_functor(alpha));
+}
+
+void krylov_scale_on_gpu(double alpha, double* x, int n)
+{
+	thrust::device_ptr<double> x_ptr(x);
+	thrust::transform(x_ptr, x_ptr+n, x_ptr, krylov_scale_functor(alpha));
+}
+
+void krylov_copy_on_gpu(double* x, double* y, int n)
+{
+	cudaMemcpy(y, x, n*sizeof(double), cudaMemcpyDeviceToDevice);
+}
+
+double* krylov_allocate_on_gpu(int n)
+{
+	double* x;
+	cudaMalloc((void**)&x, n*sizeof(double));
+	checkCUDAError("cudaMalloc");
+	return x;
+}
+
+void krylov_release_on_gpu(double* x)
+{
+	cudaFree(x);
+}
 
+double* prepare_krylov_solve_on_gpu(double* x, double* b, struct krylov_operations* ops, struct h_matrix_data* data)
+{
+	int n = data->point_count[0];
+
+	// rows and columns have to share the Z order, i.e. both point sets have to be the same
+	thrust::device_ptr<uint64_t> order1_ptr(data->order[0]);
+	thrust::device_ptr<uint64_t> order2_ptr(data->order[1]);
+	if (!thrust::equal(order1_ptr, order1_ptr+n, order2_ptr))
+	{
+		printf("Krylov solvers require identical point sets for rows and columns. Exiting...\n");
+		exit(1);
+	}
+
+	ops->n = n;
+	ops->dot = krylov_dot_on_gpu;
+	ops->axpy = krylov_axpy_on_gpu;
+	ops->scale = krylov_scale_on_gpu;
+	ops->copy = krylov_copy_on_gpu;
+	ops->allocate = krylov_allocate_on_gpu;
+	ops->release = krylov_release_on_gpu;
+
+	double* b_z = krylov_allocate_on_gpu(n);
+	krylov_copy_on_gpu(b, b_z, n);
+	reorder_vector(x, n, data->order[0]);
+	reorder_vector(b_z, n, data->order[0]);
+
+	return b_z;
+}
+
+void finish_krylov_solve_on_gpu(double* x, double* b_z, struct h_matrix_data* data)
+{
+	int n = data->point_count[0];
+
+	reorder_back_vector(x, n, data->order[0]);
+	krylov_release_on_gpu(b_z);
+}
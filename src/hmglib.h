@@ -21,13 +21,31 @@
 
 #include "morton.h"
 #include "tree.h"
+#include "system_assembler.h"
+
+// the GPU headers are only pulled in for CUDA translation units, host code builds against libhmglib_host.so with a
+// plain C++ compiler
+#ifdef __CUDACC__
 #include "linear_algebra.h"
 #include "magma_v2.h"
 #include "magma_lapack.h"
-#include "system_assembler.h"
+#endif
+
+// MAGMA queue of the GPU backend (magma_queue_t)
+struct magma_queue;
+
+#define BACKEND_GPU 1
+#define BACKEND_HOST 2
 
 struct h_matrix_data
 {
+	// backend for setup, precomputation and MVPs, i.e. BACKEND_GPU or BACKEND_HOST
+	// (for BACKEND_HOST, all arrays below live in host memory)
+	int backend;
+
+	// number of host threads used by BACKEND_HOST (0 = OpenMP default)
+	int thread_count;
+
 	// point coordinates in dim dimensions
 	double** coords_d[2];
 
@@ -71,6 +89,9 @@ struct h_matrix_data
         struct work_item** mat_vec_data;
         int mat_vec_data_array_size;
 
+	// cluster table and block list of the block cluster tree (BACKEND_HOST; mat_vec_data is only used on the GPU)
+	struct block_list* blocks;
+
 	int k;
 
 	double epsilon;
@@ -79,6 +100,7 @@ struct h_matrix_data
 
 	int point_count[2];
 
+	// matrix entry assembler (for BACKEND_HOST, the object has to be constructed on the host)
 	struct system_assembler* assem;
 
 	int max_batched_dense_size;
@@ -90,7 +112,13 @@ struct h_matrix_data
 	double* V;
 	double* dA;
 
-	magma_queue_t magma_queue;
+	// ranks of the precomputed ACA blocks and offsets of the blocks in U, V and dA (BACKEND_HOST)
+	int* k_per_item;
+	size_t* U_offsets;
+	size_t* V_offsets;
+	size_t* dA_offsets;
+
+	struct magma_queue* magma_queue;
 
 	int* dense_work_size;
 	int* aca_work_size;
@@ -99,14 +127,90 @@ struct h_matrix_data
 
 	char root_level_set_1;
 	char root_level_set_2;
+
+	// 1 if both point sets are the same and the kernel is symmetric (BACKEND_HOST); both point sets have to be given
+	// with the same coordinates (setup_h_matrix and load_h_matrix exit otherwise), a single cluster tree is built and
+	// only the blocks on and above the diagonal are stored and compressed, every block above the diagonal is applied
+	// as A_ij*x_j and A_ij'*x_i in the same pass
+	int symmetric;
+
+	// cluster tree construction, i.e. CLUSTERING_MORTON (default), _HILBERT, _MEDIAN or _PCA (the latter three for
+	// BACKEND_HOST only); the point sets are sorted by their cluster keys, which take the place of the Morton codes
+	int clustering;
+
+	// memory budget in bytes for the precomputed blocks (0 = no limit); for BACKEND_HOST, stored_blocks marks the work
+	// items selected by the cost model of the block cache (0 without a budget), all other blocks are recomputed in
+	// every MVP; the GPU only skips precomputing the dense blocks if they exceed the budget
+	size_t memory_budget;
+	char* stored_blocks;
+
+	// blocks streamed from a scratch file by the MVPs (BACKEND_HOST, 0 unless precompute_out_of_core was called)
+	struct host_block_stream* block_stream;
+
+	// storage precision of every work item, i.e. BLOCK_PRECISION_DOUBLE, _SINGLE or _BFLOAT16 (BACKEND_HOST, 0 unless
+	// reduce_storage_precision was called, then all precomputed blocks are stored in this precision)
+	char* block_precision;
+
+	// memory mapped H matrix file the precomputed data points into (BACKEND_HOST, set by load_h_matrix)
+	void* mapped_file;
+	size_t mapped_file_size;
+
+	// H-LU / H-Cholesky factorization of the H matrix (BACKEND_HOST, 0 unless factorize_h_matrix was called)
+	struct h_factorization* factorization;
+
+	// persistent handles, scratch memory and allocation counters of the MVPs (set up by setup_h_matrix)
+	struct mvp_workspace* workspace;
+
+	// phase timings and block statistics (0 unless enable_h_matrix_profiling was called)
+	struct h_matrix_profile* profile;
 };
 
 extern void init_h_matrix_data(struct h_matrix_data* data, int point_count[2], int dim, int bits);
 
+extern void init_h_matrix_data_on_backend(struct h_matrix_data* data, int point_count[2], int dim, int bits, int backend);
+
 extern void setup_h_matrix(struct h_matrix_data* data);
 
 extern void apply_h_matrix_mvp(double* x, double* y, struct h_matrix_data* data);
 
+// records the wall time of the set up and MVP phases from now on (the GPU is synchronized between the phases); if
+// json_file_name is not 0, the profile is written to this file after each call of setup_h_matrix, the precomputation
+// and the MVPs
+extern void enable_h_matrix_profiling(struct h_matrix_data* data, char* json_file_name);
+
+// writes the phase timings and the tree traversal time per level together with block counts per level, dense / ACA
+// entries, the rank histogram, the stored bytes and the flop and byte rates of the last MVP as JSON
+extern void write_h_matrix_profile(struct h_matrix_data* data, char* file_name);
+
+// statistics of the MVP workspace: number of MVPs, allocations made during the last MVP and in total (including the
+// set up), size of the workspace in bytes; steady state MVPs are expected to make no allocations
+extern void get_mvp_workspace_statistics(long* mvp_count, long* allocations_last_mvp, long* allocations_total, size_t* size, struct h_matrix_data* data);
+
+// accumulation of the block results into y (BACKEND_HOST, after setup_h_matrix): MVP_ACCUMULATE_ATOMIC (default) or
+// MVP_ACCUMULATE_ROW_OWNED, which sums up every row of y in a fixed order without atomics, such that the MVPs are
+// bitwise reproducible for any number of threads
+extern void set_mvp_accumulation(struct h_matrix_data* data, int accumulation);
+
+// order in which the blocks are handed out to the threads (BACKEND_HOST, after setup_h_matrix):
+// MVP_SCHEDULE_WORK_ITEM_ORDER (default) or MVP_SCHEDULE_COST_ORDERED, which hands out the blocks by decreasing cost
+// as estimated by host_block_mvp_cost; the resulting load balance is reported in the profile
+extern void set_mvp_scheduling(struct h_matrix_data* data, int scheduling);
+
+// strategy for the cluster trees (before setup_h_matrix, see CLUSTERING_* in morton.h): the space-filling curves split
+// clusters at their cells, the bisections split every cluster into two halves with the same number of points, which
+// keeps the trees balanced for clustered or anisotropic point sets; compare the strategies by their block statistics
+// (write_h_matrix_profile)
+extern void set_h_matrix_clustering(struct h_matrix_data* data, int clustering);
+
+// y = H*x with x and y already in the internal Z order of the point sets (no permutations)
+extern void apply_h_matrix_mvp_in_z_order(double* x, double* y, struct h_matrix_data* data);
+
+// Y = H*X for nrhs right hand sides, i.e. column-major X (point_count[1] x nrhs) and Y (point_count[0] x nrhs)
+extern void apply_h_matrix_mmp(double* X, double* Y, int nrhs, struct h_matrix_data* data);
+
+// y = H'*x with the blocks of H (BACKEND_HOST), i.e. x has point_count[0] and y point_count[1] entries
+extern void apply_h_matrix_mvp_transpose(double* x, double* y, struct h_matrix_data* data);
+
 extern void apply_h_matrix_mvp_without_batching(double* x, double* y, struct h_matrix_data* data);
 
 extern void destroy_h_matrix_data(struct h_matrix_data* data);
@@ -115,9 +219,69 @@ extern void precompute_aca(struct h_matrix_data* data);
 
 extern void precompute_dense(struct h_matrix_data* data);
 
+// sets the memory budget for precomputed blocks (0 = no limit); the blocks with the highest assembly cost per byte are
+// stored by the next precomputation, and already precomputed data is rebuilt for the new budget right away (blocks
+// that stay selected are kept), i.e. the budget may be changed at any time (BACKEND_HOST, not for mapped H matrices)
+extern void set_h_matrix_memory_budget(struct h_matrix_data* data, size_t memory_budget);
+
+// out-of-core mode (BACKEND_HOST): assembles / compresses all blocks into the scratch file scratch_file_name instead of
+// memory; from then on, the MVPs stream the blocks back in chunks of at most chunk_size bytes, reading the next chunk
+// while the current one is applied; after reduce_storage_precision, the blocks are written in the precisions selected
+// there; the scratch file is removed by destroy_h_matrix_data
+extern void precompute_out_of_core(struct h_matrix_data* data, char* scratch_file_name, size_t chunk_size);
+
+// replaces the kernel of a set up H matrix by assem (BACKEND_HOST): the Z order of the points is kept and the block
+// cluster tree is only traversed again if eta differs from the current one; the precomputed dense blocks and ACA
+// factors (and the scratch file of the out-of-core mode) are rebuilt for the new kernel, with warm_start every ACA
+// block starts at the pivot row of the largest entry in the first column of its previous factors (same tree only);
+// the memory budget applies again, reduced storage precision and recompression have to be redone if desired
+extern void set_h_matrix_kernel(struct h_matrix_data* data, struct system_assembler* assem, double eta, bool warm_start);
+
+// truncates the precomputed ACA blocks to the smallest ranks meeting epsilon by QR+SVD recompression (BACKEND_HOST)
+extern void recompress_aca(struct h_matrix_data* data);
+
+// stores every precomputed block in the lowest allowed precision (dense_precision for dense blocks, BLOCK_PRECISION_
+// DOUBLE or _SINGLE, factor_precision for ACA factors, any BLOCK_PRECISION_*) whose rounding error keeps the stored H
+// matrix within tolerance*||H||_F of the double one (blocks are only reduced for tolerances well above the unit
+// roundoff of single precision, 6e-8); the MVPs still sum up in double (BACKEND_HOST, after precomputation, block
+// cache and recompression, which cannot be applied afterwards; a second call and mapped H matrices keep the blocks)
+extern void reduce_storage_precision(struct h_matrix_data* data, double tolerance, int dense_precision, int factor_precision);
+
 extern void apply_full_mvp(double* x, double* y, struct h_matrix_data* data);
 
 extern void set_gaussian_kernel_rhs(double* b, struct h_matrix_data* data);
 
+// Krylov solvers for H*x=b (identical point sets for rows and columns); x holds the initial guess on entry and the
+// solution on exit, x and a copy of b are permuted into Z order once (b is left unchanged) and all iterations stay in
+// Z order; restart has to be at least 1; the solvers stop at
+// ||b-H*x||<=tolerance*||b|| or after max_iterations iterations and return the number of iterations; after
+// factorize_h_matrix, the factorization is used as preconditioner (by CG only if it is an H-Cholesky factorization)
+extern int solve_with_cg(double* x, double* b, double tolerance, int max_iterations, double* relative_residual, struct h_matrix_data* data);
+
+extern int solve_with_gmres(double* x, double* b, int restart, double tolerance, int max_iterations, double* relative_residual, struct h_matrix_data* data);
+
+// approximate factorization of the set up H matrix (BACKEND_HOST, identical point sets for rows and columns) by
+// H-arithmetic on its block cluster tree, i.e. H_FACTORIZATION_LU or H_FACTORIZATION_CHOLESKY (for symmetric positive
+// definite kernels) from host_factorization.h, where every low rank block is truncated to the relative accuracy
+// epsilon after each update; precomputed blocks in double are taken over, all others are assembled / compressed again;
+// a coarse epsilon (e.g. 1e-2) gives a cheap preconditioner for solve_with_gmres (solve_with_cg only takes
+// H_FACTORIZATION_CHOLESKY), a fine one a direct solver (solve_with_h_factorization); set_h_matrix_kernel drops the
+// factorization; returns H_FACTORIZATION_SUCCESS, or H_FACTORIZATION_ZERO_PIVOT / _NOT_POSITIVE_DEFINITE if the
+// factorization broke down (no factorization is kept then), e.g. to retry with H_FACTORIZATION_LU or a smaller epsilon,
+// or H_FACTORIZATION_INVALID_PARTITION if the block partition does not fit the factorization
+extern int factorize_h_matrix(struct h_matrix_data* data, int factorization, double epsilon);
+
+// x = H^-1*b by forward and backward substitution with the factorization (after factorize_h_matrix)
+extern void solve_with_h_factorization(double* x, double* b, struct h_matrix_data* data);
+
+// writes the set up (and possibly precomputed) H matrix to file_name (BACKEND_HOST only)
+extern void save_h_matrix(struct h_matrix_data* data, char* file_name);
+
+// replaces setup_h_matrix and the precomputation by mapping an H matrix file written by save_h_matrix; data has to
+// be initialized with the same point sets (in their original order) and data->assem with the same kernel that were
+// used to create the file, both are checked against the file; the mapped blocks are read-only, i.e. the precomputation,
+// the memory budget and recompress_aca keep them
+extern void load_h_matrix(struct h_matrix_data* data, char* file_name);
+
 
 #endif
@@ -0,0 +1,58 @@
+// Copyright (C) 2016 Peter Zaspel
+//
+// This file is part of hmglib.
+//
+// hmglib is free software: you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// hmglib is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hmglib.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HMGLIB_GPU_H
+#define HMGLIB_GPU_H
+
+// GPU backend of the API in hmglib.h; the API (hmglib_host.cpp) hands every call with data->backend==BACKEND_GPU
+// to these functions, which are implemented in hmglib.cu for libhmglib.so and by stubs that exit in hmglib_no_gpu.cpp
+// for the host-only libhmglib_host.so
+
+#include "hmglib.h"
+#include "krylov.h"
+
+extern void init_h_matrix_data_on_gpu(struct h_matrix_data* data, int point_count[2], int dim, int bits);
+
+extern void setup_h_matrix_on_gpu(struct h_matrix_data* data);
+
+// host block list built from host copies of the work items (for the block statistics of the profile)
+extern void get_block_list_on_gpu(struct block_list* blocks, struct h_matrix_data* data);
+
+extern void precompute_aca_on_gpu(struct h_matrix_data* data);
+
+extern void precompute_dense_on_gpu(struct h_matrix_data* data);
+
+extern void apply_h_matrix_mvp_in_z_order_on_gpu(double* x, double* y, struct h_matrix_data* data);
+
+extern void apply_h_matrix_mvp_on_gpu(double* x, double* y, struct h_matrix_data* data);
+
+extern void apply_h_matrix_mvp_without_batching_on_gpu(double* x, double* y, struct h_matrix_data* data);
+
+extern void destroy_h_matrix_data_on_gpu(struct h_matrix_data* data);
+
+extern void apply_full_mvp_on_gpu(double* x, double* y, struct h_matrix_data* data);
+
+extern void set_gaussian_kernel_rhs_on_gpu(double* b, struct h_matrix_data* data);
+
+// sets up the vector operations on the device, permutes x into Z order and returns a device copy of b in Z order
+// (same point sets only)
+extern double* prepare_krylov_solve_on_gpu(double* x, double* b, struct krylov_operations* ops, struct h_matrix_data* data);
+
+// permutes x back into the original order and frees the copy b_z of prepare_krylov_solve_on_gpu
+extern void finish_krylov_solve_on_gpu(double* x, double* b_z, struct h_matrix_data* data);
+
+#endif
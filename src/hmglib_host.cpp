@@ -0,0 +1,1350 @@
+// Copyright (C) 2016 Peter Zaspel
+//
+// This file is part of hmglib.
+//
+// hmglib is free software: you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// hmglib is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hmglib.  If not, see <http://www.gnu.org/licenses/>.
+
+// API of hmglib.h and its host backend; calls for BACKEND_GPU are handed to the GPU backend (hmglib_gpu.h), such that
+// this file does not depend on CUDA and builds the host-only libhmglib_host.so together with hmglib_no_gpu.cpp
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "morton.h"
+#include "tree.h"
+#include "host_morton.h"
+#include "host_helper.h"
+#include "host_tree.h"
+#include "host_linear_algebra.h"
+#include "host_io.h"
+#include "host_factorization.h"
+#include "krylov.h"
+#include "profiling.h"
+
+#include "hmglib.h"
+#include "hmglib_gpu.h"
+
+// the wall time of a phase is recorded in data->profile if profiling is enabled (see enable_h_matrix_profiling); the
+// phases of the GPU backend are timed in hmglib.cu
+#define TIME_start(phase) { if (data->profile!=0) profile_phase_begin(data->profile, phase); }
+#define TIME_stop(phase) { if (data->profile!=0) profile_phase_end(data->profile, phase); }
+
+// passes of set_h_matrix_memory_budget that give the budget left by overestimated ranks to further blocks
+#define BLOCK_CACHE_MAX_PASSES 4
+
+void init_h_matrix_data_on_host(struct h_matrix_data* data, int point_count[2], int dim, int bits)
+{
+	for (int i=0; i<2; i++)
+	{
+		// copying point_count
+		data->point_count[i] = point_count[i];
+
+		// allocating memory for point_count coordinates in dim dimensions
+		data->coords_d[i] = new double*[dim];
+		for (int d = 0; d < dim; d++)
+			data->coords_d[i][d] = new double[point_count[i]];
+
+		// allocating memory for point ids
+		data->point_ids_d[i] = new unsigned int[point_count[i]];
+		for (int p = 0; p < point_count[i]; p++)
+			data->point_ids_d[i][p] = p;
+
+		// allocating memory for extremal values per dimension
+		data->max_per_dim_d[i] = new double[dim];
+		data->min_per_dim_d[i] = new double[dim];
+
+		// on the host, the dimension-wise access is the coordinate array itself
+		data->coords_device[i] = data->coords_d[i];
+
+		// allocationg memory for morton codes
+		data->code_d[i] = new uint64_t[point_count[i]];
+
+		// setting up data strcture for point set
+		data->points_d[i] = new struct point_set;
+		data->points_d[i]->dim = dim;
+		data->points_d[i]->size = point_count[i];
+		data->points_d[i]->coords = data->coords_device[i];
+		data->points_d[i]->max_per_dim = data->max_per_dim_d[i];
+		data->points_d[i]->min_per_dim = data->min_per_dim_d[i];
+		data->points_d[i]->point_ids = data->point_ids_d[i];
+
+		// setting up data structure for morton code
+		data->morton_d[i] = new struct morton_code;
+		data->morton_d[i]->code = data->code_d[i];
+		data->morton_d[i]->dim = dim;
+		data->morton_d[i]->bits = bits;
+		data->morton_d[i]->size = point_count[i];
+		data->morton_d[i]->max_values = 0;
+		data->morton_d[i]->min_values = 0;
+	}
+}
+
+void init_h_matrix_data(struct h_matrix_data* data, int point_count[2], int dim, int bits)
+{
+	init_h_matrix_data_on_backend(data, point_count, dim, bits, BACKEND_GPU);
+}
+
+void init_h_matrix_data_on_backend(struct h_matrix_data* data, int point_count[2], int dim, int bits, int backend)
+{
+	data->backend = backend;
+	data->thread_count = 0;
+
+	data->dim = dim;
+	data->bits = bits;
+
+	// initialize fields for precomputation
+	data->U = 0;
+	data->V = 0;	
+	data->dA = 0;
+	data->k_per_item = 0;
+	data->U_offsets = 0;
+	data->V_offsets = 0;
+	data->dA_offsets = 0;
+	data->block_precision = 0;
+
+	data->symmetric = 0;
+
+	data->clustering = CLUSTERING_MORTON;
+
+	data->memory_budget = 0;
+	data->stored_blocks = 0;
+	data->block_stream = 0;
+
+	data->mapped_file = 0;
+	data->mapped_file_size = 0;
+
+	data->workspace = 0;
+
+	data->factorization = 0;
+
+	data->mat_vec_data = 0;
+	data->blocks = 0;
+	data->profile = 0;
+
+	if (backend==BACKEND_HOST)
+	{
+		init_h_matrix_data_on_host(data, point_count, dim, bits);
+		return;
+	}
+
+	init_h_matrix_data_on_gpu(data, point_count, dim, bits);
+}
+
+void enable_h_matrix_profiling(struct h_matrix_data* data, char* json_file_name)
+{
+	if (data->profile==0)
+		data->profile = new struct h_matrix_profile;
+	else
+		destroy_h_matrix_profile(data->profile);
+
+	init_h_matrix_profile(data->profile, json_file_name);
+
+	if (data->workspace!=0)
+		data->workspace->profile = data->profile;
+}
+
+void write_h_matrix_profile(struct h_matrix_data* data, char* file_name)
+{
+	if (data->profile==0)
+	{
+		printf("write_h_matrix_profile requires enable_h_matrix_profiling. Exiting...\n");
+		exit(1);
+	}
+
+	// the block statistics are computed on the host block list, for the GPU on one built from host copies of the work
+	// items
+	if (data->backend==BACKEND_HOST)
+	{
+		if (data->blocks!=0)
+			profile_block_statistics(data->profile, data->blocks, &(data->mat_vec_info), data->k_per_item, data->dA_offsets, data->block_precision, 0, data->k, data->dA!=0, data->U!=0);
+	}
+	else if (data->mat_vec_data!=0)
+	{
+		struct block_list blocks_h;
+		get_block_list_on_gpu(&blocks_h, data);
+
+		// the GPU stores the ACA factors of all blocks with the common rank k
+		profile_block_statistics(data->profile, &blocks_h, &(data->mat_vec_info), 0, 0, 0, (data->U!=0) ? data->k : 0, data->k, data->dA!=0, data->U!=0);
+		host_destroy_block_list(&blocks_h);
+	}
+
+	FILE* f = fopen(file_name, "w");
+	if (f==0)
+	{
+		printf("Could not open %s for writing the profile. Exiting...\n", file_name);
+		exit(1);
+	}
+	write_h_matrix_profile_json(f, data->profile, (data->backend==BACKEND_HOST) ? "host" : "gpu");
+	fclose(f);
+}
+
+// writes the profile after a profiled call, if a JSON file was given to enable_h_matrix_profiling
+static void export_h_matrix_profile(struct h_matrix_data* data)
+{
+	if ((data->profile==0) || (data->profile->json_file_name==0))
+		return;
+
+	write_h_matrix_profile(data, data->profile->json_file_name);
+}
+
+// symmetric mode is only valid for two identical point sets (in the given order), since set 2 is replaced by set 1
+static void check_symmetric_point_sets_on_host(struct h_matrix_data* data)
+{
+	if ((data->point_count[0]!=data->point_count[1]) || (data->root_level_set_1!=data->root_level_set_2))
+	{
+		printf("Symmetric mode needs two point sets of the same size on the same root level. Exiting...\n");
+		exit(1);
+	}
+
+	for (int d=0; d<data->dim; d++)
+		if (memcmp(data->coords_d[0][d], data->coords_d[1][d], data->point_count[0]*sizeof(double))!=0)
+		{
+			printf("Symmetric mode needs the same coordinates in point set 1 and point set 2. Exiting...\n");
+			exit(1);
+		}
+}
+
+// in symmetric mode, point set 2 is a copy of the Z order sorted point set 1
+static void copy_first_point_set_on_host(struct h_matrix_data* data)
+{
+	int point_count = data->point_count[0];
+
+	for (int d=0; d<data->dim; d++)
+		memcpy(data->coords_d[1][d], data->coords_d[0][d], point_count*sizeof(double));
+	memcpy(data->point_ids_d[1], data->point_ids_d[0], point_count*sizeof(unsigned int));
+	memcpy(data->max_per_dim_d[1], data->max_per_dim_d[0], data->dim*sizeof(double));
+	memcpy(data->min_per_dim_d[1], data->min_per_dim_d[0], data->dim*sizeof(double));
+}
+
+// block cluster tree of the Z order sorted point sets for the current eta, organized into one batch per work type
+static void build_block_cluster_tree_on_host(struct h_matrix_data* data)
+{
+	struct work_item root_h;
+	memset(&root_h, 0, sizeof(struct work_item));
+	root_h.set1_l = 0;
+	root_h.set1_u = data->point_count[0] - 1;
+	root_h.set2_l = 0;
+	root_h.set2_u = data->point_count[1] - 1;
+	root_h.level_1 = data->root_level_set_1;
+	root_h.level_2 = data->root_level_set_2;
+
+	data->max_elements_in_array = -1;
+	data->max_elements_in_mat_vec_data_array = -1;
+
+	double* level_seconds = new double[data->max_level];
+	int level_count;
+
+	TIME_start(PROFILE_TREE_TRAVERSAL);
+	data->blocks = new struct block_list;
+	host_traverse(root_h, data->blocks, data->morton_d[0], data->morton_d[1], data->points_d[0], data->points_d[1], data->eta, data->max_level, data->c_leaf, data->symmetric!=0, level_seconds, &level_count);
+	TIME_stop(PROFILE_TREE_TRAVERSAL);
+
+	profile_add_traversal_level_seconds(data->profile, level_seconds, level_count);
+	delete [] level_seconds;
+
+	TIME_start(PROFILE_ORGANIZE);
+	host_organize_mat_vec_data(data->blocks, &(data->mat_vec_info));
+	data->mat_vec_data_count = data->blocks->count;
+	data->mat_vec_data_array_size = data->blocks->count;
+	data->mat_vec_info.symmetric = data->symmetric ? 1 : 0;
+	TIME_stop(PROFILE_ORGANIZE);
+
+	// the host backend works on the full work item list, i.e. on a single batch per work type
+	data->dense_batch_count = 1;
+	data->aca_batch_count = 1;
+	data->dense_work_size = new int[1];
+	data->aca_work_size = new int[1];
+	data->dense_work_size[0] = data->mat_vec_info.dense_count;
+	data->aca_work_size[0] = data->mat_vec_info.aca_count;
+}
+
+void setup_h_matrix_on_host(struct h_matrix_data* data)
+{
+	host_set_thread_count(data->thread_count);
+
+	if (data->symmetric)
+		check_symmetric_point_sets_on_host(data);
+
+	// in symmetric mode, only point set 1 is sorted and set 2 is copied from it
+	int set_count = data->symmetric ? 1 : 2;
+
+	for (int i=0; i<set_count; i++)
+	{
+		// compute extremal values for the point set
+		TIME_start(PROFILE_MINMAX);
+		host_compute_minmax(data->points_d[i]);
+		TIME_stop(PROFILE_MINMAX);
+
+		// generate morton codes
+		TIME_start(PROFILE_MORTON_ENCODING);
+		host_get_cluster_keys(data->points_d[i], data->morton_d[i], data->clustering);
+		TIME_stop(PROFILE_MORTON_ENCODING);
+
+		// find ordering of points following the cluster keys
+		TIME_start(PROFILE_SORT);
+		data->order[i] = new uint64_t[data->point_count[i]];
+		host_get_morton_ordering(data->points_d[i], data->morton_d[i], data->order[i]);
+		TIME_stop(PROFILE_SORT);
+
+		// reorder points following the morton code order
+		TIME_start(PROFILE_POINT_REORDER);
+		host_reorder_point_set(data->points_d[i], data->order[i]);
+		TIME_stop(PROFILE_POINT_REORDER);
+	}
+
+	if (data->symmetric)
+	{
+		TIME_start(PROFILE_POINT_REORDER);
+		copy_first_point_set_on_host(data);
+		memcpy(data->code_d[1], data->code_d[0], data->point_count[0]*sizeof(uint64_t));
+		data->order[1] = new uint64_t[data->point_count[1]];
+		memcpy(data->order[1], data->order[0], data->point_count[0]*sizeof(uint64_t));
+		TIME_stop(PROFILE_POINT_REORDER);
+	}
+
+	build_block_cluster_tree_on_host(data);
+
+	// scratch memory of the MVPs
+	data->workspace = new struct mvp_workspace;
+	init_mvp_workspace(data->workspace, host_get_thread_count());
+	host_reserve_mvp_workspace(data->workspace, data->blocks, &(data->mat_vec_info), data->k, 1);
+	data->workspace->profile = data->profile;
+}
+
+void setup_h_matrix(struct h_matrix_data* data)
+{
+	if (data->backend==BACKEND_HOST)
+	{
+		setup_h_matrix_on_host(data);
+		export_h_matrix_profile(data);
+		return;
+	}
+
+	setup_h_matrix_on_gpu(data);
+	export_h_matrix_profile(data);
+}
+
+
+// the block costs of the MVP schedule depend on which blocks are stored and on their ranks
+static void invalidate_block_costs(struct h_matrix_data* data)
+{
+	if (data->workspace!=0)
+		invalidate_mvp_block_costs(data->workspace);
+}
+
+// selects the blocks to store within the memory budget; ranks of ACA blocks that were not compressed yet are estimated
+static void select_stored_blocks(struct h_matrix_data* data)
+{
+	if (data->stored_blocks==0)
+		data->stored_blocks = new char[data->mat_vec_info.total_count];
+
+	size_t selected_size = host_select_stored_blocks(data->stored_blocks, data->blocks, &(data->mat_vec_info), data->k, data->k_per_item, data->memory_budget);
+
+	int stored_count = 0;
+	for (int i=0; i<data->mat_vec_info.total_count; i++)
+		stored_count += data->stored_blocks[i];
+	printf("Block cache: storing %d of %d blocks (%lf MB of %lf MB budget), the other blocks are recomputed in every MVP\n", stored_count, data->mat_vec_info.total_count, (double)selected_size/(1024.0*1024.0), (double)data->memory_budget/(1024.0*1024.0));
+}
+
+void set_h_matrix_memory_budget(struct h_matrix_data* data, size_t memory_budget)
+{
+	data->memory_budget = memory_budget;
+
+	// the GPU checks the budget when precomputing the dense blocks
+	if (data->backend!=BACKEND_HOST)
+		return;
+
+	if (data->mapped_file!=0)
+	{
+		printf("set_h_matrix_memory_budget is not supported for mapped H matrices, keeping the stored blocks.\n");
+		return;
+	}
+
+	if (data->block_precision!=0)
+	{
+		printf("set_h_matrix_memory_budget is not supported after reduce_storage_precision, keeping the stored blocks.\n");
+		return;
+	}
+
+	delete [] data->stored_blocks;
+	data->stored_blocks = 0;
+
+	// without precomputed data, the blocks are selected by the next precomputation
+	if ((data->blocks==0) || ((data->dA==0) && (data->U==0)))
+		return;
+
+	// the selection overestimates the ranks of ACA blocks that were not compressed yet, the budget left by their actual
+	// ranks is filled in further passes until the selection does not change any more
+	char* previous_stored_blocks = new char[data->mat_vec_info.total_count];
+	for (int pass=0; pass<BLOCK_CACHE_MAX_PASSES; pass++)
+	{
+		if (memory_budget>0)
+		{
+			if (data->stored_blocks!=0)
+				memcpy(previous_stored_blocks, data->stored_blocks, data->mat_vec_info.total_count*sizeof(char));
+			select_stored_blocks(data);
+			if ((pass>0) && (memcmp(previous_stored_blocks, data->stored_blocks, data->mat_vec_info.total_count*sizeof(char))==0))
+				break;
+		}
+
+		if (data->dA!=0)
+		{
+			TIME_start(PROFILE_DENSE_ASSEMBLY);
+			host_store_dense_blocks(data->blocks, &(data->mat_vec_info), data->points_d[0], data->points_d[1], data->assem, data->stored_blocks, &(data->dA), &(data->dA_offsets));
+			TIME_stop(PROFILE_DENSE_ASSEMBLY);
+		}
+
+		if (data->U!=0)
+		{
+			TIME_start(PROFILE_ACA);
+			host_store_aca_blocks(data->blocks, &(data->mat_vec_info), data->points_d[0], data->points_d[1], data->eta, data->epsilon, data->k, data->assem, data->stored_blocks, 0, &(data->U), &(data->V), &(data->U_offsets), &(data->V_offsets), &(data->k_per_item));
+			TIME_stop(PROFILE_ACA);
+		}
+
+		if (memory_budget==0)
+			break;
+	}
+	delete [] previous_stored_blocks;
+	invalidate_block_costs(data);
+
+	export_h_matrix_profile(data);
+}
+
+// ACA block a starts at the pivot row first_rows[a] (chosen by the ACA+ references for first_rows==0)
+static void precompute_aca_on_host(struct h_matrix_data* data, int* first_rows)
+{
+	// the factors of a mapped H matrix live in the read-only mapping
+	if (data->mapped_file!=0)
+	{
+		printf("precompute_aca is not supported for mapped H matrices, keeping the mapped blocks.\n");
+		return;
+	}
+
+	if (data->block_precision!=0)
+	{
+		printf("precompute_aca is not supported after reduce_storage_precision. Exiting...\n");
+		exit(1);
+	}
+
+	TIME_start(PROFILE_ACA);
+
+	if ((data->memory_budget>0) && (data->stored_blocks==0))
+		select_stored_blocks(data);
+
+	host_store_aca_blocks(data->blocks, &(data->mat_vec_info), data->points_d[0], data->points_d[1], data->eta, data->epsilon, data->k, data->assem, data->stored_blocks, first_rows, &(data->U), &(data->V), &(data->U_offsets), &(data->V_offsets), &(data->k_per_item));
+	TIME_stop(PROFILE_ACA);
+	invalidate_block_costs(data);
+
+	// every ACA iteration adds one rank, the ranks are known before any recompression only
+	if (data->profile!=0)
+	{
+		data->profile->aca_iterations = 0;
+		for (int a=0; a<data->mat_vec_info.aca_count; a++)
+			if (data->k_per_item[a]!=HOST_RANK_NOT_STORED)
+				data->profile->aca_iterations += data->k_per_item[a];
+	}
+
+	// with the actual ranks known, the budget left by the rank estimates is given to further blocks
+	if (data->memory_budget>0)
+		set_h_matrix_memory_budget(data, data->memory_budget);
+
+	export_h_matrix_profile(data);
+}
+
+void precompute_aca(struct h_matrix_data* data)
+{
+	if (data->backend==BACKEND_HOST)
+	{
+		precompute_aca_on_host(data, 0);
+		return;
+	}
+
+	precompute_aca_on_gpu(data);
+
+	export_h_matrix_profile(data);
+}
+
+
+void recompress_aca(struct h_matrix_data* data)
+{
+	// the GPU stores the ACA factors of all blocks interleaved with a common rank, which leaves nothing to repack
+	if (data->backend!=BACKEND_HOST)
+	{
+		printf("recompress_aca is only supported for BACKEND_HOST, skipping recompression.\n");
+		return;
+	}
+
+	if (data->U==0)
+		return;
+
+	// the factors of a mapped H matrix live in the read-only mapping
+	if (data->mapped_file!=0)
+	{
+		printf("recompress_aca is not supported for mapped H matrices, skipping recompression.\n");
+		return;
+	}
+
+	if (data->block_precision!=0)
+	{
+		printf("recompress_aca is not supported after reduce_storage_precision, skipping recompression.\n");
+		return;
+	}
+
+	TIME_start(PROFILE_RECOMPRESSION);
+	host_recompress_aca(data->blocks, &(data->mat_vec_info), data->epsilon, &(data->U), &(data->V), &(data->U_offsets), &(data->V_offsets), data->k_per_item);
+	TIME_stop(PROFILE_RECOMPRESSION);
+	invalidate_block_costs(data);
+
+	export_h_matrix_profile(data);
+}
+
+void reduce_storage_precision(struct h_matrix_data* data, double tolerance, int dense_precision, int factor_precision)
+{
+	if (data->backend!=BACKEND_HOST)
+	{
+		printf("reduce_storage_precision is only supported for BACKEND_HOST, keeping the blocks in double precision.\n");
+		return;
+	}
+
+	// the blocks of a mapped H matrix live in the read-only mapping
+	if (data->mapped_file!=0)
+	{
+		printf("reduce_storage_precision is not supported for mapped H matrices, keeping the mapped blocks.\n");
+		return;
+	}
+
+	if (data->block_precision!=0)
+	{
+		printf("reduce_storage_precision was already called, keeping the reduced precision blocks.\n");
+		return;
+	}
+
+	host_reduce_storage_precision(data->blocks, &(data->mat_vec_info), tolerance, dense_precision, factor_precision, &(data->dA), &(data->dA_offsets), &(data->U), &(data->V), &(data->U_offsets), &(data->V_offsets), data->k_per_item, &(data->block_precision));
+	invalidate_block_costs(data);
+
+	export_h_matrix_profile(data);
+}
+
+void precompute_dense(struct h_matrix_data* data)
+{
+	if (data->backend==BACKEND_GPU)
+	{
+		precompute_dense_on_gpu(data);
+		export_h_matrix_profile(data);
+		return;
+	}
+
+	// the blocks of a mapped H matrix live in the read-only mapping
+	if (data->mapped_file!=0)
+	{
+		printf("precompute_dense is not supported for mapped H matrices, keeping the mapped blocks.\n");
+		return;
+	}
+
+	if (data->block_precision!=0)
+	{
+		printf("precompute_dense is not supported after reduce_storage_precision. Exiting...\n");
+		exit(1);
+	}
+
+	TIME_start(PROFILE_DENSE_ASSEMBLY);
+
+	if ((data->memory_budget>0) && (data->stored_blocks==0))
+		select_stored_blocks(data);
+
+	host_store_dense_blocks(data->blocks, &(data->mat_vec_info), data->points_d[0], data->points_d[1], data->assem, data->stored_blocks, &(data->dA), &(data->dA_offsets));
+	TIME_stop(PROFILE_DENSE_ASSEMBLY);
+	invalidate_block_costs(data);
+
+	export_h_matrix_profile(data);
+}
+
+
+void precompute_out_of_core(struct h_matrix_data* data, char* scratch_file_name, size_t chunk_size)
+{
+	if (data->backend!=BACKEND_HOST)
+	{
+		printf("precompute_out_of_core is only supported for BACKEND_HOST. Exiting...\n");
+		exit(1);
+	}
+
+	if (data->block_stream!=0)
+		host_destroy_block_stream(data->block_stream);
+	else
+		data->block_stream = new struct host_block_stream;
+
+	// dense blocks and ACA factors are produced in one sweep over the block list
+	TIME_start(PROFILE_ACA);
+	host_write_block_stream(data->block_stream, scratch_file_name, chunk_size, data->blocks, &(data->mat_vec_info), data->points_d[0], data->points_d[1], data->eta, data->epsilon, data->k, data->assem, data->block_precision);
+	TIME_stop(PROFILE_ACA);
+
+	export_h_matrix_profile(data);
+}
+
+void set_h_matrix_kernel(struct h_matrix_data* data, struct system_assembler* assem, double eta, bool warm_start)
+{
+	if (data->backend!=BACKEND_HOST)
+	{
+		printf("set_h_matrix_kernel is only supported for BACKEND_HOST. Exiting...\n");
+		exit(1);
+	}
+
+	if ((data->blocks==0) || (data->mapped_file!=0))
+	{
+		printf("set_h_matrix_kernel requires an H matrix set up by setup_h_matrix. Exiting...\n");
+		exit(1);
+	}
+
+	int aca_count = data->mat_vec_info.aca_count;
+	bool dense_is_precomputed = (data->dA!=0);
+	bool aca_is_precomputed = (data->U!=0);
+
+	// the Z order of the points is kept, the block cluster tree only depends on eta
+	bool tree_changes = (eta!=data->eta);
+
+	// the pivots of the previous factors are only meaningful for the same blocks
+	int* first_rows = 0;
+	if (warm_start && aca_is_precomputed && (!tree_changes))
+	{
+		first_rows = new int[aca_count];
+		host_get_aca_first_rows(first_rows, data->blocks, &(data->mat_vec_info), data->U, data->U_offsets, data->k_per_item, data->block_precision);
+	}
+
+	// the numerical data of the previous kernel is rebuilt from scratch, the blocks to store are selected again
+	delete [] data->U; data->U = 0;
+	delete [] data->V; data->V = 0;
+	delete [] data->dA; data->dA = 0;
+	delete [] data->k_per_item; data->k_per_item = 0;
+	delete [] data->U_offsets; data->U_offsets = 0;
+	delete [] data->V_offsets; data->V_offsets = 0;
+	delete [] data->dA_offsets; data->dA_offsets = 0;
+	delete [] data->block_precision; data->block_precision = 0;
+	delete [] data->stored_blocks; data->stored_blocks = 0;
+
+	// the factorization belongs to the previous kernel
+	if (data->factorization!=0)
+	{
+		host_destroy_h_factorization(data->factorization);
+		delete data->factorization;
+		data->factorization = 0;
+	}
+
+	data->assem = assem;
+
+	if (tree_changes)
+	{
+		data->eta = eta;
+		host_destroy_block_list(data->blocks);
+		delete data->blocks;
+		delete [] data->dense_work_size;
+		delete [] data->aca_work_size;
+		build_block_cluster_tree_on_host(data);
+
+		// the row schedules of the workspace refer to the previous work items
+		int accumulation = data->workspace->accumulation;
+		int scheduling = data->workspace->scheduling;
+		destroy_mvp_workspace(data->workspace);
+		init_mvp_workspace(data->workspace, host_get_thread_count());
+		data->workspace->accumulation = accumulation;
+		data->workspace->scheduling = scheduling;
+		data->workspace->profile = data->profile;
+		host_reserve_mvp_workspace(data->workspace, data->blocks, &(data->mat_vec_info), data->k, 1);
+	}
+
+	if (dense_is_precomputed)
+		precompute_dense(data);
+	if (aca_is_precomputed)
+		precompute_aca_on_host(data, first_rows);
+	delete [] first_rows;
+
+	// the scratch file is written again under the same name
+	if (data->block_stream!=0)
+	{
+		char* scratch_file_name = new char[strlen(data->block_stream->file_name)+1];
+		strcpy(scratch_file_name, data->block_stream->file_name);
+		precompute_out_of_core(data, scratch_file_name, data->block_stream->chunk_size);
+		delete [] scratch_file_name;
+	}
+
+	export_h_matrix_profile(data);
+}
+
+void apply_h_matrix_mvp_in_z_order(double* x, double* y, struct h_matrix_data* data)
+{
+	if (data->backend==BACKEND_GPU)
+	{
+		apply_h_matrix_mvp_in_z_order_on_gpu(x, y, data);
+		return;
+	}
+
+	TIME_start(PROFILE_MVP);
+	if (data->block_stream!=0)
+		host_stream_h_matrix_mmp(x, y, 1, false, data->block_stream, data->blocks, &(data->mat_vec_info), data->points_d[0], data->points_d[1], data->workspace);
+	else
+		host_h_matrix_mvp(x, y, data->blocks, &(data->mat_vec_info), data->points_d[0], data->points_d[1], data->eta, data->epsilon, data->k, data->assem, data->dA, data->dA_offsets, data->U, data->V, data->U_offsets, data->V_offsets, data->k_per_item, data->block_precision, data->workspace);
+	TIME_stop(PROFILE_MVP);
+}
+
+void apply_h_matrix_mvp(double* x, double* y, struct h_matrix_data* data)
+{
+	if (data->backend==BACKEND_GPU)
+	{
+		apply_h_matrix_mvp_on_gpu(x, y, data);
+		export_h_matrix_profile(data);
+		return;
+	}
+
+	TIME_start(PROFILE_VECTOR_REORDER);
+	host_reorder_vector(x, data->point_count[1], data->order[1]);
+	TIME_stop(PROFILE_VECTOR_REORDER);
+
+	apply_h_matrix_mvp_in_z_order(x, y, data);
+
+	TIME_start(PROFILE_VECTOR_REORDER);
+	host_reorder_back_vector(x, data->point_count[1], data->order[1]);
+	host_reorder_back_vector(y, data->point_count[0], data->order[0]);
+	TIME_stop(PROFILE_VECTOR_REORDER);
+
+	export_h_matrix_profile(data);
+}
+
+void apply_h_matrix_mvp_transpose(double* x, double* y, struct h_matrix_data* data)
+{
+	if (data->backend!=BACKEND_HOST)
+	{
+		printf("apply_h_matrix_mvp_transpose is only supported for BACKEND_HOST. Exiting...\n");
+		exit(1);
+	}
+
+	// x lives on point set 1 and y on point set 2
+	TIME_start(PROFILE_VECTOR_REORDER);
+	host_reorder_vector(x, data->point_count[0], data->order[0]);
+	TIME_stop(PROFILE_VECTOR_REORDER);
+
+	TIME_start(PROFILE_MVP);
+	if (data->block_stream!=0)
+		host_stream_h_matrix_mmp(x, y, 1, true, data->block_stream, data->blocks, &(data->mat_vec_info), data->points_d[0], data->points_d[1], data->workspace);
+	else
+		host_h_matrix_mvp_transpose(x, y, data->blocks, &(data->mat_vec_info), data->points_d[0], data->points_d[1], data->eta, data->epsilon, data->k, data->assem, data->dA, data->dA_offsets, data->U, data->V, data->U_offsets, data->V_offsets, data->k_per_item, data->block_precision, data->workspace);
+	TIME_stop(PROFILE_MVP);
+
+	TIME_start(PROFILE_VECTOR_REORDER);
+	host_reorder_back_vector(x, data->point_count[0], data->order[0]);
+	host_reorder_back_vector(y, data->point_count[1], data->order[1]);
+	TIME_stop(PROFILE_VECTOR_REORDER);
+
+	export_h_matrix_profile(data);
+}
+
+void apply_h_matrix_mmp(double* X, double* Y, int nrhs, struct h_matrix_data* data)
+{
+	if (data->backend==BACKEND_HOST)
+	{
+		// permutations are applied once for all columns
+		TIME_start(PROFILE_VECTOR_REORDER);
+		host_reorder_matrix(X, data->point_count[1], nrhs, data->order[1]);
+		TIME_stop(PROFILE_VECTOR_REORDER);
+
+		TIME_start(PROFILE_MVP);
+		if (data->block_stream!=0)
+			host_stream_h_matrix_mmp(X, Y, nrhs, false, data->block_stream, data->blocks, &(data->mat_vec_info), data->points_d[0], data->points_d[1], data->workspace);
+		else
+			host_h_matrix_mmp(X, Y, nrhs, data->blocks, &(data->mat_vec_info), data->points_d[0], data->points_d[1], data->eta, data->epsilon, data->k, data->assem, data->dA, data->dA_offsets, data->U, data->V, data->U_offsets, data->V_offsets, data->k_per_item, data->block_precision, data->workspace);
+		TIME_stop(PROFILE_MVP);
+
+		TIME_start(PROFILE_VECTOR_REORDER);
+		host_reorder_back_matrix(X, data->point_count[1], nrhs, data->order[1]);
+		host_reorder_back_matrix(Y, data->point_count[0], nrhs, data->order[0]);
+		TIME_stop(PROFILE_VECTOR_REORDER);
+
+		export_h_matrix_profile(data);
+		return;
+	}
+
+	// the batched GPU MVP works on single vectors
+	for (int c=0; c<nrhs; c++)
+		apply_h_matrix_mvp(&X[(size_t)c*data->point_count[1]], &Y[(size_t)c*data->point_count[0]], data);
+}
+
+void apply_h_matrix_mvp_without_batching(double* x, double* y, struct h_matrix_data* data)
+{
+	if (data->backend==BACKEND_GPU)
+	{
+		apply_h_matrix_mvp_without_batching_on_gpu(x, y, data);
+		return;
+	}
+
+	host_reorder_vector(x, data->point_count[1], data->order[1]);
+
+	// ignoring precomputed data
+	host_h_matrix_mvp(x, y, data->blocks, &(data->mat_vec_info), data->points_d[0], data->points_d[1], data->eta, data->epsilon, data->k, data->assem, 0, 0, 0, 0, 0, 0, 0, 0, data->workspace);
+
+	host_reorder_back_vector(x, data->point_count[1], data->order[1]);
+	host_reorder_back_vector(y, data->point_count[0], data->order[0]);
+}
+
+
+
+
+void destroy_h_matrix_data_on_host(struct h_matrix_data* data)
+{
+	// arrays pointing into a mapped H matrix file are released with the mapping
+	bool is_mapped = (data->mapped_file!=0);
+
+	if (data->workspace!=0)
+	{
+		destroy_mvp_workspace(data->workspace);
+		delete data->workspace;
+		data->workspace = 0;
+	}
+
+	if (data->profile!=0)
+	{
+		destroy_h_matrix_profile(data->profile);
+		delete data->profile;
+		data->profile = 0;
+	}
+
+	if (data->factorization!=0)
+	{
+		host_destroy_h_factorization(data->factorization);
+		delete data->factorization;
+		data->factorization = 0;
+	}
+
+	delete [] data->stored_blocks;
+	data->stored_blocks = 0;
+
+	if (data->block_stream!=0)
+	{
+		host_destroy_block_stream(data->block_stream);
+		delete data->block_stream;
+		data->block_stream = 0;
+	}
+
+	if (data->blocks!=0)
+	{
+		if (!is_mapped)
+			host_destroy_block_list(data->blocks);
+		delete data->blocks;
+		data->blocks = 0;
+	}
+
+	for (int i=0; i<2; i++)
+	{
+		if (!is_mapped)
+			delete [] data->order[i];
+		delete [] data->code_d[i];
+		for (int d = 0; d < data->dim; d++)
+			delete [] data->coords_d[i][d];
+		delete [] data->coords_d[i];
+		delete [] data->point_ids_d[i];
+		delete data->morton_d[i];
+		delete data->points_d[i];
+		delete [] data->max_per_dim_d[i];
+		delete [] data->min_per_dim_d[i];
+	}
+
+	if (is_mapped)
+	{
+		host_unmap_h_matrix_file(data->mapped_file, data->mapped_file_size);
+		data->mapped_file = 0;
+		return;
+	}
+
+	// in case ACA / dense precomputation was done, delete precomputed data
+	delete [] data->U;
+	delete [] data->V;
+	delete [] data->dA;
+	delete [] data->k_per_item;
+	delete [] data->U_offsets;
+	delete [] data->V_offsets;
+	delete [] data->dA_offsets;
+	delete [] data->block_precision;
+
+	delete [] data->aca_work_size;
+	delete [] data->dense_work_size;
+}
+
+void destroy_h_matrix_data(struct h_matrix_data* data)
+{
+	if (data->backend==BACKEND_HOST)
+	{
+		destroy_h_matrix_data_on_host(data);
+		return;
+	}
+
+	destroy_h_matrix_data_on_gpu(data);
+}
+
+void apply_full_mvp(double* x, double* y, struct h_matrix_data* data)
+{
+	if (data->backend==BACKEND_HOST)
+	{
+		host_reorder_vector(x, data->point_count[1], data->order[1]);
+		host_full_mvp(x, y, data->points_d[0], data->points_d[1], data->assem);
+		host_reorder_back_vector(x, data->point_count[1], data->order[1]);
+		host_reorder_back_vector(y, data->point_count[0], data->order[0]);
+		return;
+	}
+
+	apply_full_mvp_on_gpu(x, y, data);
+}
+
+void set_gaussian_kernel_rhs(double* b, struct h_matrix_data* data)
+{
+	if (data->backend==BACKEND_HOST)
+	{
+		double** points = data->coords_d[0];
+
+		#pragma omp parallel for
+		for (int idx=0; idx<data->point_count[0]; idx++)
+		{
+			double result = 1.0;
+
+			for (int d=0; d<data->dim; d++)
+				result = result * sqrt(M_PI) * (erf(1.0- points[d][idx]) - erf(0.0 - points[d][idx])) / (2.0);
+
+			b[idx] = result;
+		}
+
+		host_reorder_back_vector(b, data->point_count[0], data->order[0]);
+		return;
+	}
+
+	set_gaussian_kernel_rhs_on_gpu(b, data);
+}
+
+void save_h_matrix(struct h_matrix_data* data, char* file_name)
+{
+	if (data->backend!=BACKEND_HOST)
+	{
+		printf("save_h_matrix is only supported for BACKEND_HOST. Exiting...\n");
+		exit(1);
+	}
+
+	int dense_count = data->mat_vec_info.dense_count;
+	int aca_count = data->mat_vec_info.aca_count;
+
+	struct h_matrix_file_header header;
+	memset(&header, 0, sizeof(struct h_matrix_file_header));
+	header.dim = data->dim;
+	header.point_count[0] = data->point_count[0];
+	header.point_count[1] = data->point_count[1];
+	header.mat_vec_info = data->mat_vec_info;
+	header.dense_batch_count = data->dense_batch_count;
+	header.aca_batch_count = data->aca_batch_count;
+	header.k = data->k;
+	header.c_leaf = data->c_leaf;
+	header.max_level = data->max_level;
+	header.eta = data->eta;
+	header.epsilon = data->epsilon;
+
+	// the points and the kernel the file belongs to are checked by load_h_matrix
+	header.point_checksum[0] = host_point_set_checksum(data->points_d[0]);
+	header.point_checksum[1] = host_point_set_checksum(data->points_d[1]);
+	header.kernel_type = data->assem->kernel_type;
+	host_get_kernel_samples(header.kernel_samples, data->assem, data->points_d[0], data->points_d[1]);
+
+	void* sections[H_MATRIX_FILE_SECTION_COUNT];
+	memset(sections, 0, sizeof(sections));
+
+	sections[HFS_ORDER_1] = data->order[0];
+	header.section_size[HFS_ORDER_1] = data->point_count[0]*sizeof(uint64_t);
+	sections[HFS_ORDER_2] = data->order[1];
+	header.section_size[HFS_ORDER_2] = data->point_count[1]*sizeof(uint64_t);
+	host_set_block_list_sections(&header, sections, data->blocks);
+	sections[HFS_DENSE_WORK_SIZE] = data->dense_work_size;
+	header.section_size[HFS_DENSE_WORK_SIZE] = data->dense_batch_count*sizeof(int);
+	sections[HFS_ACA_WORK_SIZE] = data->aca_work_size;
+	header.section_size[HFS_ACA_WORK_SIZE] = data->aca_batch_count*sizeof(int);
+
+	// precomputed ACA blocks
+	if (data->U!=0)
+	{
+		sections[HFS_K_PER_ITEM] = data->k_per_item;
+		header.section_size[HFS_K_PER_ITEM] = aca_count*sizeof(int);
+		sections[HFS_U_OFFSETS] = data->U_offsets;
+		header.section_size[HFS_U_OFFSETS] = (aca_count+1)*sizeof(size_t);
+		sections[HFS_V_OFFSETS] = data->V_offsets;
+		header.section_size[HFS_V_OFFSETS] = (aca_count+1)*sizeof(size_t);
+		sections[HFS_U] = data->U;
+		header.section_size[HFS_U] = data->U_offsets[aca_count]*sizeof(double);
+		sections[HFS_V] = data->V;
+		header.section_size[HFS_V] = data->V_offsets[aca_count]*sizeof(double);
+	}
+
+	// precomputed dense blocks
+	if (data->dA!=0)
+	{
+		sections[HFS_DA_OFFSETS] = data->dA_offsets;
+		header.section_size[HFS_DA_OFFSETS] = (dense_count+1)*sizeof(size_t);
+		sections[HFS_DA] = data->dA;
+		header.section_size[HFS_DA] = data->dA_offsets[dense_count]*sizeof(double);
+	}
+
+	// storage precision of the precomputed blocks (if reduced)
+	if (data->block_precision!=0)
+	{
+		sections[HFS_BLOCK_PRECISION] = data->block_precision;
+		header.section_size[HFS_BLOCK_PRECISION] = data->mat_vec_info.total_count*sizeof(char);
+	}
+
+	host_write_h_matrix_file(file_name, &header, sections);
+}
+
+void load_h_matrix(struct h_matrix_data* data, char* file_name)
+{
+	if (data->backend!=BACKEND_HOST)
+	{
+		printf("load_h_matrix is only supported for BACKEND_HOST. Exiting...\n");
+		exit(1);
+	}
+
+	if (data->assem==0)
+	{
+		printf("load_h_matrix requires data->assem to check the kernel of the file. Exiting...\n");
+		exit(1);
+	}
+
+	struct h_matrix_file_header header;
+	void* sections[H_MATRIX_FILE_SECTION_COUNT];
+	data->mapped_file = host_map_h_matrix_file(file_name, &header, sections, &(data->mapped_file_size));
+
+	if ((header.dim!=data->dim) || (header.point_count[0]!=data->point_count[0]) || (header.point_count[1]!=data->point_count[1]))
+	{
+		printf("H matrix file %s was written for %d x %d points in %d dimensions, but %d x %d points in %d dimensions are given. Exiting...\n", file_name, header.point_count[0], header.point_count[1], header.dim, data->point_count[0], data->point_count[1], data->dim);
+		exit(1);
+	}
+
+	host_set_thread_count(data->thread_count);
+
+	// the stored Z order replaces Morton code generation and sorting
+	data->order[0] = (uint64_t*)sections[HFS_ORDER_1];
+	data->order[1] = (uint64_t*)sections[HFS_ORDER_2];
+	data->symmetric = header.mat_vec_info.symmetric;
+	if (data->symmetric)
+		check_symmetric_point_sets_on_host(data);
+	for (int i=0; i<(data->symmetric ? 1 : 2); i++)
+	{
+		host_compute_minmax(data->points_d[i]);
+		host_reorder_point_set(data->points_d[i], data->order[i]);
+	}
+	if (data->symmetric)
+		copy_first_point_set_on_host(data);
+
+	if ((host_point_set_checksum(data->points_d[0])!=header.point_checksum[0]) || (host_point_set_checksum(data->points_d[1])!=header.point_checksum[1]))
+	{
+		printf("H matrix file %s was written for other point sets than the given ones. Exiting...\n", file_name);
+		exit(1);
+	}
+
+	double kernel_samples[H_MATRIX_FILE_KERNEL_SAMPLES];
+	host_get_kernel_samples(kernel_samples, data->assem, data->points_d[0], data->points_d[1]);
+	bool same_kernel = (header.kernel_type==data->assem->kernel_type);
+	for (int s=0; s<H_MATRIX_FILE_KERNEL_SAMPLES; s++)
+		same_kernel = same_kernel && (fabs(kernel_samples[s]-header.kernel_samples[s])<=1e-12*fabs(header.kernel_samples[s]));
+	if (!same_kernel)
+	{
+		printf("H matrix file %s was written for another kernel than data->assem. Exiting...\n", file_name);
+		exit(1);
+	}
+
+	data->k = header.k;
+	data->c_leaf = header.c_leaf;
+	data->max_level = header.max_level;
+	data->eta = header.eta;
+	data->epsilon = header.epsilon;
+
+	// the stored block cluster tree replaces the traversal
+	data->max_elements_in_array = -1;
+	data->max_elements_in_mat_vec_data_array = -1;
+	data->blocks = new struct block_list;
+	host_get_block_list_sections(data->blocks, &header, sections);
+	data->mat_vec_data_count = header.mat_vec_data_count;
+	data->mat_vec_data_array_size = header.mat_vec_data_count;
+	data->mat_vec_info = header.mat_vec_info;
+	data->dense_batch_count = header.dense_batch_count;
+	data->aca_batch_count = header.aca_batch_count;
+	data->dense_work_size = (int*)sections[HFS_DENSE_WORK_SIZE];
+	data->aca_work_size = (int*)sections[HFS_ACA_WORK_SIZE];
+
+	// the MVP works directly on the mapped precomputed data (if any)
+	data->k_per_item = (int*)sections[HFS_K_PER_ITEM];
+	data->U_offsets = (size_t*)sections[HFS_U_OFFSETS];
+	data->V_offsets = (size_t*)sections[HFS_V_OFFSETS];
+	data->U = (double*)sections[HFS_U];
+	data->V = (double*)sections[HFS_V];
+	data->dA_offsets = (size_t*)sections[HFS_DA_OFFSETS];
+	data->dA = (double*)sections[HFS_DA];
+	data->block_precision = (char*)sections[HFS_BLOCK_PRECISION];
+
+	data->workspace = new struct mvp_workspace;
+	init_mvp_workspace(data->workspace, host_get_thread_count());
+	host_reserve_mvp_workspace(data->workspace, data->blocks, &(data->mat_vec_info), data->k, 1);
+	data->workspace->profile = data->profile;
+}
+
+void get_mvp_workspace_statistics(long* mvp_count, long* allocations_last_mvp, long* allocations_total, size_t* size, struct h_matrix_data* data)
+{
+	if (data->workspace==0)
+	{
+		printf("get_mvp_workspace_statistics requires a set up H matrix. Exiting...\n");
+		exit(1);
+	}
+
+	*mvp_count = data->workspace->mvp_count;
+	*allocations_last_mvp = data->workspace->allocations_last_mvp;
+	*allocations_total = get_mvp_workspace_allocations(data->workspace);
+	*size = get_mvp_workspace_size(data->workspace);
+}
+
+void set_mvp_accumulation(struct h_matrix_data* data, int accumulation)
+{
+	if (data->backend!=BACKEND_HOST)
+	{
+		printf("set_mvp_accumulation is only supported for BACKEND_HOST. Exiting...\n");
+		exit(1);
+	}
+
+	if (data->workspace==0)
+	{
+		printf("set_mvp_accumulation requires a set up H matrix. Exiting...\n");
+		exit(1);
+	}
+
+	// the row-owned accumulation keeps the block results, which is accounted for in the reserved workspace
+	data->workspace->accumulation = accumulation;
+	host_reserve_mvp_workspace(data->workspace, data->blocks, &(data->mat_vec_info), data->k, 1);
+}
+
+void set_mvp_scheduling(struct h_matrix_data* data, int scheduling)
+{
+	if (data->backend!=BACKEND_HOST)
+	{
+		printf("set_mvp_scheduling is only supported for BACKEND_HOST. Exiting...\n");
+		exit(1);
+	}
+
+	if (data->workspace==0)
+	{
+		printf("set_mvp_scheduling requires a set up H matrix. Exiting...\n");
+		exit(1);
+	}
+
+	data->workspace->scheduling = scheduling;
+}
+
+void set_h_matrix_clustering(struct h_matrix_data* data, int clustering)
+{
+	if ((data->backend!=BACKEND_HOST) && (clustering!=CLUSTERING_MORTON))
+	{
+		printf("set_h_matrix_clustering only supports CLUSTERING_MORTON for BACKEND_GPU. Exiting...\n");
+		exit(1);
+	}
+
+	if (data->workspace!=0)
+	{
+		printf("set_h_matrix_clustering has to be called before setup_h_matrix. Exiting...\n");
+		exit(1);
+	}
+
+	if ((clustering<CLUSTERING_MORTON) || (clustering>CLUSTERING_PCA))
+	{
+		printf("Unknown clustering %d. Exiting...\n", clustering);
+		exit(1);
+	}
+
+	data->clustering = clustering;
+}
+
+void krylov_apply_h_matrix(double* x, double* y, void* context)
+{
+	apply_h_matrix_mvp_in_z_order(x, y, (struct h_matrix_data*)context);
+}
+
+void krylov_apply_h_factorization(double* r, double* z, void* context)
+{
+	struct h_matrix_data* data = (struct h_matrix_data*)context;
+	memcpy(z, r, data->point_count[0]*sizeof(double));
+	host_h_factorization_solve(z, 1, data->factorization);
+}
+
+// sets up the Krylov operations for the H matrix in Z order, permutes x into Z order and returns a copy of b in Z
+// order (the only vector allocated per solve besides the ones of the solver), such that b itself is never modified
+// symmetric_preconditioner: the solver (CG) needs a symmetric positive definite preconditioner, i.e. only an
+// H-Cholesky factorization is used
+double* prepare_krylov_solve(double* x, double* b, struct krylov_operations* ops, int symmetric_preconditioner, struct h_matrix_data* data)
+{
+	int n = data->point_count[0];
+	double* b_z;
+
+	if (data->point_count[0]!=data->point_count[1])
+	{
+		printf("Krylov solvers require a square H matrix. Exiting...\n");
+		exit(1);
+	}
+
+	if (data->backend==BACKEND_GPU)
+		b_z = prepare_krylov_solve_on_gpu(x, b, ops, data);
+	else
+	{
+		// rows and columns have to share the Z order, i.e. both point sets have to be the same
+		if (memcmp(data->order[0], data->order[1], n*sizeof(uint64_t))!=0)
+		{
+			printf("Krylov solvers require identical point sets for rows and columns. Exiting...\n");
+			exit(1);
+		}
+
+		host_krylov_operations(ops, n);
+		b_z = ops->allocate(n);
+		ops->copy(b, b_z, n);
+		host_reorder_vector(x, n, data->order[0]);
+		host_reorder_vector(b_z, n, data->order[0]);
+	}
+
+	ops->apply = krylov_apply_h_matrix;
+	ops->context = (void*)data;
+
+	// only the host backend has factorizations
+	ops->precondition = 0;
+	if (data->factorization!=0)
+	{
+		if (!symmetric_preconditioner || (data->factorization->type==H_FACTORIZATION_CHOLESKY))
+			ops->precondition = krylov_apply_h_factorization;
+		else
+			printf("The H-LU factorization is no preconditioner for CG (H_FACTORIZATION_CHOLESKY or GMRES), solving without preconditioner\n");
+	}
+	ops->precondition_context = (void*)data;
+
+	return b_z;
+}
+
+// permutes the solution back into the original order and releases the Z order copy of the right hand side
+void finish_krylov_solve(double* x, double* b_z, struct krylov_operations* ops, struct h_matrix_data* data)
+{
+	int n = data->point_count[0];
+
+	if (data->backend==BACKEND_GPU)
+	{
+		finish_krylov_solve_on_gpu(x, b_z, data);
+		return;
+	}
+
+	host_reorder_back_vector(x, n, data->order[0]);
+	ops->release(b_z);
+}
+
+int solve_with_cg(double* x, double* b, double tolerance, int max_iterations, double* relative_residual, struct h_matrix_data* data)
+{
+	struct krylov_operations ops;
+	double* b_z = prepare_krylov_solve(x, b, &ops, 1, data);
+
+	int iterations = krylov_cg(x, b_z, tolerance, max_iterations, relative_residual, &ops);
+	printf("CG%s: %d iterations, relative residual %le\n", (ops.precondition!=0) ? " (H factorization preconditioner)" : "", iterations, *relative_residual);
+
+	finish_krylov_solve(x, b_z, &ops, data);
+
+	return iterations;
+}
+
+int solve_with_gmres(double* x, double* b, int restart, double tolerance, int max_iterations, double* relative_residual, struct h_matrix_data* data)
+{
+	if (restart<1)
+	{
+		printf("solve_with_gmres requires a restart length of at least 1. Exiting...\n");
+		exit(1);
+	}
+
+	struct krylov_operations ops;
+	double* b_z = prepare_krylov_solve(x, b, &ops, 0, data);
+
+	int iterations = krylov_gmres(x, b_z, restart, tolerance, max_iterations, relative_residual, &ops);
+	printf("GMRES(%d)%s: %d iterations, relative residual %le\n", restart, (ops.precondition!=0) ? " (H factorization preconditioner)" : "", iterations, *relative_residual);
+
+	finish_krylov_solve(x, b_z, &ops, data);
+
+	return iterations;
+}
+
+int factorize_h_matrix(struct h_matrix_data* data, int factorization, double epsilon)
+{
+	if (data->backend!=BACKEND_HOST)
+	{
+		printf("factorize_h_matrix is only supported for BACKEND_HOST. Exiting...\n");
+		exit(1);
+	}
+
+	if (data->blocks==0)
+	{
+		printf("factorize_h_matrix requires a set up H matrix. Exiting...\n");
+		exit(1);
+	}
+
+	// rows and columns have to share the Z order, i.e. both point sets have to be the same
+	int n = data->point_count[0];
+	if ((data->point_count[0]!=data->point_count[1]) || (memcmp(data->order[0], data->order[1], n*sizeof(uint64_t))!=0))
+	{
+		printf("factorize_h_matrix requires identical point sets for rows and columns. Exiting...\n");
+		exit(1);
+	}
+
+	if (data->factorization!=0)
+		host_destroy_h_factorization(data->factorization);
+	else
+		data->factorization = new struct h_factorization;
+
+	TIME_start(PROFILE_FACTORIZATION);
+	int status = host_h_factorize(data->factorization, factorization, epsilon, data->blocks, &(data->mat_vec_info), data->points_d[0], data->epsilon, data->k, data->assem, data->dA, data->dA_offsets, data->U, data->V, data->U_offsets, data->V_offsets, data->k_per_item, data->block_precision);
+	TIME_stop(PROFILE_FACTORIZATION);
+
+	// the failed factorization is already destroyed, the Krylov solvers run without preconditioner again
+	if (status!=H_FACTORIZATION_SUCCESS)
+	{
+		delete data->factorization;
+		data->factorization = 0;
+
+		if (status==H_FACTORIZATION_INVALID_PARTITION)
+			printf("H matrix factorization failed, the block partition does not fit the factorization\n");
+		else if (status==H_FACTORIZATION_ZERO_PIVOT)
+			printf("H-LU factorization failed at a zero pivot\n");
+		else
+			printf("H-Cholesky factorization failed, the H matrix is not positive definite within epsilon %.0le\n", epsilon);
+
+		return status;
+	}
+
+	int max_rank;
+	size_t size = host_h_factorization_size(data->factorization, &max_rank);
+	printf("H-%s factorization: %lf MB, maximum rank %d\n", (factorization==H_FACTORIZATION_LU) ? "LU" : "Cholesky", (double)size/(1024.0*1024.0), max_rank);
+
+	export_h_matrix_profile(data);
+	return H_FACTORIZATION_SUCCESS;
+}
+
+void solve_with_h_factorization(double* x, double* b, struct h_matrix_data* data)
+{
+	if (data->factorization==0)
+	{
+		printf("solve_with_h_factorization requires factorize_h_matrix. Exiting...\n");
+		exit(1);
+	}
+
+	int n = data->point_count[0];
+	memcpy(x, b, n*sizeof(double));
+
+	host_reorder_vector(x, n, data->order[0]);
+	host_h_factorization_solve(x, 1, data->factorization);
+	host_reorder_back_vector(x, n, data->order[0]);
+}
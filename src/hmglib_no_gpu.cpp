@@ -0,0 +1,95 @@
+// Copyright (C) 2016 Peter Zaspel
+//
+// This file is part of hmglib.
+//
+// hmglib is free software: you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// hmglib is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hmglib.  If not, see <http://www.gnu.org/licenses/>.
+
+// GPU backend of the host-only libhmglib_host.so, i.e. every call for BACKEND_GPU exits
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hmglib_gpu.h"
+
+static void gpu_backend_is_not_available(const char* function_name)
+{
+	printf("%s: BACKEND_GPU is not available in the host-only build of hmglib, use BACKEND_HOST. Exiting...\n", function_name);
+	exit(1);
+}
+
+void init_h_matrix_data_on_gpu(struct h_matrix_data* data, int point_count[2], int dim, int bits)
+{
+	gpu_backend_is_not_available("init_h_matrix_data");
+}
+
+void setup_h_matrix_on_gpu(struct h_matrix_data* data)
+{
+	gpu_backend_is_not_available("setup_h_matrix");
+}
+
+void get_block_list_on_gpu(struct block_list* blocks, struct h_matrix_data* data)
+{
+	gpu_backend_is_not_available("write_h_matrix_profile");
+}
+
+void precompute_aca_on_gpu(struct h_matrix_data* data)
+{
+	gpu_backend_is_not_available("precompute_aca");
+}
+
+void precompute_dense_on_gpu(struct h_matrix_data* data)
+{
+	gpu_backend_is_not_available("precompute_dense");
+}
+
+void apply_h_matrix_mvp_in_z_order_on_gpu(double* x, double* y, struct h_matrix_data* data)
+{
+	gpu_backend_is_not_available("apply_h_matrix_mvp_in_z_order");
+}
+
+void apply_h_matrix_mvp_on_gpu(double* x, double* y, struct h_matrix_data* data)
+{
+	gpu_backend_is_not_available("apply_h_matrix_mvp");
+}
+
+void apply_h_matrix_mvp_without_batching_on_gpu(double* x, double* y, struct h_matrix_data* data)
+{
+	gpu_backend_is_not_available("apply_h_matrix_mvp_without_batching");
+}
+
+void destroy_h_matrix_data_on_gpu(struct h_matrix_data* data)
+{
+	gpu_backend_is_not_available("destroy_h_matrix_data");
+}
+
+void apply_full_mvp_on_gpu(double* x, double* y, struct h_matrix_data* data)
+{
+	gpu_backend_is_not_available("apply_full_mvp");
+}
+
+void set_gaussian_kernel_rhs_on_gpu(double* b, struct h_matrix_data* data)
+{
+	gpu_backend_is_not_available("set_gaussian_kernel_rhs");
+}
+
+double* prepare_krylov_solve_on_gpu(double* x, double* b, struct krylov_operations* ops, struct h_matrix_data* data)
+{
+	gpu_backend_is_not_available("solve_with_cg / solve_with_gmres");
+	return 0;
+}
+
+void finish_krylov_solve_on_gpu(double* x, double* b_z, struct h_matrix_data* data)
+{
+	gpu_backend_is_not_available("solve_with_cg / solve_with_gmres");
+}
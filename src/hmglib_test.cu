@@ -75,6 +75,10 @@ int main( int argc, char* argv[])
 	curandDestroyGenerator(gen);
 
 
+	// timings and block statistics of all following calls are written to a JSON file
+	char profile_file_name[] = "hmglib_test_profile.json";
+	enable_h_matrix_profiling(&data, profile_file_name);
+
 	// run setup of H matrix
 	setup_h_matrix(&data);
 
@@ -127,6 +131,13 @@ int main( int argc, char* argv[])
 	double error = abs_error/y_test_norm;	
 	printf("Relative error in H matrix matrix-vector product: %le\n", error);
 
+	// the workspace is reserved in setup_h_matrix and after precomputing, so no product should allocate
+	apply_h_matrix_mvp(x, y, &data);
+	long mvp_count, allocations_last_mvp, allocations_total;
+	size_t workspace_size;
+	get_mvp_workspace_statistics(&mvp_count, &allocations_last_mvp, &allocations_total, &workspace_size, &data);
+	printf("Workspace: %f MB, %ld allocations in the last of %ld MVPs (%ld in total)\n", (double)workspace_size/(1024.0*1024.0), allocations_last_mvp, mvp_count, allocations_total);
+
 	
 	// cleanup of vectors
 	cudaFree(y_test);
@@ -0,0 +1,767 @@
+// Copyright (C) 2016 Peter Zaspel
+//
+// This file is part of hmglib.
+//
+// hmglib is free software: you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// hmglib is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hmglib.  If not, see <http://www.gnu.org/licenses/>.
+
+// benchmark of the host backend without nvcc, MAGMA or GSL: point sets are generated internally, the set up,
+// the compression and the MVP are timed separately for all combinations of the swept parameters, the results are
+// written as CSV / JSON and can be checked against a baseline CSV of an earlier run, e.g.
+//
+//   ./host_benchmark --points 16384,32768,65536 --dim 2,3 --threads 1,8 --csv new.csv --baseline old.csv
+//
+// lists of values are comma separated; the exit code is 1 if a run is slower than the baseline by more than the
+// tolerance
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include "host_morton.h"
+#include "host_helper.h"
+#include "host_tree.h"
+#include "host_linear_algebra.h"
+#include "profiling.h"
+#include "kernel_system_assembler.h"
+
+#define DISTRIBUTION_UNIFORM 0
+#define DISTRIBUTION_HALTON 1
+#define DISTRIBUTION_CLUSTERED 2
+#define DISTRIBUTION_SPHERE 3
+#define DISTRIBUTION_COUNT 4
+
+static const char* distribution_names[DISTRIBUTION_COUNT] = { "uniform", "halton", "clustered", "sphere" };
+
+// lowest storage precision of the precomputed blocks (BLOCK_PRECISION_*), dense blocks go down to single precision
+static const char* precision_names[3] = { "double", "single", "bfloat16" };
+
+// cluster tree construction (CLUSTERING_*)
+static const char* clustering_names[4] = { "morton", "hilbert", "median", "pca" };
+
+struct benchmark_options
+{
+	std::vector<int> distributions;
+	std::vector<int> point_counts;
+	std::vector<int> dims;
+	std::vector<double> etas;
+	std::vector<int> c_leafs;
+	std::vector<int> ks;
+	std::vector<double> epsilons;
+	std::vector<int> thread_counts;
+
+	int warmup;
+	int repetitions;
+	int error_check_limit;	// the relative MVP error is computed against the full MVP up to this number of points
+	long seed;
+	int storage_precision;
+	int clustering;
+
+	const char* csv_file_name;
+	const char* json_file_name;
+	const char* baseline_file_name;
+	double tolerance;	// allowed relative slow down with respect to the baseline
+};
+
+struct benchmark_result
+{
+	int distribution;
+	int point_count;
+	int dim;
+	double eta;
+	int c_leaf;
+	int k;
+	double epsilon;
+	int thread_count;
+	int storage_precision;
+	int clustering;
+
+	// median and minimum over the repetitions in seconds
+	double setup_median, setup_min;
+	double compression_median, compression_min;
+	double mvp_median, mvp_min;
+
+	long dense_blocks;
+	long aca_blocks;
+	double average_rank;
+	size_t bytes_stored;
+	double flops_per_mvp;
+	double bytes_per_mvp;
+	double error;	// -1 if not computed
+};
+
+// ---------------------------------------------------------------------------------------------------------------
+// point generation
+
+static double radical_inverse(long index, int base)
+{
+	double result = 0.0;
+	double factor = 1.0/base;
+	while (index>0)
+	{
+		result += factor*(index%base);
+		index /= base;
+		factor /= base;
+	}
+	return result;
+}
+
+static double normal_random()
+{
+	// Box-Muller
+	double u1 = 1.0-drand48();
+	double u2 = drand48();
+	return sqrt(-2.0*log(u1))*cos(2.0*M_PI*u2);
+}
+
+// coords[d][i] in [0,1]^dim following the distribution
+static void generate_points(double** coords, int point_count, int dim, int distribution, long seed)
+{
+	srand48(seed);
+
+	if (distribution==DISTRIBUTION_UNIFORM)
+	{
+		for (int d=0; d<dim; d++)
+			for (int i=0; i<point_count; i++)
+				coords[d][i] = drand48();
+	}
+	else if (distribution==DISTRIBUTION_HALTON)
+	{
+		// Halton sequence with a random shift modulo 1 per dimension
+		const int primes[MAX_DIM] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61, 67, 71 };
+		for (int d=0; d<dim; d++)
+		{
+			double shift = drand48();
+			for (int i=0; i<point_count; i++)
+			{
+				double value = radical_inverse(i+1, primes[d]) + shift;
+				coords[d][i] = value - floor(value);
+			}
+		}
+	}
+	else if (distribution==DISTRIBUTION_CLUSTERED)
+	{
+		// a few narrow Gaussian clusters, i.e. strongly varying point densities
+		const int cluster_count = 16;
+		const double sigma = 0.02;
+		double centers[cluster_count][MAX_DIM];
+		for (int c=0; c<cluster_count; c++)
+			for (int d=0; d<dim; d++)
+				centers[c][d] = 0.1 + 0.8*drand48();
+
+		for (int i=0; i<point_count; i++)
+		{
+			int c = (int)(drand48()*cluster_count);
+			for (int d=0; d<dim; d++)
+				coords[d][i] = std::min(1.0, std::max(0.0, centers[c][d] + sigma*normal_random()));
+		}
+	}
+	else if (distribution==DISTRIBUTION_SPHERE)
+	{
+		// points on the surface of the sphere inscribed into the unit cube, i.e. a dim-1 dimensional manifold
+		for (int i=0; i<point_count; i++)
+		{
+			double v[MAX_DIM];
+			double norm = 0.0;
+			while (norm==0.0)
+			{
+				norm = 0.0;
+				for (int d=0; d<dim; d++)
+				{
+					v[d] = normal_random();
+					norm += v[d]*v[d];
+				}
+			}
+			norm = sqrt(norm);
+			for (int d=0; d<dim; d++)
+				coords[d][i] = 0.5 + 0.5*v[d]/norm;
+		}
+	}
+}
+
+static void init_benchmark_point_set(struct point_set* points, struct morton_code* morton, double** coords, int point_count, int dim, int bits)
+{
+	points->dim = dim;
+	points->size = point_count;
+	points->coords = new double*[dim];
+	for (int d=0; d<dim; d++)
+	{
+		points->coords[d] = new double[point_count];
+		memcpy(points->coords[d], coords[d], point_count*sizeof(double));
+	}
+	points->max_per_dim = new double[dim];
+	points->min_per_dim = new double[dim];
+	points->point_ids = new unsigned int[point_count];
+	for (int i=0; i<point_count; i++)
+		points->point_ids[i] = i;
+
+	morton->code = new uint64_t[point_count];
+	morton->size = point_count;
+	morton->dim = dim;
+	morton->bits = bits;
+	morton->max_values = 0;
+	morton->min_values = 0;
+}
+
+static void destroy_benchmark_point_set(struct point_set* points, struct morton_code* morton)
+{
+	for (int d=0; d<points->dim; d++)
+		delete [] points->coords[d];
+	delete [] points->coords;
+	delete [] points->max_per_dim;
+	delete [] points->min_per_dim;
+	delete [] points->point_ids;
+	delete [] morton->code;
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+// one configuration
+
+static double median(std::vector<double> values)
+{
+	std::sort(values.begin(), values.end());
+	size_t n = values.size();
+	return (n%2==1) ? values[n/2] : 0.5*(values[n/2-1]+values[n/2]);
+}
+
+static double relative_error(double* y, double* y_test, int n)
+{
+	double y_test_norm = 0.0;
+	double abs_error = 0.0;
+	for (int i=0; i<n; i++)
+	{
+		y_test_norm += y_test[i]*y_test[i];
+		abs_error += (y_test[i]-y[i])*(y_test[i]-y[i]);
+	}
+	return sqrt(abs_error)/sqrt(y_test_norm);
+}
+
+// the H matrix of the kernel matrix of a point set with itself is set up, compressed and applied warmup+repetitions
+// times; only the repetitions are timed
+static void run_benchmark(struct benchmark_result* result, struct benchmark_options* options)
+{
+	int point_count = result->point_count;
+	int dim = result->dim;
+	int bits = (dim==1) ? 32 : 64/dim;
+	int max_level = 50;
+	int k = result->k;
+	double eta = result->eta;
+	double epsilon = result->epsilon;
+
+	host_set_thread_count(result->thread_count);
+
+	double** coords = new double*[dim];
+	for (int d=0; d<dim; d++)
+		coords[d] = new double[point_count];
+	generate_points(coords, point_count, dim, result->distribution, options->seed);
+
+	struct gaussian_kernel_system_assembler assem;
+	assem.regularization = 0.0;
+
+	double* x = new double[point_count];
+	double* y = new double[point_count];
+	srand48(options->seed+1);
+	for (int i=0; i<point_count; i++)
+		x[i] = drand48();
+
+	std::vector<double> setup_times, compression_times, mvp_times;
+
+	for (int r=-options->warmup; r<options->repetitions; r++)
+	{
+		struct point_set points[2];
+		struct morton_code morton[2];
+		uint64_t* order[2];
+		for (int i=0; i<2; i++)
+			init_benchmark_point_set(&points[i], &morton[i], coords, point_count, dim, bits);
+
+		// set up: order of both point sets along their cluster keys and block cluster tree
+		double begin = profile_wall_time();
+		for (int i=0; i<2; i++)
+		{
+			host_compute_minmax(&points[i]);
+			host_get_cluster_keys(&points[i], &morton[i], result->clustering);
+			order[i] = new uint64_t[point_count];
+			host_get_morton_ordering(&points[i], &morton[i], order[i]);
+			host_reorder_point_set(&points[i], order[i]);
+		}
+
+		struct work_item root_h;
+		memset(&root_h, 0, sizeof(struct work_item));
+		root_h.set1_l = 0;
+		root_h.set1_u = point_count - 1;
+		root_h.set2_l = 0;
+		root_h.set2_u = point_count - 1;
+
+		struct block_list blocks;
+		host_traverse(root_h, &blocks, &morton[0], &morton[1], &points[0], &points[1], eta, max_level, result->c_leaf, false, 0, 0);
+
+		struct mat_vec_data_info mat_vec_info;
+		host_organize_mat_vec_data(&blocks, &mat_vec_info);
+		double setup_time = profile_wall_time() - begin;
+
+		// compression: dense blocks and ACA factors
+		double* dA; double* U; double* V;
+		size_t* dA_offsets; size_t* U_offsets; size_t* V_offsets;
+		int* k_per_item;
+		begin = profile_wall_time();
+		host_precompute_dense(&blocks, &mat_vec_info, &points[0], &points[1], &assem, &dA, &dA_offsets);
+		host_precompute_aca(&blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &assem, &U, &V, &U_offsets, &V_offsets, &k_per_item);
+		char* block_precision = 0;
+		if (result->storage_precision!=BLOCK_PRECISION_DOUBLE)
+			host_reduce_storage_precision(&blocks, &mat_vec_info, epsilon, std::min(result->storage_precision, (int)BLOCK_PRECISION_SINGLE), result->storage_precision, &dA, &dA_offsets, &U, &V, &U_offsets, &V_offsets, k_per_item, &block_precision);
+		double compression_time = profile_wall_time() - begin;
+
+		// MVP with a persistent workspace; the first product warms up the caches
+		struct mvp_workspace workspace;
+		init_mvp_workspace(&workspace, host_get_thread_count());
+		host_reserve_mvp_workspace(&workspace, &blocks, &mat_vec_info, k, 1);
+		host_h_matrix_mvp(x, y, &blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &assem, dA, dA_offsets, U, V, U_offsets, V_offsets, k_per_item, block_precision, &workspace);
+		begin = profile_wall_time();
+		host_h_matrix_mvp(x, y, &blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &assem, dA, dA_offsets, U, V, U_offsets, V_offsets, k_per_item, block_precision, &workspace);
+		double mvp_time = profile_wall_time() - begin;
+		destroy_mvp_workspace(&workspace);
+
+		if (r>=0)
+		{
+			setup_times.push_back(setup_time);
+			compression_times.push_back(compression_time);
+			mvp_times.push_back(mvp_time);
+		}
+
+		// statistics and accuracy of the last repetition
+		if (r==options->repetitions-1)
+		{
+			struct h_matrix_profile profile;
+			init_h_matrix_profile(&profile, 0);
+			profile_block_statistics(&profile, &blocks, &mat_vec_info, k_per_item, dA_offsets, block_precision, 0, k, true, true);
+			result->dense_blocks = mat_vec_info.dense_count;
+			result->aca_blocks = mat_vec_info.aca_count;
+			long rank_sum = 0;
+			for (int a=0; a<mat_vec_info.aca_count; a++)
+				rank_sum += k_per_item[a];
+			result->average_rank = (mat_vec_info.aca_count>0) ? (double)rank_sum/mat_vec_info.aca_count : 0.0;
+			result->bytes_stored = profile.bytes_stored;
+			result->flops_per_mvp = profile.flops_per_mvp;
+			result->bytes_per_mvp = profile.stored_bytes_per_mvp + profile.vector_bytes_per_mvp;
+			destroy_h_matrix_profile(&profile);
+
+			result->error = -1.0;
+			if (point_count<=options->error_check_limit)
+			{
+				// x is applied in Z order by both products
+				double* y_test = new double[point_count];
+				host_full_mvp(x, y_test, &points[0], &points[1], &assem);
+				result->error = relative_error(y, y_test, point_count);
+				delete [] y_test;
+			}
+		}
+
+		delete [] dA; delete [] dA_offsets;
+		delete [] U; delete [] V; delete [] U_offsets; delete [] V_offsets; delete [] k_per_item; delete [] block_precision;
+		host_destroy_block_list(&blocks);
+		for (int i=0; i<2; i++)
+		{
+			delete [] order[i];
+			destroy_benchmark_point_set(&points[i], &morton[i]);
+		}
+	}
+
+	result->setup_median = median(setup_times);
+	result->setup_min = *std::min_element(setup_times.begin(), setup_times.end());
+	result->compression_median = median(compression_times);
+	result->compression_min = *std::min_element(compression_times.begin(), compression_times.end());
+	result->mvp_median = median(mvp_times);
+	result->mvp_min = *std::min_element(mvp_times.begin(), mvp_times.end());
+
+	delete [] x; delete [] y;
+	for (int d=0; d<dim; d++)
+		delete [] coords[d];
+	delete [] coords;
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+// output and baseline
+
+// identifies a configuration in the CSV file and in the baseline
+static std::string result_key(struct benchmark_result* result)
+{
+	char key[256];
+	sprintf(key, "%s,%d,%d,%g,%d,%d,%g,%d,%s,%s", distribution_names[result->distribution], result->point_count, result->dim, result->eta, result->c_leaf, result->k, result->epsilon, result->thread_count, precision_names[result->storage_precision], clustering_names[result->clustering]);
+	return std::string(key);
+}
+
+// columns of result_key; columns added later take the value of the only setting before them in older baselines
+#define KEY_COLUMN_COUNT 10
+static const char* key_column_names[KEY_COLUMN_COUNT] = { "distribution", "points", "dim", "eta", "c_leaf", "k", "epsilon", "threads", "precision", "clustering" };
+static const char* key_column_defaults[KEY_COLUMN_COUNT] = { 0, 0, 0, 0, 0, 0, 0, 0, "double", "morton" };
+
+static const char* csv_header = "distribution,points,dim,eta,c_leaf,k,epsilon,threads,precision,clustering,setup_median_s,setup_min_s,compression_median_s,compression_min_s,mvp_median_s,mvp_min_s,mvp_ns_per_nlogn,dense_blocks,aca_blocks,average_rank,bytes_stored,mvp_gflops,mvp_gbs,error";
+
+// MVP time normalized by N log N, which should be roughly constant over the point counts
+static double mvp_ns_per_nlogn(struct benchmark_result* result)
+{
+	double n = result->point_count;
+	return result->mvp_median/(n*log2(std::max(n, 2.0)))*1e9;
+}
+
+static void write_csv_row(FILE* f, struct benchmark_result* result)
+{
+	fprintf(f, "%s,%.6e,%.6e,%.6e,%.6e,%.6e,%.6e,%.4f,%ld,%ld,%.3f,%zu,%.4f,%.4f,%.3e\n", result_key(result).c_str(), result->setup_median, result->setup_min, result->compression_median, result->compression_min, result->mvp_median, result->mvp_min, mvp_ns_per_nlogn(result), result->dense_blocks, result->aca_blocks, result->average_rank, result->bytes_stored, result->flops_per_mvp/result->mvp_median*1e-9, result->bytes_per_mvp/result->mvp_median*1e-9, result->error);
+}
+
+static void write_csv(const char* file_name, std::vector<struct benchmark_result>& results)
+{
+	FILE* f = fopen(file_name, "w");
+	if (f==0)
+	{
+		printf("Could not open %s for writing. Exiting...\n", file_name);
+		exit(1);
+	}
+	fprintf(f, "%s\n", csv_header);
+	for (size_t i=0; i<results.size(); i++)
+		write_csv_row(f, &results[i]);
+	fclose(f);
+}
+
+static void write_json(const char* file_name, std::vector<struct benchmark_result>& results)
+{
+	FILE* f = fopen(file_name, "w");
+	if (f==0)
+	{
+		printf("Could not open %s for writing. Exiting...\n", file_name);
+		exit(1);
+	}
+	fprintf(f, "[\n");
+	for (size_t i=0; i<results.size(); i++)
+	{
+		struct benchmark_result* result = &results[i];
+		fprintf(f, "  { \"distribution\": \"%s\", \"points\": %d, \"dim\": %d, \"eta\": %g, \"c_leaf\": %d, \"k\": %d, \"epsilon\": %g, \"threads\": %d, \"precision\": \"%s\", \"clustering\": \"%s\",\n", distribution_names[result->distribution], result->point_count, result->dim, result->eta, result->c_leaf, result->k, result->epsilon, result->thread_count, precision_names[result->storage_precision], clustering_names[result->clustering]);
+		fprintf(f, "    \"setup_s\": { \"median\": %.6e, \"min\": %.6e }, \"compression_s\": { \"median\": %.6e, \"min\": %.6e }, \"mvp_s\": { \"median\": %.6e, \"min\": %.6e },\n", result->setup_median, result->setup_min, result->compression_median, result->compression_min, result->mvp_median, result->mvp_min);
+		fprintf(f, "    \"mvp_ns_per_nlogn\": %.4f, \"dense_blocks\": %ld, \"aca_blocks\": %ld, \"average_rank\": %.3f, \"bytes_stored\": %zu, \"mvp_gflops\": %.4f, \"mvp_gbs\": %.4f, ", mvp_ns_per_nlogn(result), result->dense_blocks, result->aca_blocks, result->average_rank, result->bytes_stored, result->flops_per_mvp/result->mvp_median*1e-9, result->bytes_per_mvp/result->mvp_median*1e-9);
+		if (result->error>=0.0)
+			fprintf(f, "\"error\": %.3e }", result->error);
+		else
+			fprintf(f, "\"error\": null }");
+		fprintf(f, "%s\n", (i+1<results.size()) ? "," : "");
+	}
+	fprintf(f, "]\n");
+	fclose(f);
+}
+
+static std::vector<std::string> split(const std::string& text, char separator)
+{
+	std::vector<std::string> parts;
+	size_t begin = 0;
+	while (true)
+	{
+		size_t end = text.find(separator, begin);
+		parts.push_back(text.substr(begin, end-begin));
+		if (end==std::string::npos)
+			break;
+		begin = end+1;
+	}
+	return parts;
+}
+
+// reads the median times of a CSV file written by an earlier run, indexed by the configuration
+static void read_baseline(const char* file_name, std::map<std::string, std::vector<double> >* baseline)
+{
+	FILE* f = fopen(file_name, "r");
+	if (f==0)
+	{
+		printf("Could not open baseline %s. Exiting...\n", file_name);
+		exit(1);
+	}
+
+	char line[4096];
+	std::vector<std::string> columns;
+	if (fgets(line, sizeof(line), f)!=0)
+		columns = split(std::string(line, strcspn(line, "\r\n")), ',');
+
+	int time_columns[3] = { -1, -1, -1 };
+	const char* time_names[3] = { "setup_median_s", "compression_median_s", "mvp_median_s" };
+	int key_columns[KEY_COLUMN_COUNT];
+	for (int c=0; c<KEY_COLUMN_COUNT; c++)
+		key_columns[c] = -1;
+	for (size_t c=0; c<columns.size(); c++)
+	{
+		for (int t=0; t<3; t++)
+			if (columns[c]==time_names[t])
+				time_columns[t] = (int)c;
+		for (int t=0; t<KEY_COLUMN_COUNT; t++)
+			if (columns[c]==key_column_names[t])
+				key_columns[t] = (int)c;
+	}
+	bool has_key = true;
+	for (int c=0; c<KEY_COLUMN_COUNT; c++)
+		has_key = has_key && ((key_columns[c]>=0) || (key_column_defaults[c]!=0));
+	if (!has_key || (time_columns[0]<0) || (time_columns[1]<0) || (time_columns[2]<0))
+	{
+		printf("Baseline %s is not a CSV file written by host_benchmark. Exiting...\n", file_name);
+		exit(1);
+	}
+
+	while (fgets(line, sizeof(line), f)!=0)
+	{
+		std::vector<std::string> fields = split(std::string(line, strcspn(line, "\r\n")), ',');
+		if (fields.size()!=columns.size())
+			continue;
+
+		std::string key;
+		for (int c=0; c<KEY_COLUMN_COUNT; c++)
+			key += std::string((c>0) ? "," : "") + ((key_columns[c]>=0) ? fields[key_columns[c]] : std::string(key_column_defaults[c]));
+
+		std::vector<double> times(3);
+		for (int t=0; t<3; t++)
+			times[t] = atof(fields[time_columns[t]].c_str());
+		(*baseline)[key] = times;
+	}
+
+	fclose(f);
+}
+
+// returns the number of regressions
+static int check_against_baseline(std::vector<struct benchmark_result>& results, std::map<std::string, std::vector<double> >& baseline, double tolerance)
+{
+	const char* phase_names[3] = { "setup", "compression", "mvp" };
+	int regressions = 0;
+
+	for (size_t i=0; i<results.size(); i++)
+	{
+		std::string key = result_key(&results[i]);
+		std::map<std::string, std::vector<double> >::iterator it = baseline.find(key);
+		if (it==baseline.end())
+		{
+			printf("baseline: no entry for %s\n", key.c_str());
+			continue;
+		}
+
+		double times[3] = { results[i].setup_median, results[i].compression_median, results[i].mvp_median };
+		for (int t=0; t<3; t++)
+		{
+			double ratio = times[t]/it->second[t];
+			if (ratio>1.0+tolerance)
+			{
+				printf("REGRESSION %s: %s %.3e s vs. %.3e s in the baseline (%.0f%% slower)\n", key.c_str(), phase_names[t], times[t], it->second[t], (ratio-1.0)*100.0);
+				regressions++;
+			}
+		}
+	}
+
+	return regressions;
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+// command line
+
+template <typename T> static std::vector<T> parse_list(const char* text, T (*convert)(const char*))
+{
+	std::vector<std::string> parts = split(std::string(text), ',');
+	std::vector<T> values;
+	for (size_t i=0; i<parts.size(); i++)
+		if (!parts[i].empty())
+			values.push_back(convert(parts[i].c_str()));
+	return values;
+}
+
+static int convert_int(const char* text)
+{
+	return atoi(text);
+}
+
+static double convert_double(const char* text)
+{
+	return atof(text);
+}
+
+static int convert_distribution(const char* text)
+{
+	for (int d=0; d<DISTRIBUTION_COUNT; d++)
+		if (strcmp(text, distribution_names[d])==0)
+			return d;
+
+	printf("Unknown point distribution %s (uniform, halton, clustered or sphere). Exiting...\n", text);
+	exit(1);
+}
+
+static int convert_precision(const char* text)
+{
+	for (int p=BLOCK_PRECISION_DOUBLE; p<=BLOCK_PRECISION_BFLOAT16; p++)
+		if (strcmp(text, precision_names[p])==0)
+			return p;
+
+	printf("Unknown storage precision %s (double, single or bfloat16). Exiting...\n", text);
+	exit(1);
+}
+
+static int convert_clustering(const char* text)
+{
+	for (int c=CLUSTERING_MORTON; c<=CLUSTERING_PCA; c++)
+		if (strcmp(text, clustering_names[c])==0)
+			return c;
+
+	printf("Unknown clustering %s (morton, hilbert, median or pca). Exiting...\n", text);
+	exit(1);
+}
+
+static void print_usage()
+{
+	printf("./host_benchmark [options], lists are comma separated\n");
+	printf("  --distribution <list>       uniform, halton, clustered, sphere (default uniform)\n");
+	printf("  --points <list>             point counts (default 4096,8192,16384,32768)\n");
+	printf("  --dim <list>                dimensions (default 2)\n");
+	printf("  --eta <list>                admissibility parameters (default 1.5)\n");
+	printf("  --c-leaf <list>             leaf sizes (default 64)\n");
+	printf("  --k <list>                  maximum ACA ranks (default 16)\n");
+	printf("  --epsilon <list>            ACA tolerances (default 1e-6)\n");
+	printf("  --threads <list>            thread counts, 0 = OpenMP default (default 0)\n");
+	printf("  --warmup <n>                untimed runs per configuration (default 1)\n");
+	printf("  --repetitions <n>           timed runs per configuration (default 3)\n");
+	printf("  --error-check-limit <n>     compare with the full MVP up to n points (default 8192)\n");
+	printf("  --seed <n>                  seed of the point generation (default 1)\n");
+	printf("  --storage-precision <p>     lowest precision of the stored blocks within epsilon: double, single or\n");
+	printf("                              bfloat16 (ACA factors only, dense blocks in single) (default double)\n");
+	printf("  --clustering <c>            cluster trees: morton, hilbert, median or pca (default morton)\n");
+	printf("  --csv <file>                write results as CSV\n");
+	printf("  --json <file>               write results as JSON\n");
+	printf("  --baseline <file>           CSV of an earlier run to check for regressions\n");
+	printf("  --tolerance <x>             allowed relative slow down against the baseline (default 0.25)\n");
+}
+
+int main( int argc, char* argv[])
+{
+	struct benchmark_options options;
+	options.distributions.push_back(DISTRIBUTION_UNIFORM);
+	for (int n=4096; n<=32768; n*=2)
+		options.point_counts.push_back(n);
+	options.dims.push_back(2);
+	options.etas.push_back(1.5);
+	options.c_leafs.push_back(64);
+	options.ks.push_back(16);
+	options.epsilons.push_back(1e-6);
+	options.thread_counts.push_back(0);
+	options.warmup = 1;
+	options.repetitions = 3;
+	options.error_check_limit = 8192;
+	options.seed = 1;
+	options.storage_precision = BLOCK_PRECISION_DOUBLE;
+	options.clustering = CLUSTERING_MORTON;
+	options.csv_file_name = 0;
+	options.json_file_name = 0;
+	options.baseline_file_name = 0;
+	options.tolerance = 0.25;
+
+	for (int a=1; a<argc; a++)
+	{
+		if ((strcmp(argv[a], "--help")==0) || (a+1>=argc))
+		{
+			print_usage();
+			return 0;
+		}
+
+		const char* option = argv[a];
+		const char* value = argv[++a];
+
+		if (strcmp(option, "--distribution")==0) options.distributions = parse_list(value, convert_distribution);
+		else if (strcmp(option, "--points")==0) options.point_counts = parse_list(value, convert_int);
+		else if (strcmp(option, "--dim")==0) options.dims = parse_list(value, convert_int);
+		else if (strcmp(option, "--eta")==0) options.etas = parse_list(value, convert_double);
+		else if (strcmp(option, "--c-leaf")==0) options.c_leafs = parse_list(value, convert_int);
+		else if (strcmp(option, "--k")==0) options.ks = parse_list(value, convert_int);
+		else if (strcmp(option, "--epsilon")==0) options.epsilons = parse_list(value, convert_double);
+		else if (strcmp(option, "--threads")==0) options.thread_counts = parse_list(value, convert_int);
+		else if (strcmp(option, "--warmup")==0) options.warmup = atoi(value);
+		else if (strcmp(option, "--repetitions")==0) options.repetitions = std::max(1, atoi(value));
+		else if (strcmp(option, "--error-check-limit")==0) options.error_check_limit = atoi(value);
+		else if (strcmp(option, "--seed")==0) options.seed = atol(value);
+		else if (strcmp(option, "--storage-precision")==0) options.storage_precision = convert_precision(value);
+		else if (strcmp(option, "--clustering")==0) options.clustering = convert_clustering(value);
+		else if (strcmp(option, "--csv")==0) options.csv_file_name = value;
+		else if (strcmp(option, "--json")==0) options.json_file_name = value;
+		else if (strcmp(option, "--baseline")==0) options.baseline_file_name = value;
+		else if (strcmp(option, "--tolerance")==0) options.tolerance = atof(value);
+		else
+		{
+			printf("Unknown option %s\n", option);
+			print_usage();
+			return 1;
+		}
+	}
+
+	for (size_t i=0; i<options.dims.size(); i++)
+		if ((options.dims[i]<1) || (options.dims[i]>MAX_DIM))
+		{
+			printf("Dimensions have to be between 1 and %d. Exiting...\n", MAX_DIM);
+			return 1;
+		}
+
+	std::map<std::string, std::vector<double> > baseline;
+	if (options.baseline_file_name!=0)
+		read_baseline(options.baseline_file_name, &baseline);
+
+	// sweep over all combinations
+	std::vector<struct benchmark_result> results;
+	printf("%s\n", csv_header);
+	for (size_t i_distribution=0; i_distribution<options.distributions.size(); i_distribution++)
+	for (size_t i_dim=0; i_dim<options.dims.size(); i_dim++)
+	for (size_t i_eta=0; i_eta<options.etas.size(); i_eta++)
+	for (size_t i_c_leaf=0; i_c_leaf<options.c_leafs.size(); i_c_leaf++)
+	for (size_t i_k=0; i_k<options.ks.size(); i_k++)
+	for (size_t i_epsilon=0; i_epsilon<options.epsilons.size(); i_epsilon++)
+	for (size_t i_threads=0; i_threads<options.thread_counts.size(); i_threads++)
+	for (size_t i_points=0; i_points<options.point_counts.size(); i_points++)
+	{
+		struct benchmark_result result;
+		memset(&result, 0, sizeof(struct benchmark_result));
+		result.distribution = options.distributions[i_distribution];
+		result.point_count = options.point_counts[i_points];
+		result.dim = options.dims[i_dim];
+		result.eta = options.etas[i_eta];
+		result.c_leaf = options.c_leafs[i_c_leaf];
+		result.k = options.ks[i_k];
+		result.epsilon = options.epsilons[i_epsilon];
+		result.thread_count = options.thread_counts[i_threads];
+		result.storage_precision = options.storage_precision;
+		result.clustering = options.clustering;
+
+		if ((result.distribution==DISTRIBUTION_SPHERE) && (result.dim<2))
+		{
+			printf("# skipping sphere points in %d dimension\n", result.dim);
+			continue;
+		}
+
+		run_benchmark(&result, &options);
+		results.push_back(result);
+		write_csv_row(stdout, &result);
+		fflush(stdout);
+	}
+
+	if (options.csv_file_name!=0)
+		write_csv(options.csv_file_name, results);
+	if (options.json_file_name!=0)
+		write_json(options.json_file_name, results);
+
+	if (options.baseline_file_name!=0)
+	{
+		int regressions = check_against_baseline(results, baseline, options.tolerance);
+		printf("%d regression(s) against %s (tolerance %.0f%%)\n", regressions, options.baseline_file_name, options.tolerance*100.0);
+		if (regressions>0)
+			return 1;
+	}
+
+	return 0;
+}
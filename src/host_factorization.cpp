@@ -0,0 +1,1073 @@
+// Copyright (C) 2016 Peter Zaspel
+//
+// This file is part of hmglib.
+//
+// hmglib is free software: you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// hmglib is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hmglib.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "host_factorization.h"
+#include "host_linear_algebra.h"
+#include "host_helper.h"
+
+// blocks with more entries than this are updated in tasks of their own, smaller ones within the parent task
+#define HOST_FACTORIZATION_TASK_CUTOFF 65536
+
+// H matrix the factorization is built from, i.e. the block list with its precomputed data and the cluster tree of
+// the rows (children holds two clusters per cluster, -1 for leaves)
+struct host_factorization_input
+{
+	struct block_list* blocks;
+	struct mat_vec_data_info* mat_vec_info;
+	struct point_set* points;
+	double aca_epsilon;
+	int k;
+	struct system_assembler* assem;
+	double* dA; size_t* dA_offsets;
+	double* U; double* V; size_t* U_offsets; size_t* V_offsets; int* k_per_item;
+	char* block_precision;
+
+	std::vector<int> children;
+	std::map<std::pair<int,int>, int> block_index;
+};
+
+// leaf of the H matrix that is filled with block block_index of the block list (with its transpose if transposed)
+struct host_factorization_leaf
+{
+	struct h_block* block;
+	int block_index;
+	bool transposed;
+};
+
+static struct h_block* host_new_h_block(int row_l, int rows, int col_l, int cols, int type)
+{
+	struct h_block* block = new struct h_block;
+	block->row_l = row_l;
+	block->rows = rows;
+	block->col_l = col_l;
+	block->cols = cols;
+	block->type = type;
+	block->A = 0;
+	block->U = 0;
+	block->V = 0;
+	block->rank = 0;
+	for (int c=0; c<4; c++)
+		block->child[c] = 0;
+
+	return block;
+}
+
+static void host_destroy_h_block(struct h_block* block)
+{
+	if (block==0)
+		return;
+
+	for (int c=0; c<4; c++)
+		host_destroy_h_block(block->child[c]);
+	delete [] block->A;
+	delete [] block->U;
+	delete [] block->V;
+	delete block;
+}
+
+static inline bool host_spawn_tasks(struct h_block* block)
+{
+	return ((size_t)block->rows*block->cols > HOST_FACTORIZATION_TASK_CUTOFF);
+}
+
+// child (i,j) of op(block), i.e. of block' if transpose
+static inline struct h_block* host_get_child(struct h_block* block, bool transpose, int i, int j)
+{
+	return transpose ? block->child[j+2*i] : block->child[i+2*j];
+}
+
+// the block partition is checked by host_check_h_partition before the factorization, i.e. a block structure the
+// recursion cannot handle is an internal error
+static void host_block_structure_error()
+{
+	printf("Block partition of the H matrix does not fit the factorization (not caught by host_check_h_partition). Exiting...\n");
+	exit(1);
+}
+
+// C = C + alpha*op(A)*op(B) for column-major C (m x n), op(A) (m x l) and op(B) (l x n)
+static void host_dense_gemm(int m, int n, int l, double alpha, double* A, int lda, bool transpose_A, double* B, int ldb, bool transpose_B, double* C, int ldc)
+{
+	std::vector<double> b(l);
+
+	for (int j=0; j<n; j++)
+	{
+		for (int p=0; p<l; p++)
+			b[p] = alpha*(transpose_B ? B[j + (size_t)p*ldb] : B[p + (size_t)j*ldb]);
+
+		double* C_j = &C[(size_t)j*ldc];
+		if (transpose_A)
+		{
+			for (int i=0; i<m; i++)
+			{
+				double* A_i = &A[(size_t)i*lda];
+				double sum = 0.0;
+				for (int p=0; p<l; p++)
+					sum += A_i[p]*b[p];
+				C_j[i] += sum;
+			}
+		}
+		else
+		{
+			for (int p=0; p<l; p++)
+			{
+				double* A_p = &A[(size_t)p*lda];
+				double b_p = b[p];
+				for (int i=0; i<m; i++)
+					C_j[i] += A_p[i]*b_p;
+			}
+		}
+	}
+}
+
+// B = A' for the column-major m x n matrix A
+static void host_dense_transpose(double* A, int lda, int m, int n, double* B, int ldb)
+{
+	for (int j=0; j<n; j++)
+		for (int i=0; i<m; i++)
+			B[j + (size_t)i*ldb] = A[i + (size_t)j*lda];
+}
+
+// B = op(T)^-1*B with the lower (lower) or upper triangle of the column-major n x n matrix T, whose diagonal is taken
+// as 1 if unit
+static void host_dense_triangular_solve(double* T, int ldt, int n, bool lower, bool unit, bool transpose, double* B, int ldb, int nrhs)
+{
+	for (int c=0; c<nrhs; c++)
+	{
+		double* x = &B[(size_t)c*ldb];
+
+		if (!transpose && lower)
+		{
+			for (int j=0; j<n; j++)
+			{
+				double* T_j = &T[(size_t)j*ldt];
+				if (!unit)
+					x[j] /= T_j[j];
+				for (int i=j+1; i<n; i++)
+					x[i] -= x[j]*T_j[i];
+			}
+		}
+		else if (!transpose)
+		{
+			for (int j=n-1; j>=0; j--)
+			{
+				double* T_j = &T[(size_t)j*ldt];
+				if (!unit)
+					x[j] /= T_j[j];
+				for (int i=0; i<j; i++)
+					x[i] -= x[j]*T_j[i];
+			}
+		}
+		else if (lower)
+		{
+			for (int j=n-1; j>=0; j--)
+			{
+				double* T_j = &T[(size_t)j*ldt];
+				double sum = x[j];
+				for (int i=j+1; i<n; i++)
+					sum -= T_j[i]*x[i];
+				x[j] = unit ? sum : sum/T_j[j];
+			}
+		}
+		else
+		{
+			for (int j=0; j<n; j++)
+			{
+				double* T_j = &T[(size_t)j*ldt];
+				double sum = x[j];
+				for (int i=0; i<j; i++)
+					sum -= T_j[i]*x[i];
+				x[j] = unit ? sum : sum/T_j[j];
+			}
+		}
+	}
+}
+
+// A = L*U in place without pivoting (unit diagonal of L not stored); returns H_FACTORIZATION_ZERO_PIVOT and leaves A
+// partially factorized at a zero pivot
+static int host_dense_lu(double* A, int n)
+{
+	for (int j=0; j<n; j++)
+	{
+		double* A_j = &A[(size_t)j*n];
+		double pivot = A_j[j];
+		if (pivot==0.0)
+			return H_FACTORIZATION_ZERO_PIVOT;
+
+		for (int i=j+1; i<n; i++)
+			A_j[i] /= pivot;
+		for (int c=j+1; c<n; c++)
+		{
+			double* A_c = &A[(size_t)c*n];
+			double a_jc = A_c[j];
+			for (int i=j+1; i<n; i++)
+				A_c[i] -= A_j[i]*a_jc;
+		}
+	}
+
+	return H_FACTORIZATION_SUCCESS;
+}
+
+// A = L*L' in place (left-looking on the lower triangle, the upper triangle is set to 0); returns
+// H_FACTORIZATION_NOT_POSITIVE_DEFINITE at the first non-positive pivot
+static int host_dense_cholesky(double* A, int n)
+{
+	for (int j=0; j<n; j++)
+	{
+		double* A_j = &A[(size_t)j*n];
+		for (int l=0; l<j; l++)
+		{
+			double* A_l = &A[(size_t)l*n];
+			double a_jl = A_l[j];
+			for (int i=j; i<n; i++)
+				A_j[i] -= A_l[i]*a_jl;
+		}
+
+		if (!(A_j[j]>0.0))
+			return H_FACTORIZATION_NOT_POSITIVE_DEFINITE;
+
+		double diagonal = sqrt(A_j[j]);
+		A_j[j] = diagonal;
+		for (int i=j+1; i<n; i++)
+			A_j[i] /= diagonal;
+		for (int i=0; i<j; i++)
+			A_j[i] = 0.0;
+	}
+
+	return H_FACTORIZATION_SUCCESS;
+}
+
+// truncates the low rank block to the relative accuracy epsilon; factors with more columns than rows are replaced by
+// an exact factorization with min(rows,cols) columns first, as the recompression expects thin factors
+static void host_truncate_low_rank_block(struct h_block* block, double epsilon)
+{
+	int rows = block->rows;
+	int cols = block->cols;
+	int rank = block->rank;
+
+	if (rank>std::min(rows, cols))
+	{
+		// U*V' = I*(V*U')' or (U*V')*I'
+		int new_rank = std::min(rows, cols);
+		double* U_new = new double[(size_t)rows*new_rank];
+		double* V_new = new double[(size_t)cols*new_rank];
+		memset(U_new, 0, (size_t)rows*new_rank*sizeof(double));
+		memset(V_new, 0, (size_t)cols*new_rank*sizeof(double));
+		if (rows<=cols)
+		{
+			for (int i=0; i<rows; i++)
+				U_new[i + (size_t)i*rows] = 1.0;
+			host_dense_gemm(cols, rows, rank, 1.0, block->V, cols, false, block->U, rows, true, V_new, cols);
+		}
+		else
+		{
+			for (int i=0; i<cols; i++)
+				V_new[i + (size_t)i*cols] = 1.0;
+			host_dense_gemm(rows, cols, rank, 1.0, block->U, rows, false, block->V, cols, true, U_new, rows);
+		}
+		delete [] block->U;
+		delete [] block->V;
+		block->U = U_new;
+		block->V = V_new;
+		block->rank = new_rank;
+		rank = new_rank;
+	}
+
+	int new_rank = host_recompress_low_rank_block(block->U, block->V, rows, cols, rank, epsilon);
+
+	// keep only the leading columns
+	if (new_rank<block->rank)
+	{
+		double* U_new = new double[(size_t)rows*new_rank];
+		double* V_new = new double[(size_t)cols*new_rank];
+		memcpy(U_new, block->U, (size_t)rows*new_rank*sizeof(double));
+		memcpy(V_new, block->V, (size_t)cols*new_rank*sizeof(double));
+		delete [] block->U;
+		delete [] block->V;
+		block->U = U_new;
+		block->V = V_new;
+	}
+	block->rank = new_rank;
+}
+
+// C = C + alpha*X*Y' with X (C->rows x rank) and Y (C->cols x rank); low rank blocks of C are truncated afterwards
+static void host_add_low_rank(struct h_block* C, double alpha, double* X, int ldx, double* Y, int ldy, int rank, double epsilon)
+{
+	if (rank==0)
+		return;
+
+	if (C->type==H_BLOCK_DENSE)
+	{
+		host_dense_gemm(C->rows, C->cols, rank, alpha, X, ldx, false, Y, ldy, true, C->A, C->rows);
+	}
+	else if (C->type==H_BLOCK_LOW_RANK)
+	{
+		// [U alpha*X]*[V Y]'
+		int new_rank = C->rank + rank;
+		double* U_new = new double[(size_t)C->rows*new_rank];
+		double* V_new = new double[(size_t)C->cols*new_rank];
+		memcpy(U_new, C->U, (size_t)C->rows*C->rank*sizeof(double));
+		memcpy(V_new, C->V, (size_t)C->cols*C->rank*sizeof(double));
+		for (int c=0; c<rank; c++)
+		{
+			double* U_c = &U_new[(size_t)(C->rank+c)*C->rows];
+			double* V_c = &V_new[(size_t)(C->rank+c)*C->cols];
+			for (int i=0; i<C->rows; i++)
+				U_c[i] = alpha*X[i + (size_t)c*ldx];
+			for (int i=0; i<C->cols; i++)
+				V_c[i] = Y[i + (size_t)c*ldy];
+		}
+		delete [] C->U;
+		delete [] C->V;
+		C->U = U_new;
+		C->V = V_new;
+		C->rank = new_rank;
+
+		host_truncate_low_rank_block(C, epsilon);
+	}
+	else
+	{
+		for (int c=0; c<4; c++)
+		{
+			struct h_block* child = C->child[c];
+			if (child==0)
+				continue;
+
+			int row_offset = child->row_l - C->row_l;
+			int col_offset = child->col_l - C->col_l;
+
+			#pragma omp task if (host_spawn_tasks(child))
+			host_add_low_rank(child, alpha, &X[row_offset], ldx, &Y[col_offset], ldy, rank, epsilon);
+		}
+		#pragma omp taskwait
+	}
+}
+
+// C = C + alpha*op(X)*B for the column-major matrix B with nrhs columns
+static void host_h_mult_dense(double alpha, struct h_block* X, bool transpose, double* B, int ldb, int nrhs, double* C, int ldc)
+{
+	if (X->type==H_BLOCK_DENSE)
+	{
+		host_dense_gemm(transpose ? X->cols : X->rows, nrhs, transpose ? X->rows : X->cols, alpha, X->A, X->rows, transpose, B, ldb, false, C, ldc);
+	}
+	else if (X->type==H_BLOCK_LOW_RANK)
+	{
+		if (X->rank==0)
+			return;
+
+		// op(X) = left*right'
+		double* left = transpose ? X->V : X->U;
+		double* right = transpose ? X->U : X->V;
+		int left_rows = transpose ? X->cols : X->rows;
+		int right_rows = transpose ? X->rows : X->cols;
+
+		std::vector<double> tmp((size_t)X->rank*nrhs, 0.0);
+		host_dense_gemm(X->rank, nrhs, right_rows, 1.0, right, right_rows, true, B, ldb, false, &tmp[0], X->rank);
+		host_dense_gemm(left_rows, nrhs, X->rank, alpha, left, left_rows, false, &tmp[0], X->rank, false, C, ldc);
+	}
+	else
+	{
+		// the children that write to the same half of C are applied one after the other, missing children are 0
+		for (int h=0; h<2; h++)
+		{
+			#pragma omp task if (host_spawn_tasks(X))
+			for (int o=0; o<2; o++)
+			{
+				struct h_block* child = host_get_child(X, transpose, h, o);
+				if (child==0)
+					continue;
+
+				int row_offset = transpose ? (child->col_l - X->col_l) : (child->row_l - X->row_l);
+				int col_offset = transpose ? (child->row_l - X->row_l) : (child->col_l - X->col_l);
+				host_h_mult_dense(alpha, child, transpose, &B[col_offset], ldb, nrhs, &C[row_offset], ldc);
+			}
+		}
+		#pragma omp taskwait
+	}
+}
+
+// B = op(T)^-1*B for the lower (lower) or upper triangle of the diagonal block T of a factorization, with unit diagonal
+// if unit; B is column-major with nrhs columns
+static void host_h_triangular_solve(struct h_block* T, bool lower, bool unit, bool transpose, double* B, int ldb, int nrhs)
+{
+	if (T->type==H_BLOCK_DENSE)
+	{
+		host_dense_triangular_solve(T->A, T->rows, T->rows, lower, unit, transpose, B, ldb, nrhs);
+		return;
+	}
+	if (T->type!=H_BLOCK_SUBDIVIDED)
+		host_block_structure_error();
+
+	// the off-diagonal block of the triangle is T10 for a lower and T01 for an upper triangle
+	struct h_block* off_diagonal = lower ? T->child[1] : T->child[2];
+	int split = T->child[0]->rows;
+
+	if (lower!=transpose)
+	{
+		host_h_triangular_solve(T->child[0], lower, unit, transpose, B, ldb, nrhs);
+		host_h_mult_dense(-1.0, off_diagonal, transpose, B, ldb, nrhs, &B[split], ldb);
+		host_h_triangular_solve(T->child[3], lower, unit, transpose, &B[split], ldb, nrhs);
+	}
+	else
+	{
+		host_h_triangular_solve(T->child[3], lower, unit, transpose, &B[split], ldb, nrhs);
+		host_h_mult_dense(-1.0, off_diagonal, transpose, &B[split], ldb, nrhs, B, ldb);
+		host_h_triangular_solve(T->child[0], lower, unit, transpose, B, ldb, nrhs);
+	}
+}
+
+static void host_h_mul_add(struct h_block* C, double alpha, struct h_block* A, bool transpose_A, struct h_block* B, bool transpose_B, double epsilon);
+
+// X = op(T)^-1*X for a block X in the block row of the diagonal block T
+static void host_h_solve_left(struct h_block* T, bool lower, bool unit, bool transpose, struct h_block* X, double epsilon)
+{
+	if (X->type==H_BLOCK_LOW_RANK)
+	{
+		host_h_triangular_solve(T, lower, unit, transpose, X->U, X->rows, X->rank);
+		return;
+	}
+	if (X->type==H_BLOCK_DENSE)
+	{
+		host_h_triangular_solve(T, lower, unit, transpose, X->A, X->rows, X->cols);
+		return;
+	}
+	if (T->type!=H_BLOCK_SUBDIVIDED)
+		host_block_structure_error();
+
+	struct h_block* off_diagonal = lower ? T->child[1] : T->child[2];
+
+	// both column halves of X are independent
+	for (int j=0; j<2; j++)
+	{
+		#pragma omp task if (host_spawn_tasks(X))
+		{
+			struct h_block* X0 = X->child[2*j];
+			struct h_block* X1 = X->child[1+2*j];
+
+			if (lower!=transpose)
+			{
+				host_h_solve_left(T->child[0], lower, unit, transpose, X0, epsilon);
+				host_h_mul_add(X1, -1.0, off_diagonal, transpose, X0, false, epsilon);
+				host_h_solve_left(T->child[3], lower, unit, transpose, X1, epsilon);
+			}
+			else
+			{
+				host_h_solve_left(T->child[3], lower, unit, transpose, X1, epsilon);
+				host_h_mul_add(X0, -1.0, off_diagonal, transpose, X1, false, epsilon);
+				host_h_solve_left(T->child[0], lower, unit, transpose, X0, epsilon);
+			}
+		}
+	}
+	#pragma omp taskwait
+}
+
+// X = X*op(T)^-1 for a block X in the block column of the diagonal block T, i.e. X' = op(T)'^-1*X'
+static void host_h_solve_right(struct h_block* T, bool lower, bool unit, bool transpose, struct h_block* X, double epsilon)
+{
+	if (X->type==H_BLOCK_LOW_RANK)
+	{
+		host_h_triangular_solve(T, lower, unit, !transpose, X->V, X->cols, X->rank);
+		return;
+	}
+	if (X->type==H_BLOCK_DENSE)
+	{
+		std::vector<double> X_transposed((size_t)X->cols*X->rows);
+		host_dense_transpose(X->A, X->rows, X->rows, X->cols, &X_transposed[0], X->cols);
+		host_h_triangular_solve(T, lower, unit, !transpose, &X_transposed[0], X->cols, X->rows);
+		host_dense_transpose(&X_transposed[0], X->cols, X->cols, X->rows, X->A, X->rows);
+		return;
+	}
+	if (T->type!=H_BLOCK_SUBDIVIDED)
+		host_block_structure_error();
+
+	struct h_block* off_diagonal = lower ? T->child[1] : T->child[2];
+
+	// both row halves of X are independent
+	for (int i=0; i<2; i++)
+	{
+		#pragma omp task if (host_spawn_tasks(X))
+		{
+			struct h_block* X0 = X->child[i];
+			struct h_block* X1 = X->child[i+2];
+
+			if (lower==transpose)
+			{
+				host_h_solve_right(T->child[0], lower, unit, transpose, X0, epsilon);
+				host_h_mul_add(X1, -1.0, X0, false, off_diagonal, transpose, epsilon);
+				host_h_solve_right(T->child[3], lower, unit, transpose, X1, epsilon);
+			}
+			else
+			{
+				host_h_solve_right(T->child[3], lower, unit, transpose, X1, epsilon);
+				host_h_mul_add(X0, -1.0, X1, false, off_diagonal, transpose, epsilon);
+				host_h_solve_right(T->child[0], lower, unit, transpose, X0, epsilon);
+			}
+		}
+	}
+	#pragma omp taskwait
+}
+
+// factors of op(X) = left*right' for a dense or low rank block X; a dense block is written as op(X)*I' or I*(op(X)')',
+// whichever has fewer columns, with the factors that are not part of X stored in left_storage / right_storage
+static int host_get_factors(struct h_block* X, bool transpose, double** left, double** right, std::vector<double>& left_storage, std::vector<double>& right_storage)
+{
+	if (X->type==H_BLOCK_LOW_RANK)
+	{
+		*left = transpose ? X->V : X->U;
+		*right = transpose ? X->U : X->V;
+		return X->rank;
+	}
+
+	int m = transpose ? X->cols : X->rows;
+	int n = transpose ? X->rows : X->cols;
+
+	if (n<=m)
+	{
+		// op(X)*I'
+		if (transpose)
+		{
+			left_storage.resize((size_t)m*n);
+			host_dense_transpose(X->A, X->rows, X->rows, X->cols, &left_storage[0], m);
+			*left = &left_storage[0];
+		}
+		else
+			*left = X->A;
+		right_storage.assign((size_t)n*n, 0.0);
+		for (int i=0; i<n; i++)
+			right_storage[i + (size_t)i*n] = 1.0;
+		*right = &right_storage[0];
+		return n;
+	}
+
+	// I*(op(X)')'
+	left_storage.assign((size_t)m*m, 0.0);
+	for (int i=0; i<m; i++)
+		left_storage[i + (size_t)i*m] = 1.0;
+	*left = &left_storage[0];
+	if (transpose)
+		*right = X->A;
+	else
+	{
+		right_storage.resize((size_t)n*m);
+		host_dense_transpose(X->A, X->rows, X->rows, X->cols, &right_storage[0], n);
+		*right = &right_storage[0];
+	}
+	return m;
+}
+
+// subdivides the dense or low rank block C like the rows of op(A) and the columns of op(B); every child gets its part
+// of the entries or of the factors
+static void host_split_block(struct h_block* C, struct h_block* A, bool transpose_A, struct h_block* B, bool transpose_B)
+{
+	struct h_block* A00 = host_get_child(A, transpose_A, 0, 0);
+	struct h_block* B00 = host_get_child(B, transpose_B, 0, 0);
+	int split_rows = transpose_A ? A00->cols : A00->rows;
+	int split_cols = transpose_B ? B00->rows : B00->cols;
+
+	for (int j=0; j<2; j++)
+		for (int i=0; i<2; i++)
+		{
+			int row_offset = i*split_rows;
+			int col_offset = j*split_cols;
+			int rows = (i==0) ? split_rows : C->rows-split_rows;
+			int cols = (j==0) ? split_cols : C->cols-split_cols;
+			struct h_block* child = host_new_h_block(C->row_l+row_offset, rows, C->col_l+col_offset, cols, C->type);
+
+			if (C->type==H_BLOCK_DENSE)
+			{
+				child->A = new double[(size_t)rows*cols];
+				for (int c=0; c<cols; c++)
+					memcpy(&(child->A[(size_t)c*rows]), &(C->A[row_offset + (size_t)(col_offset+c)*C->rows]), rows*sizeof(double));
+			}
+			else
+			{
+				child->rank = C->rank;
+				child->U = new double[(size_t)rows*C->rank];
+				child->V = new double[(size_t)cols*C->rank];
+				for (int c=0; c<C->rank; c++)
+				{
+					memcpy(&(child->U[(size_t)c*rows]), &(C->U[row_offset + (size_t)c*C->rows]), rows*sizeof(double));
+					memcpy(&(child->V[(size_t)c*cols]), &(C->V[col_offset + (size_t)c*C->cols]), cols*sizeof(double));
+				}
+			}
+
+			C->child[i+2*j] = child;
+		}
+}
+
+// joins the children made by host_split_block into C again; the low rank children are put side by side (padded with
+// zeros) and truncated
+static void host_merge_block(struct h_block* C, double epsilon)
+{
+	if (C->type==H_BLOCK_DENSE)
+	{
+		for (int b=0; b<4; b++)
+		{
+			struct h_block* child = C->child[b];
+			int row_offset = child->row_l - C->row_l;
+			int col_offset = child->col_l - C->col_l;
+			for (int c=0; c<child->cols; c++)
+				memcpy(&(C->A[row_offset + (size_t)(col_offset+c)*C->rows]), &(child->A[(size_t)c*child->rows]), child->rows*sizeof(double));
+		}
+	}
+	else
+	{
+		int rank = 0;
+		for (int b=0; b<4; b++)
+			rank += C->child[b]->rank;
+
+		double* U_new = new double[(size_t)C->rows*rank];
+		double* V_new = new double[(size_t)C->cols*rank];
+		memset(U_new, 0, (size_t)C->rows*rank*sizeof(double));
+		memset(V_new, 0, (size_t)C->cols*rank*sizeof(double));
+
+		int column = 0;
+		for (int b=0; b<4; b++)
+		{
+			struct h_block* child = C->child[b];
+			int row_offset = child->row_l - C->row_l;
+			int col_offset = child->col_l - C->col_l;
+			for (int c=0; c<child->rank; c++, column++)
+			{
+				memcpy(&U_new[row_offset + (size_t)column*C->rows], &(child->U[(size_t)c*child->rows]), child->rows*sizeof(double));
+				memcpy(&V_new[col_offset + (size_t)column*C->cols], &(child->V[(size_t)c*child->cols]), child->cols*sizeof(double));
+			}
+		}
+
+		delete [] C->U;
+		delete [] C->V;
+		C->U = U_new;
+		C->V = V_new;
+		C->rank = rank;
+
+		host_truncate_low_rank_block(C, epsilon);
+	}
+
+	for (int b=0; b<4; b++)
+	{
+		host_destroy_h_block(C->child[b]);
+		C->child[b] = 0;
+	}
+}
+
+// C = C + alpha*op(A)*op(B) for the children of the subdivided blocks A, B and C; missing children of C are skipped
+static void host_h_mul_add_children(struct h_block* C, double alpha, struct h_block* A, bool transpose_A, struct h_block* B, bool transpose_B, double epsilon)
+{
+	for (int j=0; j<2; j++)
+		for (int i=0; i<2; i++)
+		{
+			struct h_block* C_ij = C->child[i+2*j];
+			if (C_ij==0)
+				continue;
+
+			#pragma omp task if (host_spawn_tasks(C_ij))
+			for (int l=0; l<2; l++)
+				host_h_mul_add(C_ij, alpha, host_get_child(A, transpose_A, i, l), transpose_A, host_get_child(B, transpose_B, l, j), transpose_B, epsilon);
+		}
+	#pragma omp taskwait
+}
+
+// C = C + alpha*op(A)*op(B) with truncation of the updated low rank blocks of C to the relative accuracy epsilon
+static void host_h_mul_add(struct h_block* C, double alpha, struct h_block* A, bool transpose_A, struct h_block* B, bool transpose_B, double epsilon)
+{
+	int inner = transpose_A ? A->rows : A->cols;
+
+	// a low rank or dense factor gives a low rank product, i.e. op(A)*op(B) = left*(op(B)'*right)'
+	if (A->type!=H_BLOCK_SUBDIVIDED)
+	{
+		double* left;
+		double* right;
+		std::vector<double> left_storage, right_storage;
+		int rank = host_get_factors(A, transpose_A, &left, &right, left_storage, right_storage);
+		if (rank==0)
+			return;
+
+		std::vector<double> W((size_t)C->cols*rank, 0.0);
+		host_h_mult_dense(1.0, B, !transpose_B, right, inner, rank, &W[0], C->cols);
+		host_add_low_rank(C, alpha, left, C->rows, &W[0], C->cols, rank, epsilon);
+		return;
+	}
+
+	// op(A)*op(B) = (op(A)*left)*right'
+	if (B->type!=H_BLOCK_SUBDIVIDED)
+	{
+		double* left;
+		double* right;
+		std::vector<double> left_storage, right_storage;
+		int rank = host_get_factors(B, transpose_B, &left, &right, left_storage, right_storage);
+		if (rank==0)
+			return;
+
+		std::vector<double> W((size_t)C->rows*rank, 0.0);
+		host_h_mult_dense(1.0, A, transpose_A, left, inner, rank, &W[0], C->rows);
+		host_add_low_rank(C, alpha, &W[0], C->rows, right, C->cols, rank, epsilon);
+		return;
+	}
+
+	if (C->type==H_BLOCK_SUBDIVIDED)
+	{
+		host_h_mul_add_children(C, alpha, A, transpose_A, B, transpose_B, epsilon);
+		return;
+	}
+
+	// product of two subdivided blocks into a leaf: the leaf is subdivided for the update and joined afterwards
+	host_split_block(C, A, transpose_A, B, transpose_B);
+	host_h_mul_add_children(C, alpha, A, transpose_A, B, transpose_B, epsilon);
+	host_merge_block(C, epsilon);
+}
+
+// A = L*U in place; stops at the first failing diagonal block and returns its status
+static int host_h_lu(struct h_block* A, double epsilon)
+{
+	if (A->type==H_BLOCK_DENSE)
+		return host_dense_lu(A->A, A->rows);
+	if (A->type!=H_BLOCK_SUBDIVIDED)
+		host_block_structure_error();
+
+	int status = host_h_lu(A->child[0], epsilon);
+	if (status!=H_FACTORIZATION_SUCCESS)
+		return status;
+
+	// A01 = L00^-1*A01 and A10 = A10*U00^-1 are independent
+	#pragma omp task if (host_spawn_tasks(A))
+	host_h_solve_left(A->child[0], true, true, false, A->child[2], epsilon);
+	host_h_solve_right(A->child[0], false, false, false, A->child[1], epsilon);
+	#pragma omp taskwait
+
+	// Schur complement A11 = A11 - L10*U01
+	host_h_mul_add(A->child[3], -1.0, A->child[1], false, A->child[2], false, epsilon);
+	return host_h_lu(A->child[3], epsilon);
+}
+
+// A = L*L' in place on and below the diagonal; stops at the first failing diagonal block and returns its status
+static int host_h_cholesky(struct h_block* A, double epsilon)
+{
+	if (A->type==H_BLOCK_DENSE)
+		return host_dense_cholesky(A->A, A->rows);
+	if (A->type!=H_BLOCK_SUBDIVIDED)
+		host_block_structure_error();
+
+	int status = host_h_cholesky(A->child[0], epsilon);
+	if (status!=H_FACTORIZATION_SUCCESS)
+		return status;
+
+	// A10 = A10*L00^-T, A11 = A11 - L10*L10'
+	host_h_solve_right(A->child[0], true, false, true, A->child[1], epsilon);
+	host_h_mul_add(A->child[3], -1.0, A->child[1], false, A->child[1], true, epsilon);
+	return host_h_cholesky(A->child[3], epsilon);
+}
+
+// children of the clusters in the depth-first numbered cluster table; every cluster is identified with the first
+// cluster of the same index range (i.e. the clusters of set 2 with the ones of set 1)
+static void host_get_cluster_children(std::vector<int>& children, std::vector<int>& canonical, struct cluster_table* clusters)
+{
+	children.assign(2*clusters->count, -1);
+	canonical.resize(clusters->count);
+
+	std::map<std::pair<int,int>, int> first_cluster;
+	std::vector<int> path;
+
+	for (int c=0; c<clusters->count; c++)
+	{
+		// the parent is the closest cluster on the current path that is on a coarser level and contains c
+		while (!path.empty() && ((clusters->level[path.back()]>=clusters->level[c]) || (clusters->l[path.back()]>clusters->l[c]) || (clusters->u[path.back()]<clusters->u[c])))
+			path.pop_back();
+
+		if (!path.empty())
+		{
+			int parent = path.back();
+			children[2*parent + ((children[2*parent]<0) ? 0 : 1)] = c;
+		}
+		path.push_back(c);
+
+		std::pair<int,int> range(clusters->l[c], clusters->u[c]);
+		if (first_cluster.count(range)==0)
+			first_cluster[range] = c;
+		canonical[c] = first_cluster[range];
+	}
+}
+
+// index of the block c1 x c2 in the block list (-1 if there is none); a symmetric block list only holds the blocks
+// on and above the diagonal, a block below is found as the transpose of its mirror
+static int host_find_block(int c1, int c2, struct host_factorization_input* input, bool* transposed)
+{
+	std::map<std::pair<int,int>, int>::iterator it = input->block_index.find(std::make_pair(c1, c2));
+	*transposed = false;
+	if ((it==input->block_index.end()) && (input->mat_vec_info->symmetric!=0))
+	{
+		it = input->block_index.find(std::make_pair(c2, c1));
+		*transposed = true;
+	}
+
+	return (it!=input->block_index.end()) ? it->second : -1;
+}
+
+// checks that the block list partitions the clusters c1 x c2 in the way the factorization recurses: every subdivided
+// block has children on both sides and subdivided diagonal blocks (c1 x c1, c2 x c2) for the triangular solves, and
+// the diagonal leaves are dense
+static bool host_check_h_partition(int c1, int c2, bool lower_only, struct host_factorization_input* input)
+{
+	bool transposed;
+	int block_index = host_find_block(c1, c2, input, &transposed);
+	if (block_index>=0)
+		return (c1!=c2) || (input->blocks->work_type[block_index]==WT_DENSE);
+
+	if ((input->children[2*c1]<0) || (input->children[2*c2]<0))
+		return false;
+	if ((host_find_block(c1, c1, input, &transposed)>=0) || (host_find_block(c2, c2, input, &transposed)>=0))
+		return false;
+
+	for (int j=0; j<2; j++)
+		for (int i=0; i<2; i++)
+		{
+			if (lower_only && (c1==c2) && (i<j))
+				continue;
+			if (!host_check_h_partition(input->children[2*c1+i], input->children[2*c2+j], lower_only, input))
+				return false;
+		}
+
+	return true;
+}
+
+// builds the H matrix structure for the clusters c1 x c2 down to the blocks of the block list, which are collected in
+// leaves to be filled afterwards; without the blocks above the diagonal if lower_only
+static struct h_block* host_build_h_block(int c1, int c2, bool lower_only, struct host_factorization_input* input, std::vector<struct host_factorization_leaf>& leaves)
+{
+	struct cluster_table* clusters = &(input->blocks->clusters);
+	struct h_block* block = host_new_h_block(clusters->l[c1], clusters->u[c1]-clusters->l[c1]+1, clusters->l[c2], clusters->u[c2]-clusters->l[c2]+1, H_BLOCK_SUBDIVIDED);
+
+	bool transposed;
+	int block_index = host_find_block(c1, c2, input, &transposed);
+	if (block_index>=0)
+	{
+		struct host_factorization_leaf leaf;
+		leaf.block = block;
+		leaf.block_index = block_index;
+		leaf.transposed = transposed;
+		leaves.push_back(leaf);
+		block->type = (input->blocks->work_type[block_index]==WT_DENSE) ? H_BLOCK_DENSE : H_BLOCK_LOW_RANK;
+		return block;
+	}
+
+	if ((input->children[2*c1]<0) || (input->children[2*c2]<0))
+		host_block_structure_error();
+
+	for (int j=0; j<2; j++)
+		for (int i=0; i<2; i++)
+		{
+			if (lower_only && (c1==c2) && (i<j))
+				continue;
+			block->child[i+2*j] = host_build_h_block(input->children[2*c1+i], input->children[2*c2+j], lower_only, input, leaves);
+		}
+
+	return block;
+}
+
+// copies a precomputed block (stored in double) into the leaf or assembles / compresses it again
+static void host_fill_h_leaf(struct host_factorization_leaf* leaf, struct host_factorization_input* input, std::vector<double>& U_local, std::vector<double>& V_local, std::vector<char>& used, std::vector<double>& reference)
+{
+	struct h_block* block = leaf->block;
+	int i = leaf->block_index;
+	int rows = block->rows;
+	int cols = block->cols;
+	bool is_double = (input->block_precision==0) || (input->block_precision[i]==BLOCK_PRECISION_DOUBLE);
+
+	if (block->type==H_BLOCK_DENSE)
+	{
+		block->A = new double[(size_t)rows*cols];
+		bool is_stored = (input->dA!=0) && is_double && (input->dA_offsets[i+1]>input->dA_offsets[i]);
+
+		if (is_stored && leaf->transposed)
+			host_dense_transpose(&(input->dA[input->dA_offsets[i]]), cols, cols, rows, block->A, rows);
+		else if (is_stored)
+			memcpy(block->A, &(input->dA[input->dA_offsets[i]]), (size_t)rows*cols*sizeof(double));
+		else
+			host_fill_block(block->A, rows, block->row_l, rows, block->col_l, cols, input->points, input->points, input->assem);
+		return;
+	}
+
+	int a = i - input->mat_vec_info->dense_count;
+	bool is_stored = (input->U!=0) && is_double && (input->k_per_item[a]!=HOST_RANK_NOT_STORED);
+	double* U;
+	double* V;
+
+	if (is_stored)
+	{
+		block->rank = input->k_per_item[a];
+		U = &(input->U[input->U_offsets[a]]);
+		V = &(input->V[input->V_offsets[a]]);
+		if (leaf->transposed)
+			std::swap(U, V);
+	}
+	else
+	{
+		// the transpose of a block of a symmetric kernel is the block itself
+		int k_max = std::min(input->k, std::min(rows, cols));
+		U_local.resize((size_t)rows*k_max);
+		V_local.resize((size_t)cols*k_max);
+		used.resize(rows+cols);
+		reference.resize(rows+cols);
+		block->rank = host_aca(&U_local[0], &V_local[0], block->row_l, rows, block->col_l, cols, input->points, input->points, input->aca_epsilon, k_max, input->assem, -1, &used[0], &reference[0]);
+		U = &U_local[0];
+		V = &V_local[0];
+	}
+
+	block->U = new double[(size_t)rows*block->rank];
+	block->V = new double[(size_t)cols*block->rank];
+	memcpy(block->U, U, (size_t)rows*block->rank*sizeof(double));
+	memcpy(block->V, V, (size_t)cols*block->rank*sizeof(double));
+}
+
+int host_h_factorize(struct h_factorization* factorization, int type, double epsilon, struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, struct point_set* points, double aca_epsilon, int k, struct system_assembler* assem, double* dA, size_t* dA_offsets, double* U, double* V, size_t* U_offsets, size_t* V_offsets, int* k_per_item, char* block_precision)
+{
+	if ((type!=H_FACTORIZATION_LU) && (type!=H_FACTORIZATION_CHOLESKY))
+	{
+		printf("Unknown H matrix factorization %d. Exiting...\n", type);
+		exit(1);
+	}
+
+	struct host_factorization_input input;
+	input.blocks = blocks;
+	input.mat_vec_info = mat_vec_info;
+	input.points = points;
+	input.aca_epsilon = aca_epsilon;
+	input.k = k;
+	input.assem = assem;
+	input.dA = dA; input.dA_offsets = dA_offsets;
+	input.U = U; input.V = V; input.U_offsets = U_offsets; input.V_offsets = V_offsets; input.k_per_item = k_per_item;
+	input.block_precision = block_precision;
+
+	// rows and columns are both indexed by the clusters of set 1
+	std::vector<int> canonical;
+	host_get_cluster_children(input.children, canonical, &(blocks->clusters));
+	for (int i=0; i<blocks->count; i++)
+		input.block_index[std::make_pair(canonical[blocks->cluster1[i]], canonical[blocks->cluster2[i]])] = i;
+
+	factorization->type = type;
+	factorization->n = points->size;
+	factorization->epsilon = epsilon;
+	factorization->root = 0;
+
+	// the root cluster has to cover all points and the partition has to fit the recursion
+	if ((blocks->clusters.count==0) || (blocks->clusters.l[0]!=0) || (blocks->clusters.u[0]!=points->size-1))
+		return H_FACTORIZATION_INVALID_PARTITION;
+	if (!host_check_h_partition(0, 0, (type==H_FACTORIZATION_CHOLESKY), &input))
+		return H_FACTORIZATION_INVALID_PARTITION;
+
+	std::vector<struct host_factorization_leaf> leaves;
+	factorization->root = host_build_h_block(0, 0, (type==H_FACTORIZATION_CHOLESKY), &input, leaves);
+
+	int thread_count = host_get_thread_count();
+
+	#pragma omp parallel num_threads(thread_count)
+	{
+		std::vector<double> U_local, V_local, reference;
+		std::vector<char> used;
+
+		#pragma omp for schedule(dynamic)
+		for (size_t l=0; l<leaves.size(); l++)
+			host_fill_h_leaf(&leaves[l], &input, U_local, V_local, used, reference);
+	}
+
+	// the recursion runs in (work stealing) tasks; the diagonal blocks are factorized by the thread of the single
+	// region only, so the status needs no synchronization
+	int status = H_FACTORIZATION_SUCCESS;
+	#pragma omp parallel num_threads(thread_count)
+	{
+		#pragma omp single
+		{
+			if (type==H_FACTORIZATION_LU)
+				status = host_h_lu(factorization->root, epsilon);
+			else
+				status = host_h_cholesky(factorization->root, epsilon);
+		}
+	}
+
+	// a partial factorization is of no use
+	if (status!=H_FACTORIZATION_SUCCESS)
+		host_destroy_h_factorization(factorization);
+
+	return status;
+}
+
+void host_h_factorization_solve(double* X, int nrhs, struct h_factorization* factorization)
+{
+	int n = factorization->n;
+
+	#pragma omp parallel num_threads(host_get_thread_count())
+	{
+		#pragma omp single
+		{
+			if (factorization->type==H_FACTORIZATION_LU)
+			{
+				// L*U*X_new = X
+				host_h_triangular_solve(factorization->root, true, true, false, X, n, nrhs);
+				host_h_triangular_solve(factorization->root, false, false, false, X, n, nrhs);
+			}
+			else
+			{
+				// L*L'*X_new = X
+				host_h_triangular_solve(factorization->root, true, false, false, X, n, nrhs);
+				host_h_triangular_solve(factorization->root, true, false, true, X, n, nrhs);
+			}
+		}
+	}
+}
+
+static size_t host_h_block_size(struct h_block* block, int* max_rank)
+{
+	if (block==0)
+		return 0;
+
+	if (block->type==H_BLOCK_DENSE)
+		return (size_t)block->rows*block->cols*sizeof(double);
+
+	if (block->type==H_BLOCK_LOW_RANK)
+	{
+		*max_rank = std::max(*max_rank, block->rank);
+		return (size_t)(block->rows+block->cols)*block->rank*sizeof(double);
+	}
+
+	size_t size = 0;
+	for (int c=0; c<4; c++)
+		size += host_h_block_size(block->child[c], max_rank);
+	return size;
+}
+
+size_t host_h_factorization_size(struct h_factorization* factorization, int* max_rank)
+{
+	int rank = 0;
+	size_t size = host_h_block_size(factorization->root, &rank);
+
+	if (max_rank!=0)
+		*max_rank = rank;
+
+	return size;
+}
+
+void host_destroy_h_factorization(struct h_factorization* factorization)
+{
+	host_destroy_h_block(factorization->root);
+	factorization->root = 0;
+}
@@ -0,0 +1,100 @@
+// Copyright (C) 2016 Peter Zaspel
+//
+// This file is part of hmglib.
+//
+// hmglib is free software: you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// hmglib is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hmglib.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HOST_FACTORIZATION_H
+#define HOST_FACTORIZATION_H
+
+#include <stddef.h>
+
+#include "morton.h"
+#include "tree.h"
+#include "system_assembler.h"
+
+// factorizations of a square H matrix: H ~ L*U with unit lower triangular L, or H ~ L*L' for symmetric positive
+// definite matrices
+#define H_FACTORIZATION_LU 1
+#define H_FACTORIZATION_CHOLESKY 2
+
+// status of host_h_factorize (and factorize_h_matrix): a zero pivot in a diagonal block of the H-LU factorization
+// (which does not pivot), a non-positive pivot in the H-Cholesky factorization, i.e. the H matrix is not positive
+// definite within the truncation accuracy of the factorization, or a block partition the factorization cannot work
+// on (rows and columns not on one cluster tree, a low rank diagonal block or a subdivided block next to a diagonal
+// leaf)
+#define H_FACTORIZATION_SUCCESS 0
+#define H_FACTORIZATION_ZERO_PIVOT 1
+#define H_FACTORIZATION_NOT_POSITIVE_DEFINITE 2
+#define H_FACTORIZATION_INVALID_PARTITION 3
+
+// types of the blocks of a hierarchical matrix
+#define H_BLOCK_DENSE 1
+#define H_BLOCK_LOW_RANK 2
+#define H_BLOCK_SUBDIVIDED 3
+
+// block of a hierarchical matrix covering the rows row_l, ..., row_l+rows-1 and the columns col_l, ..., col_l+cols-1
+// (in Z order); a dense block is stored column-major in A, a low rank block as A = U*V' with U (rows x rank) and V
+// (cols x rank), a subdivided block has the children child[i+2*j] for the row half i and the column half j, where the
+// children above the diagonal of a Cholesky factor are 0
+struct h_block
+{
+	int row_l;
+	int rows;
+	int col_l;
+	int cols;
+	int type;
+
+	double* A;
+	double* U;
+	double* V;
+	int rank;
+
+	struct h_block* child[4];
+};
+
+// H-LU or H-Cholesky factorization, stored in place of the H matrix it was computed from: the LU factorization keeps
+// L (without its unit diagonal) below and U on and above the diagonal, the Cholesky factorization only the blocks of
+// L on and below the diagonal
+struct h_factorization
+{
+	int type;
+	int n;
+
+	// relative accuracy of the truncation of every low rank block after each update
+	double epsilon;
+
+	struct h_block* root;
+};
+
+// factorizes the square H matrix given by the block list (rows and columns on the same cluster tree, i.e. the same
+// Z order sorted point set; symmetric block lists stand for the full matrix) with blockwise truncated low rank updates
+// to the relative accuracy epsilon; precomputed blocks stored in double (see host_h_matrix_mvp) are copied, all others
+// are assembled / compressed again; runs in tasks on the host threads; returns H_FACTORIZATION_SUCCESS or the reason
+// of the breakdown, in which case the factorization is already destroyed (root 0), so that the caller can fall back
+// to H_FACTORIZATION_LU, a smaller epsilon or a diagonal shift of the kernel; the block partition is checked before
+// anything is built (H_FACTORIZATION_INVALID_PARTITION)
+extern int host_h_factorize(struct h_factorization* factorization, int type, double epsilon, struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, struct point_set* points, double aca_epsilon, int k, struct system_assembler* assem, double* dA, size_t* dA_offsets, double* U, double* V, size_t* U_offsets, size_t* V_offsets, int* k_per_item, char* block_precision);
+
+// X = H^-1*X in Z order for nrhs right hand sides (column-major X, n x nrhs) by forward and backward substitution
+// with the factors
+extern void host_h_factorization_solve(double* X, int nrhs, struct h_factorization* factorization);
+
+// bytes of the dense blocks and low rank factors of the factorization; the maximum rank of its low rank blocks is
+// stored in max_rank (if not 0)
+extern size_t host_h_factorization_size(struct h_factorization* factorization, int* max_rank);
+
+extern void host_destroy_h_factorization(struct h_factorization* factorization);
+
+#endif
@@ -0,0 +1,263 @@
+// Copyright (C) 2016 Peter Zaspel
+//
+// This file is part of hmglib.
+//
+// hmglib is free software: you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// hmglib is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hmglib.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "host_helper.h"
+
+void host_set_thread_count(int thread_count)
+{
+#ifdef _OPENMP
+	if (thread_count>0)
+		omp_set_num_threads(thread_count);
+#endif
+}
+
+void host_compute_minmax(struct point_set* points)
+{
+	int point_count = points->size;
+
+	for (int d=0; d<points->dim; d++)
+	{
+		double* coords = points->coords[d];
+		double minimum = coords[0];
+		double maximum = coords[0];
+
+		#pragma omp parallel for schedule(static) reduction(min:minimum) reduction(max:maximum)
+		for (int i=0; i<point_count; i++)
+		{
+			minimum = std::min(minimum, coords[i]);
+			maximum = std::max(maximum, coords[i]);
+		}
+
+		points->min_per_dim[d] = minimum;
+		points->max_per_dim[d] = maximum;
+	}
+}
+
+int host_get_thread_count()
+{
+#ifdef _OPENMP
+	return omp_get_max_threads();
+#else
+	return 1;
+#endif
+}
+
+int host_get_thread_id()
+{
+#ifdef _OPENMP
+	return omp_get_thread_num();
+#else
+	return 0;
+#endif
+}
+
+#define HOST_RADIX_BITS 8
+#define HOST_RADIX_BUCKETS (1 << HOST_RADIX_BITS)
+
+// stable parallel LSD radix sort of the (code, order) pairs following the lowest key_bits bits of code
+static void host_radix_sort(uint64_t* code, uint64_t* order, int point_count, int key_bits)
+{
+	int thread_count = host_get_thread_count();
+
+	uint64_t* code_tmp = new uint64_t[point_count];
+	uint64_t* order_tmp = new uint64_t[point_count];
+	size_t* histograms = new size_t[thread_count*HOST_RADIX_BUCKETS];
+
+	uint64_t* code_in = code;
+	uint64_t* order_in = order;
+	uint64_t* code_out = code_tmp;
+	uint64_t* order_out = order_tmp;
+
+	for (int shift=0; shift<key_bits; shift+=HOST_RADIX_BITS)
+	{
+		int skip_pass = 0;
+
+		#pragma omp parallel num_threads(thread_count)
+		{
+			int t = host_get_thread_id();
+			int chunk = (point_count + thread_count - 1) / thread_count;
+			int begin = std::min(t*chunk, point_count);
+			int end = std::min(begin+chunk, point_count);
+
+			// count the digits in the chunk of this thread
+			size_t* histogram = histograms + t*HOST_RADIX_BUCKETS;
+			for (int b=0; b<HOST_RADIX_BUCKETS; b++)
+				histogram[b] = 0;
+			for (int i=begin; i<end; i++)
+				histogram[(code_in[i] >> shift) & (HOST_RADIX_BUCKETS-1)]++;
+
+			#pragma omp barrier
+
+			// exclusive scan over (digit, thread) gives stable scatter offsets
+			#pragma omp single
+			{
+				size_t offset = 0;
+				for (int b=0; b<HOST_RADIX_BUCKETS; b++)
+				{
+					size_t bucket_count = 0;
+					for (int tt=0; tt<thread_count; tt++)
+					{
+						size_t count = histograms[tt*HOST_RADIX_BUCKETS+b];
+						histograms[tt*HOST_RADIX_BUCKETS+b] = offset;
+						offset += count;
+						bucket_count += count;
+					}
+					// all keys share the same digit, the pass would not change anything
+					if (bucket_count==(size_t)point_count)
+						skip_pass = 1;
+				}
+			}
+
+			if (!skip_pass)
+			{
+				for (int i=begin; i<end; i++)
+				{
+					size_t pos = histogram[(code_in[i] >> shift) & (HOST_RADIX_BUCKETS-1)]++;
+					code_out[pos] = code_in[i];
+					order_out[pos] = order_in[i];
+				}
+			}
+		}
+
+		if (!skip_pass)
+		{
+			std::swap(code_in, code_out);
+			std::swap(order_in, order_out);
+		}
+	}
+
+	// make sure that the result ends up in the input arrays
+	if (code_in!=code)
+	{
+		memcpy(code, code_in, point_count*sizeof(uint64_t));
+		memcpy(order, order_in, point_count*sizeof(uint64_t));
+	}
+
+	delete [] histograms;
+	delete [] order_tmp;
+	delete [] code_tmp;
+}
+
+void host_get_morton_ordering(struct point_set* points, struct morton_code* morton, uint64_t* order)
+{
+	int point_count = points->size;
+
+	// generate index array initially set to 1:point_count
+	#pragma omp parallel for schedule(static)
+	for (int i=0; i<point_count; i++)
+		order[i] = (uint64_t)i;
+
+	// find ordering of points following Z curve; as for the GPU, the Morton codes themselves end up being sorted
+	host_radix_sort(morton->code, order, point_count, morton->dim*morton->bits);
+}
+
+void host_reorder_point_set(struct point_set* points, uint64_t* order)
+{
+	int point_count = points->size;
+	int dim = points->dim;
+
+	double** coords_tmp = new double*[dim];
+	for (int d=0; d<dim; d++)
+		coords_tmp[d] = new double[point_count];
+	unsigned int* point_ids_tmp = new unsigned int[point_count];
+
+	// permute all coordinates and the point indices in one pass over order
+	#pragma omp parallel for schedule(static)
+	for (int i=0; i<point_count; i++)
+	{
+		uint64_t source = order[i];
+		for (int d=0; d<dim; d++)
+			coords_tmp[d][i] = points->coords[d][source];
+		point_ids_tmp[i] = points->point_ids[source];
+	}
+
+	#pragma omp parallel for schedule(static)
+	for (int i=0; i<point_count; i++)
+	{
+		for (int d=0; d<dim; d++)
+			points->coords[d][i] = coords_tmp[d][i];
+		points->point_ids[i] = point_ids_tmp[i];
+	}
+
+	for (int d=0; d<dim; d++)
+		delete [] coords_tmp[d];
+	delete [] coords_tmp;
+	delete [] point_ids_tmp;
+}
+
+void host_reorder_vector(double* vector, int vector_length, uint64_t* order)
+{
+	double* vector_tmp = new double[vector_length];
+
+	#pragma omp parallel for schedule(static)
+	for (int i=0; i<vector_length; i++)
+		vector_tmp[i] = vector[order[i]];
+
+	memcpy(vector, vector_tmp, vector_length*sizeof(double));
+	delete [] vector_tmp;
+}
+
+void host_reorder_back_vector(double* vector, int vector_length, uint64_t* order)
+{
+	double* vector_tmp = new double[vector_length];
+
+	#pragma omp parallel for schedule(static)
+	for (int i=0; i<vector_length; i++)
+		vector_tmp[order[i]] = vector[i];
+
+	memcpy(vector, vector_tmp, vector_length*sizeof(double));
+	delete [] vector_tmp;
+}
+
+void host_reorder_matrix(double* matrix, int row_count, int column_count, uint64_t* order)
+{
+	double* matrix_tmp = new double[(size_t)row_count*column_count];
+
+	// every row is gathered once for all columns
+	#pragma omp parallel for schedule(static)
+	for (int i=0; i<row_count; i++)
+	{
+		uint64_t source = order[i];
+		for (int c=0; c<column_count; c++)
+			matrix_tmp[i + (size_t)c*row_count] = matrix[source + (size_t)c*row_count];
+	}
+
+	memcpy(matrix, matrix_tmp, (size_t)row_count*column_count*sizeof(double));
+	delete [] matrix_tmp;
+}
+
+void host_reorder_back_matrix(double* matrix, int row_count, int column_count, uint64_t* order)
+{
+	double* matrix_tmp = new double[(size_t)row_count*column_count];
+
+	#pragma omp parallel for schedule(static)
+	for (int i=0; i<row_count; i++)
+	{
+		uint64_t target = order[i];
+		for (int c=0; c<column_count; c++)
+			matrix_tmp[target + (size_t)c*row_count] = matrix[i + (size_t)c*row_count];
+	}
+
+	memcpy(matrix, matrix_tmp, (size_t)row_count*column_count*sizeof(double));
+	delete [] matrix_tmp;
+}
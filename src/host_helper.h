@@ -0,0 +1,48 @@
+// Copyright (C) 2016 Peter Zaspel
+//
+// This file is part of hmglib.
+//
+// hmglib is free software: you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// hmglib is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hmglib.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HOST_HELPER_H
+#define HOST_HELPER_H
+
+#include "morton.h"
+
+// sets the number of host threads used by the host backend (thread_count<=0 keeps the OpenMP default)
+extern void host_set_thread_count(int thread_count);
+
+// number of threads used by parallel regions of the host backend
+extern int host_get_thread_count();
+
+// id of the calling thread within a parallel region of the host backend
+extern int host_get_thread_id();
+
+extern void host_compute_minmax(struct point_set* points);
+
+// sorts the Morton codes (parallel LSD radix sort) and stores the resulting permutation of the points in order
+extern void host_get_morton_ordering(struct point_set* points, struct morton_code* morton, uint64_t* order);
+
+extern void host_reorder_point_set(struct point_set* points, uint64_t* order);
+
+extern void host_reorder_vector(double* vector, int vector_length, uint64_t* order);
+
+extern void host_reorder_back_vector(double* vector, int vector_length, uint64_t* order);
+
+// row permutations of a column-major row_count x column_count matrix, i.e. of column_count vectors at once
+extern void host_reorder_matrix(double* matrix, int row_count, int column_count, uint64_t* order);
+
+extern void host_reorder_back_matrix(double* matrix, int row_count, int column_count, uint64_t* order);
+
+#endif
@@ -0,0 +1,824 @@
+// Copyright (C) 2016 Peter Zaspel
+//
+// This file is part of hmglib.
+//
+// hmglib is free software: you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// hmglib is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hmglib.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "host_morton.h"
+#include "host_helper.h"
+#include "host_tree.h"
+#include "host_linear_algebra.h"
+#include "host_io.h"
+#include "host_factorization.h"
+#include "krylov.h"
+#include "profiling.h"
+#include "kernel_system_assembler.h"
+#include "hmglib.h"
+
+// sets up a host point set with point_count random points in dim dimensions
+void init_host_point_set(struct point_set* points, struct morton_code* morton, int point_count, int dim, int bits)
+{
+	points->dim = dim;
+	points->size = point_count;
+	points->coords = new double*[dim];
+	for (int d=0; d<dim; d++)
+	{
+		points->coords[d] = new double[point_count];
+		for (int i=0; i<point_count; i++)
+			points->coords[d][i] = drand48();
+	}
+	points->max_per_dim = new double[dim];
+	points->min_per_dim = new double[dim];
+	points->point_ids = new unsigned int[point_count];
+	for (int i=0; i<point_count; i++)
+		points->point_ids[i] = i;
+
+	morton->code = new uint64_t[point_count];
+	morton->size = point_count;
+	morton->dim = dim;
+	morton->bits = bits;
+	morton->max_values = 0;
+	morton->min_values = 0;
+}
+
+void destroy_host_point_set(struct point_set* points, struct morton_code* morton)
+{
+	for (int d=0; d<points->dim; d++)
+		delete [] points->coords[d];
+	delete [] points->coords;
+	delete [] points->max_per_dim;
+	delete [] points->min_per_dim;
+	delete [] points->point_ids;
+	delete [] morton->code;
+}
+
+double relative_error(double* y, double* y_test, int n)
+{
+	double y_test_norm = 0.0;
+	double abs_error = 0.0;
+	for (int i=0; i<n; i++)
+	{
+		y_test_norm += y_test[i]*y_test[i];
+		abs_error += (y_test[i]-y[i])*(y_test[i]-y[i]);
+	}
+	return sqrt(abs_error)/sqrt(y_test_norm);
+}
+
+// context of the H matrix operator used in the Krylov solver tests
+struct host_h_matrix_operator
+{
+	struct block_list* blocks;
+	struct mat_vec_data_info* mat_vec_info;
+	struct point_set* points;
+	double eta;
+	double epsilon;
+	int k;
+	struct system_assembler* assem;
+	double* dA; size_t* dA_offsets;
+	double* U; double* V; size_t* U_offsets; size_t* V_offsets; int* k_per_item;
+	char* block_precision;
+	struct mvp_workspace* workspace;
+};
+
+void apply_host_h_matrix_operator(double* x, double* y, void* context)
+{
+	struct host_h_matrix_operator* op = (struct host_h_matrix_operator*)context;
+	host_h_matrix_mvp(x, y, op->blocks, op->mat_vec_info, op->points, op->points, op->eta, op->epsilon, op->k, op->assem, op->dA, op->dA_offsets, op->U, op->V, op->U_offsets, op->V_offsets, op->k_per_item, op->block_precision, op->workspace);
+}
+
+void apply_host_h_factorization(double* r, double* z, void* context)
+{
+	struct h_factorization* factorization = (struct h_factorization*)context;
+	memcpy(z, r, factorization->n*sizeof(double));
+	host_h_factorization_solve(z, 1, factorization);
+}
+
+// factorizes with factorization_epsilon and, if the factorization breaks down, with up to two ten times smaller
+// epsilons; returns the status of the last attempt
+int factorize_host_h_matrix_operator(struct h_factorization* factorization, int type, double factorization_epsilon, struct host_h_matrix_operator* op)
+{
+	int status = H_FACTORIZATION_SUCCESS;
+	for (int attempt=0; attempt<3; attempt++)
+	{
+		status = host_h_factorize(factorization, type, factorization_epsilon, op->blocks, op->mat_vec_info, op->points, op->epsilon, op->k, op->assem, op->dA, op->dA_offsets, op->U, op->V, op->U_offsets, op->V_offsets, op->k_per_item, op->block_precision);
+		if (status==H_FACTORIZATION_SUCCESS)
+			break;
+
+		// a smaller epsilon does not change the block partition
+		if (status==H_FACTORIZATION_INVALID_PARTITION)
+		{
+			printf("H-%s factorization failed: invalid partition\n", (type==H_FACTORIZATION_LU) ? "LU" : "Cholesky");
+			break;
+		}
+
+		printf("H-%s factorization (epsilon %.0le) failed: %s\n", (type==H_FACTORIZATION_LU) ? "LU" : "Cholesky", factorization_epsilon, (status==H_FACTORIZATION_ZERO_PIVOT) ? "zero pivot" : "not positive definite");
+		factorization_epsilon /= 10.0;
+	}
+	if (status!=H_FACTORIZATION_SUCCESS)
+		return status;
+
+	int max_rank;
+	size_t size = host_h_factorization_size(factorization, &max_rank);
+	printf("H-%s factorization (epsilon %.0le): %.3lf MB, maximum rank %d\n", (type==H_FACTORIZATION_LU) ? "LU" : "Cholesky", factorization_epsilon, (double)size/(1024.0*1024.0), max_rank);
+
+	return status;
+}
+
+// block that is the sum of two rank one blocks on the upper and the lower half of the rows; once the upper half is
+// approximated, the residual vanishes in all rows that the partially pivoted ACA would try next
+class two_halves_system_assembler : public system_assembler
+{
+	public:
+		int half;
+
+		double get_matrix_entry(int i, int j, struct point_set* point_set1_d, struct point_set* point_set2_d)
+		{
+			if (i<half)
+				return (1.0+i)*cos(0.1*j);
+			return 1.0e-3*(1.0+i-half)*sin(0.2*j+0.3);
+		}
+};
+
+int main( int argc, char* argv[])
+{
+	if (argc!=8)
+	{
+		printf("./host_hmglib_test <Nx> <Ny> <k> <c_leaf> <exponent of epsilon> <eta> <dim>\n");
+		return 0;
+	}
+
+	int point_count[2];
+	point_count[0] = atoi(argv[1]);
+	point_count[1] = atoi(argv[2]);
+	int k = atoi(argv[3]);
+	int c_leaf = atoi(argv[4]);
+	double epsilon = pow(10.0, atoi(argv[5]));
+	double eta = atof(argv[6]);
+	int dim = atoi(argv[7]);
+	int bits = (dim==1) ? 32 : 64/dim;
+	int max_level = 50;
+
+	// generate random points and compute their Z order
+	struct point_set points[2];
+	struct morton_code morton[2];
+	uint64_t* order[2];
+	srand48(1);
+	for (int i=0; i<2; i++)
+	{
+		init_host_point_set(&points[i], &morton[i], point_count[i], dim, bits);
+		host_compute_minmax(&points[i]);
+		host_get_morton_code(&points[i], &morton[i]);
+		order[i] = new uint64_t[point_count[i]];
+		host_get_morton_ordering(&points[i], &morton[i], order[i]);
+		host_reorder_point_set(&points[i], order[i]);
+	}
+
+	// build block cluster tree
+	struct work_item root_h;
+	memset(&root_h, 0, sizeof(struct work_item));
+	root_h.set1_l = 0;
+	root_h.set1_u = point_count[0] - 1;
+	root_h.set2_l = 0;
+	root_h.set2_u = point_count[1] - 1;
+
+	struct block_list blocks;
+	double* level_seconds = new double[max_level];
+	int level_count;
+	host_traverse(root_h, &blocks, &morton[0], &morton[1], &points[0], &points[1], eta, max_level, c_leaf, false, level_seconds, &level_count);
+
+	struct mat_vec_data_info mat_vec_info;
+	host_organize_mat_vec_data(&blocks, &mat_vec_info);
+	printf("Block list: %d blocks on %d clusters, %.3lf MB (%.3lf MB as work items)\n", blocks.count, blocks.clusters.count, (double)block_list_size(&blocks)/(1024.0*1024.0), (double)blocks.count*sizeof(struct work_item)/(1024.0*1024.0));
+
+	// setup kernel matrix assembler
+	struct gaussian_kernel_system_assembler assem;
+	assem.regularization = 0.0;
+
+	// generate random vector x
+	double* x = new double[point_count[1]];
+	double* y = new double[point_count[0]];
+	double* y_test = new double[point_count[0]];
+	for (int i=0; i<point_count[1]; i++)
+		x[i] = drand48();
+
+	// apply full mvp for testing puposes
+	host_full_mvp(x, y_test, &points[0], &points[1], &assem);
+
+	// apply H matrix to same vector, first with on-the-fly assembly, then with precomputed blocks
+	host_h_matrix_mvp(x, y, &blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &assem, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+	printf("Relative error in H matrix matrix-vector product (on the fly): %le\n", relative_error(y, y_test, point_count[0]));
+
+	double* dA; double* U; double* V;
+	size_t* dA_offsets; size_t* U_offsets; size_t* V_offsets;
+	int* k_per_item;
+	host_precompute_dense(&blocks, &mat_vec_info, &points[0], &points[1], &assem, &dA, &dA_offsets);
+	host_precompute_aca(&blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &assem, &U, &V, &U_offsets, &V_offsets, &k_per_item);
+
+	host_h_matrix_mvp(x, y, &blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &assem, dA, dA_offsets, U, V, U_offsets, V_offsets, k_per_item, 0, 0);
+	printf("Relative error in H matrix matrix-vector product (precomputed): %le\n", relative_error(y, y_test, point_count[0]));
+
+	// apply the transposed H matrix with the same blocks and check <H*x, z> = <x, H'*z>
+	double* z = new double[point_count[0]];
+	double* w = new double[point_count[1]];
+	double* w_test = new double[point_count[1]];
+	for (int i=0; i<point_count[0]; i++)
+		z[i] = drand48();
+	host_full_mvp(z, w_test, &points[1], &points[0], &assem);
+	host_h_matrix_mvp_transpose(z, w, &blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &assem, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+	double transpose_on_the_fly_error = relative_error(w, w_test, point_count[1]);
+	host_h_matrix_mvp_transpose(z, w, &blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &assem, dA, dA_offsets, U, V, U_offsets, V_offsets, k_per_item, 0, 0);
+	double hx_z = 0.0;
+	double x_htz = 0.0;
+	for (int i=0; i<point_count[0]; i++)
+		hx_z += y[i]*z[i];
+	for (int i=0; i<point_count[1]; i++)
+		x_htz += x[i]*w[i];
+	printf("Relative error in transposed H matrix matrix-vector product: %le (on the fly), %le (precomputed), adjoint mismatch %le\n", transpose_on_the_fly_error, relative_error(w, w_test, point_count[1]), fabs(hx_z-x_htz)/fabs(hx_z));
+	delete [] z; delete [] w; delete [] w_test;
+
+	// apply H matrix to more right hand sides than fit into one column tile at once, with atomic and with row-owned
+	// accumulation, and compare every column with a full MVP
+	int nrhs = HOST_COLUMN_TILE+3;
+	double* X = new double[(size_t)point_count[1]*nrhs];
+	double* Y = new double[(size_t)point_count[0]*nrhs];
+	double* Y_row_owned = new double[(size_t)point_count[0]*nrhs];
+	for (size_t i=0; i<(size_t)point_count[1]*nrhs; i++)
+		X[i] = drand48();
+	host_h_matrix_mmp(X, Y, nrhs, &blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &assem, dA, dA_offsets, U, V, U_offsets, V_offsets, k_per_item, 0, 0);
+	struct mvp_workspace mmp_workspace;
+	init_mvp_workspace(&mmp_workspace, host_get_thread_count());
+	mmp_workspace.accumulation = MVP_ACCUMULATE_ROW_OWNED;
+	host_h_matrix_mmp(X, Y_row_owned, nrhs, &blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &assem, 0, 0, 0, 0, 0, 0, 0, 0, &mmp_workspace);
+	destroy_mvp_workspace(&mmp_workspace);
+	double max_mmp_error = 0.0;
+	double max_row_owned_mmp_error = 0.0;
+	for (int c=0; c<nrhs; c++)
+	{
+		host_full_mvp(&X[(size_t)c*point_count[1]], y, &points[0], &points[1], &assem);
+		max_mmp_error = fmax(max_mmp_error, relative_error(&Y[(size_t)c*point_count[0]], y, point_count[0]));
+		max_row_owned_mmp_error = fmax(max_row_owned_mmp_error, relative_error(&Y_row_owned[(size_t)c*point_count[0]], y, point_count[0]));
+	}
+	printf("Maximum relative error in H matrix matrix-matrix product (%d columns): %le (precomputed), %le (on the fly, row-owned accumulation)\n", nrhs, max_mmp_error, max_row_owned_mmp_error);
+	delete [] X; delete [] Y; delete [] Y_row_owned;
+
+	// repeated MVPs with a persistent workspace, which is sized in advance and must not allocate at all
+	struct mvp_workspace workspace;
+	init_mvp_workspace(&workspace, host_get_thread_count());
+	host_reserve_mvp_workspace(&workspace, &blocks, &mat_vec_info, k, 1);
+	long setup_allocations = get_mvp_workspace_allocations(&workspace);
+	long max_allocations_per_mvp = 0;
+	for (int i=0; i<3; i++)
+	{
+		host_h_matrix_mvp(x, y, &blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &assem, 0, 0, 0, 0, 0, 0, 0, 0, &workspace);
+		max_allocations_per_mvp = std::max(max_allocations_per_mvp, workspace.allocations_last_mvp);
+		host_h_matrix_mvp(x, y, &blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &assem, dA, dA_offsets, U, V, U_offsets, V_offsets, k_per_item, 0, &workspace);
+		max_allocations_per_mvp = std::max(max_allocations_per_mvp, workspace.allocations_last_mvp);
+	}
+	printf("Relative error in H matrix matrix-vector product (persistent workspace): %le\n", relative_error(y, y_test, point_count[0]));
+	printf("Workspace: %.3lf MB, %ld allocations in set up, at most %ld allocations per MVP in %ld MVPs\n", (double)get_mvp_workspace_size(&workspace)/(1024.0*1024.0), setup_allocations, max_allocations_per_mvp, workspace.mvp_count);
+
+	// profile a precomputed MVP; the blocks have to cover every matrix entry exactly once
+	struct h_matrix_profile profile;
+	init_h_matrix_profile(&profile, 0);
+	workspace.profile = &profile;
+	profile_phase_begin(&profile, PROFILE_MVP);
+	host_h_matrix_mvp(x, y, &blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &assem, dA, dA_offsets, U, V, U_offsets, V_offsets, k_per_item, 0, &workspace);
+	profile_phase_end(&profile, PROFILE_MVP);
+	workspace.profile = 0;
+	profile_block_statistics(&profile, &blocks, &mat_vec_info, k_per_item, dA_offsets, 0, 0, k, true, true);
+	bool entries_covered = (profile.dense_entries + profile.aca_entries == (long)point_count[0]*point_count[1]);
+	profile_add_traversal_level_seconds(&profile, level_seconds, level_count);
+	delete [] level_seconds;
+	double traversal_seconds = 0.0;
+	for (int l=0; l<profile.traversal_level_count; l++)
+		traversal_seconds += profile.traversal_level_seconds[l];
+	printf("Profile: tree traversal %.3lf ms in %d levels\n", traversal_seconds*1e3, profile.traversal_level_count);
+	printf("Profile: MVP %.3lf ms (dense %.3lf ms, low rank %.3lf ms), %.3lf GFlop/s, %.3lf MB stored, all entries covered: %s\n", profile.last_mvp_seconds*1e3, profile.phase_seconds[PROFILE_MVP_DENSE]*1e3, profile.phase_seconds[PROFILE_MVP_LOW_RANK]*1e3, profile.flops_per_mvp/profile.last_mvp_seconds*1e-9, (double)profile.bytes_stored/(1024.0*1024.0), entries_covered ? "yes" : "no");
+	char profile_file_name[] = "host_hmglib_test_profile.json";
+	FILE* profile_file = fopen(profile_file_name, "w");
+	write_h_matrix_profile_json(profile_file, &profile, "host");
+	fclose(profile_file);
+	destroy_h_matrix_profile(&profile);
+
+	// row-owned accumulation with one and with several threads has to give bitwise identical results
+	double* y_reproduced = new double[point_count[0]];
+	bool reproducible = true;
+	for (int precomputed=0; precomputed<2; precomputed++)
+	{
+		for (int t=0; t<2; t++)
+		{
+			struct mvp_workspace row_owned_workspace;
+			init_mvp_workspace(&row_owned_workspace, (t==0) ? 1 : std::max(host_get_thread_count(), 4));
+			row_owned_workspace.accumulation = MVP_ACCUMULATE_ROW_OWNED;
+			host_reserve_mvp_workspace(&row_owned_workspace, &blocks, &mat_vec_info, k, 1);
+			if (precomputed)
+				host_h_matrix_mvp(x, (t==0) ? y_reproduced : y, &blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &assem, dA, dA_offsets, U, V, U_offsets, V_offsets, k_per_item, 0, &row_owned_workspace);
+			else
+				host_h_matrix_mvp(x, (t==0) ? y_reproduced : y, &blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &assem, 0, 0, 0, 0, 0, 0, 0, 0, &row_owned_workspace);
+			destroy_mvp_workspace(&row_owned_workspace);
+		}
+		reproducible = reproducible && (memcmp(y, y_reproduced, point_count[0]*sizeof(double))==0);
+	}
+	printf("Relative error in H matrix matrix-vector product (row-owned accumulation): %le, bitwise identical for 1 and %d threads: %s\n", relative_error(y, y_test, point_count[0]), std::max(host_get_thread_count(), 4), reproducible ? "yes" : "no");
+	delete [] y_reproduced;
+
+	// on-the-fly MVPs with the blocks handed out in work item order and by decreasing estimated cost
+	for (int scheduling=MVP_SCHEDULE_WORK_ITEM_ORDER; scheduling<=MVP_SCHEDULE_COST_ORDERED; scheduling++)
+	{
+		struct mvp_workspace scheduled_workspace;
+		init_mvp_workspace(&scheduled_workspace, std::max(host_get_thread_count(), 4));
+		scheduled_workspace.scheduling = scheduling;
+		host_reserve_mvp_workspace(&scheduled_workspace, &blocks, &mat_vec_info, k, 1);
+		struct h_matrix_profile schedule_profile;
+		init_h_matrix_profile(&schedule_profile, 0);
+		scheduled_workspace.profile = &schedule_profile;
+		host_h_matrix_mvp(x, y, &blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &assem, 0, 0, 0, 0, 0, 0, 0, 0, &scheduled_workspace);
+		printf("Relative error in H matrix matrix-vector product (%s schedule, %d threads): %le, imbalance predicted %.3lf, measured %.3lf, %ld allocations\n", (scheduling==MVP_SCHEDULE_COST_ORDERED) ? "cost-ordered" : "work item order", scheduled_workspace.thread_count, relative_error(y, y_test, point_count[0]), schedule_profile.mvp_predicted_imbalance, schedule_profile.mvp_thread_imbalance, scheduled_workspace.allocations_last_mvp);
+
+		// the block costs are estimated once for the same blocks and again for the precomputed blocks
+		struct mvp_block_costs* first_costs = scheduled_workspace.block_costs;
+		host_h_matrix_mvp(x, y, &blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &assem, 0, 0, 0, 0, 0, 0, 0, 0, &scheduled_workspace);
+		bool costs_kept = (scheduled_workspace.block_costs==first_costs);
+		host_h_matrix_mvp(x, y, &blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &assem, dA, dA_offsets, U, V, U_offsets, V_offsets, k_per_item, 0, &scheduled_workspace);
+		bool costs_rebuilt = (scheduled_workspace.block_costs->dA==(void*)dA) && (scheduled_workspace.block_costs->U==(void*)U);
+		printf("Block costs kept for the next MVP: %s, rebuilt for the precomputed blocks: %s, order sorted: %s\n", costs_kept ? "yes" : "no", costs_rebuilt ? "yes" : "no", (scheduled_workspace.block_costs->order!=0) ? "yes" : "no");
+		destroy_h_matrix_profile(&schedule_profile);
+		destroy_mvp_workspace(&scheduled_workspace);
+	}
+
+	// store only the blocks that fit into half of the full storage and recompute the others, then grow the budget
+	size_t full_size = (dA_offsets[mat_vec_info.dense_count]+U_offsets[mat_vec_info.aca_count]+V_offsets[mat_vec_info.aca_count])*sizeof(double);
+	char* stored = new char[mat_vec_info.total_count];
+	double* cached_dA = 0; double* cached_U = 0; double* cached_V = 0;
+	size_t* cached_dA_offsets = 0; size_t* cached_U_offsets = 0; size_t* cached_V_offsets = 0;
+	int* cached_k_per_item = 0;
+	for (int step=0; step<2; step++)
+	{
+		size_t budget = (step==0) ? full_size/2 : full_size;
+		// the second pass knows the ranks of the stored ACA blocks and fills the remaining budget
+		for (int pass=0; pass<2; pass++)
+		{
+			host_select_stored_blocks(stored, &blocks, &mat_vec_info, k, cached_k_per_item, budget);
+			host_store_dense_blocks(&blocks, &mat_vec_info, &points[0], &points[1], &assem, stored, &cached_dA, &cached_dA_offsets);
+			host_store_aca_blocks(&blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &assem, stored, 0, &cached_U, &cached_V, &cached_U_offsets, &cached_V_offsets, &cached_k_per_item);
+		}
+		host_h_matrix_mvp(x, y, &blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &assem, cached_dA, cached_dA_offsets, cached_U, cached_V, cached_U_offsets, cached_V_offsets, cached_k_per_item, 0, &workspace);
+		size_t cached_size = (cached_dA_offsets[mat_vec_info.dense_count]+cached_U_offsets[mat_vec_info.aca_count]+cached_V_offsets[mat_vec_info.aca_count])*sizeof(double);
+		printf("Relative error in H matrix matrix-vector product (block cache, %.3lf of %.3lf MB budget): %le, within budget: %s\n", (double)cached_size/(1024.0*1024.0), (double)budget/(1024.0*1024.0), relative_error(y, y_test, point_count[0]), (cached_size<=budget) ? "yes" : "no");
+	}
+	delete [] stored;
+	delete [] cached_dA; delete [] cached_U; delete [] cached_V;
+	delete [] cached_dA_offsets; delete [] cached_U_offsets; delete [] cached_V_offsets;
+	delete [] cached_k_per_item;
+
+	// write all blocks to a scratch file and stream them back in chunks of 1 MB for each MVP
+	char scratch_file_name[] = "host_hmglib_test.scratch";
+	struct host_block_stream stream;
+	host_write_block_stream(&stream, scratch_file_name, 1<<20, &blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &assem, 0);
+	host_stream_h_matrix_mmp(x, y, 1, false, &stream, &blocks, &mat_vec_info, &points[0], &points[1], &workspace);
+	printf("Relative error in H matrix matrix-vector product (out of core, %d chunks): %le\n", stream.chunk_count, relative_error(y, y_test, point_count[0]));
+	size_t stream_size = stream.block_offsets[mat_vec_info.total_count]*sizeof(double);
+	host_destroy_block_stream(&stream);
+
+	// the same H matrix through the API of hmglib.h: set up and precompute it for the points in Z order, write it to a
+	// file and map the file into a second h_matrix_data initialized with the same points
+	char file_name[] = "host_hmglib_test.hmat";
+	struct h_matrix_data data[2];
+	for (int j=0; j<2; j++)
+	{
+		init_h_matrix_data_on_backend(&data[j], point_count, dim, bits, BACKEND_HOST);
+		data[j].eta = eta;
+		data[j].max_level = max_level;
+		data[j].c_leaf = c_leaf;
+		data[j].k = k;
+		data[j].epsilon = epsilon;
+		data[j].root_level_set_1 = 0;
+		data[j].root_level_set_2 = 0;
+		data[j].assem = &assem;
+		for (int i=0; i<2; i++)
+			for (int d=0; d<dim; d++)
+				memcpy(data[j].coords_d[i][d], points[i].coords[d], point_count[i]*sizeof(double));
+	}
+
+	setup_h_matrix(&data[0]);
+	precompute_dense(&data[0]);
+	precompute_aca(&data[0]);
+	apply_h_matrix_mvp(x, y, &data[0]);
+	double api_error = relative_error(y, y_test, point_count[0]);
+	save_h_matrix(&data[0], file_name);
+
+	// a second reduction of the storage precision keeps the blocks of the first one
+	reduce_storage_precision(&data[0], 1e-5, BLOCK_PRECISION_SINGLE, BLOCK_PRECISION_BFLOAT16);
+	reduce_storage_precision(&data[0], 1e-5, BLOCK_PRECISION_SINGLE, BLOCK_PRECISION_BFLOAT16);
+	apply_h_matrix_mvp(x, y, &data[0]);
+	double api_reduced_error = relative_error(y, y_test, point_count[0]);
+	destroy_h_matrix_data(&data[0]);
+
+	// the precomputation, the recompression and the reduction of the storage precision keep the read-only mapped
+	// blocks
+	load_h_matrix(&data[1], file_name);
+	precompute_dense(&data[1]);
+	precompute_aca(&data[1]);
+	recompress_aca(&data[1]);
+	reduce_storage_precision(&data[1], 1e-5, BLOCK_PRECISION_SINGLE, BLOCK_PRECISION_BFLOAT16);
+	apply_h_matrix_mvp(x, y, &data[1]);
+	printf("Relative error in H matrix matrix-vector product (hmglib.h API): %le (set up), %le (reduced precision), %le (mapped from file)\n", api_error, api_reduced_error, relative_error(y, y_test, point_count[0]));
+	destroy_h_matrix_data(&data[1]);
+	remove(file_name);
+
+	// recompress ACA blocks and apply the H matrix again
+	host_recompress_aca(&blocks, &mat_vec_info, epsilon, &U, &V, &U_offsets, &V_offsets, k_per_item);
+	host_h_matrix_mvp(x, y, &blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &assem, dA, dA_offsets, U, V, U_offsets, V_offsets, k_per_item, 0, 0);
+	printf("Relative error in H matrix matrix-vector product (recompressed): %le\n", relative_error(y, y_test, point_count[0]));
+
+	// with a loose tolerance, the factors of most ACA blocks are stored in bfloat16; the MVP error has to stay within
+	// this tolerance (on a copy of the double blocks)
+	double bfloat16_tolerance = 3e-2;
+	size_t* bfloat16_dA_offsets = new size_t[mat_vec_info.dense_count+1];
+	size_t* bfloat16_U_offsets = new size_t[mat_vec_info.aca_count+1];
+	size_t* bfloat16_V_offsets = new size_t[mat_vec_info.aca_count+1];
+	memcpy(bfloat16_dA_offsets, dA_offsets, (mat_vec_info.dense_count+1)*sizeof(size_t));
+	memcpy(bfloat16_U_offsets, U_offsets, (mat_vec_info.aca_count+1)*sizeof(size_t));
+	memcpy(bfloat16_V_offsets, V_offsets, (mat_vec_info.aca_count+1)*sizeof(size_t));
+	double* bfloat16_dA = new double[dA_offsets[mat_vec_info.dense_count]];
+	double* bfloat16_U = new double[U_offsets[mat_vec_info.aca_count]];
+	double* bfloat16_V = new double[V_offsets[mat_vec_info.aca_count]];
+	memcpy(bfloat16_dA, dA, dA_offsets[mat_vec_info.dense_count]*sizeof(double));
+	memcpy(bfloat16_U, U, U_offsets[mat_vec_info.aca_count]*sizeof(double));
+	memcpy(bfloat16_V, V, V_offsets[mat_vec_info.aca_count]*sizeof(double));
+	char* bfloat16_block_precision;
+	host_reduce_storage_precision(&blocks, &mat_vec_info, bfloat16_tolerance, BLOCK_PRECISION_SINGLE, BLOCK_PRECISION_BFLOAT16, &bfloat16_dA, &bfloat16_dA_offsets, &bfloat16_U, &bfloat16_V, &bfloat16_U_offsets, &bfloat16_V_offsets, k_per_item, &bfloat16_block_precision);
+	int bfloat16_count = 0;
+	for (int i=0; i<mat_vec_info.total_count; i++)
+		bfloat16_count += (bfloat16_block_precision[i]==BLOCK_PRECISION_BFLOAT16) ? 1 : 0;
+	host_h_matrix_mvp(x, y, &blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &assem, bfloat16_dA, bfloat16_dA_offsets, bfloat16_U, bfloat16_V, bfloat16_U_offsets, bfloat16_V_offsets, k_per_item, bfloat16_block_precision, 0);
+	double bfloat16_error = relative_error(y, y_test, point_count[0]);
+	printf("Relative error in H matrix matrix-vector product (tolerance %.0e, %d of %d ACA blocks in bfloat16): %le, within tolerance: %s\n", bfloat16_tolerance, bfloat16_count, mat_vec_info.aca_count, bfloat16_error, (bfloat16_error<=bfloat16_tolerance) ? "yes" : "no");
+
+	// the scratch file stores the blocks in the same reduced precisions; two MVPs are served by the same reader thread
+	host_write_block_stream(&stream, scratch_file_name, 1<<20, &blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &assem, bfloat16_block_precision);
+	for (int j=0; j<2; j++)
+		host_stream_h_matrix_mmp(x, y, 1, false, &stream, &blocks, &mat_vec_info, &points[0], &points[1], &workspace);
+	double bfloat16_stream_error = relative_error(y, y_test, point_count[0]);
+	size_t bfloat16_stream_size = stream.block_offsets[mat_vec_info.total_count]*sizeof(double);
+	printf("Relative error in H matrix matrix-vector product (out of core, tolerance %.0e, %.3lf of %.3lf MB scratch file): %le, within tolerance: %s\n", bfloat16_tolerance, (double)bfloat16_stream_size/(1024.0*1024.0), (double)stream_size/(1024.0*1024.0), bfloat16_stream_error, (bfloat16_stream_error<=bfloat16_tolerance) ? "yes" : "no");
+	host_destroy_block_stream(&stream);
+	delete [] bfloat16_dA; delete [] bfloat16_U; delete [] bfloat16_V;
+	delete [] bfloat16_dA_offsets; delete [] bfloat16_U_offsets; delete [] bfloat16_V_offsets;
+	delete [] bfloat16_block_precision;
+
+	// store the blocks in single precision and the factors down to bfloat16 where their rounding error stays below
+	// reduced_tolerance*||H||_F, the products are still summed up in double; the tolerance is not tied to epsilon since
+	// for epsilon close to the single precision unit roundoff (6e-8) no block would be reduced
+	double reduced_tolerance = 1e-5;
+	char* block_precision;
+	size_t double_size = (dA_offsets[mat_vec_info.dense_count]+U_offsets[mat_vec_info.aca_count]+V_offsets[mat_vec_info.aca_count])*sizeof(double);
+	host_reduce_storage_precision(&blocks, &mat_vec_info, reduced_tolerance, BLOCK_PRECISION_SINGLE, BLOCK_PRECISION_BFLOAT16, &dA, &dA_offsets, &U, &V, &U_offsets, &V_offsets, k_per_item, &block_precision);
+	size_t reduced_size = (dA_offsets[mat_vec_info.dense_count]+U_offsets[mat_vec_info.aca_count]+V_offsets[mat_vec_info.aca_count])*sizeof(double);
+	host_h_matrix_mvp(x, y, &blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &assem, dA, dA_offsets, U, V, U_offsets, V_offsets, k_per_item, block_precision, 0);
+	double reduced_error = relative_error(y, y_test, point_count[0]);
+	printf("Relative error in H matrix matrix-vector product (reduced precision, tolerance %.0e, %.3lf of %.3lf MB): %le, within tolerance: %s\n", reduced_tolerance, (double)reduced_size/(1024.0*1024.0), (double)double_size/(1024.0*1024.0), reduced_error, (reduced_error<=reduced_tolerance) ? "yes" : "no");
+
+	// swap the kernel on the same block cluster tree; the ACA blocks of the Matern kernel start at the pivots chosen by
+	// the ACA+ references or at the pivot rows taken from the Gaussian factors
+	struct matern_kernel_system_assembler matern_assem;
+	matern_assem.regularization = 0.0;
+	int* first_rows = new int[mat_vec_info.aca_count];
+	host_get_aca_first_rows(first_rows, &blocks, &mat_vec_info, U, U_offsets, k_per_item, block_precision);
+	host_full_mvp(x, y_test, &points[0], &points[1], &matern_assem);
+	for (int warm_start=0; warm_start<2; warm_start++)
+	{
+		double* matern_U = 0; double* matern_V = 0;
+		size_t* matern_U_offsets = 0; size_t* matern_V_offsets = 0;
+		int* matern_k_per_item = 0;
+		host_store_aca_blocks(&blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &matern_assem, 0, warm_start ? first_rows : 0, &matern_U, &matern_V, &matern_U_offsets, &matern_V_offsets, &matern_k_per_item);
+		long rank_sum = 0;
+		for (int a=0; a<mat_vec_info.aca_count; a++)
+			rank_sum += matern_k_per_item[a];
+		host_h_matrix_mvp(x, y, &blocks, &mat_vec_info, &points[0], &points[1], eta, epsilon, k, &matern_assem, 0, 0, matern_U, matern_V, matern_U_offsets, matern_V_offsets, matern_k_per_item, 0, 0);
+		printf("Relative error in H matrix matrix-vector product (Matern kernel on the same tree, %s): %le, average rank %.3lf\n", warm_start ? "warm-started pivots" : "cold start", relative_error(y, y_test, point_count[0]), (double)rank_sum/mat_vec_info.aca_count);
+		delete [] matern_U; delete [] matern_V; delete [] matern_U_offsets; delete [] matern_V_offsets; delete [] matern_k_per_item;
+	}
+	delete [] first_rows;
+
+	// the ACA+ references find the lower half of the two halves block, the partially pivoted ACA would stop at rank 1
+	{
+		two_halves_system_assembler halves_assem;
+		halves_assem.half = 32;
+		int m = 2*halves_assem.half;
+		double* halves_U = new double[m*4]; double* halves_V = new double[m*4];
+		double* reference = new double[2*m]; char* used = new char[2*m];
+		int rank = host_aca(halves_U, halves_V, 0, m, 0, m, &points[0], &points[1], 1.0e-10, 4, &halves_assem, -1, used, reference);
+		double error_norm = 0.0;
+		double norm = 0.0;
+		for (int j=0; j<m; j++)
+			for (int i=0; i<m; i++)
+			{
+				double a = halves_assem.get_matrix_entry(i, j, &points[0], &points[1]);
+				double s = 0.0;
+				for (int l=0; l<rank; l++)
+					s += halves_U[l*m+i]*halves_V[l*m+j];
+				error_norm += (a-s)*(a-s);
+				norm += a*a;
+			}
+		printf("ACA+ of a block of two rank one halves: rank %d, relative error %le\n", rank, sqrt(error_norm/norm));
+		delete [] halves_U; delete [] halves_V; delete [] reference; delete [] used;
+	}
+
+	// solve a regularized square system on the first point set with CG and GMRES; the points are already in Z order
+	struct gaussian_kernel_system_assembler regularized_assem;
+	regularized_assem.regularization = 1.0;
+	struct block_list square_blocks;
+	root_h.set2_u = point_count[0] - 1;
+	host_traverse(root_h, &square_blocks, &morton[0], &morton[0], &points[0], &points[0], eta, max_level, c_leaf, false, 0, 0);
+	struct mat_vec_data_info square_mat_vec_info;
+	host_organize_mat_vec_data(&square_blocks, &square_mat_vec_info);
+
+	struct host_h_matrix_operator op;
+	op.blocks = &square_blocks; op.mat_vec_info = &square_mat_vec_info; op.points = &points[0];
+	op.eta = eta; op.epsilon = epsilon; op.k = k; op.assem = &regularized_assem; op.workspace = &workspace;
+	op.block_precision = 0;
+	host_precompute_dense(&square_blocks, &square_mat_vec_info, &points[0], &points[0], &regularized_assem, &op.dA, &op.dA_offsets);
+	host_precompute_aca(&square_blocks, &square_mat_vec_info, &points[0], &points[0], eta, epsilon, k, &regularized_assem, &op.U, &op.V, &op.U_offsets, &op.V_offsets, &op.k_per_item);
+
+	struct krylov_operations ops;
+	host_krylov_operations(&ops, point_count[0]);
+	ops.apply = apply_host_h_matrix_operator;
+	ops.context = (void*)&op;
+
+	double* b = new double[point_count[0]];
+	double* solution = new double[point_count[0]];
+	for (int i=0; i<point_count[0]; i++)
+		b[i] = drand48();
+
+	double relative_residual;
+	memset(solution, 0, point_count[0]*sizeof(double));
+	int iterations = krylov_cg(solution, b, 1e-8, 1000, &relative_residual, &ops);
+	host_full_mvp(solution, y, &points[0], &points[0], &regularized_assem);
+	printf("CG: %d iterations, relative residual %le (H matrix), %le (full matrix)\n", iterations, relative_residual, relative_error(y, b, point_count[0]));
+
+	memset(solution, 0, point_count[0]*sizeof(double));
+	iterations = krylov_gmres(solution, b, 30, 1e-8, 1000, &relative_residual, &ops);
+	host_full_mvp(solution, y, &points[0], &points[0], &regularized_assem);
+	printf("GMRES(30): %d iterations, relative residual %le (H matrix), %le (full matrix)\n", iterations, relative_residual, relative_error(y, b, point_count[0]));
+
+	// a restart length below 1 runs GMRES(1) instead of looping without Arnoldi steps
+	memset(solution, 0, point_count[0]*sizeof(double));
+	iterations = krylov_gmres(solution, b, 0, 1e-8, 20, &relative_residual, &ops);
+	printf("GMRES(0): %d iterations (at most 20), relative residual %le (H matrix)\n", iterations, relative_residual);
+
+	// the same square matrix in symmetric mode, which only keeps the blocks on and above the diagonal
+	struct block_list symmetric_blocks;
+	host_traverse(root_h, &symmetric_blocks, &morton[0], &morton[0], &points[0], &points[0], eta, max_level, c_leaf, true, 0, 0);
+	struct mat_vec_data_info symmetric_mat_vec_info;
+	host_organize_mat_vec_data(&symmetric_blocks, &symmetric_mat_vec_info);
+	symmetric_mat_vec_info.symmetric = 1;
+	host_reserve_mvp_workspace(&workspace, &symmetric_blocks, &symmetric_mat_vec_info, k, 1);
+
+	struct host_h_matrix_operator symmetric_op = op;
+	symmetric_op.blocks = &symmetric_blocks; symmetric_op.mat_vec_info = &symmetric_mat_vec_info;
+	host_precompute_dense(&symmetric_blocks, &symmetric_mat_vec_info, &points[0], &points[0], &regularized_assem, &symmetric_op.dA, &symmetric_op.dA_offsets);
+	host_precompute_aca(&symmetric_blocks, &symmetric_mat_vec_info, &points[0], &points[0], eta, epsilon, k, &regularized_assem, &symmetric_op.U, &symmetric_op.V, &symmetric_op.U_offsets, &symmetric_op.V_offsets, &symmetric_op.k_per_item);
+
+	host_full_mvp(b, y_test, &points[0], &points[0], &regularized_assem);
+	host_h_matrix_mvp(b, y, &symmetric_blocks, &symmetric_mat_vec_info, &points[0], &points[0], eta, epsilon, k, &regularized_assem, 0, 0, 0, 0, 0, 0, 0, 0, &workspace);
+	double symmetric_on_the_fly_error = relative_error(y, y_test, point_count[0]);
+	apply_host_h_matrix_operator(b, y, &symmetric_op);
+	size_t square_size = (op.dA_offsets[square_mat_vec_info.dense_count]+op.U_offsets[square_mat_vec_info.aca_count]+op.V_offsets[square_mat_vec_info.aca_count])*sizeof(double);
+	size_t symmetric_size = (symmetric_op.dA_offsets[symmetric_mat_vec_info.dense_count]+symmetric_op.U_offsets[symmetric_mat_vec_info.aca_count]+symmetric_op.V_offsets[symmetric_mat_vec_info.aca_count])*sizeof(double);
+	printf("Relative error in symmetric H matrix matrix-vector product (%d of %d blocks, %.3lf of %.3lf MB stored): %le (on the fly), %le (precomputed)\n", symmetric_mat_vec_info.total_count, square_mat_vec_info.total_count, (double)symmetric_size/(1024.0*1024.0), (double)square_size/(1024.0*1024.0), symmetric_on_the_fly_error, relative_error(y, y_test, point_count[0]));
+
+	// the same symmetric H matrix through the API of hmglib.h, which checks that both point sets are the same
+	struct h_matrix_data symmetric_data;
+	int square_point_count[2] = {point_count[0], point_count[0]};
+	init_h_matrix_data_on_backend(&symmetric_data, square_point_count, dim, bits, BACKEND_HOST);
+	symmetric_data.eta = eta;
+	symmetric_data.max_level = max_level;
+	symmetric_data.c_leaf = c_leaf;
+	symmetric_data.k = k;
+	symmetric_data.epsilon = epsilon;
+	symmetric_data.root_level_set_1 = 0;
+	symmetric_data.root_level_set_2 = 0;
+	symmetric_data.assem = &regularized_assem;
+	symmetric_data.symmetric = 1;
+	for (int i=0; i<2; i++)
+		for (int d=0; d<dim; d++)
+			memcpy(symmetric_data.coords_d[i][d], points[0].coords[d], point_count[0]*sizeof(double));
+	setup_h_matrix(&symmetric_data);
+	apply_h_matrix_mvp(b, y, &symmetric_data);
+	printf("Relative error in symmetric H matrix matrix-vector product (hmglib.h API): %le\n", relative_error(y, y_test, point_count[0]));
+	destroy_h_matrix_data(&symmetric_data);
+
+	ops.context = (void*)&symmetric_op;
+	memset(solution, 0, point_count[0]*sizeof(double));
+	iterations = krylov_cg(solution, b, 1e-8, 1000, &relative_residual, &ops);
+	host_full_mvp(solution, y, &points[0], &points[0], &regularized_assem);
+	printf("CG (symmetric): %d iterations, relative residual %le (H matrix), %le (full matrix)\n", iterations, relative_residual, relative_error(y, b, point_count[0]));
+
+	// the same solve with the blocks in single precision wherever their rounding error stays below
+	// reduced_tolerance*||H||_F
+	host_reduce_storage_precision(&symmetric_blocks, &symmetric_mat_vec_info, reduced_tolerance, BLOCK_PRECISION_SINGLE, BLOCK_PRECISION_SINGLE, &symmetric_op.dA, &symmetric_op.dA_offsets, &symmetric_op.U, &symmetric_op.V, &symmetric_op.U_offsets, &symmetric_op.V_offsets, symmetric_op.k_per_item, &symmetric_op.block_precision);
+	memset(solution, 0, point_count[0]*sizeof(double));
+	iterations = krylov_cg(solution, b, 1e-8, 1000, &relative_residual, &ops);
+	host_full_mvp(solution, y, &points[0], &points[0], &regularized_assem);
+	printf("CG (symmetric, reduced precision): %d iterations, relative residual %le (H matrix), %le (full matrix)\n", iterations, relative_residual, relative_error(y, b, point_count[0]));
+
+	// a badly conditioned system on the same partitions, preconditioned with H-Cholesky / H-LU factorizations ten times
+	// less accurate than the H matrix and solved directly with ones as accurate as the H matrix (the truncation is
+	// relative to the block norms, so much coarser Cholesky factorizations of this Gaussian matrix are indefinite; if
+	// the H matrix itself is indefinite within epsilon, PCG is skipped and the direct solve falls back to H-LU)
+	struct gaussian_kernel_system_assembler ill_conditioned_assem;
+	ill_conditioned_assem.regularization = 1e-3;
+	struct host_h_matrix_operator ill_conditioned_op = op;
+	ill_conditioned_op.assem = &ill_conditioned_assem;
+	host_precompute_dense(&square_blocks, &square_mat_vec_info, &points[0], &points[0], &ill_conditioned_assem, &ill_conditioned_op.dA, &ill_conditioned_op.dA_offsets);
+	host_precompute_aca(&square_blocks, &square_mat_vec_info, &points[0], &points[0], eta, epsilon, k, &ill_conditioned_assem, &ill_conditioned_op.U, &ill_conditioned_op.V, &ill_conditioned_op.U_offsets, &ill_conditioned_op.V_offsets, &ill_conditioned_op.k_per_item);
+	struct host_h_matrix_operator ill_conditioned_symmetric_op = symmetric_op;
+	ill_conditioned_symmetric_op.assem = &ill_conditioned_assem;
+	ill_conditioned_symmetric_op.block_precision = 0;
+	host_precompute_dense(&symmetric_blocks, &symmetric_mat_vec_info, &points[0], &points[0], &ill_conditioned_assem, &ill_conditioned_symmetric_op.dA, &ill_conditioned_symmetric_op.dA_offsets);
+	host_precompute_aca(&symmetric_blocks, &symmetric_mat_vec_info, &points[0], &points[0], eta, epsilon, k, &ill_conditioned_assem, &ill_conditioned_symmetric_op.U, &ill_conditioned_symmetric_op.V, &ill_conditioned_symmetric_op.U_offsets, &ill_conditioned_symmetric_op.V_offsets, &ill_conditioned_symmetric_op.k_per_item);
+
+	ops.context = (void*)&ill_conditioned_symmetric_op;
+	memset(solution, 0, point_count[0]*sizeof(double));
+	iterations = krylov_cg(solution, b, 1e-8, 5000, &relative_residual, &ops);
+	host_full_mvp(solution, y, &points[0], &points[0], &ill_conditioned_assem);
+	printf("CG (regularization 1e-3): %d iterations, relative residual %le (H matrix), %le (full matrix)\n", iterations, relative_residual, relative_error(y, b, point_count[0]));
+
+	struct h_factorization cholesky;
+	if (factorize_host_h_matrix_operator(&cholesky, H_FACTORIZATION_CHOLESKY, 10.0*epsilon, &ill_conditioned_symmetric_op)==H_FACTORIZATION_SUCCESS)
+	{
+		ops.precondition = apply_host_h_factorization;
+		ops.precondition_context = (void*)&cholesky;
+		memset(solution, 0, point_count[0]*sizeof(double));
+		iterations = krylov_cg(solution, b, 1e-8, 5000, &relative_residual, &ops);
+		host_full_mvp(solution, y, &points[0], &points[0], &ill_conditioned_assem);
+		printf("PCG (regularization 1e-3, H-Cholesky preconditioner): %d iterations, relative residual %le (H matrix), %le (full matrix)\n", iterations, relative_residual, relative_error(y, b, point_count[0]));
+		host_destroy_h_factorization(&cholesky);
+		ops.precondition = 0;
+	}
+	else
+		printf("PCG (regularization 1e-3, H-Cholesky preconditioner): skipped, no H-Cholesky factorization\n");
+
+	ops.context = (void*)&ill_conditioned_op;
+	memset(solution, 0, point_count[0]*sizeof(double));
+	iterations = krylov_gmres(solution, b, 30, 1e-8, 5000, &relative_residual, &ops);
+	host_full_mvp(solution, y, &points[0], &points[0], &ill_conditioned_assem);
+	printf("GMRES(30) (regularization 1e-3): %d iterations, relative residual %le (H matrix), %le (full matrix)\n", iterations, relative_residual, relative_error(y, b, point_count[0]));
+
+	struct h_factorization lu;
+	if (factorize_host_h_matrix_operator(&lu, H_FACTORIZATION_LU, 10.0*epsilon, &ill_conditioned_op)==H_FACTORIZATION_SUCCESS)
+	{
+		ops.precondition = apply_host_h_factorization;
+		ops.precondition_context = (void*)&lu;
+		memset(solution, 0, point_count[0]*sizeof(double));
+		iterations = krylov_gmres(solution, b, 30, 1e-8, 5000, &relative_residual, &ops);
+		host_full_mvp(solution, y, &points[0], &points[0], &ill_conditioned_assem);
+		printf("GMRES(30) (regularization 1e-3, H-LU preconditioner): %d iterations, relative residual %le (H matrix), %le (full matrix)\n", iterations, relative_residual, relative_error(y, b, point_count[0]));
+		host_destroy_h_factorization(&lu);
+		ops.precondition = 0;
+	}
+	else
+		printf("GMRES(30) (regularization 1e-3, H-LU preconditioner): skipped, no H-LU factorization\n");
+
+	// direct solves with factorizations as accurate as the H matrix itself
+	if (factorize_host_h_matrix_operator(&lu, H_FACTORIZATION_LU, epsilon, &ill_conditioned_op)==H_FACTORIZATION_SUCCESS)
+	{
+		memcpy(solution, b, point_count[0]*sizeof(double));
+		host_h_factorization_solve(solution, 1, &lu);
+		host_full_mvp(solution, y, &points[0], &points[0], &ill_conditioned_assem);
+		printf("Direct solve (regularization 1e-3, H-LU): relative residual %le (full matrix)\n", relative_error(y, b, point_count[0]));
+		host_destroy_h_factorization(&lu);
+	}
+	else
+		printf("Direct solve (regularization 1e-3, H-LU): skipped, no H-LU factorization\n");
+
+	// the H-Cholesky solve falls back to H-LU on the unsymmetric block list
+	int cholesky_type = H_FACTORIZATION_CHOLESKY;
+	int status = factorize_host_h_matrix_operator(&cholesky, H_FACTORIZATION_CHOLESKY, epsilon, &ill_conditioned_symmetric_op);
+	if (status!=H_FACTORIZATION_SUCCESS)
+	{
+		cholesky_type = H_FACTORIZATION_LU;
+		status = factorize_host_h_matrix_operator(&cholesky, H_FACTORIZATION_LU, epsilon, &ill_conditioned_op);
+	}
+	if (status==H_FACTORIZATION_SUCCESS)
+	{
+		memcpy(solution, b, point_count[0]*sizeof(double));
+		host_h_factorization_solve(solution, 1, &cholesky);
+		host_full_mvp(solution, y, &points[0], &points[0], &ill_conditioned_assem);
+		printf("Direct solve (regularization 1e-3, H-Cholesky%s): relative residual %le (full matrix)\n", (cholesky_type==H_FACTORIZATION_LU) ? " failed, H-LU fallback" : "", relative_error(y, b, point_count[0]));
+		host_destroy_h_factorization(&cholesky);
+	}
+	else
+		printf("Direct solve (regularization 1e-3, H-Cholesky): skipped, no H-Cholesky or H-LU factorization\n");
+
+	// the block list of the two point sets has no common cluster tree for rows and columns, the factorization has to
+	// report that instead of exiting
+	struct h_factorization rectangular;
+	status = host_h_factorize(&rectangular, H_FACTORIZATION_LU, epsilon, &blocks, &mat_vec_info, &points[0], epsilon, k, &assem, dA, dA_offsets, U, V, U_offsets, V_offsets, k_per_item, block_precision);
+	printf("H-LU factorization of the block list of two point sets: %s\n", (status==H_FACTORIZATION_INVALID_PARTITION) ? "invalid partition" : "not rejected");
+	if (status==H_FACTORIZATION_SUCCESS)
+		host_destroy_h_factorization(&rectangular);
+
+	delete [] ill_conditioned_op.dA; delete [] ill_conditioned_op.dA_offsets;
+	delete [] ill_conditioned_op.U; delete [] ill_conditioned_op.V; delete [] ill_conditioned_op.U_offsets; delete [] ill_conditioned_op.V_offsets; delete [] ill_conditioned_op.k_per_item;
+	delete [] ill_conditioned_symmetric_op.dA; delete [] ill_conditioned_symmetric_op.dA_offsets;
+	delete [] ill_conditioned_symmetric_op.U; delete [] ill_conditioned_symmetric_op.V; delete [] ill_conditioned_symmetric_op.U_offsets; delete [] ill_conditioned_symmetric_op.V_offsets; delete [] ill_conditioned_symmetric_op.k_per_item;
+
+	delete [] symmetric_op.dA; delete [] symmetric_op.dA_offsets;
+	delete [] symmetric_op.U; delete [] symmetric_op.V; delete [] symmetric_op.U_offsets; delete [] symmetric_op.V_offsets; delete [] symmetric_op.k_per_item;
+	delete [] symmetric_op.block_precision;
+	host_destroy_block_list(&symmetric_blocks);
+
+	delete [] b; delete [] solution;
+	delete [] op.dA; delete [] op.dA_offsets;
+	delete [] op.U; delete [] op.V; delete [] op.U_offsets; delete [] op.V_offsets; delete [] op.k_per_item;
+	host_destroy_block_list(&square_blocks);
+	printf("Workspace after the solves: %ld MVPs, %ld allocations in the last MVP\n", workspace.mvp_count, workspace.allocations_last_mvp);
+	destroy_mvp_workspace(&workspace);
+
+	// cluster trees of an anisotropic point set with a few dense clusters for all clustering strategies; the errors are
+	// only reported, the ACA stops at epsilon relative to each block and the MVP error is not bounded by epsilon; the
+	// Hilbert, median and PCA trees follow the point clusters and make whole clusters admissible to each other early,
+	// such large blocks may need more than k ranks, so the blocks stopped at the rank bound are counted
+	const char* clustering_names[4] = { "Morton", "Hilbert", "median", "PCA" };
+	struct point_set clustered_points;
+	struct morton_code clustered_keys;
+	init_host_point_set(&clustered_points, &clustered_keys, point_count[0], dim, bits);
+	for (int i=0; i<point_count[0]; i++)
+	{
+		int cluster = i%4;
+		for (int d=0; d<dim; d++)
+			clustered_points.coords[d][i] = ((d==0) ? 4.0 : 1.0)*(0.25*cluster + ((cluster==0) ? 1.0 : 0.05)*drand48());
+	}
+	uint64_t* clustered_order = new uint64_t[point_count[0]];
+	double* clustered_x = new double[point_count[0]];
+	for (int i=0; i<point_count[0]; i++)
+		clustered_x[i] = drand48();
+	for (int clustering=CLUSTERING_MORTON; clustering<=CLUSTERING_PCA; clustering++)
+	{
+		host_compute_minmax(&clustered_points);
+		host_get_cluster_keys(&clustered_points, &clustered_keys, clustering);
+		host_get_morton_ordering(&clustered_points, &clustered_keys, clustered_order);
+		host_reorder_point_set(&clustered_points, clustered_order);
+
+		struct block_list clustered_blocks;
+		host_traverse(root_h, &clustered_blocks, &clustered_keys, &clustered_keys, &clustered_points, &clustered_points, eta, max_level, c_leaf, false, 0, 0);
+		struct mat_vec_data_info clustered_mat_vec_info;
+		host_organize_mat_vec_data(&clustered_blocks, &clustered_mat_vec_info);
+
+		double* clustered_dA; size_t* clustered_dA_offsets;
+		double* clustered_U; double* clustered_V; size_t* clustered_U_offsets; size_t* clustered_V_offsets; int* clustered_k_per_item;
+		host_precompute_dense(&clustered_blocks, &clustered_mat_vec_info, &clustered_points, &clustered_points, &assem, &clustered_dA, &clustered_dA_offsets);
+		host_precompute_aca(&clustered_blocks, &clustered_mat_vec_info, &clustered_points, &clustered_points, eta, epsilon, k, &assem, &clustered_U, &clustered_V, &clustered_U_offsets, &clustered_V_offsets, &clustered_k_per_item);
+		host_h_matrix_mvp(clustered_x, y, &clustered_blocks, &clustered_mat_vec_info, &clustered_points, &clustered_points, eta, epsilon, k, &assem, clustered_dA, clustered_dA_offsets, clustered_U, clustered_V, clustered_U_offsets, clustered_V_offsets, clustered_k_per_item, 0, 0);
+		host_full_mvp(clustered_x, y_test, &clustered_points, &clustered_points, &assem);
+
+		struct h_matrix_profile clustered_profile;
+		init_h_matrix_profile(&clustered_profile, 0);
+		profile_block_statistics(&clustered_profile, &clustered_blocks, &clustered_mat_vec_info, clustered_k_per_item, clustered_dA_offsets, 0, 0, k, true, true);
+		long rank_sum = 0;
+		int rank_bound_count = 0;
+		for (int a=0; a<clustered_mat_vec_info.aca_count; a++)
+		{
+			rank_sum += clustered_k_per_item[a];
+			rank_bound_count += (clustered_k_per_item[a]>=k) ? 1 : 0;
+		}
+		double clustered_error = relative_error(y, y_test, point_count[0]);
+		printf("Clustering %s: %d dense blocks (%.3lf M entries), %d ACA blocks (average rank %.3lf, %d at the rank bound %d), %.3lf MB stored, relative error %le (epsilon %.0e)\n", clustering_names[clustering], clustered_mat_vec_info.dense_count, clustered_profile.dense_entries*1e-6, clustered_mat_vec_info.aca_count, (double)rank_sum/clustered_mat_vec_info.aca_count, rank_bound_count, k, (double)clustered_profile.bytes_stored/(1024.0*1024.0), clustered_error, epsilon);
+		destroy_h_matrix_profile(&clustered_profile);
+
+		delete [] clustered_dA; delete [] clustered_dA_offsets;
+		delete [] clustered_U; delete [] clustered_V; delete [] clustered_U_offsets; delete [] clustered_V_offsets; delete [] clustered_k_per_item;
+		host_destroy_block_list(&clustered_blocks);
+	}
+	delete [] clustered_order; delete [] clustered_x;
+	destroy_host_point_set(&clustered_points, &clustered_keys);
+
+	// cleanup
+	delete [] dA; delete [] dA_offsets;
+	delete [] U; delete [] V; delete [] U_offsets; delete [] V_offsets; delete [] k_per_item; delete [] block_precision;
+	delete [] x; delete [] y; delete [] y_test;
+	host_destroy_block_list(&blocks);
+	for (int i=0; i<2; i++)
+	{
+		delete [] order[i];
+		destroy_host_point_set(&points[i], &morton[i]);
+	}
+}
@@ -0,0 +1,278 @@
+// Copyright (C) 2016 Peter Zaspel
+//
+// This file is part of hmglib.
+//
+// hmglib is free software: you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// hmglib is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hmglib.  If not, see <http://www.gnu.org/licenses/>.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "host_io.h"
+
+static const char h_matrix_file_magic[8] = {'H','M','G','L','I','B','H','M'};
+
+static inline uint64_t host_align(uint64_t offset)
+{
+	return (offset + H_MATRIX_FILE_ALIGNMENT - 1) / H_MATRIX_FILE_ALIGNMENT * H_MATRIX_FILE_ALIGNMENT;
+}
+
+static void host_write_padding(FILE* f, uint64_t current_offset, uint64_t target_offset, char* file_name)
+{
+	char zeros[H_MATRIX_FILE_ALIGNMENT];
+	memset(zeros, 0, H_MATRIX_FILE_ALIGNMENT);
+
+	if (fwrite(zeros, 1, target_offset-current_offset, f)!=(target_offset-current_offset))
+	{
+		printf("Error while writing H matrix file %s. Exiting...\n", file_name);
+		exit(1);
+	}
+}
+
+void host_write_h_matrix_file(char* file_name, struct h_matrix_file_header* header, void** sections)
+{
+	memcpy(header->magic, h_matrix_file_magic, 8);
+	header->version = H_MATRIX_FILE_VERSION;
+
+	// place sections
+	uint64_t offset = host_align(sizeof(struct h_matrix_file_header));
+	for (int s=0; s<H_MATRIX_FILE_SECTION_COUNT; s++)
+	{
+		header->section_offset[s] = offset;
+		offset = host_align(offset + header->section_size[s]);
+	}
+
+	FILE* f = fopen(file_name, "wb");
+	if (f==0)
+	{
+		printf("Could not open H matrix file %s for writing. Exiting...\n", file_name);
+		exit(1);
+	}
+
+	if (fwrite(header, sizeof(struct h_matrix_file_header), 1, f)!=1)
+	{
+		printf("Error while writing H matrix file %s. Exiting...\n", file_name);
+		exit(1);
+	}
+	uint64_t current_offset = sizeof(struct h_matrix_file_header);
+
+	for (int s=0; s<H_MATRIX_FILE_SECTION_COUNT; s++)
+	{
+		host_write_padding(f, current_offset, header->section_offset[s], file_name);
+		current_offset = header->section_offset[s];
+
+		if (header->section_size[s]>0)
+		{
+			if (fwrite(sections[s], 1, header->section_size[s], f)!=header->section_size[s])
+			{
+				printf("Error while writing H matrix file %s. Exiting...\n", file_name);
+				exit(1);
+			}
+			current_offset += header->section_size[s];
+		}
+	}
+
+	fclose(f);
+}
+
+void* host_map_h_matrix_file(char* file_name, struct h_matrix_file_header* header, void** sections, size_t* mapped_size)
+{
+	int fd = open(file_name, O_RDONLY);
+	if (fd<0)
+	{
+		printf("Could not open H matrix file %s for reading. Exiting...\n", file_name);
+		exit(1);
+	}
+
+	struct stat file_stat;
+	fstat(fd, &file_stat);
+	*mapped_size = file_stat.st_size;
+
+	if (*mapped_size<sizeof(struct h_matrix_file_header))
+	{
+		printf("H matrix file %s is truncated. Exiting...\n", file_name);
+		exit(1);
+	}
+
+	void* mapped_file = mmap(0, *mapped_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapped_file==MAP_FAILED)
+	{
+		printf("Could not map H matrix file %s. Exiting...\n", file_name);
+		exit(1);
+	}
+
+	memcpy(header, mapped_file, sizeof(struct h_matrix_file_header));
+
+	if (memcmp(header->magic, h_matrix_file_magic, 8)!=0)
+	{
+		printf("%s is not an H matrix file. Exiting...\n", file_name);
+		exit(1);
+	}
+	if (header->version!=H_MATRIX_FILE_VERSION)
+	{
+		printf("H matrix file %s has version %d, expected version %d. Exiting...\n", file_name, header->version, H_MATRIX_FILE_VERSION);
+		exit(1);
+	}
+
+	for (int s=0; s<H_MATRIX_FILE_SECTION_COUNT; s++)
+	{
+		if (header->section_offset[s]+header->section_size[s]>*mapped_size)
+		{
+			printf("H matrix file %s is truncated. Exiting...\n", file_name);
+			exit(1);
+		}
+
+		sections[s] = (header->section_size[s]>0) ? (void*)((char*)mapped_file + header->section_offset[s]) : 0;
+	}
+
+	return mapped_file;
+}
+
+void host_unmap_h_matrix_file(void* mapped_file, size_t mapped_size)
+{
+	munmap(mapped_file, mapped_size);
+}
+
+uint64_t host_point_set_checksum(struct point_set* points)
+{
+	uint64_t checksum = 14695981039346656037ULL;
+
+	for (int d=0; d<points->dim; d++)
+	{
+		unsigned char* bytes = (unsigned char*)points->coords[d];
+		for (size_t b=0; b<(size_t)points->size*sizeof(double); b++)
+			checksum = (checksum ^ bytes[b]) * 1099511628211ULL;
+	}
+
+	return checksum;
+}
+
+void host_get_kernel_samples(double* samples, struct system_assembler* assem, struct point_set* points1, struct point_set* points2)
+{
+	int last = H_MATRIX_FILE_KERNEL_SAMPLES-1;
+
+	// even samples lie on the diagonal (as far as both point sets reach), odd ones on the anti-diagonal
+	for (int s=0; s<H_MATRIX_FILE_KERNEL_SAMPLES; s++)
+	{
+		int i = (int)(((long)s*(points1->size-1))/last);
+		int j;
+		if (s%2==0)
+			j = (i<points2->size) ? i : (int)(((long)s*(points2->size-1))/last);
+		else
+			j = (int)(((long)(last-s)*(points2->size-1))/last);
+		samples[s] = assem->get_matrix_entry(i, j, points1, points2);
+	}
+}
+
+void host_set_block_list_sections(struct h_matrix_file_header* header, void** sections, struct block_list* blocks)
+{
+	size_t block_count = blocks->count;
+	size_t cluster_count = blocks->clusters.count;
+	size_t box_size = cluster_count*blocks->clusters.dim*sizeof(double);
+
+	header->mat_vec_data_count = blocks->count;
+	header->cluster_count = blocks->clusters.count;
+
+	sections[HFS_BLOCK_CLUSTER_1] = blocks->cluster1;
+	header->section_size[HFS_BLOCK_CLUSTER_1] = block_count*sizeof(int);
+	sections[HFS_BLOCK_CLUSTER_2] = blocks->cluster2;
+	header->section_size[HFS_BLOCK_CLUSTER_2] = block_count*sizeof(int);
+	sections[HFS_BLOCK_WORK_TYPE] = blocks->work_type;
+	header->section_size[HFS_BLOCK_WORK_TYPE] = block_count*sizeof(char);
+	sections[HFS_CLUSTER_L] = blocks->clusters.l;
+	header->section_size[HFS_CLUSTER_L] = cluster_count*sizeof(int);
+	sections[HFS_CLUSTER_U] = blocks->clusters.u;
+	header->section_size[HFS_CLUSTER_U] = cluster_count*sizeof(int);
+	sections[HFS_CLUSTER_LEVEL] = blocks->clusters.level;
+	header->section_size[HFS_CLUSTER_LEVEL] = cluster_count*sizeof(char);
+	sections[HFS_CLUSTER_MIN] = blocks->clusters.min;
+	header->section_size[HFS_CLUSTER_MIN] = box_size;
+	sections[HFS_CLUSTER_MAX] = blocks->clusters.max;
+	header->section_size[HFS_CLUSTER_MAX] = box_size;
+}
+
+void host_get_block_list_sections(struct block_list* blocks, struct h_matrix_file_header* header, void** sections)
+{
+	blocks->count = header->mat_vec_data_count;
+	blocks->cluster1 = (int*)sections[HFS_BLOCK_CLUSTER_1];
+	blocks->cluster2 = (int*)sections[HFS_BLOCK_CLUSTER_2];
+	blocks->work_type = (char*)sections[HFS_BLOCK_WORK_TYPE];
+
+	blocks->clusters.count = header->cluster_count;
+	blocks->clusters.dim = header->dim;
+	blocks->clusters.l = (int*)sections[HFS_CLUSTER_L];
+	blocks->clusters.u = (int*)sections[HFS_CLUSTER_U];
+	blocks->clusters.level = (char*)sections[HFS_CLUSTER_LEVEL];
+	blocks->clusters.min = (double*)sections[HFS_CLUSTER_MIN];
+	blocks->clusters.max = (double*)sections[HFS_CLUSTER_MAX];
+}
+
+int host_create_scratch_file(char* file_name)
+{
+	int file = open(file_name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (file<0)
+	{
+		printf("Could not create scratch file %s. Exiting...\n", file_name);
+		exit(1);
+	}
+
+	// blocks are read back in the order they were written
+	posix_fadvise(file, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	return file;
+}
+
+void host_write_scratch_file(int file, void* data, size_t size, size_t offset, char* file_name)
+{
+	char* p = (char*)data;
+	while (size>0)
+	{
+		ssize_t written = pwrite(file, p, size, offset);
+		if (written<=0)
+		{
+			printf("Error while writing scratch file %s. Exiting...\n", file_name);
+			exit(1);
+		}
+		p += written;
+		size -= written;
+		offset += written;
+	}
+}
+
+void host_read_scratch_file(int file, void* data, size_t size, size_t offset, char* file_name)
+{
+	char* p = (char*)data;
+	while (size>0)
+	{
+		ssize_t read_size = pread(file, p, size, offset);
+		if (read_size<=0)
+		{
+			printf("Error while reading scratch file %s. Exiting...\n", file_name);
+			exit(1);
+		}
+		p += read_size;
+		size -= read_size;
+		offset += read_size;
+	}
+}
+
+void host_remove_scratch_file(int file, char* file_name)
+{
+	close(file);
+	unlink(file_name);
+}
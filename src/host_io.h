@@ -0,0 +1,112 @@
+// Copyright (C) 2016 Peter Zaspel
+//
+// This file is part of hmglib.
+//
+// hmglib is free software: you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// hmglib is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hmglib.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef HOST_IO_H
+#define HOST_IO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "tree.h"
+#include "system_assembler.h"
+
+#define H_MATRIX_FILE_VERSION 5
+
+// sections start at multiples of the page size, such that mapped arrays are aligned
+#define H_MATRIX_FILE_ALIGNMENT 4096
+
+// sections of an H matrix file
+#define HFS_ORDER_1 0
+#define HFS_ORDER_2 1
+#define HFS_BLOCK_CLUSTER_1 2
+#define HFS_DENSE_WORK_SIZE 3
+#define HFS_ACA_WORK_SIZE 4
+#define HFS_K_PER_ITEM 5
+#define HFS_U_OFFSETS 6
+#define HFS_V_OFFSETS 7
+#define HFS_U 8
+#define HFS_V 9
+#define HFS_DA_OFFSETS 10
+#define HFS_DA 11
+#define HFS_BLOCK_PRECISION 12
+#define HFS_BLOCK_CLUSTER_2 13
+#define HFS_BLOCK_WORK_TYPE 14
+#define HFS_CLUSTER_L 15
+#define HFS_CLUSTER_U 16
+#define HFS_CLUSTER_LEVEL 17
+#define HFS_CLUSTER_MIN 18
+#define HFS_CLUSTER_MAX 19
+#define H_MATRIX_FILE_SECTION_COUNT 20
+
+// matrix entries stored in the header to recognize the kernel an H matrix file was written for
+#define H_MATRIX_FILE_KERNEL_SAMPLES 8
+
+struct h_matrix_file_header
+{
+	char magic[8];
+	int version;
+	int dim;
+	int point_count[2];
+	int mat_vec_data_count;
+	int cluster_count;
+	struct mat_vec_data_info mat_vec_info;
+	int dense_batch_count;
+	int aca_batch_count;
+	int k;
+	int c_leaf;
+	int max_level;
+	double eta;
+	double epsilon;
+	uint64_t point_checksum[2];	// of the point sets in Z order (host_point_set_checksum)
+	int kernel_type;
+	double kernel_samples[H_MATRIX_FILE_KERNEL_SAMPLES];	// see host_get_kernel_samples
+	uint64_t section_offset[H_MATRIX_FILE_SECTION_COUNT];	// in bytes from the beginning of the file
+	uint64_t section_size[H_MATRIX_FILE_SECTION_COUNT];	// in bytes
+};
+
+// writes header and sections to file_name; section_size has to be set in the header, the offsets are computed here
+extern void host_write_h_matrix_file(char* file_name, struct h_matrix_file_header* header, void** sections);
+
+// maps file_name read-only into memory, checks and returns its header and stores pointers to the sections (0 for
+// empty sections); returns the mapping, which has to be released by host_unmap_h_matrix_file
+extern void* host_map_h_matrix_file(char* file_name, struct h_matrix_file_header* header, void** sections, size_t* mapped_size);
+
+extern void host_unmap_h_matrix_file(void* mapped_file, size_t mapped_size);
+
+// FNV-1a checksum of the coordinates of points in their current order
+extern uint64_t host_point_set_checksum(struct point_set* points);
+
+// matrix entries of assem at H_MATRIX_FILE_KERNEL_SAMPLES fixed positions spread over the point sets, including the
+// diagonal (which holds the regularization of the kernels)
+extern void host_get_kernel_samples(double* samples, struct system_assembler* assem, struct point_set* points1, struct point_set* points2);
+
+// sets the sections (and counts in the header) of the block list and its cluster table for writing
+extern void host_set_block_list_sections(struct h_matrix_file_header* header, void** sections, struct block_list* blocks);
+
+// block list and cluster table pointing into the sections of a mapped file
+extern void host_get_block_list_sections(struct block_list* blocks, struct h_matrix_file_header* header, void** sections);
+
+// scratch files of the out-of-core MVP: created (or truncated) for reading and writing, accessed by positioned reads
+// and writes of size bytes at offset (which may be used concurrently) and removed together with their descriptor
+extern int host_create_scratch_file(char* file_name);
+
+extern void host_write_scratch_file(int file, void* data, size_t size, size_t offset, char* file_name);
+
+extern void host_read_scratch_file(int file, void* data, size_t size, size_t offset, char* file_name);
+
+extern void host_remove_scratch_file(int file, char* file_name);
+
+#endif
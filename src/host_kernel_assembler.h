@@ -0,0 +1,176 @@
+// Copyright (C) 2016 Peter Zaspel
+//
+// This file is part of hmglib.
+//
+// hmglib is free software: you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// hmglib is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hmglib.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef HOST_KERNEL_ASSEMBLER_H
+#define HOST_KERNEL_ASSEMBLER_H
+
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "kernel_system_assembler.h"
+
+// exp(x) for x<=0 without library calls, such that loops over it can be vectorized; x = n*ln(2) + r with
+// |r|<=ln(2)/2 and exp(r) from its Taylor polynomial of degree 13 (relative error below 1e-16)
+static inline double host_exp_nonpositive(double x)
+{
+	const double shifter = 6755399441055744.0;	// 1.5*2^52, rounds to integer in the last mantissa bits
+	const double log2e = 1.4426950408889634;
+	const double ln2_hi = 6.93147180369123816490e-01;
+	const double ln2_lo = 1.90821492927058770002e-10;
+
+	x = (x < -708.0) ? -708.0 : x;
+
+	double t = x*log2e + shifter;
+	double n = t - shifter;
+	double r = (x - n*ln2_hi) - n*ln2_lo;
+
+	double p = 1.0/6227020800.0;
+	p = p*r + 1.0/479001600.0;
+	p = p*r + 1.0/39916800.0;
+	p = p*r + 1.0/3628800.0;
+	p = p*r + 1.0/362880.0;
+	p = p*r + 1.0/40320.0;
+	p = p*r + 1.0/5040.0;
+	p = p*r + 1.0/720.0;
+	p = p*r + 1.0/120.0;
+	p = p*r + 1.0/24.0;
+	p = p*r + 1.0/6.0;
+	p = p*r + 0.5;
+	p = p*r + 1.0;
+	p = p*r + 1.0;
+
+	// 2^n from the integer in the low mantissa bits of t
+	uint64_t bits;
+	memcpy(&bits, &t, sizeof(double));
+	bits = (bits + 1023) << 52;
+	double scale;
+	memcpy(&scale, &bits, sizeof(double));
+
+	return p*scale;
+}
+
+// host evaluation of the kernels of kernel_system_assembler.h in terms of squared distances, with all constants
+// computed once per assembler
+struct host_gaussian_kernel
+{
+	double regularization;
+
+	host_gaussian_kernel(gaussian_kernel_system_assembler* assem)
+	{
+		regularization = assem->regularization;
+	}
+
+	inline double evaluate(double r_squared) const
+	{
+		return host_exp_nonpositive(-r_squared);
+	}
+};
+
+struct host_matern_kernel
+{
+	double regularization;
+	double normalization;
+
+	host_matern_kernel(matern_kernel_system_assembler* assem, int dim)
+	{
+		regularization = assem->regularization;
+		normalization = 1.0/(pow(2.0,(double)dim/2.0)*tgamma(1.0+(double)dim/2.0));
+	}
+
+	inline double evaluate(double r_squared) const
+	{
+		double r = sqrt(r_squared);
+		return yn(1, r+1.0e-15)*r*normalization;
+	}
+};
+
+// assembles the m1 x m2 block starting at (l1,l2) column-major into A; DIM>0 fixes the dimension at compile time,
+// DIM==0 uses dim; the loop along the longer side of the block is vectorized
+template <class KERNEL, int DIM>
+void host_fill_block_with_kernel(const KERNEL& kernel, int dim, double* A, int lda, int l1, int m1, int l2, int m2, struct point_set* input_set1, struct point_set* input_set2)
+{
+	const int dim_count = (DIM>0) ? DIM : dim;
+
+	double* x1[MAX_DIM];
+	double* x2[MAX_DIM];
+	for (int d=0; d<dim_count; d++)
+	{
+		x1[d] = &(input_set1->coords[d][l1]);
+		x2[d] = &(input_set2->coords[d][l2]);
+	}
+
+	if ((m1==1) && (m2>1))
+	{
+		// single row, e.g. an ACA row
+		double p1[MAX_DIM];
+		for (int d=0; d<dim_count; d++)
+			p1[d] = x1[d][0];
+
+		#pragma omp simd
+		for (int j=0; j<m2; j++)
+		{
+			double r_squared = 0.0;
+			for (int d=0; d<dim_count; d++)
+				r_squared += (p1[d]-x2[d][j])*(p1[d]-x2[d][j]);
+			A[(size_t)j*lda] = kernel.evaluate(r_squared);
+		}
+	}
+	else
+	{
+		for (int j=0; j<m2; j++)
+		{
+			double p2[MAX_DIM];
+			for (int d=0; d<dim_count; d++)
+				p2[d] = x2[d][j];
+
+			double* A_j = &A[(size_t)j*lda];
+
+			#pragma omp simd
+			for (int i=0; i<m1; i++)
+			{
+				double r_squared = 0.0;
+				for (int d=0; d<dim_count; d++)
+					r_squared += (x1[d][i]-p2[d])*(x1[d][i]-p2[d]);
+				A_j[i] = kernel.evaluate(r_squared);
+			}
+		}
+	}
+
+	// regularization on the diagonal of the full matrix (cf. get_matrix_entry)
+	for (int j=0; j<m2; j++)
+	{
+		int i = l2+j-l1;
+		if ((i>=0) && (i<m1))
+			A[i + (size_t)j*lda] += kernel.regularization;
+	}
+}
+
+template <class KERNEL>
+void host_fill_block_with_kernel_for_dim(const KERNEL& kernel, int dim, double* A, int lda, int l1, int m1, int l2, int m2, struct point_set* input_set1, struct point_set* input_set2)
+{
+	switch (dim)
+	{
+		case 1: host_fill_block_with_kernel<KERNEL, 1>(kernel, dim, A, lda, l1, m1, l2, m2, input_set1, input_set2); break;
+		case 2: host_fill_block_with_kernel<KERNEL, 2>(kernel, dim, A, lda, l1, m1, l2, m2, input_set1, input_set2); break;
+		case 3: host_fill_block_with_kernel<KERNEL, 3>(kernel, dim, A, lda, l1, m1, l2, m2, input_set1, input_set2); break;
+		case 4: host_fill_block_with_kernel<KERNEL, 4>(kernel, dim, A, lda, l1, m1, l2, m2, input_set1, input_set2); break;
+		case 5: host_fill_block_with_kernel<KERNEL, 5>(kernel, dim, A, lda, l1, m1, l2, m2, input_set1, input_set2); break;
+		default: host_fill_block_with_kernel<KERNEL, 0>(kernel, dim, A, lda, l1, m1, l2, m2, input_set1, input_set2); break;
+	}
+}
+
+#endif
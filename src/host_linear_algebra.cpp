@@ -0,0 +1,2078 @@
+// Copyright (C) 2016 Peter Zaspel
+//
+// This file is part of hmglib.
+//
+// hmglib is free software: you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// hmglib is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hmglib.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include <pthread.h>
+
+#include "host_linear_algebra.h"
+#include "host_kernel_assembler.h"
+#include "host_helper.h"
+#include "host_io.h"
+#include "profiling.h"
+
+void host_organize_mat_vec_data(struct block_list* blocks, struct mat_vec_data_info* mat_vec_info)
+{
+	int block_count = blocks->count;
+
+	// stable partition of the blocks into the dense blocks followed by the ACA blocks
+	std::vector<int> permutation;
+	permutation.reserve(block_count);
+	for (int i=0; i<block_count; i++)
+		if (blocks->work_type[i]!=WT_ACA)
+			permutation.push_back(i);
+	int dense_count = (int)permutation.size();
+	for (int i=0; i<block_count; i++)
+		if (blocks->work_type[i]==WT_ACA)
+			permutation.push_back(i);
+
+	std::vector<int> cluster1(blocks->cluster1, blocks->cluster1+block_count);
+	std::vector<int> cluster2(blocks->cluster2, blocks->cluster2+block_count);
+	for (int i=0; i<block_count; i++)
+	{
+		blocks->cluster1[i] = cluster1[permutation[i]];
+		blocks->cluster2[i] = cluster2[permutation[i]];
+		blocks->work_type[i] = (i<dense_count) ? WT_DENSE : WT_ACA;
+	}
+
+	mat_vec_info->dense_count = dense_count;
+	printf("dense count: %d\n", mat_vec_info->dense_count);
+	mat_vec_info->aca_count = block_count - dense_count;
+	printf("aca_count: %d\n", mat_vec_info->aca_count);
+
+	mat_vec_info->total_count = block_count;
+
+	mat_vec_info->symmetric = 0;
+}
+
+void host_fill_block(double* A, int lda, int l1, int m1, int l2, int m2, struct point_set* input_set1, struct point_set* input_set2, struct system_assembler* assem)
+{
+	int dim = input_set1->dim;
+
+	switch (assem->kernel_type)
+	{
+		case KT_GAUSSIAN:
+			host_fill_block_with_kernel_for_dim(host_gaussian_kernel((gaussian_kernel_system_assembler*)assem), dim, A, lda, l1, m1, l2, m2, input_set1, input_set2);
+			break;
+		case KT_MATERN:
+			host_fill_block_with_kernel_for_dim(host_matern_kernel((matern_kernel_system_assembler*)assem, dim), dim, A, lda, l1, m1, l2, m2, input_set1, input_set2);
+			break;
+		default:
+			for (int j=0; j<m2; j++)
+				for (int i=0; i<m1; i++)
+					A[i + (size_t)j*lda] = assem->get_matrix_entry(l1+i, l2+j, input_set1, input_set2);
+	}
+}
+
+// bfloat16 entries of ACA factors stored in reduced precision: the upper half of a float, rounded to nearest even
+struct host_bfloat16
+{
+	uint16_t bits;
+
+	inline operator double() const
+	{
+		uint32_t float_bits = (uint32_t)bits << 16;
+		float f;
+		memcpy(&f, &float_bits, sizeof(float));
+		return f;
+	}
+};
+
+static inline struct host_bfloat16 host_to_bfloat16(double x)
+{
+	float f = (float)x;
+	uint32_t float_bits;
+	memcpy(&float_bits, &f, sizeof(float));
+	float_bits += 0x7fff + ((float_bits >> 16) & 1);
+	struct host_bfloat16 result;
+	result.bits = (uint16_t)(float_bits >> 16);
+	return result;
+}
+
+// the matrix entries (a) may be stored in double, float or bfloat16, the vector entries (b) and the sum are double
+template<typename T>
+static inline double host_dot(T* a, double* b, int n)
+{
+	double result = 0.0;
+	for (int i=0; i<n; i++)
+		result += a[i]*b[i];
+	return result;
+}
+
+// residual of row i of the block after r crosses: row = kernel(input_set1(i,:), input_set2) - sum_l U(i,l) * V(:,l)
+static void host_aca_residual_row(double* row, int i, double* U, double* V, int l1, int m1, int l2, int m2, int r, struct point_set* input_set1, struct point_set* input_set2, struct system_assembler* assem)
+{
+	host_fill_block(row, 1, l1+i, 1, l2, m2, input_set1, input_set2, assem);
+	for (int l=0; l<r; l++)
+	{
+		double scaling = U[(size_t)l*m1+i];
+		double* V_l = &V[(size_t)l*m2];
+		for (int j=0; j<m2; j++)
+			row[j] -= scaling*V_l[j];
+	}
+}
+
+// residual of column j of the block after r crosses: column = kernel(input_set1, input_set2(j,:)) - sum_l V(j,l) * U(:,l)
+static void host_aca_residual_column(double* column, int j, double* U, double* V, int l1, int m1, int l2, int m2, int r, struct point_set* input_set1, struct point_set* input_set2, struct system_assembler* assem)
+{
+	host_fill_block(column, m1, l1, m1, l2+j, 1, input_set1, input_set2, assem);
+	for (int l=0; l<r; l++)
+	{
+		double scaling = V[(size_t)l*m2+j];
+		double* U_l = &U[(size_t)l*m1];
+		for (int i=0; i<m1; i++)
+			column[i] -= scaling*U_l[i];
+	}
+}
+
+// index of the entry of x with the largest (smallest) magnitude among the ones not used so far, -1 if all are used
+static int host_aca_select(double* x, int n, char* used, bool largest)
+{
+	int index = -1;
+	for (int i=0; i<n; i++)
+		if ((!used[i]) && ((index==-1) || (largest ? (fabs(x[i])>fabs(x[index])) : (fabs(x[i])<fabs(x[index])))))
+			index = i;
+	return index;
+}
+
+// next index after i (cyclic) that has not been used so far, -1 if all are used
+static int host_aca_next_unused(int i, int n, char* used)
+{
+	for (int o=1; o<=n; o++)
+		if (!used[(i+o)%n])
+			return (i+o)%n;
+	return -1;
+}
+
+int host_aca(double* U, double* V, int l1, int m1, int l2, int m2, struct point_set* input_set1, struct point_set* input_set2, double epsilon, int k, struct system_assembler* assem, int first_row, char* used, double* reference)
+{
+	// if (k>min(m,n))
+	//     k= min(m,n);
+	// end
+	k = std::min(k, std::min(m1, m2));
+
+	char* row_used = used;
+	char* column_used = &used[m1];
+	double* reference_column = reference;
+	double* reference_row = &reference[m1];
+	memset(used, 0, (m1+m2)*sizeof(char));
+
+	int r = 0;
+	int rows_used = 0;
+	int columns_used = 0;
+	double frobenius_norm_squared = 0.0;  // ||U*V'||_F^2, updated incrementally
+
+	// ACA+: the residuals of a reference column and of a reference row are kept up to date, the next pivot is
+	// the largest entry of either of them; the reference row is the one with the smallest entry in the reference
+	// column
+	int j_ref = 0;
+	host_aca_residual_column(reference_column, j_ref, U, V, l1, m1, l2, m2, 0, input_set1, input_set2, assem);
+	int i_ref = host_aca_select(reference_column, m1, row_used, false);
+	host_aca_residual_row(reference_row, i_ref, U, V, l1, m1, l2, m2, 0, input_set1, input_set2, assem);
+	bool references_renewed = false;
+
+	while ((r<k) && (rows_used<m1) && (columns_used<m2))
+	{
+		double* u_r = &U[(size_t)r*m1];
+		double* v_r = &V[(size_t)r*m2];
+
+		int i_r = -1;
+		int j_r = -1;
+		bool row_first;
+
+		if ((r==0) && (rows_used==0) && (first_row>=0) && (first_row<m1))
+		{
+			// warm start in a given pivot row
+			i_r = first_row;
+			row_first = true;
+		}
+		else
+		{
+			int i_max = host_aca_select(reference_column, m1, row_used, true);
+			int j_max = host_aca_select(reference_row, m2, column_used, true);
+			double column_max = (i_max>=0) ? fabs(reference_column[i_max]) : 0.0;
+			double row_max = (j_max>=0) ? fabs(reference_row[j_max]) : 0.0;
+
+			if (std::max(column_max, row_max)<1.0e-13)
+			{
+				// the residual vanishes in the reference row and column; this is taken as convergence once both
+				// have been renewed
+				if (references_renewed)
+					break;
+				i_ref = host_aca_next_unused(i_ref, m1, row_used);
+				j_ref = host_aca_next_unused(j_ref, m2, column_used);
+				if ((i_ref==-1) || (j_ref==-1))
+					break;
+				host_aca_residual_column(reference_column, j_ref, U, V, l1, m1, l2, m2, r, input_set1, input_set2, assem);
+				host_aca_residual_row(reference_row, i_ref, U, V, l1, m1, l2, m2, r, input_set1, input_set2, assem);
+				references_renewed = true;
+				continue;
+			}
+
+			row_first = (column_max>=row_max);
+			i_r = i_max;
+			j_r = j_max;
+		}
+
+		if (row_first)
+		{
+			host_aca_residual_row(v_r, i_r, U, V, l1, m1, l2, m2, r, input_set1, input_set2, assem);
+			row_used[i_r] = 1;
+			rows_used++;
+
+			// [m,j_r] = max(abs(v_tilde_r)); a vanishing row is skipped
+			j_r = host_aca_select(v_r, m2, column_used, true);
+			if ((j_r==-1) || (fabs(v_r[j_r])<1.0e-13))
+				continue;
+
+			host_aca_residual_column(u_r, j_r, U, V, l1, m1, l2, m2, r, input_set1, input_set2, assem);
+			column_used[j_r] = 1;
+			columns_used++;
+		}
+		else
+		{
+			host_aca_residual_column(u_r, j_r, U, V, l1, m1, l2, m2, r, input_set1, input_set2, assem);
+			column_used[j_r] = 1;
+			columns_used++;
+
+			// [m,i_r] = max(abs(u_tilde_r)); a vanishing column is skipped
+			i_r = host_aca_select(u_r, m1, row_used, true);
+			if ((i_r==-1) || (fabs(u_r[i_r])<1.0e-13))
+				continue;
+
+			host_aca_residual_row(v_r, i_r, U, V, l1, m1, l2, m2, r, input_set1, input_set2, assem);
+			row_used[i_r] = 1;
+			rows_used++;
+		}
+
+		// v_r = (1.0./(v_tilde_r(j_r)))*v_tilde_r;
+		double pivot = v_r[j_r];
+		for (int j=0; j<m2; j++)
+			v_r[j] = v_r[j] / pivot;
+
+		// ||S_r||_F^2 = ||S_{r-1}||_F^2 + 2 sum_l (u_r'*u_l)(v_r'*v_l) + ||u_r||^2 ||v_r||^2
+		double u_r_norm_squared = host_dot(u_r, u_r, m1);
+		double v_r_norm_squared = host_dot(v_r, v_r, m2);
+		double mixed = 0.0;
+		for (int l=0; l<r; l++)
+			mixed += host_dot(u_r, &U[(size_t)l*m1], m1) * host_dot(v_r, &V[(size_t)l*m2], m2);
+		frobenius_norm_squared += 2.0*mixed + u_r_norm_squared*v_r_norm_squared;
+
+		r++;
+		references_renewed = false;
+
+		if (sqrt(u_r_norm_squared*v_r_norm_squared) <= epsilon*sqrt(fabs(frobenius_norm_squared)))
+			break;
+
+		// subtract the new cross from the references; a reference that became a pivot is replaced by the unused
+		// row (column) with the smallest entry in the other reference
+		for (int i=0; i<m1; i++)
+			reference_column[i] -= u_r[i]*v_r[j_ref];
+		for (int j=0; j<m2; j++)
+			reference_row[j] -= u_r[i_ref]*v_r[j];
+
+		if (row_used[i_ref])
+		{
+			i_ref = host_aca_select(reference_column, m1, row_used, false);
+			if (i_ref==-1)
+				break;
+			host_aca_residual_row(reference_row, i_ref, U, V, l1, m1, l2, m2, r, input_set1, input_set2, assem);
+		}
+		if (column_used[j_ref])
+		{
+			j_ref = host_aca_select(reference_row, m2, column_used, false);
+			if (j_ref==-1)
+				break;
+			host_aca_residual_column(reference_column, j_ref, U, V, l1, m1, l2, m2, r, input_set1, input_set2, assem);
+		}
+	}
+
+	return r;
+}
+
+double host_block_assembly_cost(struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, int k, int* k_per_item, int i)
+{
+	struct block_item item = get_block_item(blocks, i);
+	double m1 = item.set1_u-item.set1_l+1;
+	double m2 = item.set2_u-item.set2_l+1;
+
+	if (i<mat_vec_info->dense_count)
+		return m1*m2*HOST_KERNEL_EVALUATION_COST;
+
+	// r rows and columns of kernel evaluations, each corrected by the previous crosses
+	double r = host_block_rank_bound(blocks, mat_vec_info, k, k_per_item, i);
+	return r*(m1+m2)*(HOST_KERNEL_EVALUATION_COST+r);
+}
+
+double host_block_mvp_cost(struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, int k, bool is_stored, int* k_per_item, int i, int nrhs)
+{
+	struct block_item item = get_block_item(blocks, i);
+	double m1 = item.set1_u-item.set1_l+1;
+	double m2 = item.set2_u-item.set2_l+1;
+	double copies = is_mirrored_block(&item, mat_vec_info) ? 2.0 : 1.0;
+
+	double flops;
+	if (i<mat_vec_info->dense_count)
+		flops = 2.0*m1*m2*nrhs*copies;
+	else
+		flops = 2.0*host_block_rank_bound(blocks, mat_vec_info, k, k_per_item, i)*(m1+m2)*nrhs*copies;
+
+	if (is_stored)
+		return flops + host_block_storage_size(blocks, mat_vec_info, k, k_per_item, i)*HOST_BYTE_COST;
+	else
+		return flops + host_block_assembly_cost(blocks, mat_vec_info, k, k_per_item, i);
+}
+
+size_t host_block_storage_size(struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, int k, int* k_per_item, int i)
+{
+	struct block_item item = get_block_item(blocks, i);
+	size_t m1 = item.set1_u-item.set1_l+1;
+	size_t m2 = item.set2_u-item.set2_l+1;
+
+	if (i<mat_vec_info->dense_count)
+		return m1*m2*sizeof(double);
+
+	size_t r = host_block_rank_bound(blocks, mat_vec_info, k, k_per_item, i);
+	return r*(m1+m2)*sizeof(double);
+}
+
+int host_block_rank_bound(struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, int k, int* k_per_item, int i)
+{
+	int a = i-mat_vec_info->dense_count;
+	if ((k_per_item!=0) && (k_per_item[a]!=HOST_RANK_NOT_STORED))
+		return k_per_item[a];
+
+	struct block_item item = get_block_item(blocks, i);
+	int m1 = item.set1_u-item.set1_l+1;
+	int m2 = item.set2_u-item.set2_l+1;
+	return std::min(k, std::min(m1, m2));
+}
+
+struct host_higher_cost_per_byte
+{
+	double* cost_per_byte;
+
+	bool operator()(const int &lhs, const int &rhs) const
+	{
+		return cost_per_byte[lhs]>cost_per_byte[rhs];
+	}
+};
+
+size_t host_select_stored_blocks(char* stored, struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, int k, int* k_per_item, size_t memory_budget)
+{
+	int total_count = mat_vec_info->total_count;
+
+	std::vector<double> cost_per_byte(total_count);
+	std::vector<int> order(total_count);
+	for (int i=0; i<total_count; i++)
+	{
+		size_t size = host_block_storage_size(blocks, mat_vec_info, k, k_per_item, i);
+		cost_per_byte[i] = (size>0) ? host_block_assembly_cost(blocks, mat_vec_info, k, k_per_item, i)/size : 0.0;
+		order[i] = i;
+	}
+
+	host_higher_cost_per_byte comp;
+	comp.cost_per_byte = &cost_per_byte[0];
+	std::stable_sort(order.begin(), order.end(), comp);
+
+	// greedy: blocks that do not fit any more leave room for cheaper, smaller blocks
+	size_t used = 0;
+	for (int o=0; o<total_count; o++)
+	{
+		int i = order[o];
+		size_t size = host_block_storage_size(blocks, mat_vec_info, k, k_per_item, i);
+		stored[i] = ((memory_budget==0) || (used+size<=memory_budget)) ? 1 : 0;
+		if (stored[i])
+			used += size;
+	}
+
+	return used;
+}
+
+void host_store_dense_blocks(struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, struct point_set* input_set1, struct point_set* input_set2, struct system_assembler* assem, char* stored, double** dA, size_t** dA_offsets)
+{
+	int dense_count = mat_vec_info->dense_count;
+
+	double* old_dA = *dA;
+	size_t* old_dA_offsets = *dA_offsets;
+
+	*dA_offsets = new size_t[dense_count+1];
+	(*dA_offsets)[0] = 0;
+	for (int i=0; i<dense_count; i++)
+	{
+		struct block_item item = get_block_item(blocks, i);
+		size_t m1 = item.set1_u-item.set1_l+1;
+		size_t m2 = item.set2_u-item.set2_l+1;
+		bool is_stored = (stored==0) || stored[i];
+		(*dA_offsets)[i+1] = (*dA_offsets)[i] + (is_stored ? m1*m2 : 0);
+	}
+
+	printf("Allocating %lf MB of memory for dense blocks\n", (double)((*dA_offsets)[dense_count]*sizeof(double))/(1024.0*1024.0));
+
+	*dA = new double[(*dA_offsets)[dense_count]];
+
+	#pragma omp parallel for schedule(dynamic)
+	for (int i=0; i<dense_count; i++)
+	{
+		size_t size = (*dA_offsets)[i+1]-(*dA_offsets)[i];
+		if (size==0)
+			continue;
+
+		if ((old_dA!=0) && (old_dA_offsets[i+1]-old_dA_offsets[i]==size))
+		{
+			memcpy(&((*dA)[(*dA_offsets)[i]]), &old_dA[old_dA_offsets[i]], size*sizeof(double));
+			continue;
+		}
+
+		struct block_item item = get_block_item(blocks, i);
+		int m1 = item.set1_u-item.set1_l+1;
+		int m2 = item.set2_u-item.set2_l+1;
+		host_fill_block(&((*dA)[(*dA_offsets)[i]]), m1, item.set1_l, m1, item.set2_l, m2, input_set1, input_set2, assem);
+	}
+
+	delete [] old_dA;
+	delete [] old_dA_offsets;
+}
+
+void host_precompute_dense(struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, struct point_set* input_set1, struct point_set* input_set2, struct system_assembler* assem, double** dA, size_t** dA_offsets)
+{
+	*dA = 0;
+	*dA_offsets = 0;
+	host_store_dense_blocks(blocks, mat_vec_info, input_set1, input_set2, assem, 0, dA, dA_offsets);
+}
+
+void host_store_aca_blocks(struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, struct point_set* input_set1, struct point_set* input_set2, double eta, double epsilon, int k, struct system_assembler* assem, char* stored, int* first_rows, double** U, double** V, size_t** U_offsets, size_t** V_offsets, int** k_per_item)
+{
+	int dense_count = mat_vec_info->dense_count;
+	int aca_count = mat_vec_info->aca_count;
+
+	double* old_U = *U;
+	double* old_V = *V;
+	size_t* old_U_offsets = *U_offsets;
+	size_t* old_V_offsets = *V_offsets;
+	int* old_k_per_item = *k_per_item;
+
+	*k_per_item = new int[aca_count];
+	*U_offsets = new size_t[aca_count+1];
+	*V_offsets = new size_t[aca_count+1];
+
+	// the ranks are not known in advance, therefore the blocks are compressed into thread-local buffers first;
+	// blocks that are stored already are copied from the previous factors
+	double** U_blocks = new double*[aca_count];
+	double** V_blocks = new double*[aca_count];
+
+	#pragma omp parallel
+	{
+		std::vector<double> U_local, V_local, reference;
+		std::vector<char> used;
+
+		#pragma omp for schedule(dynamic)
+		for (int a=0; a<aca_count; a++)
+		{
+			U_blocks[a] = 0;
+			V_blocks[a] = 0;
+			(*k_per_item)[a] = HOST_RANK_NOT_STORED;
+
+			if ((stored!=0) && (!stored[dense_count+a]))
+				continue;
+
+			if ((old_U!=0) && (old_k_per_item[a]!=HOST_RANK_NOT_STORED))
+			{
+				(*k_per_item)[a] = old_k_per_item[a];
+				continue;
+			}
+
+			struct block_item item = get_block_item(blocks, dense_count+a);
+			int m1 = item.set1_u-item.set1_l+1;
+			int m2 = item.set2_u-item.set2_l+1;
+			int k_max = std::min(k, std::min(m1, m2));
+
+			U_local.resize((size_t)m1*k_max);
+			V_local.resize((size_t)m2*k_max);
+			used.resize(m1+m2);
+			reference.resize(m1+m2);
+
+			int rank = host_aca(&U_local[0], &V_local[0], item.set1_l, m1, item.set2_l, m2, input_set1, input_set2, epsilon, k_max, assem, (first_rows!=0) ? first_rows[a] : -1, &used[0], &reference[0]);
+
+			(*k_per_item)[a] = rank;
+			U_blocks[a] = new double[(size_t)m1*rank];
+			V_blocks[a] = new double[(size_t)m2*rank];
+			memcpy(U_blocks[a], &U_local[0], (size_t)m1*rank*sizeof(double));
+			memcpy(V_blocks[a], &V_local[0], (size_t)m2*rank*sizeof(double));
+		}
+	}
+
+	// pack the factors block by block, blocks that are not stored take no space
+	(*U_offsets)[0] = 0;
+	(*V_offsets)[0] = 0;
+	for (int a=0; a<aca_count; a++)
+	{
+		struct block_item item = get_block_item(blocks, dense_count+a);
+		size_t m1 = item.set1_u-item.set1_l+1;
+		size_t m2 = item.set2_u-item.set2_l+1;
+		size_t rank = std::max((*k_per_item)[a], 0);
+		(*U_offsets)[a+1] = (*U_offsets)[a] + m1*rank;
+		(*V_offsets)[a+1] = (*V_offsets)[a] + m2*rank;
+	}
+
+	printf("Allocating %lf MB of memory for ACA factors\n", (double)(((*U_offsets)[aca_count]+(*V_offsets)[aca_count])*sizeof(double))/(1024.0*1024.0));
+
+	*U = new double[(*U_offsets)[aca_count]];
+	*V = new double[(*V_offsets)[aca_count]];
+
+	#pragma omp parallel for schedule(dynamic)
+	for (int a=0; a<aca_count; a++)
+	{
+		if (U_blocks[a]!=0)
+		{
+			memcpy(&((*U)[(*U_offsets)[a]]), U_blocks[a], ((*U_offsets)[a+1]-(*U_offsets)[a])*sizeof(double));
+			memcpy(&((*V)[(*V_offsets)[a]]), V_blocks[a], ((*V_offsets)[a+1]-(*V_offsets)[a])*sizeof(double));
+			delete [] U_blocks[a];
+			delete [] V_blocks[a];
+		}
+		else if ((*k_per_item)[a]!=HOST_RANK_NOT_STORED)
+		{
+			memcpy(&((*U)[(*U_offsets)[a]]), &old_U[old_U_offsets[a]], ((*U_offsets)[a+1]-(*U_offsets)[a])*sizeof(double));
+			memcpy(&((*V)[(*V_offsets)[a]]), &old_V[old_V_offsets[a]], ((*V_offsets)[a+1]-(*V_offsets)[a])*sizeof(double));
+		}
+	}
+
+	delete [] U_blocks;
+	delete [] V_blocks;
+
+	delete [] old_U;
+	delete [] old_V;
+	delete [] old_U_offsets;
+	delete [] old_V_offsets;
+	delete [] old_k_per_item;
+}
+
+void host_precompute_aca(struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, struct point_set* input_set1, struct point_set* input_set2, double eta, double epsilon, int k, struct system_assembler* assem, double** U, double** V, size_t** U_offsets, size_t** V_offsets, int** k_per_item)
+{
+	*U = 0;
+	*V = 0;
+	*U_offsets = 0;
+	*V_offsets = 0;
+	*k_per_item = 0;
+	host_store_aca_blocks(blocks, mat_vec_info, input_set1, input_set2, eta, epsilon, k, assem, 0, 0, U, V, U_offsets, V_offsets, k_per_item);
+}
+
+// row of the largest absolute entry of u
+template<typename T>
+static int host_max_abs_row(T* u, int m)
+{
+	int i_max = 0;
+	double max_abs = 0.0;
+	for (int i=0; i<m; i++)
+	{
+		double value = fabs((double)u[i]);
+		if (value>max_abs)
+		{
+			max_abs = value;
+			i_max = i;
+		}
+	}
+	return i_max;
+}
+
+void host_get_aca_first_rows(int* first_rows, struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, double* U, size_t* U_offsets, int* k_per_item, char* block_precision)
+{
+	int dense_count = mat_vec_info->dense_count;
+
+	#pragma omp parallel for
+	for (int a=0; a<mat_vec_info->aca_count; a++)
+	{
+		first_rows[a] = -1;
+		if ((U==0) || (k_per_item[a]==HOST_RANK_NOT_STORED) || (k_per_item[a]==0))
+			continue;
+
+		struct block_item item = get_block_item(blocks, dense_count+a);
+		int m1 = item.set1_u-item.set1_l+1;
+		int precision = (block_precision!=0) ? block_precision[dense_count+a] : BLOCK_PRECISION_DOUBLE;
+		double* u_0 = &U[U_offsets[a]];
+		if (precision==BLOCK_PRECISION_SINGLE)
+			first_rows[a] = host_max_abs_row((float*)u_0, m1);
+		else if (precision==BLOCK_PRECISION_BFLOAT16)
+			first_rows[a] = host_max_abs_row((struct host_bfloat16*)u_0, m1);
+		else
+			first_rows[a] = host_max_abs_row(u_0, m1);
+	}
+}
+
+// thin Householder QR of the column-major m x n matrix A (m>=n); A is overwritten by Q (m x n), R (n x n) is
+// stored column-major; reflectors has to provide m*n entries
+static void host_householder_qr(double* A, int m, int n, double* R, double* reflectors)
+{
+	std::vector<double> beta(n);
+	memset(R, 0, (size_t)n*n*sizeof(double));
+
+	for (int j=0; j<n; j++)
+	{
+		double* A_j = &A[(size_t)j*m];
+		double* v = &reflectors[(size_t)j*m];
+
+		// v = x - alpha*e_1 with alpha = -sign(x_1)*||x||
+		double norm = sqrt(host_dot(&A_j[j], &A_j[j], m-j));
+		double alpha = (A_j[j]>0.0) ? -norm : norm;
+		memset(v, 0, j*sizeof(double));
+		memcpy(&v[j], &A_j[j], (m-j)*sizeof(double));
+		v[j] -= alpha;
+		beta[j] = host_dot(&v[j], &v[j], m-j);
+
+		R[j + (size_t)j*n] = (beta[j]>0.0) ? alpha : A_j[j];
+
+		// apply reflector to the remaining columns
+		for (int c=j+1; c<n; c++)
+		{
+			double* A_c = &A[(size_t)c*m];
+			if (beta[j]>0.0)
+			{
+				double scaling = 2.0*host_dot(&v[j], &A_c[j], m-j)/beta[j];
+				for (int i=j; i<m; i++)
+					A_c[i] -= scaling*v[i];
+			}
+			R[j + (size_t)c*n] = A_c[j];
+		}
+	}
+
+	// form Q = H_0*...*H_{n-1}*I(:,1:n) explicitly
+	memset(A, 0, (size_t)m*n*sizeof(double));
+	for (int j=0; j<n; j++)
+		A[j + (size_t)j*m] = 1.0;
+	for (int j=n-1; j>=0; j--)
+	{
+		if (beta[j]<=0.0)
+			continue;
+		double* v = &reflectors[(size_t)j*m];
+		for (int c=0; c<n; c++)
+		{
+			double* A_c = &A[(size_t)c*m];
+			double scaling = 2.0*host_dot(&v[j], &A_c[j], m-j)/beta[j];
+			for (int i=j; i<m; i++)
+				A_c[i] -= scaling*v[i];
+		}
+	}
+}
+
+// one-sided Jacobi SVD of the column-major n x n matrix M; on exit, the columns of M are W*Sigma, i.e. pairwise
+// orthogonal with norms equal to the singular values, and Z holds the right singular vectors (M_in = M_out*Z')
+static void host_jacobi_svd(double* M, double* Z, int n)
+{
+	memset(Z, 0, (size_t)n*n*sizeof(double));
+	for (int j=0; j<n; j++)
+		Z[j + (size_t)j*n] = 1.0;
+
+	for (int sweep=0; sweep<30; sweep++)
+	{
+		bool rotated = false;
+
+		for (int p=0; p<n-1; p++)
+			for (int q=p+1; q<n; q++)
+			{
+				double* M_p = &M[(size_t)p*n];
+				double* M_q = &M[(size_t)q*n];
+				double alpha = host_dot(M_p, M_p, n);
+				double beta = host_dot(M_q, M_q, n);
+				double gamma = host_dot(M_p, M_q, n);
+
+				if (fabs(gamma) <= 1.0e-15*sqrt(alpha*beta))
+					continue;
+				rotated = true;
+
+				double zeta = (beta-alpha)/(2.0*gamma);
+				double t = ((zeta>=0.0) ? 1.0 : -1.0) / (fabs(zeta)+sqrt(1.0+zeta*zeta));
+				double c = 1.0/sqrt(1.0+t*t);
+				double s = c*t;
+
+				double* Z_p = &Z[(size_t)p*n];
+				double* Z_q = &Z[(size_t)q*n];
+				for (int i=0; i<n; i++)
+				{
+					double m_p = M_p[i];
+					double m_q = M_q[i];
+					M_p[i] = c*m_p - s*m_q;
+					M_q[i] = s*m_p + c*m_q;
+					double z_p = Z_p[i];
+					double z_q = Z_q[i];
+					Z_p[i] = c*z_p - s*z_q;
+					Z_q[i] = s*z_p + c*z_q;
+				}
+			}
+
+		if (!rotated)
+			break;
+	}
+}
+
+int host_recompress_low_rank_block(double* U, double* V, int m1, int m2, int r, double epsilon)
+{
+	if (r==0)
+		return 0;
+
+	// U = Q_U*R_U, V = Q_V*R_V  =>  U*V' = Q_U*(R_U*R_V')*Q_V'
+	std::vector<double> R_U((size_t)r*r), R_V((size_t)r*r), M((size_t)r*r), Z((size_t)r*r);
+	std::vector<double> reflectors((size_t)std::max(m1, m2)*r);
+	host_householder_qr(U, m1, r, &R_U[0], &reflectors[0]);
+	host_householder_qr(V, m2, r, &R_V[0], &reflectors[0]);
+
+	// M = R_U*R_V'
+	for (int j=0; j<r; j++)
+		for (int i=0; i<r; i++)
+		{
+			double sum = 0.0;
+			for (int l=0; l<r; l++)
+				sum += R_U[i + (size_t)l*r]*R_V[j + (size_t)l*r];
+			M[i + (size_t)j*r] = sum;
+		}
+
+	// M = (W*Sigma)*Z'
+	host_jacobi_svd(&M[0], &Z[0], r);
+
+	std::vector<double> sigma(r);
+	std::vector<int> index(r);
+	double total = 0.0;
+	for (int j=0; j<r; j++)
+	{
+		sigma[j] = sqrt(host_dot(&M[(size_t)j*r], &M[(size_t)j*r], r));
+		index[j] = j;
+		total += sigma[j]*sigma[j];
+	}
+	for (int a=1; a<r; a++)
+		for (int b=a; (b>0) && (sigma[index[b]]>sigma[index[b-1]]); b--)
+			std::swap(index[b], index[b-1]);
+
+	// smallest rank for which the truncated singular values meet epsilon relative to ||U*V'||_F
+	int new_r = r;
+	double tail = 0.0;
+	while ((new_r>0) && (tail+sigma[index[new_r-1]]*sigma[index[new_r-1]] <= epsilon*epsilon*total))
+	{
+		tail += sigma[index[new_r-1]]*sigma[index[new_r-1]];
+		new_r--;
+	}
+
+	// U_new = Q_U*(W*Sigma)(:,index), V_new = Q_V*Z(:,index); both fit into the storage of the old factors
+	std::vector<double> Q_U(U, U+(size_t)m1*r), Q_V(V, V+(size_t)m2*r);
+	for (int c=0; c<new_r; c++)
+	{
+		double* U_c = &U[(size_t)c*m1];
+		double* V_c = &V[(size_t)c*m2];
+		double* M_c = &M[(size_t)index[c]*r];
+		double* Z_c = &Z[(size_t)index[c]*r];
+		memset(U_c, 0, m1*sizeof(double));
+		memset(V_c, 0, m2*sizeof(double));
+		for (int l=0; l<r; l++)
+		{
+			for (int i=0; i<m1; i++)
+				U_c[i] += Q_U[i + (size_t)l*m1]*M_c[l];
+			for (int i=0; i<m2; i++)
+				V_c[i] += Q_V[i + (size_t)l*m2]*Z_c[l];
+		}
+	}
+
+	return new_r;
+}
+
+void host_recompress_aca(struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, double epsilon, double** U, double** V, size_t** U_offsets, size_t** V_offsets, int* k_per_item)
+{
+	int dense_count = mat_vec_info->dense_count;
+	int aca_count = mat_vec_info->aca_count;
+
+	// recompress every block in place
+	#pragma omp parallel for schedule(dynamic)
+	for (int a=0; a<aca_count; a++)
+	{
+		struct block_item item = get_block_item(blocks, dense_count+a);
+		int m1 = item.set1_u-item.set1_l+1;
+		int m2 = item.set2_u-item.set2_l+1;
+		if (k_per_item[a]==HOST_RANK_NOT_STORED)
+			continue;
+		k_per_item[a] = host_recompress_low_rank_block(&((*U)[(*U_offsets)[a]]), &((*V)[(*V_offsets)[a]]), m1, m2, k_per_item[a], epsilon);
+	}
+
+	// pack the factors with the new ranks
+	size_t* U_offsets_new = new size_t[aca_count+1];
+	size_t* V_offsets_new = new size_t[aca_count+1];
+	U_offsets_new[0] = 0;
+	V_offsets_new[0] = 0;
+	for (int a=0; a<aca_count; a++)
+	{
+		struct block_item item = get_block_item(blocks, dense_count+a);
+		size_t m1 = item.set1_u-item.set1_l+1;
+		size_t m2 = item.set2_u-item.set2_l+1;
+		size_t rank = std::max(k_per_item[a], 0);
+		U_offsets_new[a+1] = U_offsets_new[a] + m1*rank;
+		V_offsets_new[a+1] = V_offsets_new[a] + m2*rank;
+	}
+
+	printf("Recompressed ACA factors from %lf MB to %lf MB\n", (double)(((*U_offsets)[aca_count]+(*V_offsets)[aca_count])*sizeof(double))/(1024.0*1024.0), (double)((U_offsets_new[aca_count]+V_offsets_new[aca_count])*sizeof(double))/(1024.0*1024.0));
+
+	double* U_new = new double[U_offsets_new[aca_count]];
+	double* V_new = new double[V_offsets_new[aca_count]];
+
+	#pragma omp parallel for schedule(dynamic)
+	for (int a=0; a<aca_count; a++)
+	{
+		memcpy(&U_new[U_offsets_new[a]], &((*U)[(*U_offsets)[a]]), (U_offsets_new[a+1]-U_offsets_new[a])*sizeof(double));
+		memcpy(&V_new[V_offsets_new[a]], &((*V)[(*V_offsets)[a]]), (V_offsets_new[a+1]-V_offsets_new[a])*sizeof(double));
+	}
+
+	delete [] *U;
+	delete [] *V;
+	delete [] *U_offsets;
+	delete [] *V_offsets;
+	*U = U_new;
+	*V = V_new;
+	*U_offsets = U_offsets_new;
+	*V_offsets = V_offsets_new;
+}
+
+// unit roundoff of the storage precisions
+static double host_unit_roundoff(int precision)
+{
+	if (precision==BLOCK_PRECISION_SINGLE)
+		return ldexp(1.0, -24);
+	else if (precision==BLOCK_PRECISION_BFLOAT16)
+		return ldexp(1.0, -8);
+	return ldexp(1.0, -53);
+}
+
+// stores n entries of source in the given precision at destination, which takes block_precision_doubles(n, precision)
+// doubles (the padding is zeroed)
+static void host_pack_entries(double* destination, double* source, size_t n, int precision)
+{
+	size_t doubles = block_precision_doubles(n, precision);
+	if (doubles==0)
+		return;
+	destination[doubles-1] = 0.0;
+
+	if (precision==BLOCK_PRECISION_SINGLE)
+	{
+		float* packed = (float*)destination;
+		for (size_t j=0; j<n; j++)
+			packed[j] = (float)source[j];
+	}
+	else if (precision==BLOCK_PRECISION_BFLOAT16)
+	{
+		struct host_bfloat16* packed = (struct host_bfloat16*)destination;
+		for (size_t j=0; j<n; j++)
+			packed[j] = host_to_bfloat16(source[j]);
+	}
+	else
+		memcpy(destination, source, n*sizeof(double));
+}
+
+void host_reduce_storage_precision(struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, double tolerance, int dense_precision, int factor_precision, double** dA, size_t** dA_offsets, double** U, double** V, size_t** U_offsets, size_t** V_offsets, int* k_per_item, char** block_precision)
+{
+	int dense_count = mat_vec_info->dense_count;
+	int aca_count = mat_vec_info->aca_count;
+	int total_count = mat_vec_info->total_count;
+
+	if (dense_precision==BLOCK_PRECISION_BFLOAT16)
+	{
+		printf("Dense blocks can only be stored in double or single precision. Exiting...\n");
+		exit(1);
+	}
+
+	*block_precision = new char[total_count];
+	memset(*block_precision, BLOCK_PRECISION_DOUBLE, total_count*sizeof(char));
+
+	// rounding to a precision with unit roundoff u changes a stored block by at most u*error_bound[i] in the
+	// Frobenius norm, i.e. ||A||_F for a dense block and about 2*||U||_F*||V||_F for a low rank block; the Frobenius
+	// norm of H is taken from the stored blocks (mirrored blocks of a symmetric partition count twice)
+	double* error_bound = new double[total_count];
+	double squared_norm = 0.0;
+	double stored_copies = 0.0;
+
+	#pragma omp parallel for schedule(dynamic) reduction(+:squared_norm,stored_copies)
+	for (int i=0; i<total_count; i++)
+	{
+		struct block_item item = get_block_item(blocks, i);
+		int m1 = item.set1_u-item.set1_l+1;
+		int m2 = item.set2_u-item.set2_l+1;
+		double copies = is_mirrored_block(&item, mat_vec_info) ? 2.0 : 1.0;
+		error_bound[i] = 0.0;
+
+		if (i<dense_count)
+		{
+			if ((*dA==0) || ((*dA_offsets)[i+1]==(*dA_offsets)[i]))
+				continue;
+			double* A = &((*dA)[(*dA_offsets)[i]]);
+			double block_squared_norm = host_dot(A, A, m1*m2);
+			error_bound[i] = sqrt(block_squared_norm);
+			squared_norm += copies*block_squared_norm;
+		}
+		else
+		{
+			int a = i-dense_count;
+			if ((*U==0) || (k_per_item[a]==HOST_RANK_NOT_STORED))
+				continue;
+			int r = k_per_item[a];
+			double* U_a = &((*U)[(*U_offsets)[a]]);
+			double* V_a = &((*V)[(*V_offsets)[a]]);
+
+			// ||U*V'||_F^2 = sum of (U'*U)_lm*(V'*V)_lm
+			double block_squared_norm = 0.0;
+			for (int l=0; l<r; l++)
+				for (int m=0; m<r; m++)
+					block_squared_norm += host_dot(&U_a[(size_t)l*m1], &U_a[(size_t)m*m1], m1)*host_dot(&V_a[(size_t)l*m2], &V_a[(size_t)m*m2], m2);
+			error_bound[i] = 2.0*sqrt(host_dot(U_a, U_a, m1*r)*host_dot(V_a, V_a, m2*r));
+			squared_norm += copies*fmax(block_squared_norm, 0.0);
+		}
+		stored_copies += copies;
+	}
+
+	// the squared errors of all stored blocks sum up to at most (tolerance*||H||_F)^2
+	double threshold = (stored_copies>0.0) ? tolerance*sqrt(squared_norm/stored_copies) : 0.0;
+
+	int reduced_dense_count = 0;
+	int reduced_aca_count[3] = {0, 0, 0};
+	for (int i=0; i<total_count; i++)
+	{
+		if (error_bound[i]==0.0)
+			continue;
+
+		struct block_item item = get_block_item(blocks, i);
+		size_t m1 = item.set1_u-item.set1_l+1;
+		size_t m2 = item.set2_u-item.set2_l+1;
+		int lowest_precision = (i<dense_count) ? dense_precision : factor_precision;
+
+		// a block is only reduced if it actually gets smaller, which keeps the storage size unique per precision
+		for (int precision=lowest_precision; precision>BLOCK_PRECISION_DOUBLE; precision--)
+		{
+			bool is_smaller;
+			if (i<dense_count)
+				is_smaller = (block_precision_doubles(m1*m2, precision)<m1*m2);
+			else
+			{
+				size_t r = k_per_item[i-dense_count];
+				is_smaller = (block_precision_doubles(m1*r, precision)<m1*r) && (block_precision_doubles(m2*r, precision)<m2*r);
+			}
+
+			if (is_smaller && (host_unit_roundoff(precision)*error_bound[i]<=threshold))
+			{
+				(*block_precision)[i] = precision;
+				if (i<dense_count)
+					reduced_dense_count++;
+				else
+					reduced_aca_count[precision]++;
+				break;
+			}
+		}
+	}
+
+	delete [] error_bound;
+
+	size_t old_size = 0;
+	size_t new_size = 0;
+
+	// repack the dense blocks
+	if (*dA!=0)
+	{
+		size_t* dA_offsets_new = new size_t[dense_count+1];
+		dA_offsets_new[0] = 0;
+		for (int i=0; i<dense_count; i++)
+		{
+			struct block_item item = get_block_item(blocks, i);
+			size_t m1 = item.set1_u-item.set1_l+1;
+			size_t m2 = item.set2_u-item.set2_l+1;
+			bool is_stored = ((*dA_offsets)[i+1]>(*dA_offsets)[i]);
+			dA_offsets_new[i+1] = dA_offsets_new[i] + (is_stored ? block_precision_doubles(m1*m2, (*block_precision)[i]) : 0);
+		}
+
+		double* dA_new = new double[dA_offsets_new[dense_count]];
+
+		#pragma omp parallel for schedule(dynamic)
+		for (int i=0; i<dense_count; i++)
+		{
+			size_t size = (*dA_offsets)[i+1]-(*dA_offsets)[i];
+			if (size>0)
+				host_pack_entries(&dA_new[dA_offsets_new[i]], &((*dA)[(*dA_offsets)[i]]), size, (*block_precision)[i]);
+		}
+
+		old_size += (*dA_offsets)[dense_count];
+		new_size += dA_offsets_new[dense_count];
+		delete [] *dA;
+		delete [] *dA_offsets;
+		*dA = dA_new;
+		*dA_offsets = dA_offsets_new;
+	}
+
+	// repack the ACA factors
+	if (*U!=0)
+	{
+		size_t* U_offsets_new = new size_t[aca_count+1];
+		size_t* V_offsets_new = new size_t[aca_count+1];
+		U_offsets_new[0] = 0;
+		V_offsets_new[0] = 0;
+		for (int a=0; a<aca_count; a++)
+		{
+			int precision = (*block_precision)[dense_count+a];
+			U_offsets_new[a+1] = U_offsets_new[a] + block_precision_doubles((*U_offsets)[a+1]-(*U_offsets)[a], precision);
+			V_offsets_new[a+1] = V_offsets_new[a] + block_precision_doubles((*V_offsets)[a+1]-(*V_offsets)[a], precision);
+		}
+
+		double* U_new = new double[U_offsets_new[aca_count]];
+		double* V_new = new double[V_offsets_new[aca_count]];
+
+		#pragma omp parallel for schedule(dynamic)
+		for (int a=0; a<aca_count; a++)
+		{
+			int precision = (*block_precision)[dense_count+a];
+			host_pack_entries(&U_new[U_offsets_new[a]], &((*U)[(*U_offsets)[a]]), (*U_offsets)[a+1]-(*U_offsets)[a], precision);
+			host_pack_entries(&V_new[V_offsets_new[a]], &((*V)[(*V_offsets)[a]]), (*V_offsets)[a+1]-(*V_offsets)[a], precision);
+		}
+
+		old_size += (*U_offsets)[aca_count] + (*V_offsets)[aca_count];
+		new_size += U_offsets_new[aca_count] + V_offsets_new[aca_count];
+		delete [] *U;
+		delete [] *V;
+		delete [] *U_offsets;
+		delete [] *V_offsets;
+		*U = U_new;
+		*V = V_new;
+		*U_offsets = U_offsets_new;
+		*V_offsets = V_offsets_new;
+	}
+
+	printf("Reduced storage precision of %d dense blocks (single) and %d ACA blocks (%d single, %d bfloat16) from %lf MB to %lf MB\n", reduced_dense_count, reduced_aca_count[BLOCK_PRECISION_SINGLE]+reduced_aca_count[BLOCK_PRECISION_BFLOAT16], reduced_aca_count[BLOCK_PRECISION_SINGLE], reduced_aca_count[BLOCK_PRECISION_BFLOAT16], (double)(old_size*sizeof(double))/(1024.0*1024.0), (double)(new_size*sizeof(double))/(1024.0*1024.0));
+}
+
+// Y_local += A*X_local for a column-major m1 x m2 matrix A and nrhs columns of X_local (leading dimension ldx) and
+// Y_local (leading dimension ldy); columns of A are reused for four right hand sides at a time; the entries of A may
+// be stored in reduced precision, all products are summed up in double
+template<typename T>
+static inline void host_gemm(double* Y_local, int ldy, T* A, int lda, int m1, int m2, double* X_local, int ldx, int nrhs)
+{
+	for (int j=0; j<m2; j++)
+	{
+		T* A_j = &A[(size_t)j*lda];
+		int c = 0;
+		for (; c+4<=nrhs; c+=4)
+		{
+			double x_0 = X_local[j + (size_t)c*ldx];
+			double x_1 = X_local[j + (size_t)(c+1)*ldx];
+			double x_2 = X_local[j + (size_t)(c+2)*ldx];
+			double x_3 = X_local[j + (size_t)(c+3)*ldx];
+			double* Y_0 = &Y_local[(size_t)c*ldy];
+			double* Y_1 = &Y_local[(size_t)(c+1)*ldy];
+			double* Y_2 = &Y_local[(size_t)(c+2)*ldy];
+			double* Y_3 = &Y_local[(size_t)(c+3)*ldy];
+			for (int i=0; i<m1; i++)
+			{
+				double a = A_j[i];
+				Y_0[i] += a*x_0;
+				Y_1[i] += a*x_1;
+				Y_2[i] += a*x_2;
+				Y_3[i] += a*x_3;
+			}
+		}
+		for (; c<nrhs; c++)
+		{
+			double x_c = X_local[j + (size_t)c*ldx];
+			double* Y_c = &Y_local[(size_t)c*ldy];
+			for (int i=0; i<m1; i++)
+				Y_c[i] += A_j[i]*x_c;
+		}
+	}
+}
+
+// Y_local += A*X_local and Y_transposed += A'*X_transposed in a single pass over the columns of A, i.e. Y_local and
+// X_transposed have m1 rows, X_local and Y_transposed m2 rows (used for mirrored blocks of a symmetric partition)
+template<typename T>
+static inline void host_gemm_and_transposed(double* Y_local, int ldy, double* Y_transposed, int ldyt, T* A, int lda, int m1, int m2, double* X_local, double* X_transposed, int ldx, int nrhs)
+{
+	for (int j=0; j<m2; j++)
+	{
+		T* A_j = &A[(size_t)j*lda];
+		for (int c=0; c<nrhs; c++)
+		{
+			double x_c = X_local[j + (size_t)c*ldx];
+			double* Y_c = &Y_local[(size_t)c*ldy];
+			double* X_transposed_c = &X_transposed[(size_t)c*ldx];
+			double sum = 0.0;
+			for (int i=0; i<m1; i++)
+			{
+				double a = A_j[i];
+				Y_c[i] += a*x_c;
+				sum += a*X_transposed_c[i];
+			}
+			Y_transposed[j + (size_t)c*ldyt] += sum;
+		}
+	}
+}
+
+// Y_transposed += A'*X_transposed for a column-major m1 x m2 matrix A, i.e. X_transposed has m1 and Y_transposed m2
+// rows; the columns of A are contiguous, so every entry of Y_transposed is a dot product
+template<typename T>
+static inline void host_gemm_transposed(double* Y_transposed, int ldyt, T* A, int lda, int m1, int m2, double* X_transposed, int ldx, int nrhs)
+{
+	for (int j=0; j<m2; j++)
+	{
+		T* A_j = &A[(size_t)j*lda];
+		for (int c=0; c<nrhs; c++)
+			Y_transposed[j + (size_t)c*ldyt] += host_dot(A_j, &X_transposed[(size_t)c*ldx], m1);
+	}
+}
+
+// Y_local += A*X_local and / or Y_transposed += A'*X_transposed, whichever output is not 0
+template<typename T>
+static inline void host_apply_dense_block(double* Y_local, int ldy, double* Y_transposed, int ldyt, T* A, int lda, int m1, int m2, double* X_local, double* X_transposed, int ldx, int nrhs)
+{
+	if ((Y_local!=0) && (Y_transposed!=0))
+		host_gemm_and_transposed(Y_local, ldy, Y_transposed, ldyt, A, lda, m1, m2, X_local, X_transposed, ldx, nrhs);
+	else if (Y_local!=0)
+		host_gemm(Y_local, ldy, A, lda, m1, m2, X_local, ldx, nrhs);
+	else
+		host_gemm_transposed(Y_transposed, ldyt, A, lda, m1, m2, X_transposed, ldx, nrhs);
+}
+
+// Y_local += U*(V'*X_local) for a rank-k factorization with column-major U (m1 x k) and V (m2 x k); tmp has to
+// provide k*nrhs entries
+template<typename T>
+static inline void host_low_rank_mmp(double* Y_local, int ldy, T* U, T* V, int m1, int m2, int k, double* X_local, int ldx, int nrhs, double* tmp)
+{
+	for (int c=0; c<nrhs; c++)
+		for (int l=0; l<k; l++)
+			tmp[l + (size_t)c*k] = host_dot(&V[(size_t)l*m2], &X_local[(size_t)c*ldx], m2);
+
+	host_gemm(Y_local, ldy, U, m1, m1, k, tmp, k, nrhs);
+}
+
+// Y_local += U*(V'*X_local) and / or Y_transposed += V*(U'*X_transposed), whichever output is not 0
+template<typename T>
+static inline void host_apply_low_rank_block(double* Y_local, int ldy, double* Y_transposed, int ldyt, T* U, T* V, int m1, int m2, int k, double* X_local, double* X_transposed, int ldx, int nrhs, double* tmp)
+{
+	if (Y_local!=0)
+		host_low_rank_mmp(Y_local, ldy, U, V, m1, m2, k, X_local, ldx, nrhs, tmp);
+	if (Y_transposed!=0)
+		host_low_rank_mmp(Y_transposed, ldyt, V, U, m2, m1, k, X_transposed, ldx, nrhs, tmp);
+}
+
+// precomputed blocks are applied in their storage precision (dense blocks in double or single precision)
+static inline void host_apply_stored_dense_block(double* Y_local, int ldy, double* Y_transposed, int ldyt, double* A, int precision, int m1, int m2, double* X_local, double* X_transposed, int ldx, int nrhs)
+{
+	if (precision==BLOCK_PRECISION_SINGLE)
+		host_apply_dense_block(Y_local, ldy, Y_transposed, ldyt, (float*)A, m1, m1, m2, X_local, X_transposed, ldx, nrhs);
+	else
+		host_apply_dense_block(Y_local, ldy, Y_transposed, ldyt, A, m1, m1, m2, X_local, X_transposed, ldx, nrhs);
+}
+
+static inline void host_apply_stored_low_rank_block(double* Y_local, int ldy, double* Y_transposed, int ldyt, double* U, double* V, int precision, int m1, int m2, int k, double* X_local, double* X_transposed, int ldx, int nrhs, double* tmp)
+{
+	if (precision==BLOCK_PRECISION_SINGLE)
+		host_apply_low_rank_block(Y_local, ldy, Y_transposed, ldyt, (float*)U, (float*)V, m1, m2, k, X_local, X_transposed, ldx, nrhs, tmp);
+	else if (precision==BLOCK_PRECISION_BFLOAT16)
+		host_apply_low_rank_block(Y_local, ldy, Y_transposed, ldyt, (struct host_bfloat16*)U, (struct host_bfloat16*)V, m1, m2, k, X_local, X_transposed, ldx, nrhs, tmp);
+	else
+		host_apply_low_rank_block(Y_local, ldy, Y_transposed, ldyt, U, V, m1, m2, k, X_local, X_transposed, ldx, nrhs, tmp);
+}
+
+static inline void host_add_to_full_matrix(double* Y, int ldy, double* Y_local, int l1, int m1, int nrhs)
+{
+	for (int c=0; c<nrhs; c++)
+		for (int i=0; i<m1; i++)
+		{
+			#pragma omp atomic
+			Y[l1+i + (size_t)c*ldy] += Y_local[i + (size_t)c*m1];
+		}
+}
+
+// Y_local = A*X_local and / or Y_transposed = A'*X_transposed (leading dimension m2), whichever output is not 0,
+// assembling A tile by tile on the fly
+static void host_apply_dense_block_in_tiles(double* Y_local, int ldy, double* X_local, double* Y_transposed, double* X_transposed, int ldx, int nrhs, int l1, int m1, int l2, int m2, struct point_set* input_set1, struct point_set* input_set2, struct system_assembler* assem, double* tile)
+{
+	for (int jt=0; jt<m2; jt+=HOST_TILE_COLS)
+	{
+		int tile_cols = std::min(HOST_TILE_COLS, m2-jt);
+		for (int it=0; it<m1; it+=HOST_TILE_ROWS)
+		{
+			int tile_rows = std::min(HOST_TILE_ROWS, m1-it);
+			host_fill_block(tile, tile_rows, l1+it, tile_rows, l2+jt, tile_cols, input_set1, input_set2, assem);
+			host_apply_dense_block((Y_local!=0) ? &Y_local[it] : 0, ldy, (Y_transposed!=0) ? &Y_transposed[jt] : 0, m2, tile, tile_rows, tile_rows, tile_cols, &X_local[jt], &X_transposed[it], ldx, nrhs);
+		}
+	}
+}
+
+// whether block item writes to the rows of set 1 (side 0) or set 2 (side 1) in a product with H or H'
+static inline bool host_block_writes_side(struct block_item* item, struct mat_vec_data_info* mat_vec_info, bool transpose, int side)
+{
+	if (is_mirrored_block(item, mat_vec_info))
+		return true;
+
+	return (side==0) ? !transpose : transpose;
+}
+
+// number of entries (per right hand side) of the block results kept by the row-owned accumulation
+static size_t host_row_owned_result_size(struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, bool transpose)
+{
+	size_t size = 0;
+
+	for (int i=0; i<mat_vec_info->total_count; i++)
+	{
+		struct block_item item = get_block_item(blocks, i);
+		if (host_block_writes_side(&item, mat_vec_info, transpose, 0))
+			size += item.set1_u-item.set1_l+1;
+		if (host_block_writes_side(&item, mat_vec_info, transpose, 1))
+			size += item.set2_u-item.set2_l+1;
+	}
+
+	return size;
+}
+
+static void host_build_row_schedule(struct mvp_row_schedule* schedule, struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, int row_count, bool transpose)
+{
+	int total_count = mat_vec_info->total_count;
+
+	schedule->blocks = (void*)blocks;
+	schedule->total_count = total_count;
+	schedule->symmetric = mat_vec_info->symmetric;
+
+	// place the contributions one after the other in the result buffer and split the rows at their bounds
+	schedule->local_offsets = new size_t[2*(size_t)total_count];
+	schedule->local_size = 0;
+	std::vector<int> bounds;
+	bounds.push_back(0);
+	bounds.push_back(row_count);
+	for (int c=0; c<2*total_count; c++)
+	{
+		struct block_item item = get_block_item(blocks, c/2);
+		schedule->local_offsets[c] = schedule->local_size;
+		if (!host_block_writes_side(&item, mat_vec_info, transpose, c%2))
+			continue;
+
+		int l = (c%2==0) ? item.set1_l : item.set2_l;
+		int u = (c%2==0) ? item.set1_u : item.set2_u;
+		schedule->local_size += u-l+1;
+		bounds.push_back(l);
+		bounds.push_back(u+1);
+	}
+	std::sort(bounds.begin(), bounds.end());
+	bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+
+	schedule->segment_count = (int)bounds.size()-1;
+	schedule->segment_begin = new int[bounds.size()];
+	memcpy(schedule->segment_begin, &bounds[0], bounds.size()*sizeof(int));
+
+	// contributions per segment in increasing order of c, which fixes the order of the sums
+	schedule->contribution_offsets = new int[schedule->segment_count+1];
+	memset(schedule->contribution_offsets, 0, (schedule->segment_count+1)*sizeof(int));
+	for (int pass=0; pass<2; pass++)
+	{
+		if (pass==1)
+		{
+			for (int seg=0; seg<schedule->segment_count; seg++)
+				schedule->contribution_offsets[seg+1] += schedule->contribution_offsets[seg];
+			schedule->contributions = new int[std::max(schedule->contribution_offsets[schedule->segment_count], 1)];
+		}
+		std::vector<int> filled(pass==1 ? schedule->segment_count : 0, 0);
+
+		for (int c=0; c<2*total_count; c++)
+		{
+			struct block_item item = get_block_item(blocks, c/2);
+			if (!host_block_writes_side(&item, mat_vec_info, transpose, c%2))
+				continue;
+
+			int l = (c%2==0) ? item.set1_l : item.set2_l;
+			int u = (c%2==0) ? item.set1_u : item.set2_u;
+			int seg = (int)(std::lower_bound(bounds.begin(), bounds.end(), l) - bounds.begin());
+			for (; (seg<schedule->segment_count) && (schedule->segment_begin[seg]<=u); seg++)
+			{
+				if (pass==0)
+					schedule->contribution_offsets[seg+1]++;
+				else
+					schedule->contributions[schedule->contribution_offsets[seg] + filled[seg]++] = c;
+			}
+		}
+	}
+}
+
+// schedule of the row-owned accumulation of workspace for the given partition and direction, (re)built if needed
+static struct mvp_row_schedule* host_get_row_schedule(struct mvp_workspace* workspace, struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, int row_count, bool transpose)
+{
+	struct mvp_row_schedule** schedule = &workspace->row_schedules[transpose ? 1 : 0];
+
+	if ((*schedule!=0) && (((*schedule)->blocks!=(void*)blocks) || ((*schedule)->total_count!=mat_vec_info->total_count) || ((*schedule)->symmetric!=mat_vec_info->symmetric)))
+		destroy_mvp_row_schedule(*schedule);
+	else if (*schedule!=0)
+		return *schedule;
+	else
+		*schedule = new struct mvp_row_schedule;
+
+	host_build_row_schedule(*schedule, blocks, mat_vec_info, row_count, transpose);
+
+	return *schedule;
+}
+
+// Y += sum of the block results; every segment of rows is summed up by one thread in the order of the schedule
+static void host_reduce_row_owned_results(double* Y, int ldy, int nrhs, struct mvp_row_schedule* schedule, double* results, struct block_list* blocks, int thread_count)
+{
+	#pragma omp parallel for schedule(dynamic, 16) num_threads(thread_count)
+	for (int seg=0; seg<schedule->segment_count; seg++)
+	{
+		int begin = schedule->segment_begin[seg];
+		int end = schedule->segment_begin[seg+1];
+
+		for (int j=schedule->contribution_offsets[seg]; j<schedule->contribution_offsets[seg+1]; j++)
+		{
+			int c = schedule->contributions[j];
+			struct block_item item = get_block_item(blocks, c/2);
+			int l = (c%2==0) ? item.set1_l : item.set2_l;
+			int m = (c%2==0) ? item.set1_u-item.set1_l+1 : item.set2_u-item.set2_l+1;
+			double* result = &results[schedule->local_offsets[c]*nrhs];
+
+			for (int col=0; col<nrhs; col++)
+				for (int r=begin; r<end; r++)
+					Y[r + (size_t)col*ldy] += result[r-l + (size_t)col*m];
+		}
+	}
+}
+
+struct host_higher_cost_first
+{
+	double* cost;
+
+	bool operator()(const int &lhs, const int &rhs) const
+	{
+		return (cost[lhs]>cost[rhs]) || ((cost[lhs]==cost[rhs]) && (lhs<rhs));
+	}
+};
+
+// block costs of workspace for the given partition, stored blocks and product, (re)built if needed; the order of
+// decreasing cost is only sorted if with_order
+static struct mvp_block_costs* host_get_block_costs(struct mvp_workspace* workspace, struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, int k, double* dA, size_t* dA_offsets, double* U, int* k_per_item, int nrhs, bool with_order)
+{
+	struct mvp_block_costs* costs = workspace->block_costs;
+	int total_count = mat_vec_info->total_count;
+	int dense_count = mat_vec_info->dense_count;
+
+	if ((costs!=0) && ((costs->blocks!=(void*)blocks) || (costs->total_count!=total_count) || (costs->symmetric!=mat_vec_info->symmetric) || (costs->dA!=(void*)dA) || (costs->dA_offsets!=(void*)dA_offsets) || (costs->U!=(void*)U) || (costs->k_per_item!=(void*)k_per_item) || (costs->k!=k) || (costs->nrhs!=nrhs)))
+	{
+		invalidate_mvp_block_costs(workspace);
+		costs = 0;
+	}
+
+	if (costs==0)
+	{
+		costs = new struct mvp_block_costs;
+		costs->blocks = (void*)blocks;
+		costs->total_count = total_count;
+		costs->symmetric = mat_vec_info->symmetric;
+		costs->dA = (void*)dA;
+		costs->dA_offsets = (void*)dA_offsets;
+		costs->U = (void*)U;
+		costs->k_per_item = (void*)k_per_item;
+		costs->k = k;
+		costs->nrhs = nrhs;
+		costs->order = 0;
+		costs->cost = new double[std::max(total_count, 1)];
+		for (int i=0; i<total_count; i++)
+		{
+			bool is_stored;
+			if (i<dense_count)
+				is_stored = (dA!=0) && (dA_offsets[i+1]>dA_offsets[i]);
+			else
+				is_stored = (U!=0) && (k_per_item[i-dense_count]!=HOST_RANK_NOT_STORED);
+			costs->cost[i] = host_block_mvp_cost(blocks, mat_vec_info, k, is_stored, (U!=0) ? k_per_item : 0, i, nrhs);
+		}
+		workspace->block_costs = costs;
+	}
+
+	if (with_order && (costs->order==0))
+	{
+		costs->order = new int[std::max(total_count, 1)];
+		for (int i=0; i<total_count; i++)
+			costs->order[i] = i;
+		host_higher_cost_first higher_cost_first;
+		higher_cost_first.cost = costs->cost;
+		std::sort(costs->order, costs->order+total_count, higher_cost_first);
+	}
+
+	return costs;
+}
+
+// busiest thread over mean thread load if the blocks are handed out in the given order (0 = work item order) to
+// thread_count threads with the given costs, each to the thread that is idle first; loads is scratch memory for
+// thread_count entries
+static double host_list_schedule_imbalance(int* order, double* cost, int total_count, int thread_count, double* loads)
+{
+	for (int t=0; t<thread_count; t++)
+		loads[t] = 0.0;
+
+	// min heap of the thread loads
+	double total_cost = 0.0;
+	for (int j=0; j<total_count; j++)
+	{
+		int i = (order!=0) ? order[j] : j;
+		std::pop_heap(loads, loads+thread_count, std::greater<double>());
+		loads[thread_count-1] += cost[i];
+		std::push_heap(loads, loads+thread_count, std::greater<double>());
+		total_cost += cost[i];
+	}
+
+	double max_load = *std::max_element(loads, loads+thread_count);
+	return (total_cost>0.0) ? max_load/(total_cost/thread_count) : 1.0;
+}
+
+// output buffers of block i (0 if the block does not write to that side): the slots of the block in the result
+// buffer of the row-owned accumulation or scratch memory of the thread's arena
+static inline void host_get_block_outputs(double** Y_local, double** Y_transposed, int i, int m1, int m2, int nrhs, bool transpose, struct block_item* item, struct mat_vec_data_info* mat_vec_info, struct mvp_row_schedule* schedule, double* results, struct workspace_arena* arena)
+{
+	double** outputs[2] = {Y_local, Y_transposed};
+	int rows[2] = {m1, m2};
+
+	for (int side=0; side<2; side++)
+	{
+		*outputs[side] = 0;
+		if (!host_block_writes_side(item, mat_vec_info, transpose, side))
+			continue;
+
+		if (schedule!=0)
+			*outputs[side] = &results[schedule->local_offsets[2*i+side]*nrhs];
+		else
+			*outputs[side] = (double*)workspace_arena_malloc(arena, (size_t)rows[side]*nrhs*sizeof(double));
+		memset(*outputs[side], 0, (size_t)rows[side]*nrhs*sizeof(double));
+	}
+}
+
+size_t host_mvp_workspace_size(struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, int k, int nrhs)
+{
+	// blocks are assumed to be assembled / compressed on the fly, which is an upper bound for precomputed blocks
+	size_t size = 0;
+	nrhs = std::min(nrhs, HOST_COLUMN_TILE);
+
+	for (int i=0; i<mat_vec_info->total_count; i++)
+	{
+		struct block_item item = get_block_item(blocks, i);
+		size_t m1 = item.set1_u-item.set1_l+1;
+		size_t m2 = item.set2_u-item.set2_l+1;
+
+		// a transposed product needs m2 instead of m1 rows, a mirrored block both
+		size_t block_size = std::max(m1, m2)*nrhs*sizeof(double);
+		if (is_mirrored_block(&item, mat_vec_info))
+			block_size += std::min(m1, m2)*nrhs*sizeof(double) + WORKSPACE_ALIGNMENT;
+		if (i<mat_vec_info->dense_count)
+			block_size += HOST_TILE_ROWS*HOST_TILE_COLS*sizeof(double);
+		else
+		{
+			size_t k_max = std::max(std::min((size_t)k, std::min(m1, m2)), (size_t)1);
+			block_size += (m1+m2)*k_max*sizeof(double) + k_max*nrhs*sizeof(double) + (m1+m2)*(sizeof(char)+sizeof(double));
+		}
+		block_size += 6*WORKSPACE_ALIGNMENT;
+
+		size = std::max(size, block_size);
+	}
+
+	return size;
+}
+
+void host_reserve_mvp_workspace(struct mvp_workspace* workspace, struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, int k, int nrhs)
+{
+	size_t size = host_mvp_workspace_size(blocks, mat_vec_info, k, nrhs);
+
+	// the block results of the row-owned accumulation are taken from the arena of the first thread (for at most
+	// HOST_COLUMN_TILE columns, see host_apply_h_matrix)
+	size_t result_size = 0;
+	if (workspace->accumulation==MVP_ACCUMULATE_ROW_OWNED)
+		result_size = std::max(host_row_owned_result_size(blocks, mat_vec_info, false), host_row_owned_result_size(blocks, mat_vec_info, true))*std::min(nrhs, HOST_COLUMN_TILE)*sizeof(double) + WORKSPACE_ALIGNMENT;
+
+	// so are the per thread times of the profile
+	result_size += workspace->thread_count*sizeof(double) + WORKSPACE_ALIGNMENT;
+
+	for (int t=0; t<workspace->thread_count; t++)
+		reserve_workspace_arena(&workspace->host_arenas[t], size + ((t==0) ? result_size : 0));
+}
+
+// Y = H*X or, if transpose, Y = H'*X; the transposed product uses the same blocks with the roles of the row and
+// column clusters swapped, i.e. every block gathers from the rows of set 1 and scatters into the rows of set 2
+static void host_apply_h_matrix(double* X, double* Y, int nrhs, bool transpose, struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, struct point_set* input_set1, struct point_set* input_set2, double eta, double epsilon, int k, struct system_assembler* assem, double* dA, size_t* dA_offsets, double* U, double* V, size_t* U_offsets, size_t* V_offsets, int* k_per_item, char* block_precision, struct mvp_workspace* workspace)
+{
+	int dense_count = mat_vec_info->dense_count;
+	int point_count_1 = input_set1->size;
+	int point_count_2 = input_set2->size;
+	int ldx = transpose ? point_count_1 : point_count_2;
+	int ldy = transpose ? point_count_2 : point_count_1;
+
+	// the results of all blocks are kept until the row-owned accumulation sums them up, wider products are split into
+	// products of HOST_COLUMN_TILE columns to bound the result buffer
+	if ((workspace!=0) && (workspace->accumulation==MVP_ACCUMULATE_ROW_OWNED) && (nrhs>HOST_COLUMN_TILE))
+	{
+		for (int c=0; c<nrhs; c+=HOST_COLUMN_TILE)
+			host_apply_h_matrix(&X[(size_t)c*ldx], &Y[(size_t)c*ldy], std::min(HOST_COLUMN_TILE, nrhs-c), transpose, blocks, mat_vec_info, input_set1, input_set2, eta, epsilon, k, assem, dA, dA_offsets, U, V, U_offsets, V_offsets, k_per_item, block_precision, workspace);
+		return;
+	}
+
+	// without a persistent workspace, a temporary one is used
+	struct mvp_workspace temporary_workspace;
+	if (workspace==0)
+	{
+		init_mvp_workspace(&temporary_workspace, host_get_thread_count());
+		workspace = &temporary_workspace;
+	}
+
+	begin_mvp_workspace_use(workspace);
+
+	// set output matrix to zero
+	memset(Y, 0, (size_t)ldy*nrhs*sizeof(double));
+
+	// with the row-owned accumulation, the blocks write their results to the result buffer, which is summed up into
+	// Y after all blocks are done
+	struct mvp_row_schedule* schedule = 0;
+	double* results = 0;
+	if (workspace->accumulation==MVP_ACCUMULATE_ROW_OWNED)
+	{
+		schedule = host_get_row_schedule(workspace, blocks, mat_vec_info, ldy, transpose);
+		results = (double*)workspace_arena_malloc(&workspace->host_arenas[0], std::max(schedule->local_size, (size_t)1)*nrhs*sizeof(double));
+	}
+
+	struct h_matrix_profile* profile = workspace->profile;
+	int total_count = mat_vec_info->total_count;
+	int thread_count = workspace->thread_count;
+
+	// estimated block costs for the cost-ordered schedule and for the predicted load balance of the profile, kept in
+	// the workspace across MVPs
+	double* block_cost = 0;
+	int* block_order = 0;
+	bool cost_ordered = (workspace->scheduling==MVP_SCHEDULE_COST_ORDERED);
+	if (cost_ordered || (profile!=0))
+	{
+		struct mvp_block_costs* costs = host_get_block_costs(workspace, blocks, mat_vec_info, k, dA, dA_offsets, U, k_per_item, nrhs, cost_ordered);
+		block_cost = costs->cost;
+		if (cost_ordered)
+			block_order = costs->order;
+	}
+
+	// dense and low rank blocks are mixed in the parallel loop, their share of the wall time is given by the time
+	// the threads spend in them
+	double loop_begin = 0.0;
+	double* seconds_per_thread = 0;
+	if (profile!=0)
+	{
+		profile->mvp_dense_thread_seconds = 0.0;
+		profile->mvp_low_rank_thread_seconds = 0.0;
+		seconds_per_thread = (double*)workspace_arena_malloc(&workspace->host_arenas[0], thread_count*sizeof(double));
+		for (int t=0; t<thread_count; t++)
+			seconds_per_thread[t] = 0.0;
+		loop_begin = profile_wall_time();
+	}
+
+	#pragma omp parallel num_threads(thread_count)
+	{
+		struct workspace_arena* arena = &workspace->host_arenas[host_get_thread_id()];
+		double dense_seconds = 0.0;
+		double low_rank_seconds = 0.0;
+
+		#pragma omp for schedule(dynamic)
+		for (int j=0; j<total_count; j++)
+		{
+			int i = (block_order!=0) ? block_order[j] : j;
+			double block_begin = (profile!=0) ? profile_wall_time() : 0.0;
+
+			struct block_item item = get_block_item(blocks, i);
+			int m1 = item.set1_u-item.set1_l+1;
+			int m2 = item.set2_u-item.set2_l+1;
+
+			// all scratch memory of the block is taken from the thread's arena and given back after the block
+			size_t mark = workspace_arena_mark(arena);
+
+			// low rank blocks that are not stored are compressed once for all right hand sides
+			bool is_stored;
+			if (i<dense_count)
+				is_stored = (dA!=0) && (dA_offsets[i+1]>dA_offsets[i]);
+			else
+				is_stored = (U!=0) && (k_per_item[i-dense_count]!=HOST_RANK_NOT_STORED);
+			double* U_local = 0;
+			double* V_local = 0;
+			int rank = 0;
+			if ((i>=dense_count) && (!is_stored))
+			{
+				int k_max = std::min(k, std::min(m1, m2));
+				U_local = (double*)workspace_arena_malloc(arena, (size_t)m1*k_max*sizeof(double));
+				V_local = (double*)workspace_arena_malloc(arena, (size_t)m2*k_max*sizeof(double));
+				char* used = (char*)workspace_arena_malloc(arena, (m1+m2)*sizeof(char));
+				double* reference = (double*)workspace_arena_malloc(arena, (m1+m2)*sizeof(double));
+				rank = host_aca(U_local, V_local, item.set1_l, m1, item.set2_l, m2, input_set1, input_set2, epsilon, k_max, assem, -1, used, reference);
+			}
+
+			// the block is applied to HOST_COLUMN_TILE right hand sides at a time (dense blocks that are not stored are
+			// assembled again for every column tile); a mirrored block of a symmetric partition is applied as the block
+			// and its transpose, otherwise only one of them is needed
+			for (int c=0; c<nrhs; c+=HOST_COLUMN_TILE)
+			{
+				int columns = std::min(HOST_COLUMN_TILE, nrhs-c);
+				double* X_local = &X[item.set2_l + (size_t)c*ldx];
+				double* X_transposed = &X[item.set1_l + (size_t)c*ldx];
+				size_t column_tile_mark = workspace_arena_mark(arena);
+
+				double* Y_local;
+				double* Y_transposed;
+				host_get_block_outputs(&Y_local, &Y_transposed, i, m1, m2, columns, transpose, &item, mat_vec_info, schedule, results, arena);
+
+				if (i<dense_count)
+				{
+					if (is_stored)
+						host_apply_stored_dense_block(Y_local, m1, Y_transposed, m2, &dA[dA_offsets[i]], (block_precision!=0) ? block_precision[i] : BLOCK_PRECISION_DOUBLE, m1, m2, X_local, X_transposed, ldx, columns);
+					else
+					{
+						double* tile = (double*)workspace_arena_malloc(arena, HOST_TILE_ROWS*HOST_TILE_COLS*sizeof(double));
+						host_apply_dense_block_in_tiles(Y_local, m1, X_local, Y_transposed, X_transposed, ldx, columns, item.set1_l, m1, item.set2_l, m2, input_set1, input_set2, assem, tile);
+					}
+				}
+				else
+				{
+					int a = i-dense_count;
+
+					if (is_stored)
+					{
+						double* tmp = (double*)workspace_arena_malloc(arena, (size_t)std::max(k_per_item[a], 1)*columns*sizeof(double));
+						host_apply_stored_low_rank_block(Y_local, m1, Y_transposed, m2, &U[U_offsets[a]], &V[V_offsets[a]], (block_precision!=0) ? block_precision[i] : BLOCK_PRECISION_DOUBLE, m1, m2, k_per_item[a], X_local, X_transposed, ldx, columns, tmp);
+					}
+					else
+					{
+						double* tmp = (double*)workspace_arena_malloc(arena, (size_t)std::max(rank, 1)*columns*sizeof(double));
+						host_apply_low_rank_block(Y_local, m1, Y_transposed, m2, U_local, V_local, m1, m2, rank, X_local, X_transposed, ldx, columns, tmp);
+					}
+				}
+
+				if ((Y_local!=0) && (schedule==0))
+					host_add_to_full_matrix(&Y[(size_t)c*ldy], ldy, Y_local, item.set1_l, m1, columns);
+				if ((Y_transposed!=0) && (schedule==0))
+					host_add_to_full_matrix(&Y[(size_t)c*ldy], ldy, Y_transposed, item.set2_l, m2, columns);
+
+				workspace_arena_release(arena, column_tile_mark);
+			}
+
+			workspace_arena_release(arena, mark);
+
+			if (profile!=0)
+			{
+				if (i<dense_count)
+					dense_seconds += profile_wall_time() - block_begin;
+				else
+					low_rank_seconds += profile_wall_time() - block_begin;
+			}
+		}
+
+		if (profile!=0)
+		{
+			#pragma omp atomic
+			profile->mvp_dense_thread_seconds += dense_seconds;
+			#pragma omp atomic
+			profile->mvp_low_rank_thread_seconds += low_rank_seconds;
+			seconds_per_thread[host_get_thread_id()] = dense_seconds + low_rank_seconds;
+		}
+	}
+
+	if (schedule!=0)
+		host_reduce_row_owned_results(Y, ldy, nrhs, schedule, results, blocks, thread_count);
+
+	if (profile!=0)
+	{
+		// load balance of the block loop, measured and as predicted by the cost model for the same block order
+		double max_seconds = *std::max_element(seconds_per_thread, seconds_per_thread+thread_count);
+		double thread_seconds_sum = profile->mvp_dense_thread_seconds + profile->mvp_low_rank_thread_seconds;
+		profile->mvp_thread_imbalance = (thread_seconds_sum>0.0) ? max_seconds/(thread_seconds_sum/thread_count) : 1.0;
+		profile->mvp_predicted_imbalance = host_list_schedule_imbalance(block_order, block_cost, total_count, thread_count, seconds_per_thread);
+
+		double loop_seconds = profile_wall_time() - loop_begin;
+		double thread_seconds = profile->mvp_dense_thread_seconds + profile->mvp_low_rank_thread_seconds;
+		double dense_share = (thread_seconds>0.0) ? profile->mvp_dense_thread_seconds/thread_seconds : 0.0;
+		profile_add_phase_seconds(profile, PROFILE_MVP_DENSE, loop_seconds*dense_share);
+		profile_add_phase_seconds(profile, PROFILE_MVP_LOW_RANK, loop_seconds*(1.0-dense_share));
+		profile->last_mvp_rhs = nrhs;
+	}
+
+	end_mvp_workspace_use(workspace);
+
+	if (workspace==&temporary_workspace)
+		destroy_mvp_workspace(&temporary_workspace);
+}
+
+void host_h_matrix_mmp(double* X, double* Y, int nrhs, struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, struct point_set* input_set1, struct point_set* input_set2, double eta, double epsilon, int k, struct system_assembler* assem, double* dA, size_t* dA_offsets, double* U, double* V, size_t* U_offsets, size_t* V_offsets, int* k_per_item, char* block_precision, struct mvp_workspace* workspace)
+{
+	host_apply_h_matrix(X, Y, nrhs, false, blocks, mat_vec_info, input_set1, input_set2, eta, epsilon, k, assem, dA, dA_offsets, U, V, U_offsets, V_offsets, k_per_item, block_precision, workspace);
+}
+
+void host_h_matrix_mvp(double* x, double* y, struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, struct point_set* input_set1, struct point_set* input_set2, double eta, double epsilon, int k, struct system_assembler* assem, double* dA, size_t* dA_offsets, double* U, double* V, size_t* U_offsets, size_t* V_offsets, int* k_per_item, char* block_precision, struct mvp_workspace* workspace)
+{
+	host_apply_h_matrix(x, y, 1, false, blocks, mat_vec_info, input_set1, input_set2, eta, epsilon, k, assem, dA, dA_offsets, U, V, U_offsets, V_offsets, k_per_item, block_precision, workspace);
+}
+
+void host_h_matrix_mmp_transpose(double* X, double* Y, int nrhs, struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, struct point_set* input_set1, struct point_set* input_set2, double eta, double epsilon, int k, struct system_assembler* assem, double* dA, size_t* dA_offsets, double* U, double* V, size_t* U_offsets, size_t* V_offsets, int* k_per_item, char* block_precision, struct mvp_workspace* workspace)
+{
+	host_apply_h_matrix(X, Y, nrhs, true, blocks, mat_vec_info, input_set1, input_set2, eta, epsilon, k, assem, dA, dA_offsets, U, V, U_offsets, V_offsets, k_per_item, block_precision, workspace);
+}
+
+void host_h_matrix_mvp_transpose(double* x, double* y, struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, struct point_set* input_set1, struct point_set* input_set2, double eta, double epsilon, int k, struct system_assembler* assem, double* dA, size_t* dA_offsets, double* U, double* V, size_t* U_offsets, size_t* V_offsets, int* k_per_item, char* block_precision, struct mvp_workspace* workspace)
+{
+	host_apply_h_matrix(x, y, 1, true, blocks, mat_vec_info, input_set1, input_set2, eta, epsilon, k, assem, dA, dA_offsets, U, V, U_offsets, V_offsets, k_per_item, block_precision, workspace);
+}
+
+// reader thread of a block stream, which reads one requested chunk at a time into the given buffer
+struct host_stream_reader
+{
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t request_posted;
+	pthread_cond_t request_done;
+
+	// chunk requested (-1 if none is pending) and buffer it is read into
+	int chunk;
+	double* buffer;
+
+	bool stop;
+	struct host_block_stream* stream;
+};
+
+static void* host_run_stream_reader(void* argument)
+{
+	struct host_stream_reader* reader = (struct host_stream_reader*)argument;
+	struct host_block_stream* stream = reader->stream;
+
+	pthread_mutex_lock(&reader->mutex);
+	while (true)
+	{
+		while ((reader->chunk<0) && !reader->stop)
+			pthread_cond_wait(&reader->request_posted, &reader->mutex);
+		if (reader->stop)
+			break;
+
+		// the chunk is read without holding the lock
+		int chunk = reader->chunk;
+		double* buffer = reader->buffer;
+		pthread_mutex_unlock(&reader->mutex);
+
+		size_t begin = stream->block_offsets[stream->chunk_begin[chunk]];
+		size_t end = stream->block_offsets[stream->chunk_begin[chunk+1]];
+		host_read_scratch_file(stream->file, buffer, (end-begin)*sizeof(double), begin*sizeof(double), stream->file_name);
+
+		pthread_mutex_lock(&reader->mutex);
+		reader->chunk = -1;
+		pthread_cond_signal(&reader->request_done);
+	}
+	pthread_mutex_unlock(&reader->mutex);
+
+	return 0;
+}
+
+// hands chunk over to the reader thread, which reads it into buffer
+static void host_request_chunk(struct host_block_stream* stream, int chunk, double* buffer)
+{
+	struct host_stream_reader* reader = stream->reader;
+
+	pthread_mutex_lock(&reader->mutex);
+	reader->chunk = chunk;
+	reader->buffer = buffer;
+	pthread_cond_signal(&reader->request_posted);
+	pthread_mutex_unlock(&reader->mutex);
+}
+
+// waits until the reader thread has read the requested chunk
+static void host_wait_for_chunk(struct host_block_stream* stream)
+{
+	struct host_stream_reader* reader = stream->reader;
+
+	pthread_mutex_lock(&reader->mutex);
+	while (reader->chunk>=0)
+		pthread_cond_wait(&reader->request_done, &reader->mutex);
+	pthread_mutex_unlock(&reader->mutex);
+}
+
+void host_write_block_stream(struct host_block_stream* stream, char* file_name, size_t chunk_size, struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, struct point_set* input_set1, struct point_set* input_set2, double eta, double epsilon, int k, struct system_assembler* assem, char* block_precision)
+{
+	int dense_count = mat_vec_info->dense_count;
+	int total_count = mat_vec_info->total_count;
+	size_t chunk_length = std::max(chunk_size/sizeof(double), (size_t)1);
+
+	stream->chunk_size = chunk_size;
+	stream->file_name = new char[strlen(file_name)+1];
+	strcpy(stream->file_name, file_name);
+	stream->file = host_create_scratch_file(stream->file_name);
+	stream->block_offsets = new size_t[total_count+1];
+	stream->k_per_item = new int[mat_vec_info->aca_count];
+	stream->block_precision = 0;
+	if (block_precision!=0)
+	{
+		stream->block_precision = new char[total_count];
+		memcpy(stream->block_precision, block_precision, total_count*sizeof(char));
+	}
+
+	// the blocks are computed in groups of about one chunk in parallel and appended in block list order, i.e. only
+	// one group is held in memory at a time
+	std::vector<double*> block_data(total_count);
+	std::vector<size_t> block_length(total_count);
+	stream->block_offsets[0] = 0;
+	int group_begin = 0;
+	while (group_begin<total_count)
+	{
+		int group_end = group_begin;
+		size_t group_length = 0;
+		do
+		{
+			group_length += host_block_storage_size(blocks, mat_vec_info, k, 0, group_end)/sizeof(double);
+			group_end++;
+		} while ((group_end<total_count) && (group_length<chunk_length));
+
+		#pragma omp parallel
+		{
+			std::vector<double> U_local, V_local, reference;
+			std::vector<char> used;
+
+			#pragma omp for schedule(dynamic)
+			for (int i=group_begin; i<group_end; i++)
+			{
+				struct block_item item = get_block_item(blocks, i);
+				int m1 = item.set1_u-item.set1_l+1;
+				int m2 = item.set2_u-item.set2_l+1;
+				int precision = (stream->block_precision!=0) ? stream->block_precision[i] : BLOCK_PRECISION_DOUBLE;
+
+				if (i<dense_count)
+				{
+					block_length[i] = block_precision_doubles((size_t)m1*m2, precision);
+					block_data[i] = new double[std::max(block_length[i], (size_t)1)];
+					if (precision==BLOCK_PRECISION_DOUBLE)
+						host_fill_block(block_data[i], m1, item.set1_l, m1, item.set2_l, m2, input_set1, input_set2, assem);
+					else
+					{
+						U_local.resize((size_t)m1*m2);
+						host_fill_block(&U_local[0], m1, item.set1_l, m1, item.set2_l, m2, input_set1, input_set2, assem);
+						host_pack_entries(block_data[i], &U_local[0], (size_t)m1*m2, precision);
+					}
+				}
+				else
+				{
+					// U and V of the block are stored one after the other
+					int k_max = std::min(k, std::min(m1, m2));
+					U_local.resize((size_t)m1*k_max);
+					V_local.resize((size_t)m2*k_max);
+					used.resize(m1+m2);
+					reference.resize(m1+m2);
+
+					int rank = host_aca(&U_local[0], &V_local[0], item.set1_l, m1, item.set2_l, m2, input_set1, input_set2, epsilon, k_max, assem, -1, &used[0], &reference[0]);
+
+					stream->k_per_item[i-dense_count] = rank;
+					size_t U_length = block_precision_doubles((size_t)m1*rank, precision);
+					block_length[i] = U_length + block_precision_doubles((size_t)m2*rank, precision);
+					block_data[i] = new double[std::max(block_length[i], (size_t)1)];
+					host_pack_entries(block_data[i], &U_local[0], (size_t)m1*rank, precision);
+					host_pack_entries(&block_data[i][U_length], &V_local[0], (size_t)m2*rank, precision);
+				}
+			}
+		}
+
+		for (int i=group_begin; i<group_end; i++)
+		{
+			stream->block_offsets[i+1] = stream->block_offsets[i] + block_length[i];
+			host_write_scratch_file(stream->file, block_data[i], block_length[i]*sizeof(double), stream->block_offsets[i]*sizeof(double), stream->file_name);
+			delete [] block_data[i];
+		}
+
+		group_begin = group_end;
+	}
+
+	// chunks of consecutive blocks that are read at once; blocks larger than chunk_size form a chunk of their own
+	std::vector<int> chunk_begin;
+	stream->max_chunk_length = 0;
+	int i = 0;
+	while (i<total_count)
+	{
+		chunk_begin.push_back(i);
+		int end = i+1;
+		while ((end<total_count) && (stream->block_offsets[end+1]-stream->block_offsets[i]<=chunk_length))
+			end++;
+		stream->max_chunk_length = std::max(stream->max_chunk_length, stream->block_offsets[end]-stream->block_offsets[i]);
+		i = end;
+	}
+	chunk_begin.push_back(total_count);
+
+	stream->chunk_count = chunk_begin.size()-1;
+	stream->chunk_begin = new int[chunk_begin.size()];
+	memcpy(stream->chunk_begin, &chunk_begin[0], chunk_begin.size()*sizeof(int));
+
+	for (int b=0; b<2; b++)
+		stream->buffers[b] = new double[std::max(stream->max_chunk_length, (size_t)1)];
+
+	// the reader thread lives as long as the stream and serves the read requests of all MVPs
+	struct host_stream_reader* reader = new struct host_stream_reader;
+	pthread_mutex_init(&reader->mutex, 0);
+	pthread_cond_init(&reader->request_posted, 0);
+	pthread_cond_init(&reader->request_done, 0);
+	reader->chunk = -1;
+	reader->buffer = 0;
+	reader->stop = false;
+	reader->stream = stream;
+	stream->reader = reader;
+	if (pthread_create(&reader->thread, 0, host_run_stream_reader, reader)!=0)
+	{
+		printf("Could not start the reader thread of the scratch file. Exiting...\n");
+		exit(1);
+	}
+
+	printf("Wrote %lf MB of blocks to %s (%d chunks of at most %lf MB)\n", (double)(stream->block_offsets[total_count]*sizeof(double))/(1024.0*1024.0), stream->file_name, stream->chunk_count, (double)(stream->max_chunk_length*sizeof(double))/(1024.0*1024.0));
+}
+
+void host_destroy_block_stream(struct host_block_stream* stream)
+{
+	struct host_stream_reader* reader = stream->reader;
+	pthread_mutex_lock(&reader->mutex);
+	reader->stop = true;
+	pthread_cond_signal(&reader->request_posted);
+	pthread_mutex_unlock(&reader->mutex);
+	pthread_join(reader->thread, 0);
+	pthread_mutex_destroy(&reader->mutex);
+	pthread_cond_destroy(&reader->request_posted);
+	pthread_cond_destroy(&reader->request_done);
+	delete reader;
+
+	host_remove_scratch_file(stream->file, stream->file_name);
+	delete [] stream->file_name;
+	delete [] stream->block_offsets;
+	delete [] stream->k_per_item;
+	delete [] stream->block_precision;
+	delete [] stream->chunk_begin;
+	for (int b=0; b<2; b++)
+		delete [] stream->buffers[b];
+}
+
+void host_stream_h_matrix_mmp(double* X, double* Y, int nrhs, bool transpose, struct host_block_stream* stream, struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, struct point_set* input_set1, struct point_set* input_set2, struct mvp_workspace* workspace)
+{
+	int dense_count = mat_vec_info->dense_count;
+	int ldx = transpose ? input_set1->size : input_set2->size;
+	int ldy = transpose ? input_set2->size : input_set1->size;
+
+	// as in host_apply_h_matrix, the row-owned accumulation takes at most HOST_COLUMN_TILE columns at once (the scratch
+	// file is read once per column tile then)
+	if ((workspace!=0) && (workspace->accumulation==MVP_ACCUMULATE_ROW_OWNED) && (nrhs>HOST_COLUMN_TILE))
+	{
+		for (int c=0; c<nrhs; c+=HOST_COLUMN_TILE)
+			host_stream_h_matrix_mmp(&X[(size_t)c*ldx], &Y[(size_t)c*ldy], std::min(HOST_COLUMN_TILE, nrhs-c), transpose, stream, blocks, mat_vec_info, input_set1, input_set2, workspace);
+		return;
+	}
+
+	// without a persistent workspace, a temporary one is used
+	struct mvp_workspace temporary_workspace;
+	if (workspace==0)
+	{
+		init_mvp_workspace(&temporary_workspace, host_get_thread_count());
+		workspace = &temporary_workspace;
+	}
+
+	begin_mvp_workspace_use(workspace);
+
+	memset(Y, 0, (size_t)ldy*nrhs*sizeof(double));
+
+	// the block results of the row-owned accumulation are kept over all chunks
+	struct mvp_row_schedule* schedule = 0;
+	double* results = 0;
+	if (workspace->accumulation==MVP_ACCUMULATE_ROW_OWNED)
+	{
+		schedule = host_get_row_schedule(workspace, blocks, mat_vec_info, ldy, transpose);
+		results = (double*)workspace_arena_malloc(&workspace->host_arenas[0], std::max(schedule->local_size, (size_t)1)*nrhs*sizeof(double));
+	}
+
+	// double buffering: while the blocks of one chunk are applied, the reader thread reads the next chunk into the
+	// other buffer
+	if (stream->chunk_count>0)
+		host_request_chunk(stream, 0, stream->buffers[0]);
+
+	for (int c=0; c<stream->chunk_count; c++)
+	{
+		host_wait_for_chunk(stream);
+		if (c+1<stream->chunk_count)
+			host_request_chunk(stream, c+1, stream->buffers[(c+1)%2]);
+
+		double* buffer = stream->buffers[c%2];
+		size_t chunk_offset = stream->block_offsets[stream->chunk_begin[c]];
+
+		#pragma omp parallel num_threads(workspace->thread_count)
+		{
+			struct workspace_arena* arena = &workspace->host_arenas[host_get_thread_id()];
+
+			#pragma omp for schedule(dynamic)
+			for (int i=stream->chunk_begin[c]; i<stream->chunk_begin[c+1]; i++)
+			{
+				struct block_item item = get_block_item(blocks, i);
+				int m1 = item.set1_u-item.set1_l+1;
+				int m2 = item.set2_u-item.set2_l+1;
+				double* block = &buffer[stream->block_offsets[i]-chunk_offset];
+				int precision = (stream->block_precision!=0) ? stream->block_precision[i] : BLOCK_PRECISION_DOUBLE;
+
+				// the block is applied to HOST_COLUMN_TILE right hand sides at a time
+				for (int col=0; col<nrhs; col+=HOST_COLUMN_TILE)
+				{
+					int columns = std::min(HOST_COLUMN_TILE, nrhs-col);
+					double* X_local = &X[item.set2_l + (size_t)col*ldx];
+					double* X_transposed = &X[item.set1_l + (size_t)col*ldx];
+
+					size_t mark = workspace_arena_mark(arena);
+
+					double* Y_local;
+					double* Y_transposed;
+					host_get_block_outputs(&Y_local, &Y_transposed, i, m1, m2, columns, transpose, &item, mat_vec_info, schedule, results, arena);
+
+					if (i<dense_count)
+						host_apply_stored_dense_block(Y_local, m1, Y_transposed, m2, block, precision, m1, m2, X_local, X_transposed, ldx, columns);
+					else
+					{
+						int rank = stream->k_per_item[i-dense_count];
+						double* tmp = (double*)workspace_arena_malloc(arena, (size_t)std::max(rank, 1)*columns*sizeof(double));
+						host_apply_stored_low_rank_block(Y_local, m1, Y_transposed, m2, block, &block[block_precision_doubles((size_t)m1*rank, precision)], precision, m1, m2, rank, X_local, X_transposed, ldx, columns, tmp);
+					}
+
+					if ((Y_local!=0) && (schedule==0))
+						host_add_to_full_matrix(&Y[(size_t)col*ldy], ldy, Y_local, item.set1_l, m1, columns);
+					if ((Y_transposed!=0) && (schedule==0))
+						host_add_to_full_matrix(&Y[(size_t)col*ldy], ldy, Y_transposed, item.set2_l, m2, columns);
+
+					workspace_arena_release(arena, mark);
+				}
+			}
+		}
+	}
+
+	if (schedule!=0)
+		host_reduce_row_owned_results(Y, ldy, nrhs, schedule, results, blocks, workspace->thread_count);
+
+	end_mvp_workspace_use(workspace);
+
+	if (workspace==&temporary_workspace)
+		destroy_mvp_workspace(&temporary_workspace);
+}
+
+void host_full_mvp(double* x, double* y, struct point_set* input_set1, struct point_set* input_set2, struct system_assembler* assem)
+{
+	int point_count_1 = input_set1->size;
+	int point_count_2 = input_set2->size;
+
+	// every thread owns blocks of HOST_TILE_ROWS rows of y
+	#pragma omp parallel
+	{
+		std::vector<double> tile(HOST_TILE_ROWS*HOST_TILE_COLS);
+
+		#pragma omp for schedule(dynamic)
+		for (int it=0; it<point_count_1; it+=HOST_TILE_ROWS)
+		{
+			int tile_rows = std::min(HOST_TILE_ROWS, point_count_1-it);
+			memset(&y[it], 0, tile_rows*sizeof(double));
+			host_apply_dense_block_in_tiles(&y[it], tile_rows, x, 0, 0, point_count_2, 1, it, tile_rows, 0, point_count_2, input_set1, input_set2, assem, &tile[0]);
+		}
+	}
+}
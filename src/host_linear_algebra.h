@@ -0,0 +1,184 @@
+// Copyright (C) 2016 Peter Zaspel
+//
+// This file is part of hmglib.
+//
+// hmglib is free software: you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// hmglib is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hmglib.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef HOST_LINEAR_ALGEBRA_H_
+#define HOST_LINEAR_ALGEBRA_H_
+
+#include <stddef.h>
+
+#include "morton.h"
+#include "tree.h"
+#include "system_assembler.h"
+#include "workspace.h"
+
+// dense blocks are assembled on the host in column-major tiles of HOST_TILE_ROWS x HOST_TILE_COLS entries (64 KB),
+// such that a tile stays in cache between its assembly and its application
+#define HOST_TILE_ROWS 64
+#define HOST_TILE_COLS 128
+
+// the MMPs apply every block to HOST_COLUMN_TILE right hand sides at a time, such that the block results and the scratch
+// memory of a block have at most HOST_COLUMN_TILE columns for any number of right hand sides
+#define HOST_COLUMN_TILE 32
+
+// rank in k_per_item of ACA blocks that are not precomputed, but compressed on the fly in every MVP
+#define HOST_RANK_NOT_STORED -1
+
+// cost of one kernel evaluation in flops, used by the cost model that selects the blocks to precompute
+#define HOST_KERNEL_EVALUATION_COST 20.0
+
+// cost of reading one byte of a stored block from memory in flops, used by the cost model of the MVP schedule
+#define HOST_BYTE_COST 1.0
+
+// sorts the blocks by type (dense blocks first, otherwise keeping their order) and counts them
+extern void host_organize_mat_vec_data(struct block_list* blocks, struct mat_vec_data_info* mat_vec_info);
+
+// assembles the m1 x m2 block starting at (l1,l2) column-major into A with leading dimension lda; known kernel types
+// use the specialized routines from host_kernel_assembler.h, others fall back to get_matrix_entry
+extern void host_fill_block(double* A, int lda, int l1, int m1, int l2, int m2, struct point_set* input_set1, struct point_set* input_set2, struct system_assembler* assem);
+
+// ACA+ of the m1 x m2 block starting at (l1,l2), i.e. A ~ U*V'; U (m1 x k) and V (m2 x k) are column-major; the pivots
+// are taken from the residuals of a reference row and a reference column, such that rows or columns in which the
+// residual vanishes do not end the approximation early; the first pivot row is first_row (relative to l1, -1 = chosen
+// by the references), used and reference have to provide m1+m2 entries each; returns the rank that was reached
+extern int host_aca(double* U, double* V, int l1, int m1, int l2, int m2, struct point_set* input_set1, struct point_set* input_set2, double epsilon, int k, struct system_assembler* assem, int first_row, char* used, double* reference);
+
+// precomputes all dense blocks; dense block i is stored column-major at (*dA)[(*dA_offsets)[i]]
+extern void host_precompute_dense(struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, struct point_set* input_set1, struct point_set* input_set2, struct system_assembler* assem, double** dA, size_t** dA_offsets);
+
+// precomputes all ACA blocks; ACA block a (i.e. work item dense_count+a) has rank (*k_per_item)[a] and its factors
+// are stored at (*U)[(*U_offsets)[a]] and (*V)[(*V_offsets)[a]]
+extern void host_precompute_aca(struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, struct point_set* input_set1, struct point_set* input_set2, double eta, double epsilon, int k, struct system_assembler* assem, double** U, double** V, size_t** U_offsets, size_t** V_offsets, int** k_per_item);
+
+// cost model of the block cache: flops to assemble / compress work item i and bytes to store it; ACA blocks of
+// unknown rank (k_per_item==0 or HOST_RANK_NOT_STORED) are estimated with the rank bound min(k,m1,m2)
+extern double host_block_assembly_cost(struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, int k, int* k_per_item, int i);
+
+// cost model of the MVP schedule: flops to apply work item i to nrhs right hand sides (twice for a mirrored block)
+// plus the bytes read for a stored block or the cost to assemble / compress a block that is not stored
+extern double host_block_mvp_cost(struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, int k, bool is_stored, int* k_per_item, int i, int nrhs);
+
+extern size_t host_block_storage_size(struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, int k, int* k_per_item, int i);
+
+extern int host_block_rank_bound(struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, int k, int* k_per_item, int i);
+
+// selects the blocks to precompute within memory_budget bytes (0 = no limit) by taking them greedily in the order of
+// decreasing assembly cost per byte; sets stored[i] for all mat_vec_info->total_count work items and returns the
+// (estimated) bytes of the selected blocks
+extern size_t host_select_stored_blocks(char* stored, struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, int k, int* k_per_item, size_t memory_budget);
+
+// (re)builds the precomputed dense blocks such that exactly the blocks with stored[i]!=0 (all for stored==0) are kept;
+// blocks of the previous arrays *dA, *dA_offsets (if not 0) are reused and the previous arrays are released; blocks
+// that are not stored have empty ranges in *dA_offsets
+extern void host_store_dense_blocks(struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, struct point_set* input_set1, struct point_set* input_set2, struct system_assembler* assem, char* stored, double** dA, size_t** dA_offsets);
+
+// same for the ACA blocks, which are selected by stored[dense_count+a]; blocks that are not stored have the rank
+// HOST_RANK_NOT_STORED; ACA block a starts at the pivot row first_rows[a] (-1 or first_rows==0: chosen by the ACA+
+// references)
+extern void host_store_aca_blocks(struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, struct point_set* input_set1, struct point_set* input_set2, double eta, double epsilon, int k, struct system_assembler* assem, char* stored, int* first_rows, double** U, double** V, size_t** U_offsets, size_t** V_offsets, int** k_per_item);
+
+// first pivot rows to warm-start a new compression of the ACA blocks (e.g. for another kernel on the same block
+// cluster tree) from the precomputed factors: the row of the largest entry in the first column of U, i.e. the row
+// that crossed the dominant column of the block (-1 for blocks without factors)
+extern void host_get_aca_first_rows(int* first_rows, struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, double* U, size_t* U_offsets, int* k_per_item, char* block_precision);
+
+// truncates the rank-r factorization U*V' (column-major U: m1 x r, V: m2 x r) by QR decompositions of both factors
+// and an SVD of the r x r core to the smallest rank that meets epsilon relative to ||U*V'||_F; the new factors
+// overwrite the leading columns of U and V, the new rank is returned
+extern int host_recompress_low_rank_block(double* U, double* V, int m1, int m2, int r, double epsilon);
+
+// recompresses all precomputed ACA blocks and repacks U and V (and their offsets) with the new ranks
+extern void host_recompress_aca(struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, double epsilon, double** U, double** V, size_t** U_offsets, size_t** V_offsets, int* k_per_item);
+
+// repacks the precomputed blocks (stored in double) with a storage precision per block, which is the lowest allowed
+// precision (dense_precision for dense blocks, factor_precision for ACA factors) whose rounding error bound is at
+// most tolerance*||H||_F/sqrt(number of blocks), such that the stored H matrix differs from the double one by at
+// most tolerance*||H||_F (tolerance is typically the ACA epsilon); *block_precision is allocated with the precision
+// of every work item, blocks that are not stored keep BLOCK_PRECISION_DOUBLE; recompression has to be done before
+extern void host_reduce_storage_precision(struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, double tolerance, int dense_precision, int factor_precision, double** dA, size_t** dA_offsets, double** U, double** V, size_t** U_offsets, size_t** V_offsets, int* k_per_item, char** block_precision);
+
+// scratch memory per thread that an H matrix-matrix product with nrhs right hand sides needs at most (which does not
+// grow beyond HOST_COLUMN_TILE right hand sides)
+extern size_t host_mvp_workspace_size(struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, int k, int nrhs);
+
+// sizes the host arenas of workspace such that products with up to nrhs right hand sides do not allocate
+extern void host_reserve_mvp_workspace(struct mvp_workspace* workspace, struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, int k, int nrhs);
+
+// y = H*x in Z order; blocks for which no precomputed data is given (dA==0 or U==0, or not stored, see
+// host_store_dense_blocks) are assembled / compressed on the fly; block_precision gives the storage precision of
+// every work item (0 if all precomputed blocks are stored in double, see host_reduce_storage_precision); scratch
+// memory is taken from workspace (a temporary workspace is used for workspace==0)
+extern void host_h_matrix_mvp(double* x, double* y, struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, struct point_set* input_set1, struct point_set* input_set2, double eta, double epsilon, int k, struct system_assembler* assem, double* dA, size_t* dA_offsets, double* U, double* V, size_t* U_offsets, size_t* V_offsets, int* k_per_item, char* block_precision, struct mvp_workspace* workspace);
+
+// Y = H*X in Z order for nrhs right hand sides, i.e. column-major X (input_set2->size x nrhs) and Y
+// (input_set1->size x nrhs); every block is compressed once (if not stored) and applied to HOST_COLUMN_TILE columns at
+// a time
+extern void host_h_matrix_mmp(double* X, double* Y, int nrhs, struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, struct point_set* input_set1, struct point_set* input_set2, double eta, double epsilon, int k, struct system_assembler* assem, double* dA, size_t* dA_offsets, double* U, double* V, size_t* U_offsets, size_t* V_offsets, int* k_per_item, char* block_precision, struct mvp_workspace* workspace);
+
+// y = H'*x in Z order with the same blocks as host_h_matrix_mvp, i.e. x has input_set1->size and y input_set2->size
+// entries
+extern void host_h_matrix_mvp_transpose(double* x, double* y, struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, struct point_set* input_set1, struct point_set* input_set2, double eta, double epsilon, int k, struct system_assembler* assem, double* dA, size_t* dA_offsets, double* U, double* V, size_t* U_offsets, size_t* V_offsets, int* k_per_item, char* block_precision, struct mvp_workspace* workspace);
+
+// Y = H'*X in Z order for nrhs right hand sides, i.e. column-major X (input_set1->size x nrhs) and Y
+// (input_set2->size x nrhs)
+extern void host_h_matrix_mmp_transpose(double* X, double* Y, int nrhs, struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, struct point_set* input_set1, struct point_set* input_set2, double eta, double epsilon, int k, struct system_assembler* assem, double* dA, size_t* dA_offsets, double* U, double* V, size_t* U_offsets, size_t* V_offsets, int* k_per_item, char* block_precision, struct mvp_workspace* workspace);
+
+// blocks of the out-of-core MVP, which are written to a scratch file in block list order (dense blocks column-major,
+// ACA blocks as U followed by V, both packed in the storage precision of the block) and streamed back in chunks of
+// consecutive blocks for every MVP
+struct host_block_stream
+{
+	char* file_name;
+	int file;
+
+	// offsets (in doubles) of the total_count blocks in the file, ranks of the ACA blocks and storage precision of
+	// every work item (0 if all blocks are stored in double)
+	size_t* block_offsets;
+	int* k_per_item;
+	char* block_precision;
+
+	// chunk c holds the work items chunk_begin[c], ..., chunk_begin[c+1]-1
+	int chunk_count;
+	int* chunk_begin;
+	size_t max_chunk_length;
+
+	// one buffer holds the chunk that is applied, the other one the chunk that is read ahead by the reader thread,
+	// which lives as long as the stream
+	double* buffers[2];
+	struct host_stream_reader* reader;
+
+	// chunk_size the stream was written with
+	size_t chunk_size;
+};
+
+// assembles / compresses all blocks and writes them to the scratch file file_name, holding only about chunk_size bytes
+// of blocks in memory at a time; the chunks read by the MVP have at most chunk_size bytes (unless a single block is
+// larger); block_precision gives the storage precision of every work item in the file (0 = double, e.g. the one
+// selected by host_reduce_storage_precision); starts the reader thread of the stream
+extern void host_write_block_stream(struct host_block_stream* stream, char* file_name, size_t chunk_size, struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, struct point_set* input_set1, struct point_set* input_set2, double eta, double epsilon, int k, struct system_assembler* assem, char* block_precision);
+
+// stops the reader thread, releases the buffers and removes the scratch file
+extern void host_destroy_block_stream(struct host_block_stream* stream);
+
+// Y = H*X (or Y = H'*X if transpose) in Z order for nrhs right hand sides with the blocks streamed from the scratch
+// file; the next chunk is read by the reader thread of the stream while the blocks of the current chunk are applied
+extern void host_stream_h_matrix_mmp(double* X, double* Y, int nrhs, bool transpose, struct host_block_stream* stream, struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, struct point_set* input_set1, struct point_set* input_set2, struct mvp_workspace* workspace);
+
+// y = A*x in Z order using the full kernel matrix (for testing purposes)
+extern void host_full_mvp(double* x, double* y, struct point_set* input_set1, struct point_set* input_set2, struct system_assembler* assem);
+
+#endif /* HOST_LINEAR_ALGEBRA_H_ */
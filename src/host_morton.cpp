@@ -0,0 +1,332 @@
+// Copyright (C) 2016 Peter Zaspel
+//
+// This file is part of hmglib.
+//
+// hmglib is free software: you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// hmglib is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hmglib.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+#include "host_morton.h"
+
+// power iterations for the principal axis of a cluster (CLUSTERING_PCA)
+#define HOST_PCA_ITERATIONS 30
+
+// clusters with more points than this are bisected in tasks of their own, smaller ones within the parent task
+#define HOST_BISECTION_TASK_CUTOFF 4096
+
+static inline uint64_t host_coord_to_fp(double coord, double minimum, double max_minus_min, int bits)
+{
+	// degenerated dimension (all points share the same coordinate)
+	if (max_minus_min<=0.0)
+		return 0x0ul;
+
+	double tmp = (coord - minimum) / max_minus_min;
+	uint64_t fp = (uint64_t)floor( tmp*(double)(1ul << bits) );
+	uint64_t fp_max = (1ul << bits) - 1;
+
+	return (fp < fp_max) ? fp : fp_max;
+}
+
+// bit mask of the positions 0, dim, 2*dim, ..., (bits-1)*dim, to which the bits of a fixed-point coordinate are stretched
+static uint64_t host_compute_stretch_mask(int dim, int bits)
+{
+	uint64_t mask = 0x0ul;
+	for (int b=0; b<bits; b++)
+		mask = mask | (0x1ul << (b*dim));
+	return mask;
+}
+
+// lookup table spreading the 8 bits of one byte of a fixed-point coordinate to the positions 0, dim, 2*dim, ..., 7*dim
+static void host_compute_stretch_table(uint64_t* table, int dim)
+{
+	for (int value=0; value<256; value++)
+	{
+		table[value] = 0x0ul;
+		for (int b=0; b<8; b++)
+			if ((b*dim<64) && ((value >> b) & 0x1))
+				table[value] = table[value] | (0x1ul << (b*dim));
+	}
+}
+
+static inline uint64_t host_stretch(uint64_t x, int dim, int bits, uint64_t mask, uint64_t* table)
+{
+#ifdef __BMI2__
+	(void)dim; (void)bits; (void)table;
+	return _pdep_u64(x, mask);
+#else
+	(void)mask;
+	uint64_t result = 0x0ul;
+	for (int byte=0; 8*byte<bits; byte++)
+		result = result | (table[(x >> (8*byte)) & 0xfful] << (8*byte*dim));
+	return result;
+#endif
+}
+
+void host_get_morton_code(struct point_set* points, struct morton_code* morton)
+{
+	int dim = points->dim;
+	int bits = morton->bits;
+	int point_count = points->size;
+
+	if ((dim<1) || (dim>MAX_DIM) || (bits<1) || (bits>32) || (dim*bits>64))
+	{
+		printf("Morton codes with %d bits in %d dimensions are not supported (need dim<=%d, bits<=32, dim*bits<=64). Exiting...\n", bits, dim, MAX_DIM);
+		exit(1);
+	}
+
+	uint64_t mask = host_compute_stretch_mask(dim, bits);
+
+	uint64_t table[256];
+	host_compute_stretch_table(table, dim);
+
+	#pragma omp parallel for schedule(static)
+	for (int idx=0; idx<point_count; idx++)
+	{
+		uint64_t code_result = 0x0ul;
+		for (int d=0; d<dim; d++)
+		{
+			double maximum = points->max_per_dim[d];
+			double minimum = points->min_per_dim[d];
+
+			// generate fixed-point representation of coordinate
+			uint64_t tmp_code = host_coord_to_fp(points->coords[d][idx], minimum, maximum-minimum, bits);
+
+			// stretch binary representation and interleave, i.e. bit b of dimension d is placed at position b*dim+d
+			code_result = code_result | (host_stretch(tmp_code, dim, bits, mask, table) << d);
+		}
+
+		morton->code[idx] = code_result;
+	}
+}
+
+// Hilbert index of the bits-bit coordinates X[0], ..., X[dim-1] (J. Skilling, Programming the Hilbert curve, 2004);
+// X is transformed in place into the transposed index, whose bits are then interleaved like a Morton code
+static inline uint64_t host_hilbert_index(uint32_t* X, int dim, int bits)
+{
+	uint32_t M = 1u << (bits-1);
+
+	// inverse undo of the excess work
+	for (uint32_t Q=M; Q>1; Q>>=1)
+	{
+		uint32_t P = Q-1;
+		for (int i=0; i<dim; i++)
+		{
+			if (X[i] & Q)
+				X[0] ^= P;
+			else
+			{
+				uint32_t t = (X[0]^X[i]) & P;
+				X[0] ^= t;
+				X[i] ^= t;
+			}
+		}
+	}
+
+	// Gray encode
+	for (int i=1; i<dim; i++)
+		X[i] ^= X[i-1];
+	uint32_t t = 0;
+	for (uint32_t Q=M; Q>1; Q>>=1)
+		if (X[dim-1] & Q)
+			t ^= Q-1;
+	for (int i=0; i<dim; i++)
+		X[i] ^= t;
+
+	uint64_t index = 0x0ul;
+	for (int b=bits-1; b>=0; b--)
+		for (int i=0; i<dim; i++)
+			index = (index << 1) | ((X[i] >> b) & 0x1u);
+
+	return index;
+}
+
+static void host_get_hilbert_code(struct point_set* points, struct morton_code* keys)
+{
+	int dim = points->dim;
+	int bits = keys->bits;
+	int point_count = points->size;
+
+	// the same scaling in all dimensions keeps the cells of the curve cubes in the original geometry
+	double extent = 0.0;
+	for (int d=0; d<dim; d++)
+		extent = std::max(extent, points->max_per_dim[d]-points->min_per_dim[d]);
+
+	#pragma omp parallel for schedule(static)
+	for (int idx=0; idx<point_count; idx++)
+	{
+		uint32_t X[MAX_DIM];
+		for (int d=0; d<dim; d++)
+			X[d] = (uint32_t)host_coord_to_fp(points->coords[d][idx], points->min_per_dim[d], extent, bits);
+
+		keys->code[idx] = host_hilbert_index(X, dim, bits);
+	}
+}
+
+// direction along which the points index[l], ..., index[u] are bisected: the longest edge of their bounding box or
+// (pca) their principal axis, found by power iteration on the covariance matrix starting from the longest edge
+static void host_get_bisection_axis(double* axis, int* index, int l, int u, struct point_set* points, bool pca)
+{
+	int dim = points->dim;
+	int count = u-l+1;
+
+	std::vector<double> mean(dim, 0.0);
+	int longest = 0;
+	double longest_edge = -1.0;
+	for (int d=0; d<dim; d++)
+	{
+		double* coords = points->coords[d];
+		double minimum = coords[index[l]];
+		double maximum = coords[index[l]];
+		for (int i=l; i<=u; i++)
+		{
+			minimum = std::min(minimum, coords[index[i]]);
+			maximum = std::max(maximum, coords[index[i]]);
+			mean[d] += coords[index[i]];
+		}
+		mean[d] /= count;
+
+		if (maximum-minimum>longest_edge)
+		{
+			longest_edge = maximum-minimum;
+			longest = d;
+		}
+	}
+
+	for (int d=0; d<dim; d++)
+		axis[d] = (d==longest) ? 1.0 : 0.0;
+
+	if (!pca)
+		return;
+
+	std::vector<double> covariance(dim*dim, 0.0);
+	for (int i=l; i<=u; i++)
+		for (int d1=0; d1<dim; d1++)
+			for (int d2=0; d2<dim; d2++)
+				covariance[d1*dim+d2] += (points->coords[d1][index[i]]-mean[d1])*(points->coords[d2][index[i]]-mean[d2]);
+
+	std::vector<double> next(dim);
+	for (int iteration=0; iteration<HOST_PCA_ITERATIONS; iteration++)
+	{
+		double norm = 0.0;
+		for (int d1=0; d1<dim; d1++)
+		{
+			next[d1] = 0.0;
+			for (int d2=0; d2<dim; d2++)
+				next[d1] += covariance[d1*dim+d2]*axis[d2];
+			norm += next[d1]*next[d1];
+		}
+
+		// all points coincide, keep the longest edge
+		if (norm==0.0)
+			return;
+
+		norm = sqrt(norm);
+		for (int d=0; d<dim; d++)
+			axis[d] = next[d]/norm;
+	}
+}
+
+// splits the points index[l], ..., index[u] into halves at their median along the bisection axis and sets the key bit
+// of depth in the second half; the halves are bisected further in tasks (for large clusters)
+static void host_bisect(uint64_t* keys, int* index, int l, int u, int depth, int key_bits, struct point_set* points, bool pca)
+{
+	if ((u<=l) || (depth>=key_bits))
+		return;
+
+	int dim = points->dim;
+	int count = u-l+1;
+
+	std::vector<double> axis(dim);
+	host_get_bisection_axis(&axis[0], index, l, u, points, pca);
+
+	// ties are broken by the point index, such that the halves do not depend on the order within the cluster
+	std::vector<std::pair<double,int> > projection(count);
+	for (int i=l; i<=u; i++)
+	{
+		double p = 0.0;
+		for (int d=0; d<dim; d++)
+			p += axis[d]*points->coords[d][index[i]];
+		projection[i-l] = std::make_pair(p, index[i]);
+	}
+
+	int half = count/2;
+	std::nth_element(projection.begin(), projection.begin()+half, projection.end());
+
+	uint64_t bit = 0x1ul << (key_bits-1-depth);
+	for (int i=0; i<count; i++)
+	{
+		index[l+i] = projection[i].second;
+		if (i>=half)
+			keys[index[l+i]] |= bit;
+	}
+
+	#pragma omp task if (count>HOST_BISECTION_TASK_CUTOFF)
+	host_bisect(keys, index, l, l+half-1, depth+1, key_bits, points, pca);
+
+	host_bisect(keys, index, l+half, u, depth+1, key_bits, points, pca);
+
+	#pragma omp taskwait
+}
+
+void host_get_cluster_keys(struct point_set* points, struct morton_code* keys, int clustering)
+{
+	if (clustering==CLUSTERING_MORTON)
+	{
+		host_get_morton_code(points, keys);
+		return;
+	}
+
+	int dim = points->dim;
+	int bits = keys->bits;
+	int point_count = points->size;
+
+	if ((dim<1) || (dim>MAX_DIM) || (bits<1) || (bits>32) || (dim*bits>64))
+	{
+		printf("Cluster keys with %d bits in %d dimensions are not supported (need dim<=%d, bits<=32, dim*bits<=64). Exiting...\n", bits, dim, MAX_DIM);
+		exit(1);
+	}
+
+	if (clustering==CLUSTERING_HILBERT)
+	{
+		host_get_hilbert_code(points, keys);
+		return;
+	}
+
+	if ((clustering!=CLUSTERING_MEDIAN) && (clustering!=CLUSTERING_PCA))
+	{
+		printf("Unknown clustering %d. Exiting...\n", clustering);
+		exit(1);
+	}
+
+	int* index = new int[point_count];
+	for (int i=0; i<point_count; i++)
+	{
+		index[i] = i;
+		keys->code[i] = 0x0ul;
+	}
+
+	#pragma omp parallel
+	{
+		#pragma omp single
+		host_bisect(keys->code, index, 0, point_count-1, 0, dim*bits, points, clustering==CLUSTERING_PCA);
+	}
+
+	delete [] index;
+}
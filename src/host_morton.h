@@ -0,0 +1,31 @@
+// Copyright (C) 2016 Peter Zaspel
+//
+// This file is part of hmglib.
+//
+// hmglib is free software: you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// hmglib is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hmglib.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HOST_MORTON_H
+#define HOST_MORTON_H
+
+#include "morton.h"
+
+// computes the Morton codes of all points on the host for any dim<=MAX_DIM; requires bits<=32 and dim*bits<=64
+extern void host_get_morton_code(struct point_set* points, struct morton_code* morton);
+
+// computes the cluster keys of all points for clustering (CLUSTERING_*) into keys->code, under the same restrictions
+// on dim and bits as the Morton codes; the bisection strategies assign bit b (counted from the most significant of
+// the dim*bits key bits) to the split on depth b, i.e. they split clusters down to single points or dim*bits levels
+extern void host_get_cluster_keys(struct point_set* points, struct morton_code* keys, int clustering);
+
+#endif
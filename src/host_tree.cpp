@@ -0,0 +1,491 @@
+// Copyright (C) 2016 Peter Zaspel
+//
+// This file is part of hmglib.
+//
+// hmglib is free software: you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// hmglib is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hmglib.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include <map>
+#include <omp.h>
+
+#include "host_tree.h"
+#include "host_helper.h"
+
+// clusters with more points than this are built in tasks of their own, smaller ones within the parent task
+#define HOST_TASK_POINT_CUTOFF 4096
+
+// number of clusters allocated at once in a per-thread arena
+#define HOST_CLUSTER_CHUNK_SIZE 4096
+
+// node of the cluster tree of one point set, i.e. the Morton code range [l,u] together with its bounding box (dim
+// entries each in min and max) and its position in the cluster table
+struct host_cluster
+{
+	int l;
+	int u;
+	char level;
+	int index;
+	struct host_cluster* child[2];
+	double* min;
+	double* max;
+};
+
+// node of the block cluster tree
+struct host_node
+{
+	struct host_cluster* cluster1;
+	struct host_cluster* cluster2;
+	int level_1;
+	int level_2;
+};
+
+// leaf of the block cluster tree
+struct host_leaf
+{
+	struct host_cluster* cluster1;
+	struct host_cluster* cluster2;
+	char work_type;
+};
+
+// per-thread storage for clusters (with their bounding boxes), block cluster tree leaves and the nodes of the next
+// level of the block cluster tree; clusters are allocated in chunks so that they never move
+struct host_arena
+{
+	std::vector<struct host_cluster*> cluster_chunks;
+	std::vector<double*> box_chunks;
+	int chunk_used;
+	std::vector<struct host_leaf> leaves;
+	std::vector<struct host_node> next_nodes;
+	char padding[64];	// avoid false sharing between the arenas of different threads
+};
+
+//! host version of the split computation within a morton code based tree (cf. findSplit in tree.cu)
+static inline int host_find_split(struct morton_code* codes, int first, int last)
+{
+	uint64_t firstCode = codes->code[first];
+	uint64_t lastCode = codes->code[last];
+
+	// identical Morton codes => split the range in the middle
+	if (firstCode == lastCode)
+		return (first + last) >> 1;
+
+	int commonPrefix = __builtin_clzll(firstCode ^ lastCode);
+
+	// binary search for the highest object that shares more than commonPrefix bits with the first one
+	int split = first;
+	int step = last - first;
+
+	do
+	{
+		step = (step + 1) >> 1;
+		int newSplit = split + step;
+
+		if (newSplit < last)
+		{
+			uint64_t splitCode = codes->code[newSplit];
+			int splitPrefix = __builtin_clzll(firstCode ^ splitCode);
+			if (splitPrefix > commonPrefix)
+				split = newSplit;
+		}
+	}
+	while (step > 1);
+
+	return split;
+}
+
+static inline double host_compute_diameter(double* min, double* max, int dim)
+{
+	double diam = 0.0;
+
+	for (int d=0; d<dim; d++)
+		diam += (max[d]-min[d]) * (max[d]-min[d]);
+
+	return sqrt(diam);
+}
+
+static inline double host_compute_distance(double* min1, double* max1, double* min2, double* max2, int dim)
+{
+	double dist = 0.0;
+
+	for (int d=0; d<dim; d++)
+		dist += (fmax(0.0, min1[d]-max2[d]) * fmax(0.0, min1[d]-max2[d])) + (fmax(0.0, min2[d]-max1[d]) * fmax(0.0, min2[d]-max1[d]));
+
+	return sqrt(dist);
+}
+
+static inline bool host_bounding_box_admissibility(struct host_cluster* cluster1, struct host_cluster* cluster2, int dim, double eta)
+{
+	double diam1 = host_compute_diameter(cluster1->min, cluster1->max, dim);
+	double diam2 = host_compute_diameter(cluster2->min, cluster2->max, dim);
+
+	double dist = host_compute_distance(cluster1->min, cluster1->max, cluster2->min, cluster2->max, dim);
+
+	return (fmax(diam1, diam2) <= (eta*dist));
+}
+
+static void host_compute_bounding_box(double* min, double* max, struct point_set* input_set, int l, int u)
+{
+	for (int d=0; d<input_set->dim; d++)
+	{
+		double* coords = input_set->coords[d];
+		min[d] = coords[l];
+		max[d] = coords[l];
+		for (int i=l+1; i<=u; i++)
+		{
+			min[d] = fmin(min[d], coords[i]);
+			max[d] = fmax(max[d], coords[i]);
+		}
+	}
+}
+
+static struct host_cluster* host_new_cluster(struct host_arena* arena, int dim)
+{
+	if (arena->cluster_chunks.empty() || (arena->chunk_used==HOST_CLUSTER_CHUNK_SIZE))
+	{
+		arena->cluster_chunks.push_back(new struct host_cluster[HOST_CLUSTER_CHUNK_SIZE]);
+		arena->box_chunks.push_back(new double[(size_t)HOST_CLUSTER_CHUNK_SIZE*2*dim]);
+		arena->chunk_used = 0;
+	}
+
+	struct host_cluster* cluster = &(arena->cluster_chunks.back()[arena->chunk_used]);
+	cluster->min = &(arena->box_chunks.back()[(size_t)arena->chunk_used*2*dim]);
+	cluster->max = cluster->min + dim;
+	arena->chunk_used++;
+
+	return cluster;
+}
+
+// builds the cluster tree below cluster following the splits in the Morton codes; bounding boxes are computed on
+// the leaves and merged bottom-up
+static void host_build_cluster_tree(struct host_cluster* cluster, int l, int u, int level, int depth, struct morton_code* codes, struct point_set* points, int leaf_size, int max_level, struct host_arena* arenas)
+{
+	cluster->l = l;
+	cluster->u = u;
+	cluster->level = level;
+	cluster->child[0] = 0;
+	cluster->child[1] = 0;
+
+	if (((u-l+1)<=leaf_size) || ((depth+1)>=max_level))
+	{
+		host_compute_bounding_box(cluster->min, cluster->max, points, l, u);
+		return;
+	}
+
+	int split = host_find_split(codes, l, u);
+
+	struct host_arena* arena = &arenas[host_get_thread_id()];
+	struct host_cluster* child0 = host_new_cluster(arena, points->dim);
+	struct host_cluster* child1 = host_new_cluster(arena, points->dim);
+	cluster->child[0] = child0;
+	cluster->child[1] = child1;
+
+	#pragma omp task if ((u-l+1)>HOST_TASK_POINT_CUTOFF)
+	host_build_cluster_tree(child0, l, split, level+1, depth+1, codes, points, leaf_size, max_level, arenas);
+
+	host_build_cluster_tree(child1, split+1, u, level+1, depth+1, codes, points, leaf_size, max_level, arenas);
+
+	#pragma omp taskwait
+
+	for (int d=0; d<points->dim; d++)
+	{
+		cluster->min[d] = fmin(child0->min[d], child1->min[d]);
+		cluster->max[d] = fmax(child0->max[d], child1->max[d]);
+	}
+}
+
+static inline void host_add_leaf(struct host_arena* arena, struct host_cluster* cluster1, struct host_cluster* cluster2, int work_type)
+{
+	struct host_leaf leaf;
+	leaf.cluster1 = cluster1;
+	leaf.cluster2 = cluster2;
+	leaf.work_type = work_type;
+	arena->leaves.push_back(leaf);
+}
+
+static inline void host_add_node(struct host_arena* arena, struct host_cluster* cluster1, struct host_cluster* cluster2, int level_1, int level_2)
+{
+	struct host_node node;
+	node.cluster1 = cluster1;
+	node.cluster2 = cluster2;
+	node.level_1 = level_1;
+	node.level_2 = level_2;
+	arena->next_nodes.push_back(node);
+}
+
+// decides on a node of the current level of the block cluster tree: either it becomes a leaf or its children are
+// added to the next level
+static void host_traverse_node(struct host_node* node, int current_level, struct host_arena* arena, int dim, double eta, int max_level, int c_leaf, bool symmetric)
+{
+	struct host_cluster* cluster1 = node->cluster1;
+	struct host_cluster* cluster2 = node->cluster2;
+	int m1 = cluster1->u-cluster1->l+1;
+	int m2 = cluster2->u-cluster2->l+1;
+
+	bool is_admissible = host_bounding_box_admissibility(cluster1, cluster2, dim, eta);
+	bool is_last_level = ((current_level+1)>=max_level);
+
+	if (node->level_1==node->level_2)
+	{
+		if (is_admissible || (m1<=c_leaf) || (m2<=c_leaf) || is_last_level || (cluster1->child[0]==0) || (cluster2->child[0]==0))
+		{
+			host_add_leaf(arena, cluster1, cluster2, is_admissible ? WT_ACA : WT_DENSE);
+			return;
+		}
+
+		// on the diagonal of a symmetric partition, the block below the diagonal is the transpose of the one above
+		bool skip_lower = symmetric && (cluster1==cluster2);
+
+		for (int c1=0; c1<2; c1++)
+			for (int c2=(skip_lower ? c1 : 0); c2<2; c2++)
+				host_add_node(arena, cluster1->child[c1], cluster2->child[c2], node->level_1+1, node->level_2+1);
+	}
+	else
+	{
+		// split only the block on the coarser level; single points and the last level are not split any more
+		bool split_first = (node->level_1<node->level_2);
+		struct host_cluster* cluster = split_first ? cluster1 : cluster2;
+
+		if (((cluster->u-cluster->l+1)<=1) || is_last_level || (cluster->child[0]==0))
+		{
+			host_add_leaf(arena, cluster1, cluster2, is_admissible ? WT_ACA : WT_DENSE);
+			return;
+		}
+
+		for (int c=0; c<2; c++)
+		{
+			if (split_first)
+				host_add_node(arena, cluster1->child[c], cluster2, node->level_1+1, node->level_2);
+			else
+				host_add_node(arena, cluster1, cluster2->child[c], node->level_1, node->level_2+1);
+		}
+	}
+}
+
+struct host_leaf_smaller
+{
+	bool operator()(const struct host_leaf& a, const struct host_leaf& b) const
+	{
+		return (a.cluster1->l < b.cluster1->l) || ((a.cluster1->l == b.cluster1->l) && (a.cluster2->l < b.cluster2->l));
+	}
+};
+
+// numbers the clusters below cluster in depth-first order (independent of the thread count) starting at *count
+static void host_number_clusters(struct host_cluster* cluster, int* count)
+{
+	cluster->index = (*count)++;
+
+	if (cluster->child[0]!=0)
+	{
+		host_number_clusters(cluster->child[0], count);
+		host_number_clusters(cluster->child[1], count);
+	}
+}
+
+static void host_fill_cluster_table(struct cluster_table* clusters, struct host_cluster* cluster)
+{
+	int c = cluster->index;
+	int dim = clusters->dim;
+
+	clusters->l[c] = cluster->l;
+	clusters->u[c] = cluster->u;
+	clusters->level[c] = cluster->level;
+	memcpy(&(clusters->min[(size_t)c*dim]), cluster->min, dim*sizeof(double));
+	memcpy(&(clusters->max[(size_t)c*dim]), cluster->max, dim*sizeof(double));
+
+	if (cluster->child[0]!=0)
+	{
+		host_fill_cluster_table(clusters, cluster->child[0]);
+		host_fill_cluster_table(clusters, cluster->child[1]);
+	}
+}
+
+static void host_allocate_block_list(struct block_list* blocks, int block_count, int cluster_count, int dim)
+{
+	blocks->count = block_count;
+	blocks->cluster1 = new int[block_count];
+	blocks->cluster2 = new int[block_count];
+	blocks->work_type = new char[block_count];
+
+	blocks->clusters.count = cluster_count;
+	blocks->clusters.dim = dim;
+	blocks->clusters.l = new int[cluster_count];
+	blocks->clusters.u = new int[cluster_count];
+	blocks->clusters.level = new char[cluster_count];
+	blocks->clusters.min = new double[(size_t)cluster_count*dim];
+	blocks->clusters.max = new double[(size_t)cluster_count*dim];
+}
+
+void host_traverse(struct work_item root_h, struct block_list* blocks, struct morton_code* input_set1_codes, struct morton_code* input_set2_codes, struct point_set* input_set1, struct point_set* input_set2, double eta, int max_level, int c_leaf, bool symmetric, double* level_seconds, int* level_count)
+{
+	int thread_count = host_get_thread_count();
+	int dim = input_set1->dim;
+
+	struct host_arena* arenas = new struct host_arena[thread_count];
+	for (int t=0; t<thread_count; t++)
+		arenas[t].chunk_used = 0;
+
+	// the block cluster tree only splits both clusters at once, unless the root levels differ
+	int leaf_size = (root_h.level_1==root_h.level_2) ? std::max(c_leaf, 1) : 1;
+
+	struct host_cluster* root1;
+	struct host_cluster* root2;
+
+	// build both cluster trees (a single one if symmetric) using (work stealing) tasks
+	#pragma omp parallel num_threads(thread_count)
+	{
+		#pragma omp single
+		{
+			root1 = host_new_cluster(&arenas[host_get_thread_id()], dim);
+			root2 = symmetric ? root1 : host_new_cluster(&arenas[host_get_thread_id()], dim);
+
+			#pragma omp task
+			host_build_cluster_tree(root1, root_h.set1_l, root_h.set1_u, root_h.level_1, 0, input_set1_codes, input_set1, leaf_size, max_level, arenas);
+
+			if (!symmetric)
+				host_build_cluster_tree(root2, root_h.set2_l, root_h.set2_u, root_h.level_2, 0, input_set2_codes, input_set2, leaf_size, max_level, arenas);
+
+			#pragma omp taskwait
+		}
+	}
+
+	// traverse the block cluster tree level by level (as on the GPU), the nodes of one level are shared by all threads
+	std::vector<struct host_node> nodes(1);
+	nodes[0].cluster1 = root1;
+	nodes[0].cluster2 = root2;
+	nodes[0].level_1 = root_h.level_1;
+	nodes[0].level_2 = root_h.level_2;
+
+	int current_level = 0;
+	while (!nodes.empty())
+	{
+		double level_begin = omp_get_wtime();
+		int node_count = (int)nodes.size();
+
+		#pragma omp parallel for schedule(dynamic, 64) num_threads(thread_count)
+		for (int i=0; i<node_count; i++)
+			host_traverse_node(&nodes[i], current_level, &arenas[host_get_thread_id()], dim, eta, max_level, c_leaf, symmetric);
+
+		nodes.clear();
+		for (int t=0; t<thread_count; t++)
+		{
+			nodes.insert(nodes.end(), arenas[t].next_nodes.begin(), arenas[t].next_nodes.end());
+			arenas[t].next_nodes.clear();
+		}
+
+		if (level_seconds!=0)
+			level_seconds[current_level] = omp_get_wtime()-level_begin;
+		current_level++;
+	}
+
+	if (level_count!=0)
+		*level_count = current_level;
+
+	// every cluster is stored once in the cluster table, the clusters of set 2 follow the ones of set 1
+	int cluster_count = 0;
+	host_number_clusters(root1, &cluster_count);
+	if (!symmetric)
+		host_number_clusters(root2, &cluster_count);
+
+	// concatenate the leaves of all threads
+	std::vector<struct host_leaf> leaves;
+	size_t total_count = 0;
+	for (int t=0; t<thread_count; t++)
+		total_count += arenas[t].leaves.size();
+	leaves.reserve(total_count);
+	for (int t=0; t<thread_count; t++)
+	{
+		leaves.insert(leaves.end(), arenas[t].leaves.begin(), arenas[t].leaves.end());
+		std::vector<struct host_leaf>().swap(arenas[t].leaves);
+	}
+
+	// the leaves are the same for any thread count, sorting them makes their order reproducible, too
+	std::sort(leaves.begin(), leaves.end(), host_leaf_smaller());
+
+	host_allocate_block_list(blocks, (int)total_count, cluster_count, dim);
+
+	host_fill_cluster_table(&(blocks->clusters), root1);
+	if (!symmetric)
+		host_fill_cluster_table(&(blocks->clusters), root2);
+
+	for (size_t i=0; i<total_count; i++)
+	{
+		blocks->cluster1[i] = leaves[i].cluster1->index;
+		blocks->cluster2[i] = leaves[i].cluster2->index;
+		blocks->work_type[i] = leaves[i].work_type;
+	}
+
+	for (int t=0; t<thread_count; t++)
+		for (size_t c=0; c<arenas[t].cluster_chunks.size(); c++)
+		{
+			delete [] arenas[t].cluster_chunks[c];
+			delete [] arenas[t].box_chunks[c];
+		}
+	delete [] arenas;
+}
+
+void host_get_block_list(struct block_list* blocks, struct work_item* work_items, int work_item_count)
+{
+	int dim = (work_item_count>0) ? work_items[0].dim : 0;
+
+	// clusters of set s are identified by their index range
+	std::map<std::pair<int,int>, int> cluster_index[2];
+	std::vector<int> cluster_item;
+	std::vector<int> cluster_set;
+	for (int i=0; i<work_item_count; i++)
+		for (int s=0; s<2; s++)
+		{
+			std::pair<int,int> range = (s==0) ? std::make_pair(work_items[i].set1_l, work_items[i].set1_u) : std::make_pair(work_items[i].set2_l, work_items[i].set2_u);
+			if (cluster_index[s].count(range)==0)
+			{
+				cluster_index[s][range] = (int)cluster_item.size();
+				cluster_item.push_back(i);
+				cluster_set.push_back(s);
+			}
+		}
+
+	host_allocate_block_list(blocks, work_item_count, (int)cluster_item.size(), dim);
+
+	for (int c=0; c<blocks->clusters.count; c++)
+	{
+		struct work_item* item = &work_items[cluster_item[c]];
+		bool first = (cluster_set[c]==0);
+		blocks->clusters.l[c] = first ? item->set1_l : item->set2_l;
+		blocks->clusters.u[c] = first ? item->set1_u : item->set2_u;
+		blocks->clusters.level[c] = first ? item->level_1 : item->level_2;
+		memcpy(&(blocks->clusters.min[(size_t)c*dim]), first ? item->min1 : item->min2, dim*sizeof(double));
+		memcpy(&(blocks->clusters.max[(size_t)c*dim]), first ? item->max1 : item->max2, dim*sizeof(double));
+	}
+
+	for (int i=0; i<work_item_count; i++)
+	{
+		blocks->cluster1[i] = cluster_index[0][std::make_pair(work_items[i].set1_l, work_items[i].set1_u)];
+		blocks->cluster2[i] = cluster_index[1][std::make_pair(work_items[i].set2_l, work_items[i].set2_u)];
+		blocks->work_type[i] = work_items[i].work_type;
+	}
+}
+
+void host_destroy_block_list(struct block_list* blocks)
+{
+	delete [] blocks->cluster1;
+	delete [] blocks->cluster2;
+	delete [] blocks->work_type;
+	delete [] blocks->clusters.l;
+	delete [] blocks->clusters.u;
+	delete [] blocks->clusters.level;
+	delete [] blocks->clusters.min;
+	delete [] blocks->clusters.max;
+}
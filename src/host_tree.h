@@ -0,0 +1,38 @@
+// Copyright (C) 2016 Peter Zaspel
+//
+// This file is part of hmglib.
+//
+// hmglib is free software: you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// hmglib is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hmglib.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HOST_TREE_H
+#define HOST_TREE_H
+
+#include "morton.h"
+#include "tree.h"
+
+// host counterpart of traverse_with_dynamic_arrays_dynamic_output; expects Z order sorted point sets and Morton
+// codes, allocates the arrays of blocks with new[] and stores the cluster table of both cluster trees and the leaves
+// (WT_ACA / WT_DENSE) of the block cluster tree in it; if symmetric, both point sets have to be the same, only the
+// cluster tree of set 1 is built and only the leaves on and above the diagonal are kept; the block cluster tree is
+// traversed level by level, the wall time of every level is stored in level_seconds (max_level entries, 0 = not
+// recorded) and the number of levels in level_count (0 = not recorded)
+extern void host_traverse(struct work_item root_h, struct block_list* blocks, struct morton_code* input_set1_codes, struct morton_code* input_set2_codes, struct point_set* input_set1, struct point_set* input_set2, double eta, int max_level, int c_leaf, bool symmetric, double* level_seconds, int* level_count);
+
+// block list of work_item_count (host) work items, e.g. of the GPU backend, with one cluster per index range and set
+extern void host_get_block_list(struct block_list* blocks, struct work_item* work_items, int work_item_count);
+
+// releases the arrays of a block list allocated by host_traverse or host_get_block_list
+extern void host_destroy_block_list(struct block_list* blocks);
+
+#endif
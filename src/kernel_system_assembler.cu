@@ -18,6 +18,7 @@
 #include <stdio.h>
 #include <curand.h>
 
+#include "helper.h"
 #include "system_assembler.h"
 //#include "generic_system_adapter.h"
 #include "kernel_system_assembler.h"
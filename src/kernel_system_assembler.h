@@ -20,7 +20,7 @@
         
 
 
-#include "hmglib.h"
+#include <math.h>
 #include "system_assembler.h"
 
 class gaussian_kernel_system_assembler : public system_assembler
@@ -29,13 +29,17 @@ class gaussian_kernel_system_assembler : public system_assembler
 
 		double regularization;
 
+		__host__ __device__ gaussian_kernel_system_assembler() : regularization(0.0)
+		{
+			kernel_type = KT_GAUSSIAN;
+		}
 
-		__device__ double gaussian_kernel(double r)
+		__host__ __device__ double gaussian_kernel(double r)
 		{
 			return exp(-r*r);
 		}
 
-		__device__ double get_matrix_entry(int i, int j, struct point_set* point_set1_d, struct point_set* point_set2_d)
+		__host__ __device__ double get_matrix_entry(int i, int j, struct point_set* point_set1_d, struct point_set* point_set2_d)
 		{
 			double result = 0.0;
 			for (int d=0; d<point_set1_d->dim; d++)
@@ -73,13 +77,17 @@ class matern_kernel_system_assembler : public system_assembler
 
 		double regularization;
 
+		__host__ __device__ matern_kernel_system_assembler() : regularization(0.0)
+		{
+			kernel_type = KT_MATERN;
+		}
 
-		__device__ double matern_kernel(double r, int dim)
+		__host__ __device__ double matern_kernel(double r, int dim)
 		{
 			return (yn(1, r+1.0e-15)*pow(r,1.0))/(pow(2.0,(double)dim/2.0)*tgamma(1.0+(double)dim/2.0));
 		}
 
-		__device__ double get_matrix_entry(int i, int j, struct point_set* point_set1_d, struct point_set* point_set2_d)
+		__host__ __device__ double get_matrix_entry(int i, int j, struct point_set* point_set1_d, struct point_set* point_set2_d)
 		{
 			double result = 0.0;
 			for (int d=0; d<point_set1_d->dim; d++)
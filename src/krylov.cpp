@@ -0,0 +1,279 @@
+// Copyright (C) 2016 Peter Zaspel
+//
+// This file is part of hmglib.
+//
+// hmglib is free software: you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// hmglib is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hmglib.  If not, see <http://www.gnu.org/licenses/>.
+#include <stdio.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "krylov.h"
+
+static double host_krylov_dot(double* a, double* b, int n)
+{
+	double result = 0.0;
+
+	#pragma omp parallel for schedule(static) reduction(+:result)
+	for (int i=0; i<n; i++)
+		result += a[i]*b[i];
+
+	return result;
+}
+
+static void host_krylov_axpy(double alpha, double* x, double* y, int n)
+{
+	#pragma omp parallel for schedule(static)
+	for (int i=0; i<n; i++)
+		y[i] += alpha*x[i];
+}
+
+static void host_krylov_scale(double alpha, double* x, int n)
+{
+	#pragma omp parallel for schedule(static)
+	for (int i=0; i<n; i++)
+		x[i] *= alpha;
+}
+
+static void host_krylov_copy(double* x, double* y, int n)
+{
+	memcpy(y, x, n*sizeof(double));
+}
+
+static double* host_krylov_allocate(int n)
+{
+	return new double[n];
+}
+
+static void host_krylov_release(double* x)
+{
+	delete [] x;
+}
+
+void host_krylov_operations(struct krylov_operations* ops, int n)
+{
+	ops->n = n;
+	ops->dot = host_krylov_dot;
+	ops->axpy = host_krylov_axpy;
+	ops->scale = host_krylov_scale;
+	ops->copy = host_krylov_copy;
+	ops->allocate = host_krylov_allocate;
+	ops->release = host_krylov_release;
+	ops->precondition = 0;
+	ops->precondition_context = 0;
+}
+
+int krylov_cg(double* x, double* b, double tolerance, int max_iterations, double* relative_residual, struct krylov_operations* ops)
+{
+	int n = ops->n;
+	bool is_preconditioned = (ops->precondition!=0);
+
+	double* r = ops->allocate(n);
+	double* p = ops->allocate(n);
+	double* q = ops->allocate(n);
+	// without preconditioner, z = r
+	double* z = is_preconditioned ? ops->allocate(n) : r;
+
+	double b_norm = sqrt(ops->dot(b, b, n));
+	if (b_norm==0.0)
+		b_norm = 1.0;
+
+	// r = b - A*x, z = M^-1*r, p = z
+	ops->apply(x, q, ops->context);
+	ops->copy(b, r, n);
+	ops->axpy(-1.0, q, r, n);
+	if (is_preconditioned)
+		ops->precondition(r, z, ops->precondition_context);
+	ops->copy(z, p, n);
+
+	double rho = ops->dot(r, z, n);
+	double r_norm = is_preconditioned ? sqrt(ops->dot(r, r, n)) : sqrt(rho);
+	int iteration = 0;
+
+	while ((r_norm>tolerance*b_norm) && (iteration<max_iterations))
+	{
+		// q = A*p
+		ops->apply(p, q, ops->context);
+
+		// breakdown if A is not positive definite in the direction of p
+		double p_q = ops->dot(p, q, n);
+		if (!(p_q>0.0) || !isfinite(p_q))
+		{
+			printf("CG breakdown in iteration %d: p'*A*p = %le, the operator is not symmetric positive definite\n", iteration, p_q);
+			break;
+		}
+
+		double alpha = rho / p_q;
+		ops->axpy(alpha, p, x, n);
+		ops->axpy(-alpha, q, r, n);
+
+		if (is_preconditioned)
+			ops->precondition(r, z, ops->precondition_context);
+		double rho_new = ops->dot(r, z, n);
+		r_norm = is_preconditioned ? sqrt(ops->dot(r, r, n)) : sqrt(rho_new);
+		iteration++;
+
+		// an indefinite preconditioner gives r'*M^-1*r<=0 before convergence
+		if (is_preconditioned && !(rho_new>0.0) && (r_norm>tolerance*b_norm))
+		{
+			printf("CG breakdown in iteration %d: r'*M^-1*r = %le, the preconditioner is not symmetric positive definite\n", iteration, rho_new);
+			break;
+		}
+
+		// p = z + (rho_new/rho)*p
+		ops->scale(rho_new/rho, p, n);
+		ops->axpy(1.0, z, p, n);
+
+		rho = rho_new;
+	}
+
+	*relative_residual = r_norm/b_norm;
+
+	ops->release(r);
+	ops->release(p);
+	ops->release(q);
+	if (is_preconditioned)
+		ops->release(z);
+
+	return iteration;
+}
+
+// applies the Givens rotation (c,s) to (a,b)
+static inline void krylov_apply_givens(double c, double s, double* a, double* b)
+{
+	double tmp = c*(*a) + s*(*b);
+	*b = -s*(*a) + c*(*b);
+	*a = tmp;
+}
+
+int krylov_gmres(double* x, double* b, int restart, double tolerance, int max_iterations, double* relative_residual, struct krylov_operations* ops)
+{
+	int n = ops->n;
+	bool is_preconditioned = (ops->precondition!=0);
+
+	// the Arnoldi loop has to make progress
+	if (restart<1)
+		restart = 1;
+
+	// Krylov basis and small Hessenberg least squares problem
+	std::vector<double*> V(restart+1);
+	for (int j=0; j<=restart; j++)
+		V[j] = ops->allocate(n);
+	double* w = ops->allocate(n);
+	// preconditioned vector and correction of the right preconditioned system A*M^-1*u=b
+	double* z = is_preconditioned ? ops->allocate(n) : 0;
+	double* u = is_preconditioned ? ops->allocate(n) : 0;
+	std::vector<double> H((size_t)(restart+1)*restart), cs(restart), sn(restart), g(restart+1), y(restart);
+
+	double b_norm = sqrt(ops->dot(b, b, n));
+	if (b_norm==0.0)
+		b_norm = 1.0;
+
+	int iteration = 0;
+	double residual_norm = 0.0;
+
+	while (true)
+	{
+		// r = b - A*x
+		ops->apply(x, w, ops->context);
+		ops->copy(b, V[0], n);
+		ops->axpy(-1.0, w, V[0], n);
+		residual_norm = sqrt(ops->dot(V[0], V[0], n));
+
+		if ((residual_norm<=tolerance*b_norm) || (iteration>=max_iterations))
+			break;
+
+		ops->scale(1.0/residual_norm, V[0], n);
+		g.assign(restart+1, 0.0);
+		g[0] = residual_norm;
+
+		int j = 0;
+		for (; (j<restart) && (iteration<max_iterations); j++)
+		{
+			// Arnoldi step with modified Gram-Schmidt on A*M^-1
+			if (is_preconditioned)
+			{
+				ops->precondition(V[j], z, ops->precondition_context);
+				ops->apply(z, V[j+1], ops->context);
+			}
+			else
+				ops->apply(V[j], V[j+1], ops->context);
+			for (int i=0; i<=j; i++)
+			{
+				H[i + (size_t)j*(restart+1)] = ops->dot(V[j+1], V[i], n);
+				ops->axpy(-H[i + (size_t)j*(restart+1)], V[i], V[j+1], n);
+			}
+			double h_next = sqrt(ops->dot(V[j+1], V[j+1], n));
+			H[j+1 + (size_t)j*(restart+1)] = h_next;
+			if (h_next>0.0)
+				ops->scale(1.0/h_next, V[j+1], n);
+
+			// update QR decomposition of H by Givens rotations
+			for (int i=0; i<j; i++)
+				krylov_apply_givens(cs[i], sn[i], &H[i + (size_t)j*(restart+1)], &H[i+1 + (size_t)j*(restart+1)]);
+			double h_jj = H[j + (size_t)j*(restart+1)];
+			double denominator = sqrt(h_jj*h_jj + h_next*h_next);
+			cs[j] = (denominator>0.0) ? h_jj/denominator : 1.0;
+			sn[j] = (denominator>0.0) ? h_next/denominator : 0.0;
+			krylov_apply_givens(cs[j], sn[j], &H[j + (size_t)j*(restart+1)], &H[j+1 + (size_t)j*(restart+1)]);
+			krylov_apply_givens(cs[j], sn[j], &g[j], &g[j+1]);
+
+			iteration++;
+
+			// |g[j+1]| is the residual norm of the current iterate
+			if ((fabs(g[j+1])<=tolerance*b_norm) || (h_next==0.0))
+			{
+				j++;
+				break;
+			}
+		}
+
+		// x = x + M^-1*V(:,1:j)*(H(1:j,1:j) \ g(1:j))
+		for (int i=j-1; i>=0; i--)
+		{
+			y[i] = g[i];
+			for (int l=i+1; l<j; l++)
+				y[i] -= H[i + (size_t)l*(restart+1)]*y[l];
+			y[i] /= H[i + (size_t)i*(restart+1)];
+		}
+		if (is_preconditioned && (j>0))
+		{
+			ops->copy(V[0], u, n);
+			ops->scale(y[0], u, n);
+			for (int i=1; i<j; i++)
+				ops->axpy(y[i], V[i], u, n);
+			ops->precondition(u, z, ops->precondition_context);
+			ops->axpy(1.0, z, x, n);
+		}
+		else if (!is_preconditioned)
+		{
+			for (int i=0; i<j; i++)
+				ops->axpy(y[i], V[i], x, n);
+		}
+	}
+
+	*relative_residual = residual_norm/b_norm;
+
+	for (int j=0; j<=restart; j++)
+		ops->release(V[j]);
+	ops->release(w);
+	if (is_preconditioned)
+	{
+		ops->release(z);
+		ops->release(u);
+	}
+
+	return iteration;
+}
@@ -0,0 +1,59 @@
+// Copyright (C) 2016 Peter Zaspel
+//
+// This file is part of hmglib.
+//
+// hmglib is free software: you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// hmglib is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hmglib.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef KRYLOV_H
+#define KRYLOV_H
+
+// backend-independent description of the linear operator and the vector operations used by the Krylov solvers;
+// all vectors have length n and live where the backend keeps its data
+struct krylov_operations
+{
+	int n;
+	void* context;
+
+	// y = A*x
+	void (*apply)(double* x, double* y, void* context);
+	// result = a'*b
+	double (*dot)(double* a, double* b, int n);
+	// y = y + alpha*x
+	void (*axpy)(double alpha, double* x, double* y, int n);
+	// x = alpha*x
+	void (*scale)(double alpha, double* x, int n);
+	// y = x
+	void (*copy)(double* x, double* y, int n);
+	double* (*allocate)(int n);
+	void (*release)(double* x);
+
+	// z = M^-1*r for a preconditioner M ~ A (0 = no preconditioning); CG expects M to be symmetric positive definite,
+	// GMRES applies M^-1 from the right, such that its residuals are the ones of A*x=b
+	void (*precondition)(double* r, double* z, void* context);
+	void* precondition_context;
+};
+
+// sets up the vector operations for vectors in host memory without preconditioning (apply and context have to be set
+// by the caller)
+extern void host_krylov_operations(struct krylov_operations* ops, int n);
+
+// (preconditioned) conjugate gradients for A*x=b, starting with the initial guess in x; stops at ||b-A*x||<=tolerance*||b|| or after
+// max_iterations iterations; returns the number of iterations, the final relative residual is stored in
+// relative_residual; stops early with a message if p'*A*p (or r'*M^-1*r) is not positive, i.e. on an indefinite
+// operator (or preconditioner)
+extern int krylov_cg(double* x, double* b, double tolerance, int max_iterations, double* relative_residual, struct krylov_operations* ops);
+
+// GMRES(restart) for A*x=b with the same conventions as krylov_cg; restart<1 is treated as 1
+extern int krylov_gmres(double* x, double* b, int restart, double tolerance, int max_iterations, double* relative_residual, struct krylov_operations* ops);
+
+#endif
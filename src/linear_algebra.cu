@@ -30,10 +30,13 @@
 #include <thrust/partition.h>
 #include <thrust/extrema.h>
 #include <thrust/gather.h>
+#include <thrust/system/cuda/execution_policy.h>
 
 #include "system_assembler.h"
 
 #include "linear_algebra.h"
+#include "workspace.h"
+#include "profiling.h"
 
 #ifndef CHECK_CUDA_ERROR
 #define CHECK_CUDA_ERROR
@@ -46,6 +49,77 @@ cudaError_t err = cudaGetLastError();
 }
 #endif
 
+// scratch memory of the MVP is taken from the arenas of the workspace; without a workspace (e.g. during precomputing),
+// it is allocated directly
+void workspace_device_malloc(struct mvp_workspace* workspace, void** p, size_t size)
+{
+	if (workspace==0)
+	{
+		cudaMalloc(p, size);
+		checkCUDAError("cudaMalloc");
+	}
+	else
+		*p = workspace_arena_malloc(&workspace->device_arena, size);
+}
+
+void workspace_device_free(struct mvp_workspace* workspace, void* p)
+{
+	if (workspace==0)
+		cudaFree(p);
+	else
+		workspace_arena_free(&workspace->device_arena, p);
+}
+
+size_t workspace_device_mark(struct mvp_workspace* workspace)
+{
+	if (workspace==0)
+		return 0;
+	return workspace_arena_mark(&workspace->device_arena);
+}
+
+void workspace_device_release(struct mvp_workspace* workspace, size_t mark)
+{
+	if (workspace!=0)
+		workspace_arena_release(&workspace->device_arena, mark);
+}
+
+void* workspace_host_malloc(struct mvp_workspace* workspace, size_t size)
+{
+	if (workspace==0)
+		return malloc(size);
+	return workspace_arena_malloc(&workspace->staging_arena, size);
+}
+
+void workspace_host_free(struct mvp_workspace* workspace, void* p)
+{
+	if (workspace==0)
+		free(p);
+	else
+		workspace_arena_free(&workspace->staging_arena, p);
+}
+
+// temporary storage of thrust algorithms, taken from the workspace
+struct workspace_thrust_allocator
+{
+	typedef char value_type;
+
+	struct mvp_workspace* workspace;
+
+	workspace_thrust_allocator(struct mvp_workspace* _workspace) : workspace(_workspace) {}
+
+	char* allocate(std::ptrdiff_t size)
+	{
+		char* p;
+		workspace_device_malloc(workspace, (void**)&p, size);
+		return p;
+	}
+
+	void deallocate(char* p, size_t size)
+	{
+		workspace_device_free(workspace, p);
+	}
+};
+
 cudaEvent_t ssstart, ssstop;
 float mmmilliseconds;
 cudaEvent_t sssstart, sssstop;
@@ -1285,10 +1359,13 @@ void compute_batched_norms(double* batched_norms, int* norm_count, double* x, in
 		cudaFree(x_tmp);
 }
 
-void compute_batched_norms_with_keys_output(double* batched_norms, int* keys_output, int* norm_count, double* x, int m_total, thrust::device_ptr<int> work_item_map_ptr, int block_size)
+void compute_batched_norms_with_keys_output(double* batched_norms, int* keys_output, int* norm_count, double* x, int m_total, thrust::device_ptr<int> work_item_map_ptr, int block_size, struct mvp_workspace* workspace)
 {
+	workspace_thrust_allocator thrust_allocator(workspace);
+	size_t workspace_mark = workspace_device_mark(workspace);
+
 		double* x_tmp;
-		cudaMalloc((void**)&x_tmp, m_total*sizeof(double));
+		workspace_device_malloc(workspace, (void**)&x_tmp, m_total*sizeof(double));
 		checkCUDAError("cudaMalloc");
 		thrust::device_ptr<double> x_tmp_ptr(x_tmp);
 		thrust::device_ptr<int> keys_output_ptr(keys_output);
@@ -1299,7 +1376,7 @@ void compute_batched_norms_with_keys_output(double* batched_norms, int* keys_out
 		checkCUDAError("cudaMemcpy");
 		thrust::transform(x_tmp_ptr, x_tmp_ptr+m_total, x_tmp_ptr, square());
 		thrust::pair<thrust::device_ptr<int>, thrust::device_ptr<double> > new_end;
-		new_end = thrust::reduce_by_key(work_item_map_ptr, work_item_map_ptr+m_total, x_tmp_ptr, keys_output_ptr, batched_norms_ptr, thrust::equal_to<int>(), thrust::plus<double>());
+		new_end = thrust::reduce_by_key(thrust::cuda::par(thrust_allocator), work_item_map_ptr, work_item_map_ptr+m_total, x_tmp_ptr, keys_output_ptr, batched_norms_ptr, thrust::equal_to<int>(), thrust::plus<double>());
 
 		// output_set_count is NOT equal to mat_mat_vec_data_count, since invalid entries are discarded
 		*norm_count = new_end.first - keys_output_ptr;
@@ -1307,7 +1384,9 @@ void compute_batched_norms_with_keys_output(double* batched_norms, int* keys_out
 		finalize_norm_computation<<<(*norm_count + (block_size-1)) / block_size, block_size>>>(batched_norms, *norm_count);
 		checkCUDAError("finalize_norm_computation");
 
-		cudaFree(x_tmp);
+		workspace_device_free(workspace, x_tmp);
+
+	workspace_device_release(workspace, workspace_mark);
 }
 
 
@@ -1348,7 +1427,7 @@ void compute_batched_products_for_kxk_matrices(double* batched_products, int* pr
 }
 
 
-void batched_low_rank_mvp(double* x, double* y, double* U, double* V, int m1_total, int m2_total, int* m1_h, int* m2_h, int mat_vec_data_count, int batch_count, int k, int* k_per_item, cublasStatus_t stat, cublasHandle_t handle , int* point_map_offsets1_h, int* point_map_offsets2_h, int* point_map1, int* point_map2, int* work_item_map1 )
+void batched_low_rank_mvp(double* x, double* y, double* U, double* V, int m1_total, int m2_total, int* m1_h, int* m2_h, int mat_vec_data_count, int batch_count, int k, int* k_per_item, cublasStatus_t stat, cublasHandle_t handle , int* point_map_offsets1_h, int* point_map_offsets2_h, int* point_map1, int* point_map2, int* work_item_map1, struct mvp_workspace* workspace )
 {
 	int block_size = MATRIX_ENTRY_BLOCK_SIZE;
 
@@ -1357,7 +1436,7 @@ void batched_low_rank_mvp(double* x, double* y, double* U, double* V, int m1_tot
 
 	// allocation and extraction of batched local operands
 	double* local_x;
-	cudaMalloc((void**)&local_x, m2_total*sizeof(double));
+	workspace_device_malloc(workspace, (void**)&local_x, m2_total*sizeof(double));
 	checkCUDAError("cudaMalloc");
 	thrust::device_ptr<double> local_x_ptr(local_x);
 	thrust::device_ptr<double> x_ptr(x);
@@ -1366,12 +1445,12 @@ void batched_low_rank_mvp(double* x, double* y, double* U, double* V, int m1_tot
 
 	// allocation of batched local intermediate results
 	double* local_tmp;
-	cudaMalloc((void**)&local_tmp, batch_count*k*sizeof(double));
+	workspace_device_malloc(workspace, (void**)&local_tmp, batch_count*k*sizeof(double));
 	checkCUDAError("cudaMalloc");
 
 	// allocation of batched local results
 	double* local_y;
-	cudaMalloc((void**)&local_y, m1_total*sizeof(double));
+	workspace_device_malloc(workspace, (void**)&local_y, m1_total*sizeof(double));
 	checkCUDAError("cudaMalloc");
 
 
@@ -1384,7 +1463,7 @@ void batched_low_rank_mvp(double* x, double* y, double* U, double* V, int m1_tot
 
 
 	int* k_per_item_h;
-	k_per_item_h = new int[mat_vec_data_count];
+	k_per_item_h = (int*)workspace_host_malloc(workspace, (mat_vec_data_count)*sizeof(int));
 	cudaMemcpy(k_per_item_h, k_per_item, mat_vec_data_count*sizeof(int), cudaMemcpyDeviceToHost);
 
 	int current_batch = 0;
@@ -1404,7 +1483,7 @@ void batched_low_rank_mvp(double* x, double* y, double* U, double* V, int m1_tot
 		}
 	}
 
-	delete[] k_per_item_h;
+	workspace_host_free(workspace, k_per_item_h);
 
 
 	thrust::device_ptr<double> local_y_ptr(local_y);
@@ -1416,9 +1495,9 @@ void batched_low_rank_mvp(double* x, double* y, double* U, double* V, int m1_tot
 
 ////	TIME_ssstop("ACA apply");
 
-	cudaFree(local_x);
-	cudaFree(local_y);
-	cudaFree(local_tmp);
+	workspace_device_free(workspace, local_x);
+	workspace_device_free(workspace, local_y);
+	workspace_device_free(workspace, local_tmp);
 
 
 
@@ -1426,7 +1505,7 @@ void batched_low_rank_mvp(double* x, double* y, double* U, double* V, int m1_tot
 
 
 
-void batched_low_rank_mvp_magma(double* x, double* y, double* U, double* V, int m1_total, int m2_total, int* m1, int* m2, int mat_vec_data_count, int batch_count, int k, int* k_per_item, cublasStatus_t stat, cublasHandle_t handle, magma_queue_t* queue, int* point_map_offsets1_h, int* point_map_offsets2_h, int* point_map1, int* point_map2, int* work_item_map1 )
+void batched_low_rank_mvp_magma(double* x, double* y, double* U, double* V, int m1_total, int m2_total, int* m1, int* m2, int mat_vec_data_count, int batch_count, int k, int* k_per_item, cublasStatus_t stat, cublasHandle_t handle, magma_queue_t* queue, int* point_map_offsets1_h, int* point_map_offsets2_h, int* point_map1, int* point_map2, int* work_item_map1, struct mvp_workspace* workspace )
 {
 	int block_size = MATRIX_ENTRY_BLOCK_SIZE;
 
@@ -1435,7 +1514,7 @@ void batched_low_rank_mvp_magma(double* x, double* y, double* U, double* V, int
 
 	// allocation and extraction of batched local operands
 	double* local_x;
-	cudaMalloc((void**)&local_x, m2_total*sizeof(double));
+	workspace_device_malloc(workspace, (void**)&local_x, m2_total*sizeof(double));
 	checkCUDAError("cudaMalloc");
 	thrust::device_ptr<double> local_x_ptr(local_x);
 	thrust::device_ptr<double> x_ptr(x);
@@ -1444,14 +1523,14 @@ void batched_low_rank_mvp_magma(double* x, double* y, double* U, double* V, int
 
 	// allocation of batched local intermediate results
 	double* local_tmp;
-	cudaMalloc((void**)&local_tmp, batch_count*k*sizeof(double));
+	workspace_device_malloc(workspace, (void**)&local_tmp, batch_count*k*sizeof(double));
 	checkCUDAError("cudaMalloc");
 	thrust::device_ptr<double> local_tmp_ptr(local_tmp);
 	thrust::fill(local_tmp_ptr, local_tmp_ptr+(batch_count*k), 0.0);
 
 	// allocation of batched local results
 	double* local_y;
-	cudaMalloc((void**)&local_y, m1_total*sizeof(double));
+	workspace_device_malloc(workspace, (void**)&local_y, m1_total*sizeof(double));
 	checkCUDAError("cudaMalloc");
 	thrust::device_ptr<double> local_y_ptr(local_y);
 	thrust::fill(local_y_ptr, local_y_ptr+m1_total, 0.0);
@@ -1470,9 +1549,9 @@ void batched_low_rank_mvp_magma(double* x, double* y, double* U, double* V, int
         int* incx;
         int* incy;
         int* ldda;
-        cudaMalloc((void**)&incx,sizeof(int)*(mat_vec_data_count+1));
-        cudaMalloc((void**)&incy,sizeof(int)*(mat_vec_data_count+1));
-        cudaMalloc((void**)&ldda,sizeof(int)*(mat_vec_data_count+1));
+        workspace_device_malloc(workspace, (void**)&incx,sizeof(int)*(mat_vec_data_count+1));
+        workspace_device_malloc(workspace, (void**)&incy,sizeof(int)*(mat_vec_data_count+1));
+        workspace_device_malloc(workspace, (void**)&ldda,sizeof(int)*(mat_vec_data_count+1));
 
 	checkCUDAError("cudaMalloc1");
 
@@ -1483,11 +1562,11 @@ void batched_low_rank_mvp_magma(double* x, double* y, double* U, double* V, int
         thrust::fill(incy_ptr, incy_ptr+(mat_vec_data_count+1), 1);
 	thrust::fill(ldda_ptr, ldda_ptr+(mat_vec_data_count+1), m2_total);
 
-	double** dU_array_h = new double*[mat_vec_data_count+1];
-	double** dV_array_h = new double*[mat_vec_data_count+1];
-	double** dx_array_h = new double*[mat_vec_data_count+1];
-	double** dtmp_array_h = new double*[mat_vec_data_count+1];
-	double** dy_array_h = new double*[mat_vec_data_count+1];
+	double** dU_array_h = (double**)workspace_host_malloc(workspace, (mat_vec_data_count+1)*sizeof(double*));
+	double** dV_array_h = (double**)workspace_host_malloc(workspace, (mat_vec_data_count+1)*sizeof(double*));
+	double** dx_array_h = (double**)workspace_host_malloc(workspace, (mat_vec_data_count+1)*sizeof(double*));
+	double** dtmp_array_h = (double**)workspace_host_malloc(workspace, (mat_vec_data_count+1)*sizeof(double*));
+	double** dy_array_h = (double**)workspace_host_malloc(workspace, (mat_vec_data_count+1)*sizeof(double*));
 
 	double** dU_array;
 	double** dV_array;
@@ -1495,17 +1574,17 @@ void batched_low_rank_mvp_magma(double* x, double* y, double* U, double* V, int
 	double** dtmp_array;
 	double** dy_array;
 
-	cudaMalloc((void**)&dU_array, (mat_vec_data_count+1)*sizeof(double*));
-	cudaMalloc((void**)&dV_array, (mat_vec_data_count+1)*sizeof(double*));
-	cudaMalloc((void**)&dx_array, (mat_vec_data_count+1)*sizeof(double*));
-	cudaMalloc((void**)&dtmp_array, (mat_vec_data_count+1)*sizeof(double*));
-	cudaMalloc((void**)&dy_array, (mat_vec_data_count+1)*sizeof(double*));
+	workspace_device_malloc(workspace, (void**)&dU_array, (mat_vec_data_count+1)*sizeof(double*));
+	workspace_device_malloc(workspace, (void**)&dV_array, (mat_vec_data_count+1)*sizeof(double*));
+	workspace_device_malloc(workspace, (void**)&dx_array, (mat_vec_data_count+1)*sizeof(double*));
+	workspace_device_malloc(workspace, (void**)&dtmp_array, (mat_vec_data_count+1)*sizeof(double*));
+	workspace_device_malloc(workspace, (void**)&dy_array, (mat_vec_data_count+1)*sizeof(double*));
 	checkCUDAError("cudaMalloc2");
 
 	int current_batch = 0;
 
-	int* m1_h = new int[mat_vec_data_count];
-	int* m2_h = new int[mat_vec_data_count];
+	int* m1_h = (int*)workspace_host_malloc(workspace, (mat_vec_data_count)*sizeof(int));
+	int* m2_h = (int*)workspace_host_malloc(workspace, (mat_vec_data_count)*sizeof(int));
 	cudaMemcpy(m1_h, m1, mat_vec_data_count*sizeof(int), cudaMemcpyDeviceToHost);
 	cudaMemcpy(m2_h, m2, mat_vec_data_count*sizeof(int), cudaMemcpyDeviceToHost);
 
@@ -1529,8 +1608,8 @@ void batched_low_rank_mvp_magma(double* x, double* y, double* U, double* V, int
 		}
         }
 
-	delete [] m1_h;
-	delete [] m2_h;
+	workspace_host_free(workspace, m1_h);
+	workspace_host_free(workspace, m2_h);
 
 	cudaMemcpy(dV_array, dV_array_h, (mat_vec_data_count)*sizeof(double*), cudaMemcpyHostToDevice);
 	cudaMemcpy(dU_array, dU_array_h, (mat_vec_data_count)*sizeof(double*), cudaMemcpyHostToDevice);
@@ -1540,11 +1619,11 @@ void batched_low_rank_mvp_magma(double* x, double* y, double* U, double* V, int
 
 	checkCUDAError("cudaMemcpy");
 
-	delete [] dU_array_h;
-	delete [] dV_array_h;
-	delete [] dx_array_h;
-	delete [] dtmp_array_h;
-	delete [] dy_array_h;
+	workspace_host_free(workspace, dU_array_h);
+	workspace_host_free(workspace, dV_array_h);
+	workspace_host_free(workspace, dx_array_h);
+	workspace_host_free(workspace, dtmp_array_h);
+	workspace_host_free(workspace, dy_array_h);
 
 
         magmablas_dgemv_vbatched( MagmaTrans, m2, k_per_item, one, dV_array, ldda, dx_array, incx, zero, dtmp_array, incy, current_batch, *queue);
@@ -1557,17 +1636,17 @@ void batched_low_rank_mvp_magma(double* x, double* y, double* U, double* V, int
 
 	checkCUDAError("magmablas_dgemv_vbatched1");
 
-	cudaFree(dU_array);
-	cudaFree(dV_array);
-	cudaFree(dx_array);
-	cudaFree(dtmp_array);
-	cudaFree(dy_array);
+	workspace_device_free(workspace, dU_array);
+	workspace_device_free(workspace, dV_array);
+	workspace_device_free(workspace, dx_array);
+	workspace_device_free(workspace, dtmp_array);
+	workspace_device_free(workspace, dy_array);
 
 	checkCUDAError("cudaFree1");
 
-	cudaFree(incx);
-	cudaFree(incy);
-	cudaFree(ldda);
+	workspace_device_free(workspace, incx);
+	workspace_device_free(workspace, incy);
+	workspace_device_free(workspace, ldda);
 
 	checkCUDAError("cudaFree2");
 
@@ -1582,9 +1661,9 @@ void batched_low_rank_mvp_magma(double* x, double* y, double* U, double* V, int
 
 ////	TIME_ssstop("ACA apply");
 
-	cudaFree(local_x);
-	cudaFree(local_y);
-	cudaFree(local_tmp);
+	workspace_device_free(workspace, local_x);
+	workspace_device_free(workspace, local_y);
+	workspace_device_free(workspace, local_tmp);
 
 	checkCUDAError("cudaFree3");
 
@@ -1757,8 +1836,10 @@ bool do_stop_based_on_batched_frobenius_norm(double* U, double* V, double* u_r,
 //--------------------------------------------------------------
 // compute mapping of batch data entries to global point indices
 //--------------------------------------------------------------
-void compute_point_map(int* point_map1, int* point_map2, int m1_total, int m2_total, int* m1, int* m2, int* point_map_offsets1, int* point_map_offsets2, struct work_item* mat_vec_data, int mat_vec_data_count, int work_type)
+void compute_point_map(int* point_map1, int* point_map2, int m1_total, int m2_total, int* m1, int* m2, int* point_map_offsets1, int* point_map_offsets2, struct work_item* mat_vec_data, int mat_vec_data_count, int work_type, struct mvp_workspace* workspace)
 {
+	workspace_thrust_allocator thrust_allocator(workspace);
+
 	int block_size = 512;
 
 	thrust::device_ptr<int> point_map1_ptr(point_map1);
@@ -1774,8 +1855,8 @@ void compute_point_map(int* point_map1, int* point_map2, int m1_total, int m2_to
 
 	// use inclusive scan to generate index map
 	// 2  3  0  5  6  7  8  0  2  3  4  0  
-	thrust::inclusive_scan(point_map1_ptr, point_map1_ptr+m1_total, point_map1_ptr);
-	thrust::inclusive_scan(point_map2_ptr, point_map2_ptr+m2_total, point_map2_ptr);
+	thrust::inclusive_scan(thrust::cuda::par(thrust_allocator), point_map1_ptr, point_map1_ptr+m1_total, point_map1_ptr);
+	thrust::inclusive_scan(thrust::cuda::par(thrust_allocator), point_map2_ptr, point_map2_ptr+m2_total, point_map2_ptr);
 
 	// correct upper bounds
 	// 2  3  4  5  6  7  8  9  2  3  4  5 
@@ -1855,8 +1936,10 @@ void compute_point_map_and_pattern_with_padding(int* point_map2, int* pattern2,
 // --------------------------------------------------------------
 // compute mapping of rows in batched data to index in work_queue	
 // --------------------------------------------------------------
-void compute_work_item_maps(int* work_item_map1, int* work_item_map2, int m1_total, int m2_total, int* point_map_offsets1, int* point_map_offsets2, int* m1, int* m2, struct work_item* mat_vec_data, int mat_vec_data_count, int work_type)
+void compute_work_item_maps(int* work_item_map1, int* work_item_map2, int m1_total, int m2_total, int* point_map_offsets1, int* point_map_offsets2, int* m1, int* m2, struct work_item* mat_vec_data, int mat_vec_data_count, int work_type, struct mvp_workspace* workspace)
 {
+	workspace_thrust_allocator thrust_allocator(workspace);
+
 	int block_size = 512;
 
 	thrust::device_ptr<int> work_item_map1_ptr(work_item_map1);
@@ -1873,8 +1956,8 @@ void compute_work_item_maps(int* work_item_map1, int* work_item_map2, int m1_tot
 
 	// fill gaps
 	// 0  0  2  2  0  0  0  3  3  3  3  0  1  1  1  0  0
-	thrust::inclusive_scan(work_item_map1_ptr, work_item_map1_ptr+m1_total, work_item_map1_ptr);
-	thrust::inclusive_scan(work_item_map2_ptr, work_item_map2_ptr+m2_total, work_item_map2_ptr);
+	thrust::inclusive_scan(thrust::cuda::par(thrust_allocator), work_item_map1_ptr, work_item_map1_ptr+m1_total, work_item_map1_ptr);
+	thrust::inclusive_scan(thrust::cuda::par(thrust_allocator), work_item_map2_ptr, work_item_map2_ptr+m2_total, work_item_map2_ptr);
 
 	// correct upper bounds
 	// 0  0  2  2  2  0  0  3  3  3  3  3  1  1  1  1  0
@@ -1886,13 +1969,16 @@ void compute_work_item_maps(int* work_item_map1, int* work_item_map2, int m1_tot
 // ------------------------------------------------------------------------------------------------------------
 // creating map between work item list (including invalid entries) and batch set list (without invalid entries)
 // ------------------------------------------------------------------------------------------------------------
-void compute_work_item_to_batch_map(int* work_item_to_batch_map, struct work_item* mat_vec_data, int mat_vec_data_count, int* batch_count, int work_type)
+void compute_work_item_to_batch_map(int* work_item_to_batch_map, struct work_item* mat_vec_data, int mat_vec_data_count, int* batch_count, int work_type, struct mvp_workspace* workspace)
 {
+	workspace_thrust_allocator thrust_allocator(workspace);
+	size_t workspace_mark = workspace_device_mark(workspace);
+
 	thrust::device_ptr<int> work_item_to_batch_map_ptr(work_item_to_batch_map);
 	thrust::device_ptr<struct work_item> mat_vec_data_ptr(mat_vec_data);
 
 	int* tmp_field;
-	cudaMalloc((void**)&tmp_field, mat_vec_data_count*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&tmp_field, mat_vec_data_count*sizeof(int));
 	thrust::device_ptr<int> tmp_field_ptr(tmp_field);
 
 	// fill tmp_field with sequence
@@ -1903,9 +1989,9 @@ void compute_work_item_to_batch_map(int* work_item_to_batch_map, struct work_ite
 	//              tmp_field =  1  2  4
 	thrust::device_ptr<int> end_after_removal;
 	if (work_type==WT_ACA)
-		end_after_removal = thrust::remove_if(tmp_field_ptr, tmp_field_ptr+mat_vec_data_count, mat_vec_data_ptr, is_not_WT_ACA());
+		end_after_removal = thrust::remove_if(thrust::cuda::par(thrust_allocator), tmp_field_ptr, tmp_field_ptr+mat_vec_data_count, mat_vec_data_ptr, is_not_WT_ACA());
 	else
-		end_after_removal = thrust::remove_if(tmp_field_ptr, tmp_field_ptr+mat_vec_data_count, mat_vec_data_ptr, is_not_WT_DENSE());
+		end_after_removal = thrust::remove_if(thrust::cuda::par(thrust_allocator), tmp_field_ptr, tmp_field_ptr+mat_vec_data_count, mat_vec_data_ptr, is_not_WT_DENSE());
 	
 	*batch_count = end_after_removal-tmp_field_ptr;
 
@@ -1916,26 +2002,29 @@ void compute_work_item_to_batch_map(int* work_item_to_batch_map, struct work_ite
 	// scatter sequence to appropriate positions (indicated by tmp_field)
 	// work_item_to_batch_map = -1  0  1 -1  2 -1
 	thrust::scatter(thrust::make_counting_iterator(0), thrust::make_counting_iterator(*batch_count), tmp_field_ptr, work_item_to_batch_map_ptr);
-	cudaFree(tmp_field);
+	workspace_device_free(workspace, tmp_field);
 
+	workspace_device_release(workspace, workspace_mark);
 }
 
 
-void compute_m1_m2(int* m1, int* m2, struct work_item* mat_vec_data, int mat_vec_data_count, int work_type)
+void compute_m1_m2(int* m1, int* m2, struct work_item* mat_vec_data, int mat_vec_data_count, int work_type, struct mvp_workspace* workspace)
 {
+	size_t workspace_mark = workspace_device_mark(workspace);
+
 	int block_size = 512;
 
 	int* l1;
 	int* u1;
-	cudaMalloc((void**)&l1, mat_vec_data_count*sizeof(int));
-	cudaMalloc((void**)&u1, mat_vec_data_count*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&l1, mat_vec_data_count*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&u1, mat_vec_data_count*sizeof(int));
 	thrust::device_ptr<int> l1_ptr(l1);
 	thrust::device_ptr<int> u1_ptr(u1);
 
 	int* l2;
 	int* u2;
-	cudaMalloc((void**)&l2, mat_vec_data_count*sizeof(int));
-	cudaMalloc((void**)&u2, mat_vec_data_count*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&l2, mat_vec_data_count*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&u2, mat_vec_data_count*sizeof(int));
 	thrust::device_ptr<int> l2_ptr(l2);
 	thrust::device_ptr<int> u2_ptr(u2);
 
@@ -1955,16 +2044,18 @@ void compute_m1_m2(int* m1, int* m2, struct work_item* mat_vec_data, int mat_vec
 	thrust::transform(u2_ptr, u2_ptr+mat_vec_data_count, l2_ptr, m2_ptr, minus_plus_1()); // numbers of columns
 
 	// l1, u1, l2, u2 are no longer needed
-	cudaFree(l1);
-	cudaFree(l2);
-	cudaFree(u1);
-	cudaFree(u2);
-
+	workspace_device_free(workspace, l1);
+	workspace_device_free(workspace, l2);
+	workspace_device_free(workspace, u1);
+	workspace_device_free(workspace, u2);
 
+	workspace_device_release(workspace, workspace_mark);
 }
 
-void create_maps_and_indices(int* m1, int* m2, int m1_total, int m2_total, int* point_map_offsets1, int* point_map_offsets2, int* point_map1, int* point_map2, int* work_item_map1, int* work_item_map2, int* work_item_to_batch_map, int* batch_count, struct work_item* mat_vec_data, int mat_vec_data_count, int work_type)
+void create_maps_and_indices(int* m1, int* m2, int m1_total, int m2_total, int* point_map_offsets1, int* point_map_offsets2, int* point_map1, int* point_map2, int* work_item_map1, int* work_item_map2, int* work_item_to_batch_map, int* batch_count, struct work_item* mat_vec_data, int mat_vec_data_count, int work_type, struct mvp_workspace* workspace)
 {
+	workspace_thrust_allocator thrust_allocator(workspace);
+
 
 	thrust::device_ptr<struct work_item> mat_vec_data_ptr(mat_vec_data);
 	thrust::device_ptr<int> m1_ptr(m1);
@@ -1976,8 +2067,8 @@ void create_maps_and_indices(int* m1, int* m2, int m1_total, int m2_total, int*
 	// ------------------------------------------------------
 	thrust::device_ptr<int> point_map_offsets1_ptr(point_map_offsets1);
 	thrust::device_ptr<int> point_map_offsets2_ptr(point_map_offsets2);
-	thrust::exclusive_scan(m1_ptr, m1_ptr+mat_vec_data_count, point_map_offsets1_ptr, 0);
-	thrust::exclusive_scan(m2_ptr, m2_ptr+mat_vec_data_count, point_map_offsets2_ptr, 0);
+	thrust::exclusive_scan(thrust::cuda::par(thrust_allocator), m1_ptr, m1_ptr+mat_vec_data_count, point_map_offsets1_ptr, 0);
+	thrust::exclusive_scan(thrust::cuda::par(thrust_allocator), m2_ptr, m2_ptr+mat_vec_data_count, point_map_offsets2_ptr, 0);
 
 	//--------------------------------------------------------------
 	// compute mapping of batch data entries to global point indices
@@ -1985,7 +2076,7 @@ void create_maps_and_indices(int* m1, int* m2, int m1_total, int m2_total, int*
 	thrust::device_ptr<int> point_map1_ptr(point_map1);
 	thrust::device_ptr<int> point_map2_ptr(point_map2);
 
-	compute_point_map(point_map1, point_map2, m1_total, m2_total, m1, m2, point_map_offsets1, point_map_offsets2, mat_vec_data, mat_vec_data_count, work_type);
+	compute_point_map(point_map1, point_map2, m1_total, m2_total, m1, m2, point_map_offsets1, point_map_offsets2, mat_vec_data, mat_vec_data_count, work_type, workspace);
 
 	// --------------------------------------------------------------
 	// compute mapping of rows in batched data to index in work_queue	
@@ -1993,14 +2084,14 @@ void create_maps_and_indices(int* m1, int* m2, int m1_total, int m2_total, int*
 	thrust::device_ptr<int> work_item_map1_ptr(work_item_map1);
 	thrust::device_ptr<int> work_item_map2_ptr(work_item_map2);
 
-	compute_work_item_maps(work_item_map1, work_item_map2, m1_total, m2_total, point_map_offsets1, point_map_offsets2, m1, m2, mat_vec_data, mat_vec_data_count, work_type);
+	compute_work_item_maps(work_item_map1, work_item_map2, m1_total, m2_total, point_map_offsets1, point_map_offsets2, m1, m2, mat_vec_data, mat_vec_data_count, work_type, workspace);
 
 	// ------------------------------------------------------------------------------------------------------------
 	// creating map between work item list (including invalid entries) and batch set list (without invalid entries)
 	// ------------------------------------------------------------------------------------------------------------
 	thrust::device_ptr<int> work_item_to_batch_map_ptr(work_item_to_batch_map);
 
-	compute_work_item_to_batch_map(work_item_to_batch_map, mat_vec_data, mat_vec_data_count, batch_count, work_type);
+	compute_work_item_to_batch_map(work_item_to_batch_map, mat_vec_data, mat_vec_data_count, batch_count, work_type, workspace);
 
 
 
@@ -2033,8 +2124,11 @@ struct is_true
 
 
 
-void compute_current_batched_v_r(double* v_r, double* U, double* V, int m1_total, int m2_total, struct work_item* mat_vec_data, int mat_vec_data_count, bool* search_for_new_v_r, int* i_r, int* point_map1, int* point_map2, int* point_map_offsets1, int* point_map_offsets2, int* work_item_map2, struct point_set* input_set1, struct point_set* input_set2, int* k_per_item, int* m1, int r, struct system_assembler* assem, int k_max, bool* stop_full_aca_for_batch)
+void compute_current_batched_v_r(double* v_r, double* U, double* V, int m1_total, int m2_total, struct work_item* mat_vec_data, int mat_vec_data_count, bool* search_for_new_v_r, int* i_r, int* point_map1, int* point_map2, int* point_map_offsets1, int* point_map_offsets2, int* work_item_map2, struct point_set* input_set1, struct point_set* input_set2, int* k_per_item, int* m1, int r, struct system_assembler* assem, int k_max, bool* stop_full_aca_for_batch, struct mvp_workspace* workspace)
 {
+	workspace_thrust_allocator thrust_allocator(workspace);
+	size_t workspace_mark = workspace_device_mark(workspace);
+
 
 	int block_size = MATRIX_ENTRY_BLOCK_SIZE;
 
@@ -2047,8 +2141,8 @@ void compute_current_batched_v_r(double* v_r, double* U, double* V, int m1_total
 
 	int* keys_output;
 	double* v_r_norms;
-	cudaMalloc((void**)&keys_output, m2_total*sizeof(int));
-	cudaMalloc((void**)&v_r_norms, m2_total*sizeof(double));
+	workspace_device_malloc(workspace, (void**)&keys_output, m2_total*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&v_r_norms, m2_total*sizeof(double));
 	thrust::device_ptr<int> keys_output_ptr(keys_output);
 	thrust::device_ptr<double> v_r_norms_ptr(v_r_norms);
 
@@ -2098,7 +2192,7 @@ void compute_current_batched_v_r(double* v_r, double* U, double* V, int m1_total
 
 //		// computing norms of batched vectors (to check whether to increase i_r)
 		int v_r_norms_count;
-		compute_batched_norms_with_keys_output(v_r_norms, keys_output, &v_r_norms_count, v_r, m2_total, work_item_map2_ptr, block_size);
+		compute_batched_norms_with_keys_output(v_r_norms, keys_output, &v_r_norms_count, v_r, m2_total, work_item_map2_ptr, block_size, workspace);
 
 
 // there are no invalid entries by construction
@@ -2117,7 +2211,7 @@ void compute_current_batched_v_r(double* v_r, double* U, double* V, int m1_total
 
 
 		bool continue_search_for_new_v_r;
-		continue_search_for_new_v_r = thrust::reduce(search_for_new_v_r_ptr, search_for_new_v_r_ptr+mat_vec_data_count, false, thrust::logical_or<bool>());
+		continue_search_for_new_v_r = thrust::reduce(thrust::cuda::par(thrust_allocator), search_for_new_v_r_ptr, search_for_new_v_r_ptr+mat_vec_data_count, false, thrust::logical_or<bool>());
 
 //		print_int(compute_v_r, mat_vec_data_count);
 //		printf("max: %d\n", max_of_compute_v_r);
@@ -2138,15 +2232,19 @@ void compute_current_batched_v_r(double* v_r, double* U, double* V, int m1_total
 
 ////	TIME_ssstart;
 
-	cudaFree(keys_output);
+	workspace_device_free(workspace, keys_output);
 	checkCUDAError("cudaFree");
-	cudaFree(v_r_norms);
+	workspace_device_free(workspace, v_r_norms);
 	checkCUDAError("cudaFree");
 
+	workspace_device_release(workspace, workspace_mark);
 }
 
-void compute_current_batched_u_r(double* u_r, double* v_r, double* U, double* V, int m1_total, int m2_total, struct work_item* mat_vec_data, int mat_vec_data_count, int* point_map1, int* point_map2, int* work_item_map1, int* work_item_map2, struct point_set* input_set1, struct point_set* input_set2, int* k_per_item, int* j_r_global, int* work_item_to_batch_map, int r, struct system_assembler* assem, bool* stop_full_aca_for_batch)
+void compute_current_batched_u_r(double* u_r, double* v_r, double* U, double* V, int m1_total, int m2_total, struct work_item* mat_vec_data, int mat_vec_data_count, int* point_map1, int* point_map2, int* work_item_map1, int* work_item_map2, struct point_set* input_set1, struct point_set* input_set2, int* k_per_item, int* j_r_global, int* work_item_to_batch_map, int r, struct system_assembler* assem, bool* stop_full_aca_for_batch, struct mvp_workspace* workspace)
 {
+	workspace_thrust_allocator thrust_allocator(workspace);
+	size_t workspace_mark = workspace_device_mark(workspace);
+
 
 		int block_size = MATRIX_ENTRY_BLOCK_SIZE;
 
@@ -2155,12 +2253,12 @@ void compute_current_batched_u_r(double* u_r, double* v_r, double* U, double* V,
 		thrust::device_ptr<int> j_r_global_ptr(j_r_global);
 
 		double* maximum_values;
-		cudaMalloc((void**)&maximum_values, mat_vec_data_count*sizeof(double));
+		workspace_device_malloc(workspace, (void**)&maximum_values, mat_vec_data_count*sizeof(double));
 		checkCUDAError("cudaMalloc");
 		thrust::device_ptr<double> maximum_values_ptr(maximum_values);
 
 		int* batch_to_work_item_map; // maps batch set to work item number
-		cudaMalloc((void**)&batch_to_work_item_map, mat_vec_data_count*sizeof(double));  // mat_vec_data_count is just an upper bound
+		workspace_device_malloc(workspace, (void**)&batch_to_work_item_map, mat_vec_data_count*sizeof(double));  // mat_vec_data_count is just an upper bound
 		checkCUDAError("cudaMalloc");
 		thrust::device_ptr<int> batch_to_work_item_map_ptr(batch_to_work_item_map);
 
@@ -2169,19 +2267,19 @@ void compute_current_batched_u_r(double* u_r, double* v_r, double* U, double* V,
 
 		// allocate and fill "indices" with 0, 1, 2, ...
 		int* indices;
-		cudaMalloc((void**)&indices, m2_total*sizeof(double));
+		workspace_device_malloc(workspace, (void**)&indices, m2_total*sizeof(double));
 		checkCUDAError("cudaMalloc");
 		thrust::device_ptr<int> indices_ptr(indices);
 		thrust::sequence(indices_ptr, indices_ptr+m2_total);
 
 		// compute block-wise maximum and maximum positions at the same time
 		thrust::pair<thrust::device_ptr<int>, thrust::zip_iterator<thrust::tuple<thrust::device_ptr<double>,thrust::device_ptr<int> > > > new_end2;
-		new_end2 = thrust::reduce_by_key(work_item_map2_ptr, work_item_map2_ptr+m2_total, thrust::make_zip_iterator(thrust::make_tuple(v_r_ptr, indices_ptr)), batch_to_work_item_map_ptr, thrust::make_zip_iterator(thrust::make_tuple(maximum_values_ptr, j_r_global_ptr)), thrust::equal_to<int>(), tuple_absolute_maximum());
+		new_end2 = thrust::reduce_by_key(thrust::cuda::par(thrust_allocator), work_item_map2_ptr, work_item_map2_ptr+m2_total, thrust::make_zip_iterator(thrust::make_tuple(v_r_ptr, indices_ptr)), batch_to_work_item_map_ptr, thrust::make_zip_iterator(thrust::make_tuple(maximum_values_ptr, j_r_global_ptr)), thrust::equal_to<int>(), tuple_absolute_maximum());
 
 		// ATTENTION: In the following, I assume that the output size is identical to mat_vec_data_count, which is mandatory!!!
 
-		cudaFree(maximum_values);
-		cudaFree(batch_to_work_item_map);
+		workspace_device_free(workspace, maximum_values);
+		workspace_device_free(workspace, batch_to_work_item_map);
 
 //	//	TIME_ssstop("ACA u_r computation 3");
 //	//	TIME_ssstart;
@@ -2217,13 +2315,16 @@ void compute_current_batched_u_r(double* u_r, double* v_r, double* U, double* V,
 		checkCUDAError("batched_fill_kernel_vector_and_scaled_substraction_for_u_r");
 
 
-	cudaFree(indices);
+	workspace_device_free(workspace, indices);
 
+	workspace_device_release(workspace, workspace_mark);
 }
 
 
-void apply_batched_aca(double* x, double* y, struct work_item* mat_vec_data, int mat_vec_data_count, struct point_set* input_set1, struct point_set* input_set2, cublasStatus_t stat, cublasHandle_t handle, double eta, double epsilon, int k, struct system_assembler* assem)
+void apply_batched_aca(double* x, double* y, struct work_item* mat_vec_data, int mat_vec_data_count, struct point_set* input_set1, struct point_set* input_set2, cublasStatus_t stat, cublasHandle_t handle, double eta, double epsilon, int k, struct system_assembler* assem, struct mvp_workspace* workspace)
 {
+	workspace_thrust_allocator thrust_allocator(workspace);
+
 	int block_size = 512;
 
 	
@@ -2242,15 +2343,15 @@ void apply_batched_aca(double* x, double* y, struct work_item* mat_vec_data, int
 	// ------------------------
 	int* m1;
 	int* m2;
-	cudaMalloc((void**)&m1, mat_vec_data_count*sizeof(int));
-	cudaMalloc((void**)&m2, mat_vec_data_count*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&m1, mat_vec_data_count*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&m2, mat_vec_data_count*sizeof(int));
 	thrust::device_ptr<int> m1_ptr(m1);
 	thrust::device_ptr<int> m2_ptr(m2);
-	compute_m1_m2(m1, m2, mat_vec_data, mat_vec_data_count, WT_ACA);
+	compute_m1_m2(m1, m2, mat_vec_data, mat_vec_data_count, WT_ACA, workspace);
 	int m1_total;
 	int m2_total;
-	m1_total = thrust::reduce(m1_ptr, m1_ptr+mat_vec_data_count);
-	m2_total = thrust::reduce(m2_ptr, m2_ptr+mat_vec_data_count);
+	m1_total = thrust::reduce(thrust::cuda::par(thrust_allocator), m1_ptr, m1_ptr+mat_vec_data_count);
+	m2_total = thrust::reduce(thrust::cuda::par(thrust_allocator), m2_ptr, m2_ptr+mat_vec_data_count);
 
 
 	// -------------------------------
@@ -2266,13 +2367,13 @@ void apply_batched_aca(double* x, double* y, struct work_item* mat_vec_data, int
 	int* work_item_map2; // map of rows of V to work item indices in mat_vec_data
 	int* work_item_to_batch_map;  // map between work item list (including invalid entries) and batch set list (without invalid entries)
 
-	cudaMalloc((void**)&point_map_offsets1, mat_vec_data_count*sizeof(int));
-	cudaMalloc((void**)&point_map_offsets2, mat_vec_data_count*sizeof(int));
-	cudaMalloc((void**)&point_map1, m1_total*sizeof(int));
-	cudaMalloc((void**)&point_map2, m2_total*sizeof(int));
-	cudaMalloc((void**)&work_item_map1, m1_total*sizeof(int));
-	cudaMalloc((void**)&work_item_map2, m2_total*sizeof(int));
-	cudaMalloc((void**)&work_item_to_batch_map, mat_vec_data_count*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&point_map_offsets1, mat_vec_data_count*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&point_map_offsets2, mat_vec_data_count*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&point_map1, m1_total*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&point_map2, m2_total*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&work_item_map1, m1_total*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&work_item_map2, m2_total*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&work_item_to_batch_map, mat_vec_data_count*sizeof(int));
 
 	thrust::device_ptr<int> point_map_offsets1_ptr(point_map_offsets1);
 	thrust::device_ptr<int> point_map_offsets2_ptr(point_map_offsets2);
@@ -2282,7 +2383,7 @@ void apply_batched_aca(double* x, double* y, struct work_item* mat_vec_data, int
 	thrust::device_ptr<int> work_item_map2_ptr(work_item_map2);
 	thrust::device_ptr<int> work_item_to_batch_map_ptr(work_item_to_batch_map);
 
-	create_maps_and_indices(m1, m2, m1_total, m2_total, point_map_offsets1, point_map_offsets2, point_map1, point_map2, work_item_map1, work_item_map2, work_item_to_batch_map, &batch_count, mat_vec_data, mat_vec_data_count, WT_ACA);
+	create_maps_and_indices(m1, m2, m1_total, m2_total, point_map_offsets1, point_map_offsets2, point_map1, point_map2, work_item_map1, work_item_map2, work_item_to_batch_map, &batch_count, mat_vec_data, mat_vec_data_count, WT_ACA, workspace);
 
 
 	// -----------------------------------------------------
@@ -2293,10 +2394,10 @@ void apply_batched_aca(double* x, double* y, struct work_item* mat_vec_data, int
 	int* point_map_offsets2_h;
 	int* point_map_offsets1_h;
 	
-	m1_h = new int[mat_vec_data_count];
-	m2_h = new int[mat_vec_data_count];
-	point_map_offsets2_h = new int[mat_vec_data_count];
-	point_map_offsets1_h = new int[mat_vec_data_count];
+	m1_h = (int*)workspace_host_malloc(workspace, (mat_vec_data_count)*sizeof(int));
+	m2_h = (int*)workspace_host_malloc(workspace, (mat_vec_data_count)*sizeof(int));
+	point_map_offsets2_h = (int*)workspace_host_malloc(workspace, (mat_vec_data_count)*sizeof(int));
+	point_map_offsets1_h = (int*)workspace_host_malloc(workspace, (mat_vec_data_count)*sizeof(int));
 	
 	cudaMemcpy(m1_h, m1, mat_vec_data_count*sizeof(int), cudaMemcpyDeviceToHost);
 	cudaMemcpy(m2_h, m2, mat_vec_data_count*sizeof(int), cudaMemcpyDeviceToHost);
@@ -2309,7 +2410,7 @@ void apply_batched_aca(double* x, double* y, struct work_item* mat_vec_data, int
 	// compute the "k" per batch
 	//--------------------------
 	int* k_per_item;
-	cudaMalloc((void**)&k_per_item, mat_vec_data_count*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&k_per_item, mat_vec_data_count*sizeof(int));
 	thrust::device_ptr<int> k_per_item_ptr(k_per_item);
 	// if (k>min(m,n))
 	//     k= min(m,n);
@@ -2322,8 +2423,8 @@ void apply_batched_aca(double* x, double* y, struct work_item* mat_vec_data, int
 	//-----------------------------
 	// set upper bound for global k
 	//-----------------------------
-	int m1_max = thrust::reduce(m1_ptr, m1_ptr+mat_vec_data_count, 0, thrust::maximum<int>());
-	int m2_max = thrust::reduce(m2_ptr, m2_ptr+mat_vec_data_count, 0, thrust::maximum<int>());
+	int m1_max = thrust::reduce(thrust::cuda::par(thrust_allocator), m1_ptr, m1_ptr+mat_vec_data_count, 0, thrust::maximum<int>());
+	int m2_max = thrust::reduce(thrust::cuda::par(thrust_allocator), m2_ptr, m2_ptr+mat_vec_data_count, 0, thrust::maximum<int>());
 	if (k>min(m1_max, m2_max))
 	{
 		k = min(m1_max, m2_max);
@@ -2336,10 +2437,10 @@ void apply_batched_aca(double* x, double* y, struct work_item* mat_vec_data, int
 	// allocate and init batched U, V
 	//-------------------------------
 	double* U;
-	cudaMalloc((void**)&U, m1_total*k*sizeof(double));  
+	workspace_device_malloc(workspace, (void**)&U, m1_total*k*sizeof(double));  
 	checkCUDAError("cudaMalloc");
 	double* V;
-	cudaMalloc((void**)&V, m2_total*k*sizeof(double));
+	workspace_device_malloc(workspace, (void**)&V, m2_total*k*sizeof(double));
 	checkCUDAError("cudaMalloc");
 
 	thrust::device_ptr<double> U_ptr(U);
@@ -2361,7 +2462,7 @@ void apply_batched_aca(double* x, double* y, struct work_item* mat_vec_data, int
 //	int i_r = -1;
 
 	int* i_r;
-	cudaMalloc((void**)&i_r, mat_vec_data_count*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&i_r, mat_vec_data_count*sizeof(int));
 	thrust::device_ptr<int> i_r_ptr(i_r);
 
 	thrust::fill(i_r_ptr, i_r_ptr+mat_vec_data_count, -1);
@@ -2369,7 +2470,7 @@ void apply_batched_aca(double* x, double* y, struct work_item* mat_vec_data, int
 	thrust::replace_if(i_r_ptr, i_r_ptr+mat_vec_data_count, mat_vec_data_ptr, is_not_WT_ACA(), -1);
 
 	bool* search_for_new_v_r;
-	cudaMalloc((void**)&search_for_new_v_r, mat_vec_data_count*sizeof(bool));
+	workspace_device_malloc(workspace, (void**)&search_for_new_v_r, mat_vec_data_count*sizeof(bool));
 //	thrust::device_ptr<int> compute_v_r_ptr(compute_v_r);
 
   	
@@ -2391,7 +2492,7 @@ void apply_batched_aca(double* x, double* y, struct work_item* mat_vec_data, int
 
 
         bool* stop_full_aca_for_batch;
-        cudaMalloc((void**)&stop_full_aca_for_batch, mat_vec_data_count*sizeof(bool));
+        workspace_device_malloc(workspace, (void**)&stop_full_aca_for_batch, mat_vec_data_count*sizeof(bool));
         thrust::device_ptr<bool> stop_full_aca_for_batch_ptr(stop_full_aca_for_batch);
         thrust::fill(stop_full_aca_for_batch_ptr, stop_full_aca_for_batch_ptr+mat_vec_data_count, false);
 
@@ -2424,7 +2525,7 @@ void apply_batched_aca(double* x, double* y, struct work_item* mat_vec_data, int
                 thrust::replace_if(stop_full_aca_for_batch_ptr, stop_full_aca_for_batch_ptr+mat_vec_data_count, k_per_item_ptr, ser, true);
 
 
-                compute_current_batched_v_r(v_r, U, V, m1_total, m2_total, mat_vec_data, mat_vec_data_count, search_for_new_v_r, i_r, point_map1, point_map2, point_map_offsets1, point_map_offsets2, work_item_map2, input_set1, input_set2, k_per_item, m1, r, assem, k, stop_full_aca_for_batch);
+                compute_current_batched_v_r(v_r, U, V, m1_total, m2_total, mat_vec_data, mat_vec_data_count, search_for_new_v_r, i_r, point_map1, point_map2, point_map_offsets1, point_map_offsets2, work_item_map2, input_set1, input_set2, k_per_item, m1, r, assem, k, stop_full_aca_for_batch, workspace);
 
 
                 //// [m,j_r] = max(abs(v_tilde_r));
@@ -2432,14 +2533,14 @@ void apply_batched_aca(double* x, double* y, struct work_item* mat_vec_data, int
                 //int j_r = max_pos - v_r_ptr;
 
                 int* j_r_global; // j_r index (maximum positions) as global indices in the batched vector
-                cudaMalloc((void**)&j_r_global, mat_vec_data_count*sizeof(int));  // mat_vec_data_count is an upper bound to the actual amount of batches
+                workspace_device_malloc(workspace, (void**)&j_r_global, mat_vec_data_count*sizeof(int));  // mat_vec_data_count is an upper bound to the actual amount of batches
                 checkCUDAError("cudaMalloc");
                 thrust::device_ptr<int> j_r_global_ptr(j_r_global);
 
-                compute_current_batched_u_r(u_r, v_r, U, V, m1_total, m2_total, mat_vec_data, mat_vec_data_count, point_map1, point_map2, work_item_map1, work_item_map2, input_set1, input_set2, k_per_item, j_r_global, work_item_to_batch_map, r, assem, stop_full_aca_for_batch);
+                compute_current_batched_u_r(u_r, v_r, U, V, m1_total, m2_total, mat_vec_data, mat_vec_data_count, point_map1, point_map2, work_item_map1, work_item_map2, input_set1, input_set2, k_per_item, j_r_global, work_item_to_batch_map, r, assem, stop_full_aca_for_batch, workspace);
 
 
-                cudaFree(j_r_global);
+                workspace_device_free(workspace, j_r_global);
 
 
 //              bool check_frobenius = false;
@@ -2458,13 +2559,13 @@ void apply_batched_aca(double* x, double* y, struct work_item* mat_vec_data, int
 //              }
         }
 
-        cudaFree(stop_full_aca_for_batch);
+        workspace_device_free(workspace, stop_full_aca_for_batch);
 
 
 
-	cudaFree(work_item_to_batch_map);
-	cudaFree(i_r);
-	cudaFree(search_for_new_v_r);
+	workspace_device_free(workspace, work_item_to_batch_map);
+	workspace_device_free(workspace, i_r);
+	workspace_device_free(workspace, search_for_new_v_r);
 /*
 	cudaFree(stop_aca_as_soon_as_possible);
 	delete [] stop_aca_as_soon_as_possible_h;
@@ -2478,15 +2579,15 @@ void apply_batched_aca(double* x, double* y, struct work_item* mat_vec_data, int
 //        printf("2:   %lf MB of %lf MB available.\n", (double)free_mem/(1024.0*1024.0), (double)total_mem/(1024.0*1024.0));
 //        }
 
-	cudaFree(m1);
-	cudaFree(m2);
-	cudaFree(point_map_offsets1);
-	cudaFree(point_map_offsets2);
+	workspace_device_free(workspace, m1);
+	workspace_device_free(workspace, m2);
+	workspace_device_free(workspace, point_map_offsets1);
+	workspace_device_free(workspace, point_map_offsets2);
 
 //	TIME_sssstart;
 
 	// apply low-rank matrix-vector product
-	batched_low_rank_mvp(x, y, U, V, m1_total, m2_total, m1_h, m2_h, mat_vec_data_count, batch_count, k, k_per_item, stat, handle , point_map_offsets1_h, point_map_offsets2_h, point_map1, point_map2, work_item_map1 );
+	batched_low_rank_mvp(x, y, U, V, m1_total, m2_total, m1_h, m2_h, mat_vec_data_count, batch_count, k, k_per_item, stat, handle , point_map_offsets1_h, point_map_offsets2_h, point_map1, point_map2, work_item_map1, workspace );
 //	TIME_sssstop("batched_low_rank_mvp");
 
 
@@ -2495,19 +2596,19 @@ void apply_batched_aca(double* x, double* y, struct work_item* mat_vec_data, int
 //		cudaStreamDestroy(streams[b]);
 //	delete[] streams;
 
-	delete [] m1_h;
-	delete [] m2_h;
-	delete [] point_map_offsets1_h;
-	delete [] point_map_offsets2_h;
+	workspace_host_free(workspace, m1_h);
+	workspace_host_free(workspace, m2_h);
+	workspace_host_free(workspace, point_map_offsets1_h);
+	workspace_host_free(workspace, point_map_offsets2_h);
 
 
-	cudaFree(U);
-	cudaFree(V);
-	cudaFree(k_per_item);
-	cudaFree(point_map1);
-	cudaFree(point_map2);
-	cudaFree(work_item_map1);
-	cudaFree(work_item_map2);
+	workspace_device_free(workspace, U);
+	workspace_device_free(workspace, V);
+	workspace_device_free(workspace, k_per_item);
+	workspace_device_free(workspace, point_map1);
+	workspace_device_free(workspace, point_map2);
+	workspace_device_free(workspace, work_item_map1);
+	workspace_device_free(workspace, work_item_map2);
 	checkCUDAError("cudaFrees a the end of batched ACA");
 
 
@@ -2543,7 +2644,7 @@ void apply_batched_dense(double* x, double* y, struct work_item* mat_vec_data, i
 	cudaMalloc((void**)&m2, mat_vec_data_count*sizeof(int));
 	thrust::device_ptr<int> m1_ptr(m1);
 	thrust::device_ptr<int> m2_ptr(m2);
-	compute_m1_m2(m1, m2, mat_vec_data, mat_vec_data_count, WT_DENSE);
+	compute_m1_m2(m1, m2, mat_vec_data, mat_vec_data_count, WT_DENSE, 0);
 	int m1_total;
 	int m2_total;
 	m1_total = thrust::reduce(m1_ptr, m1_ptr+mat_vec_data_count);
@@ -2606,7 +2707,7 @@ void apply_batched_dense(double* x, double* y, struct work_item* mat_vec_data, i
 //	TIME_ssstop("Indexing a.2");
 //	TIME_ssstart;
 
-	create_maps_and_indices(m1, m2, m1_total, m2_total, point_map_offsets1, point_map_offsets2, point_map1, point_map2, work_item_map1, work_item_map2, work_item_to_batch_map, &batch_count, mat_vec_data, mat_vec_data_count, WT_DENSE);
+	create_maps_and_indices(m1, m2, m1_total, m2_total, point_map_offsets1, point_map_offsets2, point_map1, point_map2, work_item_map1, work_item_map2, work_item_to_batch_map, &batch_count, mat_vec_data, mat_vec_data_count, WT_DENSE, 0);
 
 //	TIME_ssstop("Indexing b");
 //	TIME_ssstart;
@@ -2814,8 +2915,10 @@ __global__ void set_dA_array(double** dA_array, double* hA, int mat_vec_data_cou
 	return;
 }
 
-void apply_batched_dense_magma(double* x, double* y, struct work_item* mat_vec_data, int mat_vec_data_count, struct point_set* input_set1, struct point_set* input_set2, cublasStatus_t stat, cublasHandle_t handle, struct system_assembler* assem, magma_queue_t* queue, double* hA, bool use_precomputed_data)
+void apply_batched_dense_magma(double* x, double* y, struct work_item* mat_vec_data, int mat_vec_data_count, struct point_set* input_set1, struct point_set* input_set2, cublasStatus_t stat, cublasHandle_t handle, struct system_assembler* assem, magma_queue_t* queue, double* hA, bool use_precomputed_data, struct mvp_workspace* workspace)
 {
+	workspace_thrust_allocator thrust_allocator(workspace);
+
 	int block_size = MATRIX_ENTRY_BLOCK_SIZE;
 
 	if (mat_vec_data_count==0)
@@ -2836,15 +2939,15 @@ void apply_batched_dense_magma(double* x, double* y, struct work_item* mat_vec_d
 	// ------------------------
 	int* m1;
 	int* m2;
-	cudaMalloc((void**)&m1, (mat_vec_data_count+1)*sizeof(int));
-	cudaMalloc((void**)&m2, (mat_vec_data_count+1)*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&m1, (mat_vec_data_count+1)*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&m2, (mat_vec_data_count+1)*sizeof(int));
 	thrust::device_ptr<int> m1_ptr(m1);
 	thrust::device_ptr<int> m2_ptr(m2);
-	compute_m1_m2(m1, m2, mat_vec_data, mat_vec_data_count, WT_DENSE);
+	compute_m1_m2(m1, m2, mat_vec_data, mat_vec_data_count, WT_DENSE, workspace);
 	int m1_total;
 	int m2_total;
-	m1_total = thrust::reduce(m1_ptr, m1_ptr+mat_vec_data_count);
-	m2_total = thrust::reduce(m2_ptr, m2_ptr+mat_vec_data_count);
+	m1_total = thrust::reduce(thrust::cuda::par(thrust_allocator), m1_ptr, m1_ptr+mat_vec_data_count);
+	m2_total = thrust::reduce(thrust::cuda::par(thrust_allocator), m2_ptr, m2_ptr+mat_vec_data_count);
 
 /*
 	int* matrix_sizes;
@@ -2873,13 +2976,13 @@ void apply_batched_dense_magma(double* x, double* y, struct work_item* mat_vec_d
 //	printf("%d %d %d\n",mat_vec_data_count, m1_total, m2_total);
 
 
-	cudaMalloc((void**)&point_map_offsets1, mat_vec_data_count*sizeof(int));
-	cudaMalloc((void**)&point_map_offsets2, mat_vec_data_count*sizeof(int));
-	cudaMalloc((void**)&point_map1, m1_total*sizeof(int));
-	cudaMalloc((void**)&point_map2, m2_total*sizeof(int));
-	cudaMalloc((void**)&work_item_map1, m1_total*sizeof(int));
-	cudaMalloc((void**)&work_item_map2, m2_total*sizeof(int));
-	cudaMalloc((void**)&work_item_to_batch_map, mat_vec_data_count*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&point_map_offsets1, mat_vec_data_count*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&point_map_offsets2, mat_vec_data_count*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&point_map1, m1_total*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&point_map2, m2_total*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&work_item_map1, m1_total*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&work_item_map2, m2_total*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&work_item_to_batch_map, mat_vec_data_count*sizeof(int));
 
 
 	thrust::device_ptr<int> point_map_offsets1_ptr(point_map_offsets1);
@@ -2891,7 +2994,7 @@ void apply_batched_dense_magma(double* x, double* y, struct work_item* mat_vec_d
 	thrust::device_ptr<int> work_item_to_batch_map_ptr(work_item_to_batch_map);
 
 
-	create_maps_and_indices(m1, m2, m1_total, m2_total, point_map_offsets1, point_map_offsets2, point_map1, point_map2, work_item_map1, work_item_map2, work_item_to_batch_map, &batch_count, mat_vec_data, mat_vec_data_count, WT_DENSE);
+	create_maps_and_indices(m1, m2, m1_total, m2_total, point_map_offsets1, point_map_offsets2, point_map1, point_map2, work_item_map1, work_item_map2, work_item_to_batch_map, &batch_count, mat_vec_data, mat_vec_data_count, WT_DENSE, workspace);
 
 
 	// -----------------------------------------------------
@@ -2902,10 +3005,10 @@ void apply_batched_dense_magma(double* x, double* y, struct work_item* mat_vec_d
 	int* point_map_offsets2_h;
 	int* point_map_offsets1_h;
 	
-	m1_h = new int[mat_vec_data_count];
-	m2_h = new int[mat_vec_data_count];
-	point_map_offsets2_h = new int[mat_vec_data_count];
-	point_map_offsets1_h = new int[mat_vec_data_count];
+	m1_h = (int*)workspace_host_malloc(workspace, (mat_vec_data_count)*sizeof(int));
+	m2_h = (int*)workspace_host_malloc(workspace, (mat_vec_data_count)*sizeof(int));
+	point_map_offsets2_h = (int*)workspace_host_malloc(workspace, (mat_vec_data_count)*sizeof(int));
+	point_map_offsets1_h = (int*)workspace_host_malloc(workspace, (mat_vec_data_count)*sizeof(int));
 	
 	cudaMemcpy(m1_h, m1, mat_vec_data_count*sizeof(int), cudaMemcpyDeviceToHost);
 	cudaMemcpy(m2_h, m2, mat_vec_data_count*sizeof(int), cudaMemcpyDeviceToHost);
@@ -2916,8 +3019,8 @@ void apply_batched_dense_magma(double* x, double* y, struct work_item* mat_vec_d
 //	//------------------------------
 //	// get maximal m1,m2 for padding
 //	//------------------------------
-	int m1_max = thrust::reduce(m1_ptr, m1_ptr+mat_vec_data_count, 0, thrust::maximum<int>());
-	int m2_max = thrust::reduce(m2_ptr, m2_ptr+mat_vec_data_count, 0, thrust::maximum<int>());
+	int m1_max = thrust::reduce(thrust::cuda::par(thrust_allocator), m1_ptr, m1_ptr+mat_vec_data_count, 0, thrust::maximum<int>());
+	int m2_max = thrust::reduce(thrust::cuda::par(thrust_allocator), m2_ptr, m2_ptr+mat_vec_data_count, 0, thrust::maximum<int>());
 
 //	printf("MAX: m1 %d  m2 %d\n", m1_max, m2_max);
 
@@ -2933,8 +3036,8 @@ void apply_batched_dense_magma(double* x, double* y, struct work_item* mat_vec_d
 
 //	printf("fill_batched_matrix %d %d\n",(m1_total*m2_max + (block_size - 1)) / block_size, block_size);
 
-	double** hx_array = new double*[mat_vec_data_count];
-	double** hy_array = new double*[mat_vec_data_count];
+	double** hx_array = (double**)workspace_host_malloc(workspace, (mat_vec_data_count)*sizeof(double*));
+	double** hy_array = (double**)workspace_host_malloc(workspace, (mat_vec_data_count)*sizeof(double*));
 
 //	TIME_ssstop("FILLING.0.1")
 //	TIME_ssstart;
@@ -2946,17 +3049,17 @@ void apply_batched_dense_magma(double* x, double* y, struct work_item* mat_vec_d
 
 
 	int* matrix_offsets;
-	cudaMalloc((void**)&matrix_offsets, (mat_vec_data_count+1)*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&matrix_offsets, (mat_vec_data_count+1)*sizeof(int));
 	thrust::device_ptr<int> matrix_offsets_ptr(matrix_offsets);
 	thrust::multiplies<int> op;
 	thrust::transform(m1_ptr, m1_ptr+mat_vec_data_count, m2_ptr, matrix_offsets_ptr, op);
-	int total_size = reduce(matrix_offsets_ptr, matrix_offsets_ptr+mat_vec_data_count);
-	thrust::exclusive_scan(matrix_offsets_ptr, matrix_offsets_ptr+mat_vec_data_count, matrix_offsets_ptr);
+	int total_size = thrust::reduce(thrust::cuda::par(thrust_allocator), matrix_offsets_ptr, matrix_offsets_ptr+mat_vec_data_count);
+	thrust::exclusive_scan(thrust::cuda::par(thrust_allocator), matrix_offsets_ptr, matrix_offsets_ptr+mat_vec_data_count, matrix_offsets_ptr);
 
 
 
 	double** dA_array;
-	cudaMalloc((void**)&dA_array, mat_vec_data_count*sizeof(double*));
+	workspace_device_malloc(workspace, (void**)&dA_array, mat_vec_data_count*sizeof(double*));
 	
 	set_dA_array<<<(mat_vec_data_count+(block_size-1)) / block_size, block_size>>>(dA_array, hA, mat_vec_data_count, matrix_offsets);
 	cudaThreadSynchronize();
@@ -2967,8 +3070,8 @@ void apply_batched_dense_magma(double* x, double* y, struct work_item* mat_vec_d
 
 	double** dx_array;
 	double** dy_array;
-	cudaMalloc((void**)&dx_array, mat_vec_data_count*sizeof(double*));
-	cudaMalloc((void**)&dy_array, mat_vec_data_count*sizeof(double*));
+	workspace_device_malloc(workspace, (void**)&dx_array, mat_vec_data_count*sizeof(double*));
+	workspace_device_malloc(workspace, (void**)&dy_array, mat_vec_data_count*sizeof(double*));
 
 	checkCUDAError("cudaMalloc");
 	
@@ -2991,7 +3094,7 @@ void apply_batched_dense_magma(double* x, double* y, struct work_item* mat_vec_d
 
 	// allocation of local x (including padding)
         double* local_x;
-        cudaMalloc((void**)&local_x, m2_total*sizeof(double));
+        workspace_device_malloc(workspace, (void**)&local_x, m2_total*sizeof(double));
         checkCUDAError("cudaMalloc");
 
 	// getting pointers
@@ -3018,7 +3121,7 @@ void apply_batched_dense_magma(double* x, double* y, struct work_item* mat_vec_d
 
         // allocation of batched local results
         double* local_y;
-        cudaMalloc((void**)&local_y, m1_total*sizeof(double));
+        workspace_device_malloc(workspace, (void**)&local_y, m1_total*sizeof(double));
         checkCUDAError("cudaMalloc");
 
 	current_pointer = local_y;
@@ -3047,9 +3150,9 @@ void apply_batched_dense_magma(double* x, double* y, struct work_item* mat_vec_d
 	int* incx;
 	int* incy;
 	int* ldda;	
-	cudaMalloc((void**)&incx,sizeof(int)*(mat_vec_data_count+1));
-	cudaMalloc((void**)&incy,sizeof(int)*(mat_vec_data_count+1));
-	cudaMalloc((void**)&ldda,sizeof(int)*(mat_vec_data_count+1));
+	workspace_device_malloc(workspace, (void**)&incx,sizeof(int)*(mat_vec_data_count+1));
+	workspace_device_malloc(workspace, (void**)&incy,sizeof(int)*(mat_vec_data_count+1));
+	workspace_device_malloc(workspace, (void**)&ldda,sizeof(int)*(mat_vec_data_count+1));
 	cudaMemcpy(ldda, m1, mat_vec_data_count*sizeof(int), cudaMemcpyDeviceToDevice);
 	thrust::device_ptr<int> incx_ptr(incx);
 	thrust::device_ptr<int> incy_ptr(incy);
@@ -3072,8 +3175,8 @@ void apply_batched_dense_magma(double* x, double* y, struct work_item* mat_vec_d
         add_batched_local_results_to_full_vector<<<(m1_total + (block_size - 1)) / block_size, block_size>>>(y, local_y, point_map1, work_item_map1, m1_total);
 
 
-        cudaFree(local_x);
-        cudaFree(local_y);
+        workspace_device_free(workspace, local_x);
+        workspace_device_free(workspace, local_y);
 
 //	TIME_ssstop("Update");
 //	TIME_ssstart;
@@ -3084,18 +3187,18 @@ void apply_batched_dense_magma(double* x, double* y, struct work_item* mat_vec_d
 //	cudaFree(matrix_sizes);
 //	cudaFree(matrix_offsets);
 
-	cudaFree(work_item_to_batch_map);
+	workspace_device_free(workspace, work_item_to_batch_map);
 
-	cudaFree(dx_array);
-	cudaFree(dy_array);
-	cudaFree(dA_array);
-	cudaFree(matrix_offsets);
-	cudaFree(incx);
-	cudaFree(incy);
-	cudaFree(ldda);
+	workspace_device_free(workspace, dx_array);
+	workspace_device_free(workspace, dy_array);
+	workspace_device_free(workspace, dA_array);
+	workspace_device_free(workspace, matrix_offsets);
+	workspace_device_free(workspace, incx);
+	workspace_device_free(workspace, incy);
+	workspace_device_free(workspace, ldda);
 
-	delete [] hx_array;
-	delete [] hy_array;
+	workspace_host_free(workspace, hx_array);
+	workspace_host_free(workspace, hy_array);
 
 
 //       {
@@ -3104,24 +3207,24 @@ void apply_batched_dense_magma(double* x, double* y, struct work_item* mat_vec_d
 //        printf("2:   %lf MB of %lf MB available.\n", (double)free_mem/(1024.0*1024.0), (double)total_mem/(1024.0*1024.0));
 //        }
 
-	cudaFree(m1);
-	cudaFree(m2);
-	cudaFree(point_map_offsets1);
-	cudaFree(point_map_offsets2);
+	workspace_device_free(workspace, m1);
+	workspace_device_free(workspace, m2);
+	workspace_device_free(workspace, point_map_offsets1);
+	workspace_device_free(workspace, point_map_offsets2);
 
 
 
 
-	delete [] m1_h;
-	delete [] m2_h;
-	delete [] point_map_offsets1_h;
-	delete [] point_map_offsets2_h;
+	workspace_host_free(workspace, m1_h);
+	workspace_host_free(workspace, m2_h);
+	workspace_host_free(workspace, point_map_offsets1_h);
+	workspace_host_free(workspace, point_map_offsets2_h);
 
 
-	cudaFree(point_map1);
-	cudaFree(point_map2);
-	cudaFree(work_item_map1);
-	cudaFree(work_item_map2);
+	workspace_device_free(workspace, point_map1);
+	workspace_device_free(workspace, point_map2);
+	workspace_device_free(workspace, work_item_map1);
+	workspace_device_free(workspace, work_item_map2);
 	checkCUDAError("cudaFrees a the end of batched ACA");
 
 
@@ -3163,7 +3266,7 @@ void precompute_batched_dense_magma(struct work_item* mat_vec_data, int mat_vec_
 	cudaMalloc((void**)&m2, (mat_vec_data_count+1)*sizeof(int));
 	thrust::device_ptr<int> m1_ptr(m1);
 	thrust::device_ptr<int> m2_ptr(m2);
-	compute_m1_m2(m1, m2, mat_vec_data, mat_vec_data_count, WT_DENSE);
+	compute_m1_m2(m1, m2, mat_vec_data, mat_vec_data_count, WT_DENSE, 0);
 	int m1_total;
 	int m2_total;
 	m1_total = thrust::reduce(m1_ptr, m1_ptr+mat_vec_data_count);
@@ -3214,7 +3317,7 @@ void precompute_batched_dense_magma(struct work_item* mat_vec_data, int mat_vec_
 	thrust::device_ptr<int> work_item_to_batch_map_ptr(work_item_to_batch_map);
 
 
-	create_maps_and_indices(m1, m2, m1_total, m2_total, point_map_offsets1, point_map_offsets2, point_map1, point_map2, work_item_map1, work_item_map2, work_item_to_batch_map, &batch_count, mat_vec_data, mat_vec_data_count, WT_DENSE);
+	create_maps_and_indices(m1, m2, m1_total, m2_total, point_map_offsets1, point_map_offsets2, point_map1, point_map2, work_item_map1, work_item_map2, work_item_to_batch_map, &batch_count, mat_vec_data, mat_vec_data_count, WT_DENSE, 0);
 
 
 	// -----------------------------------------------------
@@ -3342,8 +3445,10 @@ void precompute_batched_dense_magma(struct work_item* mat_vec_data, int mat_vec_
 }
 
 
-void apply_precomputed_batched_aca_magma(double* x, double* y, struct work_item* mat_vec_data, int mat_vec_data_count, struct point_set* input_set1, struct point_set* input_set2, cublasStatus_t stat, cublasHandle_t handle, magma_queue_t* queue, double eta, double epsilon, int k, double* U, double* V)
+void apply_precomputed_batched_aca_magma(double* x, double* y, struct work_item* mat_vec_data, int mat_vec_data_count, struct point_set* input_set1, struct point_set* input_set2, cublasStatus_t stat, cublasHandle_t handle, magma_queue_t* queue, double eta, double epsilon, int k, double* U, double* V, struct mvp_workspace* workspace)
 {
+	workspace_thrust_allocator thrust_allocator(workspace);
+
 	int block_size = 512;
 
 	if (mat_vec_data_count==0)
@@ -3365,15 +3470,15 @@ void apply_precomputed_batched_aca_magma(double* x, double* y, struct work_item*
 	// ------------------------
 	int* m1;
 	int* m2;
-	cudaMalloc((void**)&m1, (mat_vec_data_count+1)*sizeof(int));
-	cudaMalloc((void**)&m2, (mat_vec_data_count+1)*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&m1, (mat_vec_data_count+1)*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&m2, (mat_vec_data_count+1)*sizeof(int));
 	thrust::device_ptr<int> m1_ptr(m1);
 	thrust::device_ptr<int> m2_ptr(m2);
-	compute_m1_m2(m1, m2, mat_vec_data, mat_vec_data_count, WT_ACA);
+	compute_m1_m2(m1, m2, mat_vec_data, mat_vec_data_count, WT_ACA, workspace);
 	int m1_total;
 	int m2_total;
-	m1_total = thrust::reduce(m1_ptr, m1_ptr+mat_vec_data_count);
-	m2_total = thrust::reduce(m2_ptr, m2_ptr+mat_vec_data_count);
+	m1_total = thrust::reduce(thrust::cuda::par(thrust_allocator), m1_ptr, m1_ptr+mat_vec_data_count);
+	m2_total = thrust::reduce(thrust::cuda::par(thrust_allocator), m2_ptr, m2_ptr+mat_vec_data_count);
 
 
 	// -------------------------------
@@ -3389,13 +3494,13 @@ void apply_precomputed_batched_aca_magma(double* x, double* y, struct work_item*
 	int* work_item_map2; // map of rows of V to work item indices in mat_vec_data
 	int* work_item_to_batch_map;  // map between work item list (including invalid entries) and batch set list (without invalid entries)
 
-	cudaMalloc((void**)&point_map_offsets1, mat_vec_data_count*sizeof(int));
-	cudaMalloc((void**)&point_map_offsets2, mat_vec_data_count*sizeof(int));
-	cudaMalloc((void**)&point_map1, m1_total*sizeof(int));
-	cudaMalloc((void**)&point_map2, m2_total*sizeof(int));
-	cudaMalloc((void**)&work_item_map1, m1_total*sizeof(int));
-	cudaMalloc((void**)&work_item_map2, m2_total*sizeof(int));
-	cudaMalloc((void**)&work_item_to_batch_map, mat_vec_data_count*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&point_map_offsets1, mat_vec_data_count*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&point_map_offsets2, mat_vec_data_count*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&point_map1, m1_total*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&point_map2, m2_total*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&work_item_map1, m1_total*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&work_item_map2, m2_total*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&work_item_to_batch_map, mat_vec_data_count*sizeof(int));
 
 	thrust::device_ptr<int> point_map_offsets1_ptr(point_map_offsets1);
 	thrust::device_ptr<int> point_map_offsets2_ptr(point_map_offsets2);
@@ -3405,7 +3510,7 @@ void apply_precomputed_batched_aca_magma(double* x, double* y, struct work_item*
 	thrust::device_ptr<int> work_item_map2_ptr(work_item_map2);
 	thrust::device_ptr<int> work_item_to_batch_map_ptr(work_item_to_batch_map);
 
-	create_maps_and_indices(m1, m2, m1_total, m2_total, point_map_offsets1, point_map_offsets2, point_map1, point_map2, work_item_map1, work_item_map2, work_item_to_batch_map, &batch_count, mat_vec_data, mat_vec_data_count, WT_ACA);
+	create_maps_and_indices(m1, m2, m1_total, m2_total, point_map_offsets1, point_map_offsets2, point_map1, point_map2, work_item_map1, work_item_map2, work_item_to_batch_map, &batch_count, mat_vec_data, mat_vec_data_count, WT_ACA, workspace);
 
 
 	// -----------------------------------------------------
@@ -3416,10 +3521,10 @@ void apply_precomputed_batched_aca_magma(double* x, double* y, struct work_item*
 	int* point_map_offsets2_h;
 	int* point_map_offsets1_h;
 	
-	m1_h = new int[mat_vec_data_count];
-	m2_h = new int[mat_vec_data_count];
-	point_map_offsets2_h = new int[mat_vec_data_count];
-	point_map_offsets1_h = new int[mat_vec_data_count];
+	m1_h = (int*)workspace_host_malloc(workspace, (mat_vec_data_count)*sizeof(int));
+	m2_h = (int*)workspace_host_malloc(workspace, (mat_vec_data_count)*sizeof(int));
+	point_map_offsets2_h = (int*)workspace_host_malloc(workspace, (mat_vec_data_count)*sizeof(int));
+	point_map_offsets1_h = (int*)workspace_host_malloc(workspace, (mat_vec_data_count)*sizeof(int));
 	
 	cudaMemcpy(m1_h, m1, mat_vec_data_count*sizeof(int), cudaMemcpyDeviceToHost);
 	cudaMemcpy(m2_h, m2, mat_vec_data_count*sizeof(int), cudaMemcpyDeviceToHost);
@@ -3432,7 +3537,7 @@ void apply_precomputed_batched_aca_magma(double* x, double* y, struct work_item*
 	// compute the "k" per batch
 	//--------------------------
 	int* k_per_item;
-	cudaMalloc((void**)&k_per_item, (mat_vec_data_count+1)*sizeof(int));
+	workspace_device_malloc(workspace, (void**)&k_per_item, (mat_vec_data_count+1)*sizeof(int));
 	thrust::device_ptr<int> k_per_item_ptr(k_per_item);
 	// if (k>min(m,n))
 	//     k= min(m,n);
@@ -3445,8 +3550,8 @@ void apply_precomputed_batched_aca_magma(double* x, double* y, struct work_item*
 	//-----------------------------
 	// set upper bound for global k
 	//-----------------------------
-	int m1_max = thrust::reduce(m1_ptr, m1_ptr+mat_vec_data_count, 0, thrust::maximum<int>());
-	int m2_max = thrust::reduce(m2_ptr, m2_ptr+mat_vec_data_count, 0, thrust::maximum<int>());
+	int m1_max = thrust::reduce(thrust::cuda::par(thrust_allocator), m1_ptr, m1_ptr+mat_vec_data_count, 0, thrust::maximum<int>());
+	int m2_max = thrust::reduce(thrust::cuda::par(thrust_allocator), m2_ptr, m2_ptr+mat_vec_data_count, 0, thrust::maximum<int>());
 	if (k>min(m1_max, m2_max))
 	{
 		k = min(m1_max, m2_max);
@@ -3469,14 +3574,14 @@ void apply_precomputed_batched_aca_magma(double* x, double* y, struct work_item*
 //        printf("2:   %lf MB of %lf MB available.\n", (double)free_mem/(1024.0*1024.0), (double)total_mem/(1024.0*1024.0));
 //        }
 
-	cudaFree(work_item_to_batch_map);
-	cudaFree(point_map_offsets1);
-	cudaFree(point_map_offsets2);
+	workspace_device_free(workspace, work_item_to_batch_map);
+	workspace_device_free(workspace, point_map_offsets1);
+	workspace_device_free(workspace, point_map_offsets2);
 
 //	TIME_sssstart;
 
 	// apply low-rank matrix-vector product
-	batched_low_rank_mvp_magma(x, y, U, V, m1_total, m2_total, m1, m2, mat_vec_data_count, batch_count, k, k_per_item, stat, handle, queue, point_map_offsets1_h, point_map_offsets2_h, point_map1, point_map2, work_item_map1 );
+	batched_low_rank_mvp_magma(x, y, U, V, m1_total, m2_total, m1, m2, mat_vec_data_count, batch_count, k, k_per_item, stat, handle, queue, point_map_offsets1_h, point_map_offsets2_h, point_map1, point_map2, work_item_map1, workspace );
 
 //	TIME_sssstop("batched_low_rank_mvp");
 
@@ -3486,19 +3591,19 @@ void apply_precomputed_batched_aca_magma(double* x, double* y, struct work_item*
 //		cudaStreamDestroy(streams[b]);
 //	delete[] streams;
 
-	delete [] m1_h;
-	delete [] m2_h;
-	delete [] point_map_offsets1_h;
-	delete [] point_map_offsets2_h;
+	workspace_host_free(workspace, m1_h);
+	workspace_host_free(workspace, m2_h);
+	workspace_host_free(workspace, point_map_offsets1_h);
+	workspace_host_free(workspace, point_map_offsets2_h);
 
-	cudaFree(m1);
-	cudaFree(m2);
+	workspace_device_free(workspace, m1);
+	workspace_device_free(workspace, m2);
 
-	cudaFree(k_per_item);
-	cudaFree(point_map1);
-	cudaFree(point_map2);
-	cudaFree(work_item_map1);
-	cudaFree(work_item_map2);
+	workspace_device_free(workspace, k_per_item);
+	workspace_device_free(workspace, point_map1);
+	workspace_device_free(workspace, point_map2);
+	workspace_device_free(workspace, work_item_map1);
+	workspace_device_free(workspace, work_item_map2);
 	checkCUDAError("cudaFrees a the end of batched ACA");
 
 
@@ -3537,7 +3642,7 @@ void apply_precomputed_batched_aca(double* x, double* y, struct work_item* mat_v
 	cudaMalloc((void**)&m2, mat_vec_data_count*sizeof(int));
 	thrust::device_ptr<int> m1_ptr(m1);
 	thrust::device_ptr<int> m2_ptr(m2);
-	compute_m1_m2(m1, m2, mat_vec_data, mat_vec_data_count, WT_ACA);
+	compute_m1_m2(m1, m2, mat_vec_data, mat_vec_data_count, WT_ACA, 0);
 	int m1_total;
 	int m2_total;
 	m1_total = thrust::reduce(m1_ptr, m1_ptr+mat_vec_data_count);
@@ -3573,7 +3678,7 @@ void apply_precomputed_batched_aca(double* x, double* y, struct work_item* mat_v
 	thrust::device_ptr<int> work_item_map2_ptr(work_item_map2);
 	thrust::device_ptr<int> work_item_to_batch_map_ptr(work_item_to_batch_map);
 
-	create_maps_and_indices(m1, m2, m1_total, m2_total, point_map_offsets1, point_map_offsets2, point_map1, point_map2, work_item_map1, work_item_map2, work_item_to_batch_map, &batch_count, mat_vec_data, mat_vec_data_count, WT_ACA);
+	create_maps_and_indices(m1, m2, m1_total, m2_total, point_map_offsets1, point_map_offsets2, point_map1, point_map2, work_item_map1, work_item_map2, work_item_to_batch_map, &batch_count, mat_vec_data, mat_vec_data_count, WT_ACA, 0);
 
 
 	// -----------------------------------------------------
@@ -3646,7 +3751,7 @@ void apply_precomputed_batched_aca(double* x, double* y, struct work_item* mat_v
 	TIME_sssstart;
 
 	// apply low-rank matrix-vector product
-	batched_low_rank_mvp(x, y, U, V, m1_total, m2_total, m1_h, m2_h, mat_vec_data_count, batch_count, k, k_per_item, stat, handle , point_map_offsets1_h, point_map_offsets2_h, point_map1, point_map2, work_item_map1 );
+	batched_low_rank_mvp(x, y, U, V, m1_total, m2_total, m1_h, m2_h, mat_vec_data_count, batch_count, k, k_per_item, stat, handle , point_map_offsets1_h, point_map_offsets2_h, point_map1, point_map2, work_item_map1, 0 );
 
 	TIME_sssstop("batched_low_rank_mvp");
 
@@ -3707,7 +3812,7 @@ void precompute_batched_aca(struct work_item* mat_vec_data, int mat_vec_data_cou
 	cudaMalloc((void**)&m2, mat_vec_data_count*sizeof(int));
 	thrust::device_ptr<int> m1_ptr(m1);
 	thrust::device_ptr<int> m2_ptr(m2);
-	compute_m1_m2(m1, m2, mat_vec_data, mat_vec_data_count, WT_ACA);
+	compute_m1_m2(m1, m2, mat_vec_data, mat_vec_data_count, WT_ACA, 0);
 	int m1_total;
 	int m2_total;
 	m1_total = thrust::reduce(m1_ptr, m1_ptr+mat_vec_data_count);
@@ -3743,7 +3848,7 @@ void precompute_batched_aca(struct work_item* mat_vec_data, int mat_vec_data_cou
 	thrust::device_ptr<int> work_item_map2_ptr(work_item_map2);
 	thrust::device_ptr<int> work_item_to_batch_map_ptr(work_item_to_batch_map);
 
-	create_maps_and_indices(m1, m2, m1_total, m2_total, point_map_offsets1, point_map_offsets2, point_map1, point_map2, work_item_map1, work_item_map2, work_item_to_batch_map, &batch_count, mat_vec_data, mat_vec_data_count, WT_ACA);
+	create_maps_and_indices(m1, m2, m1_total, m2_total, point_map_offsets1, point_map_offsets2, point_map1, point_map2, work_item_map1, work_item_map2, work_item_to_batch_map, &batch_count, mat_vec_data, mat_vec_data_count, WT_ACA, 0);
 
 
 	// -----------------------------------------------------
@@ -3919,7 +4024,7 @@ void precompute_batched_aca(struct work_item* mat_vec_data, int mat_vec_data_cou
 		thrust::replace_if(stop_full_aca_for_batch_ptr, stop_full_aca_for_batch_ptr+mat_vec_data_count, k_per_item_ptr, ser, true);
 
 
-		compute_current_batched_v_r(v_r, *U, *V, m1_total, m2_total, mat_vec_data, mat_vec_data_count, search_for_new_v_r, i_r, point_map1, point_map2, point_map_offsets1, point_map_offsets2, work_item_map2, input_set1, input_set2, k_per_item, m1, r, assem, k, stop_full_aca_for_batch);
+		compute_current_batched_v_r(v_r, *U, *V, m1_total, m2_total, mat_vec_data, mat_vec_data_count, search_for_new_v_r, i_r, point_map1, point_map2, point_map_offsets1, point_map_offsets2, work_item_map2, input_set1, input_set2, k_per_item, m1, r, assem, k, stop_full_aca_for_batch, 0);
 
 
 		//// [m,j_r] = max(abs(v_tilde_r));
@@ -3931,7 +4036,7 @@ void precompute_batched_aca(struct work_item* mat_vec_data, int mat_vec_data_cou
 		checkCUDAError("cudaMalloc");
 		thrust::device_ptr<int> j_r_global_ptr(j_r_global);
 
-		compute_current_batched_u_r(u_r, v_r, *U, *V, m1_total, m2_total, mat_vec_data, mat_vec_data_count, point_map1, point_map2, work_item_map1, work_item_map2, input_set1, input_set2, k_per_item, j_r_global, work_item_to_batch_map, r, assem, stop_full_aca_for_batch);
+		compute_current_batched_u_r(u_r, v_r, *U, *V, m1_total, m2_total, mat_vec_data, mat_vec_data_count, point_map1, point_map2, work_item_map1, work_item_map2, input_set1, input_set2, k_per_item, j_r_global, work_item_to_batch_map, r, assem, stop_full_aca_for_batch, 0);
 
 
 		cudaFree(j_r_global);
@@ -4048,6 +4153,7 @@ void organize_mat_vec_data(struct work_item* mat_vec_data, int mat_vec_data_coun
 
 	mat_vec_info->total_count = mat_vec_data_count;
 
+	mat_vec_info->symmetric = 0;
 }
 
 __global__ void linear_algebra_get_point_count_dim(int* point_count, int* dim, struct point_set* input_set1)
@@ -4289,68 +4395,227 @@ void precompute_work_sizes(int** dense_work_size, int** aca_work_size, int* dens
 
 
 
-void h_matrix_mvp(double* x, double* y, struct work_item* mat_vec_data, struct mat_vec_data_info* mat_vec_info, struct point_set* input_set1, struct point_set* input_set2, double eta, double epsilon, int k, double* dA, double* U, double* V, struct system_assembler* assem, int max_batched_dense_size, double dense_batching_ratio, int max_batched_aca_size, magma_queue_t magma_queue, int* dense_work_size, int* aca_work_size, int dense_batch_count, int aca_batch_count, bool use_precomputed_aca, bool use_precomputed_dense)
+static void* gpu_workspace_malloc(size_t size)
 {
-    cublasStatus_t stat;
-    cublasHandle_t handle;
-    stat = cublasCreate(&handle);
+	void* p;
+	cudaMalloc(&p, size);
+	checkCUDAError("cudaMalloc of workspace");
+	return p;
+}
 
-	// set output vector to zero
+static void gpu_workspace_free(void* p)
+{
+	cudaFree(p);
+}
 
-		// very dirty way to get point count and dimensionality of points
-		int point_count_1,dim;
-		int* point_count_1_d; cudaMalloc((void**)&point_count_1_d, sizeof(int));
-		int* dim_d; cudaMalloc((void**)&dim_d, sizeof(int));
-		linear_algebra_get_point_count_dim<<<1,1>>>(point_count_1_d, dim_d, input_set1);
-		cudaMemcpy(&point_count_1, point_count_1_d, sizeof(int), cudaMemcpyDeviceToHost);
-		cudaMemcpy(&dim, dim_d, sizeof(int), cudaMemcpyDeviceToHost);
-		cudaFree(point_count_1_d); cudaFree(dim_d);
+static void* staging_workspace_malloc(size_t size)
+{
+	void* p = malloc(size);
+	if (p==0)
+	{
+		printf("Could not allocate %lu bytes of staging memory. Exiting...\n", (unsigned long)size);
+		exit(1);
+	}
+	return p;
+}
+
+static void staging_workspace_free(void* p)
+{
+	free(p);
+}
+
+void init_mvp_workspace_on_gpu(struct mvp_workspace* workspace, struct point_set* input_set1, size_t device_size)
+{
+	init_mvp_workspace(workspace, 0);
+	init_workspace_arena(&workspace->device_arena, gpu_workspace_malloc, gpu_workspace_free);
+	init_workspace_arena(&workspace->staging_arena, staging_workspace_malloc, staging_workspace_free);
+
+	cublasHandle_t handle;
+	cublasCreate(&handle);
+	workspace->cublas_handle = (void*)handle;
+	workspace->other_allocations++;
+
+	// very dirty way to get point count and dimensionality of points, done once here instead of in every MVP
+	int* point_count_1_d; cudaMalloc((void**)&point_count_1_d, sizeof(int));
+	int* dim_d; cudaMalloc((void**)&dim_d, sizeof(int));
+	linear_algebra_get_point_count_dim<<<1,1>>>(point_count_1_d, dim_d, input_set1);
+	cudaMemcpy(&(workspace->point_count_1), point_count_1_d, sizeof(int), cudaMemcpyDeviceToHost);
+	cudaMemcpy(&(workspace->dim), dim_d, sizeof(int), cudaMemcpyDeviceToHost);
+	cudaFree(point_count_1_d); cudaFree(dim_d);
+	workspace->other_allocations += 2;
+	checkCUDAError("init_mvp_workspace_on_gpu");
+
+	reserve_workspace_arena(&workspace->device_arena, device_size);
+}
+
+// upper bound of the device scratch memory of one batch of count work items with m1_total rows and m2_total columns
+// in total (index maps, low rank factors, local vectors and temporary storage of the thrust algorithms)
+static size_t batch_device_workspace_bound(int count, int m1_total, int m2_total, int k)
+{
+	size_t ints = 24*(size_t)(count+1) + 3*((size_t)m1_total+(size_t)m2_total);
+	size_t doubles = ((size_t)m1_total+(size_t)m2_total)*(k+4) + (size_t)count*(k+4);
+	size_t pointers = 8*(size_t)(count+1);
+	size_t thrust_storage = ((size_t)count+(size_t)m1_total+(size_t)m2_total)*sizeof(double) + 1048576;
+
+	// every block of the arena is padded to WORKSPACE_ALIGNMENT
+	return ints*sizeof(int) + doubles*sizeof(double) + pointers*sizeof(double*) + thrust_storage + 64*WORKSPACE_ALIGNMENT;
+}
+
+// upper bound of the staging memory of one batch of count work items
+static size_t batch_staging_workspace_bound(int count)
+{
+	return 8*(size_t)(count+1)*(sizeof(int)+sizeof(double*)) + 16*WORKSPACE_ALIGNMENT;
+}
+
+static void sum_batch_sizes(struct work_item* mat_vec_data_h, int first, int count, int* m1_total, int* m2_total)
+{
+	*m1_total = 0;
+	*m2_total = 0;
+	for (int i=first; i<first+count; i++)
+	{
+		*m1_total += mat_vec_data_h[i].set1_u-mat_vec_data_h[i].set1_l+1;
+		*m2_total += mat_vec_data_h[i].set2_u-mat_vec_data_h[i].set2_l+1;
+	}
+}
+
+void reserve_mvp_workspace_on_gpu(struct mvp_workspace* workspace, struct work_item* mat_vec_data, struct mat_vec_data_info* mat_vec_info, int k, int max_batched_dense_size, int* dense_work_size, int* aca_work_size, int dense_batch_count, int aca_batch_count, bool use_precomputed_aca, bool use_precomputed_dense)
+{
+	struct work_item* mat_vec_data_h = new struct work_item[mat_vec_info->dense_count+mat_vec_info->aca_count];
+
+	cudaMemcpy(mat_vec_data_h, mat_vec_data, (mat_vec_info->dense_count+mat_vec_info->aca_count)*sizeof(struct work_item), cudaMemcpyDeviceToHost);
+
+	int m1_total, m2_total;
+	size_t dense_size = 0;
+	size_t aca_size = 0;
+	size_t staging_size = 0;
+
+	// dense phase; the buffer for on-the-fly dense blocks stays allocated during all dense batches
+	int dense_batches = use_precomputed_dense ? 1 : dense_batch_count;
+	int current_dense_work_item_index = 0;
+	for (int b = 0; b<dense_batches; b++)
+	{
+		if (dense_work_size[b]>0)
+		{
+			sum_batch_sizes(mat_vec_data_h, current_dense_work_item_index, dense_work_size[b], &m1_total, &m2_total);
+			dense_size = thrust::max(dense_size, batch_device_workspace_bound(dense_work_size[b], m1_total, m2_total, k));
+			staging_size = thrust::max(staging_size, batch_staging_workspace_bound(dense_work_size[b]));
+			current_dense_work_item_index += dense_work_size[b];
+		}
+	}
+	if (!use_precomputed_dense)
+		dense_size += (size_t)max_batched_dense_size*sizeof(double) + WORKSPACE_ALIGNMENT;
+
+	// low rank phase; precomputed low rank blocks are applied in a single batch
+	if (use_precomputed_aca)
+	{
+		sum_batch_sizes(mat_vec_data_h, mat_vec_info->dense_count, mat_vec_info->aca_count, &m1_total, &m2_total);
+		aca_size = batch_device_workspace_bound(mat_vec_info->aca_count, m1_total, m2_total, k);
+		staging_size = thrust::max(staging_size, batch_staging_workspace_bound(mat_vec_info->aca_count));
+	}
+	else
+	{
+		int current_aca_work_item_index = mat_vec_info->dense_count;
+		for (int b = 0; b<aca_batch_count; b++)
+		{
+			if (aca_work_size[b]>0)
+			{
+				sum_batch_sizes(mat_vec_data_h, current_aca_work_item_index, aca_work_size[b], &m1_total, &m2_total);
+				aca_size = thrust::max(aca_size, batch_device_workspace_bound(aca_work_size[b], m1_total, m2_total, k));
+				staging_size = thrust::max(staging_size, batch_staging_workspace_bound(aca_work_size[b]));
+				current_aca_work_item_index += aca_work_size[b];
+			}
+		}
+	}
+
+	delete [] mat_vec_data_h;
+
+	reserve_workspace_arena(&workspace->device_arena, thrust::max(dense_size, aca_size));
+	reserve_workspace_arena(&workspace->staging_arena, staging_size);
+}
+
+void destroy_mvp_workspace_on_gpu(struct mvp_workspace* workspace)
+{
+	if (workspace->cublas_handle!=0)
+		cublasDestroy((cublasHandle_t)workspace->cublas_handle);
+
+	destroy_mvp_workspace(workspace);
+}
+
+void h_matrix_mvp(double* x, double* y, struct work_item* mat_vec_data, struct mat_vec_data_info* mat_vec_info, struct point_set* input_set1, struct point_set* input_set2, double eta, double epsilon, int k, double* dA, double* U, double* V, struct system_assembler* assem, int max_batched_dense_size, double dense_batching_ratio, int max_batched_aca_size, magma_queue_t magma_queue, int* dense_work_size, int* aca_work_size, int dense_batch_count, int aca_batch_count, bool use_precomputed_aca, bool use_precomputed_dense, struct mvp_workspace* workspace)
+{
+	// without a persistent workspace, a temporary one is used
+	struct mvp_workspace temporary_workspace;
+	if (workspace==0)
+	{
+		init_mvp_workspace_on_gpu(&temporary_workspace, input_set1, 0);
+		workspace = &temporary_workspace;
+	}
+
+	begin_mvp_workspace_use(workspace);
+
+    cublasStatus_t stat = CUBLAS_STATUS_SUCCESS;
+    cublasHandle_t handle = (cublasHandle_t)workspace->cublas_handle;
+
+	// set output vector to zero
+	int point_count_1 = workspace->point_count_1;
 
 	thrust::device_ptr<double> y_ptr(y);
 	thrust::fill(y_ptr, y_ptr+point_count_1, 0.0);
 
 
-	TIME_ssstart;
+	// the phases of the MVP are synchronized only if they are profiled
+	struct h_matrix_profile* profile = workspace->profile;
+	if (profile!=0)
+	{
+		cudaDeviceSynchronize();
+		profile_phase_begin(profile, PROFILE_MVP_DENSE);
+	}
 
 	int current_dense_work_item_index = 0;
 
 	if (use_precomputed_dense)
 	{
-		apply_batched_dense_magma(x, y, &mat_vec_data[current_dense_work_item_index], dense_work_size[0], input_set1, input_set2, stat, handle, assem, &magma_queue, dA, true);
+		apply_batched_dense_magma(x, y, &mat_vec_data[current_dense_work_item_index], dense_work_size[0], input_set1, input_set2, stat, handle, assem, &magma_queue, dA, true, workspace);
 
 	}
 	else
 	{
-		cudaMalloc((void**)&dA, sizeof(double)*max_batched_dense_size);  // Actually this does not allocate dA such that it is accessible
-										 // by data->dA. However dA will be freed immediately anyway
+		workspace_device_malloc(workspace, (void**)&dA, sizeof(double)*max_batched_dense_size);  // Actually this does not allocate dA such that it is accessible
+										 // by data->dA. However dA will be given back immediately anyway
 	
 		for (int b = 0; b<dense_batch_count; b++)
 		{
 			if (dense_work_size[b]>0)
 			{
-				apply_batched_dense_magma(x, y, &mat_vec_data[current_dense_work_item_index], dense_work_size[b], input_set1, input_set2, stat, handle, assem, &magma_queue, dA, false);
+				// scratch memory of a batch is reused by the next batch
+				size_t batch_mark = workspace_device_mark(workspace);
+
+				apply_batched_dense_magma(x, y, &mat_vec_data[current_dense_work_item_index], dense_work_size[b], input_set1, input_set2, stat, handle, assem, &magma_queue, dA, false, workspace);
+
+				workspace_device_release(workspace, batch_mark);
 	
 				current_dense_work_item_index += dense_work_size[b];	
 			}
 		
 	        }
 
-		cudaFree(dA);
+		workspace_device_free(workspace, dA);
 	}
 
 
-	TIME_ssstop("dense blocks");
-
-
-	TIME_ssstart;
+	if (profile!=0)
+	{
+		cudaDeviceSynchronize();
+		profile_phase_end(profile, PROFILE_MVP_DENSE);
+		profile_phase_begin(profile, PROFILE_MVP_LOW_RANK);
+	}
 
 
 	if (use_precomputed_aca)
 	{
 		thrust::device_ptr<struct work_item> mat_vec_data_ptr(mat_vec_data);
-		thrust::device_ptr<struct work_item> dense_end_ptr = thrust::partition_point(mat_vec_data_ptr, mat_vec_data_ptr+mat_vec_info->total_count, is_not_WT_ACA());
 	
-		apply_precomputed_batched_aca_magma(x, y, &mat_vec_data[mat_vec_info->dense_count], mat_vec_info->aca_count, input_set1, input_set2, stat, handle, &magma_queue, eta, epsilon, k, U, V);
+		apply_precomputed_batched_aca_magma(x, y, &mat_vec_data[mat_vec_info->dense_count], mat_vec_info->aca_count, input_set1, input_set2, stat, handle, &magma_queue, eta, epsilon, k, U, V, workspace);
 	}
 	else
 	{
@@ -4362,7 +4627,11 @@ void h_matrix_mvp(double* x, double* y, struct work_item* mat_vec_data, struct m
 		{
 			if (aca_work_size[b] > 0)
 			{
-				apply_batched_aca(x, y, &mat_vec_data[current_aca_work_item_index], aca_work_size[b], input_set1, input_set2, stat, handle, eta, epsilon, k, assem);
+				size_t batch_mark = workspace_device_mark(workspace);
+
+				apply_batched_aca(x, y, &mat_vec_data[current_aca_work_item_index], aca_work_size[b], input_set1, input_set2, stat, handle, eta, epsilon, k, assem, workspace);
+
+				workspace_device_release(workspace, batch_mark);
 	
 				current_aca_work_item_index += aca_work_size[b];	
 			}
@@ -4372,10 +4641,17 @@ void h_matrix_mvp(double* x, double* y, struct work_item* mat_vec_data, struct m
 
 
 
-	TIME_ssstop("ACA blocks");
+	if (profile!=0)
+	{
+		cudaDeviceSynchronize();
+		profile_phase_end(profile, PROFILE_MVP_LOW_RANK);
+		profile->last_mvp_rhs = 1;
+	}
+
+	end_mvp_workspace_use(workspace);
 
-    
-	cublasDestroy(handle);
+	if (workspace==&temporary_workspace)
+		destroy_mvp_workspace_on_gpu(&temporary_workspace);
 }
 
 
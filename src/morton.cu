@@ -106,6 +106,12 @@ __global__ void get_morton_code_kernel(struct point_set* points, struct morton_c
 		
 }
 
+int get_morton_code_is_supported(int dim, int bits)
+{
+	// these are the cases covered by stretch
+	return ((dim==3)&&(bits==20)) || ((dim==2)&&(bits==32)) || ((dim==10)&&(bits==4));
+}
+
 void get_morton_code(struct point_set* points, struct morton_code* morton, int grid_size, int block_size)
 {
 	get_morton_code_kernel<<<grid_size, block_size>>>(points, morton);
@@ -42,7 +42,17 @@ struct morton_code
 	
 #define MAX_DIM 20
 
+// cluster tree construction (BACKEND_HOST): the points are sorted by 64 bit cluster keys and every cluster is split
+// at the first bit in which the keys of its points differ
+#define CLUSTERING_MORTON 0	// Z order curve, every dimension scaled to [0,1] (default)
+#define CLUSTERING_HILBERT 1	// Hilbert curve, all dimensions scaled by the same factor
+#define CLUSTERING_MEDIAN 2	// bisection at the median along the longest edge of the bounding box
+#define CLUSTERING_PCA 3	// bisection at the median along the principal axis of the points
+
 	
+// returns whether the GPU Morton code generation supports the given dim / bits combination
+extern int get_morton_code_is_supported(int dim, int bits);
+
 extern void get_morton_code(struct point_set* points, struct morton_code* morton, int grid_size, int block_size);
 
 #endif
@@ -73,6 +73,8 @@ int main( int argc, char* argv[])
 		bits = 32;
 	else if (dim==3)
 		bits = 20;
+	else if ((dim>=1)&&(dim<=MAX_POINT_DIMENSION))
+		bits = min(32, 64/dim);
 	else
 	{
 		printf("Dimension %d is not supported. Exiting...\n", dim);
@@ -0,0 +1,300 @@
+// Copyright (C) 2016 Peter Zaspel
+//
+// This file is part of hmglib.
+//
+// hmglib is free software: you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// hmglib is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hmglib.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include <algorithm>
+
+#include "profiling.h"
+
+static const char* profile_phase_names[PROFILE_PHASE_COUNT] = { "minmax", "morton_encoding", "sort", "point_reorder", "tree_traversal", "organize", "batching", "aca", "recompression", "dense_assembly", "mvp", "mvp_dense", "mvp_low_rank", "vector_reorder", "factorization" };
+
+void init_h_matrix_profile(struct h_matrix_profile* profile, const char* json_file_name)
+{
+	memset(profile, 0, sizeof(struct h_matrix_profile));
+
+	profile->aca_iterations = -1;
+
+	if (json_file_name!=0)
+	{
+		profile->json_file_name = new char[strlen(json_file_name)+1];
+		strcpy(profile->json_file_name, json_file_name);
+	}
+}
+
+void destroy_h_matrix_profile(struct h_matrix_profile* profile)
+{
+	delete [] profile->rank_histogram;
+	delete [] profile->json_file_name;
+
+	memset(profile, 0, sizeof(struct h_matrix_profile));
+}
+
+void reset_h_matrix_profile(struct h_matrix_profile* profile)
+{
+	for (int p=0; p<PROFILE_PHASE_COUNT; p++)
+	{
+		profile->phase_seconds[p] = 0.0;
+		profile->phase_calls[p] = 0;
+	}
+	profile->traversal_level_count = 0;
+	for (int l=0; l<PROFILE_MAX_LEVELS; l++)
+		profile->traversal_level_seconds[l] = 0.0;
+	profile->last_mvp_seconds = 0.0;
+	profile->last_mvp_rhs = 0;
+	profile->mvp_thread_imbalance = 0.0;
+	profile->mvp_predicted_imbalance = 0.0;
+}
+
+double profile_wall_time()
+{
+	return omp_get_wtime();
+}
+
+void profile_phase_begin(struct h_matrix_profile* profile, int phase)
+{
+	if (profile==0)
+		return;
+
+	profile->phase_begin[phase] = profile_wall_time();
+}
+
+void profile_phase_end(struct h_matrix_profile* profile, int phase)
+{
+	if (profile==0)
+		return;
+
+	double seconds = profile_wall_time() - profile->phase_begin[phase];
+	profile_add_phase_seconds(profile, phase, seconds);
+
+	if (phase==PROFILE_MVP)
+		profile->last_mvp_seconds = seconds;
+}
+
+void profile_add_phase_seconds(struct h_matrix_profile* profile, int phase, double seconds)
+{
+	if (profile==0)
+		return;
+
+	profile->phase_seconds[phase] += seconds;
+	profile->phase_calls[phase]++;
+}
+
+void profile_add_traversal_level_seconds(struct h_matrix_profile* profile, double* level_seconds, int level_count)
+{
+	if (profile==0)
+		return;
+
+	level_count = std::min(level_count, PROFILE_MAX_LEVELS);
+	for (int l=0; l<level_count; l++)
+		profile->traversal_level_seconds[l] += level_seconds[l];
+	profile->traversal_level_count = std::max(profile->traversal_level_count, level_count);
+}
+
+void profile_block_statistics(struct h_matrix_profile* profile, struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, int* k_per_item, size_t* dA_offsets, char* block_precision, int uniform_rank, int k, bool dense_is_stored, bool aca_is_stored)
+{
+	profile->level_count = 0;
+	for (int l=0; l<PROFILE_MAX_LEVELS; l++)
+	{
+		profile->dense_per_level[l] = 0;
+		profile->aca_per_level[l] = 0;
+	}
+	profile->dense_entries = 0;
+	profile->aca_entries = 0;
+	profile->flops_per_mvp = 0.0;
+	profile->vector_bytes_per_mvp = 0.0;
+	profile->stored_bytes_per_mvp = 0.0;
+	profile->bytes_stored = block_list_size(blocks);
+
+	// ranks of the ACA blocks (if known)
+	int max_rank = -1;
+	if (k_per_item!=0)
+	{
+		for (int a=0; a<mat_vec_info->aca_count; a++)
+			if (k_per_item[a]>max_rank)
+				max_rank = k_per_item[a];
+	}
+	else if (uniform_rank>0)
+		max_rank = uniform_rank;
+
+	delete [] profile->rank_histogram;
+	profile->rank_histogram = 0;
+	profile->rank_histogram_size = 0;
+	if (max_rank>=0)
+	{
+		profile->rank_histogram_size = max_rank+1;
+		profile->rank_histogram = new long[max_rank+1];
+		memset(profile->rank_histogram, 0, (max_rank+1)*sizeof(long));
+	}
+
+	for (int i=0; i<mat_vec_info->total_count; i++)
+	{
+		struct block_item item = get_block_item(blocks, i);
+		long m1 = item.set1_u-item.set1_l+1;
+		long m2 = item.set2_u-item.set2_l+1;
+
+		int level = blocks->clusters.level[blocks->cluster1[i]];
+		if (level>=PROFILE_MAX_LEVELS)
+			level = PROFILE_MAX_LEVELS-1;
+		if (level+1>profile->level_count)
+			profile->level_count = level+1;
+
+		// a mirrored block of a symmetric partition is applied twice, but stored once
+		long copies = is_mirrored_block(&item, mat_vec_info) ? 2 : 1;
+
+		int precision = (block_precision!=0) ? block_precision[i] : BLOCK_PRECISION_DOUBLE;
+
+		// every block reads its part of x and reads / writes its part of y
+		profile->vector_bytes_per_mvp += (double)copies*(m2+2*m1)*sizeof(double);
+
+		if (i<mat_vec_info->dense_count)
+		{
+			profile->dense_per_level[level]++;
+			profile->dense_entries += copies*m1*m2;
+			profile->flops_per_mvp += 2.0*copies*m1*m2;
+
+			if (dense_is_stored && ((dA_offsets==0) || (dA_offsets[i+1]>dA_offsets[i])))
+			{
+				size_t bytes = block_precision_doubles(m1*m2, precision)*sizeof(double);
+				profile->bytes_stored += bytes;
+				profile->stored_bytes_per_mvp += (double)bytes;
+			}
+		}
+		else
+		{
+			int a = i-mat_vec_info->dense_count;
+			long rank = (k_per_item!=0) ? k_per_item[a] : ((uniform_rank>0) ? uniform_rank : k);
+
+			// blocks compressed on the fly have an unknown rank of at most k
+			bool is_stored = aca_is_stored && (rank>=0);
+			if (rank<0)
+				rank = std::min((long)k, std::min(m1, m2));
+
+			profile->aca_per_level[level]++;
+			profile->aca_entries += copies*m1*m2;
+			profile->flops_per_mvp += 2.0*copies*rank*(m1+m2);
+
+			if ((profile->rank_histogram!=0) && is_stored)
+				profile->rank_histogram[rank]++;
+
+			if (is_stored)
+			{
+				size_t bytes = (block_precision_doubles(rank*m1, precision)+block_precision_doubles(rank*m2, precision))*sizeof(double);
+				profile->bytes_stored += bytes;
+				profile->stored_bytes_per_mvp += (double)bytes;
+			}
+		}
+	}
+}
+
+const char* profile_phase_name(int phase)
+{
+	return profile_phase_names[phase];
+}
+
+// rates are only meaningful for a measured MVP
+static void write_json_rate(FILE* f, double amount, double seconds)
+{
+	if (seconds>0.0)
+		fprintf(f, "%.6e", amount/seconds);
+	else
+		fprintf(f, "null");
+}
+
+// load balance ratios are only recorded by the host MVP
+static void write_json_ratio(FILE* f, double ratio)
+{
+	if (ratio>0.0)
+		fprintf(f, "%.6e", ratio);
+	else
+		fprintf(f, "null");
+}
+
+void write_h_matrix_profile_json(FILE* f, struct h_matrix_profile* profile, const char* backend_name)
+{
+	fprintf(f, "{\n");
+	fprintf(f, "  \"backend\": \"%s\",\n", backend_name);
+
+	fprintf(f, "  \"phases\": {\n");
+	for (int p=0; p<PROFILE_PHASE_COUNT; p++)
+		fprintf(f, "    \"%s\": { \"seconds\": %.6e, \"calls\": %ld }%s\n", profile_phase_names[p], profile->phase_seconds[p], profile->phase_calls[p], (p<PROFILE_PHASE_COUNT-1) ? "," : "");
+	fprintf(f, "  },\n");
+
+	fprintf(f, "  \"tree_traversal_per_level\": [");
+	for (int l=0; l<profile->traversal_level_count; l++)
+		fprintf(f, "%s{ \"level\": %d, \"seconds\": %.6e }", (l>0) ? ", " : "", l, profile->traversal_level_seconds[l]);
+	fprintf(f, "],\n");
+
+	long dense_count = 0;
+	long aca_count = 0;
+	for (int l=0; l<profile->level_count; l++)
+	{
+		dense_count += profile->dense_per_level[l];
+		aca_count += profile->aca_per_level[l];
+	}
+
+	fprintf(f, "  \"blocks\": {\n");
+	fprintf(f, "    \"dense\": %ld,\n", dense_count);
+	fprintf(f, "    \"aca\": %ld,\n", aca_count);
+	fprintf(f, "    \"per_level\": [");
+	for (int l=0; l<profile->level_count; l++)
+		fprintf(f, "%s{ \"level\": %d, \"dense\": %ld, \"aca\": %ld }", (l>0) ? ", " : "", l, profile->dense_per_level[l], profile->aca_per_level[l]);
+	fprintf(f, "]\n");
+	fprintf(f, "  },\n");
+
+	fprintf(f, "  \"entries\": { \"dense\": %ld, \"aca\": %ld },\n", profile->dense_entries, profile->aca_entries);
+
+	if (profile->aca_iterations>=0)
+		fprintf(f, "  \"aca_iterations\": %ld,\n", profile->aca_iterations);
+	else
+		fprintf(f, "  \"aca_iterations\": null,\n");
+
+	fprintf(f, "  \"rank_histogram\": [");
+	for (int r=0; r<profile->rank_histogram_size; r++)
+		fprintf(f, "%s%ld", (r>0) ? ", " : "", profile->rank_histogram[r]);
+	fprintf(f, "],\n");
+
+	fprintf(f, "  \"bytes_stored\": %zu,\n", profile->bytes_stored);
+
+	// the MVP cost grows linearly with the number of right hand sides, apart from reading the stored blocks
+	int rhs = (profile->last_mvp_rhs>0) ? profile->last_mvp_rhs : 1;
+	double flops = profile->flops_per_mvp*rhs;
+	double bytes = profile->stored_bytes_per_mvp + profile->vector_bytes_per_mvp*rhs;
+
+	fprintf(f, "  \"last_mvp\": {\n");
+	fprintf(f, "    \"seconds\": %.6e,\n", profile->last_mvp_seconds);
+	fprintf(f, "    \"right_hand_sides\": %d,\n", rhs);
+	fprintf(f, "    \"flops\": %.6e,\n", flops);
+	fprintf(f, "    \"bytes\": %.6e,\n", bytes);
+	fprintf(f, "    \"gflops_per_second\": ");
+	write_json_rate(f, flops*1e-9, profile->last_mvp_seconds);
+	fprintf(f, ",\n");
+	fprintf(f, "    \"gigabytes_per_second\": ");
+	write_json_rate(f, bytes*1e-9, profile->last_mvp_seconds);
+	fprintf(f, ",\n");
+	fprintf(f, "    \"thread_imbalance\": ");
+	write_json_ratio(f, profile->mvp_thread_imbalance);
+	fprintf(f, ",\n");
+	fprintf(f, "    \"predicted_imbalance\": ");
+	write_json_ratio(f, profile->mvp_predicted_imbalance);
+	fprintf(f, "\n");
+	fprintf(f, "  }\n");
+
+	fprintf(f, "}\n");
+}
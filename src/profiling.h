@@ -0,0 +1,131 @@
+// Copyright (C) 2016 Peter Zaspel
+//
+// This file is part of hmglib.
+//
+// hmglib is free software: you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// hmglib is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hmglib.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PROFILING_H
+#define PROFILING_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "tree.h"
+
+// phases of the set up and of the MVP
+#define PROFILE_MINMAX 0
+#define PROFILE_MORTON_ENCODING 1
+#define PROFILE_SORT 2
+#define PROFILE_POINT_REORDER 3
+#define PROFILE_TREE_TRAVERSAL 4
+#define PROFILE_ORGANIZE 5
+#define PROFILE_BATCHING 6
+#define PROFILE_ACA 7
+#define PROFILE_RECOMPRESSION 8
+#define PROFILE_DENSE_ASSEMBLY 9
+#define PROFILE_MVP 10
+#define PROFILE_MVP_DENSE 11
+#define PROFILE_MVP_LOW_RANK 12
+#define PROFILE_VECTOR_REORDER 13
+#define PROFILE_FACTORIZATION 14
+#define PROFILE_PHASE_COUNT 15
+
+#define PROFILE_MAX_LEVELS 64
+
+// wall times and counters of one H matrix; the phases are recorded by the library, the block statistics are
+// computed from the block list by profile_block_statistics
+struct h_matrix_profile
+{
+	// accumulated wall time in seconds and number of calls per phase
+	double phase_seconds[PROFILE_PHASE_COUNT];
+	long phase_calls[PROFILE_PHASE_COUNT];
+	double phase_begin[PROFILE_PHASE_COUNT];
+
+	// wall time per level of the block cluster tree traversal (part of PROFILE_TREE_TRAVERSAL)
+	int traversal_level_count;
+	double traversal_level_seconds[PROFILE_MAX_LEVELS];
+
+	// the most recent MVP and its number of right hand sides
+	double last_mvp_seconds;
+	int last_mvp_rhs;
+
+	// time spent by all threads in dense / low rank blocks of the current host MVP (for splitting its wall time)
+	double mvp_dense_thread_seconds;
+	double mvp_low_rank_thread_seconds;
+
+	// load balance of the most recent host MVP, i.e. time of the busiest thread over the mean time of all threads
+	// (1 = perfect balance), measured and as predicted by the cost model of the blocks (0 if not recorded)
+	double mvp_thread_imbalance;
+	double mvp_predicted_imbalance;
+
+	// blocks per level (level of the row cluster)
+	int level_count;
+	long dense_per_level[PROFILE_MAX_LEVELS];
+	long aca_per_level[PROFILE_MAX_LEVELS];
+
+	// matrix entries covered by dense and ACA blocks
+	long dense_entries;
+	long aca_entries;
+
+	// sum of the ranks found by the ACA before any recompression (-1 if unknown)
+	long aca_iterations;
+
+	// number of ACA blocks per rank (rank_histogram_size = maximum rank + 1, 0 if the ranks are unknown)
+	long* rank_histogram;
+	int rank_histogram_size;
+
+	// bytes of the precomputed blocks and of the work items
+	size_t bytes_stored;
+
+	// estimated floating point operations and memory traffic of one MVP per right hand side; the stored blocks
+	// are read once per MVP, independent of the number of right hand sides
+	double flops_per_mvp;
+	double vector_bytes_per_mvp;
+	double stored_bytes_per_mvp;
+
+	// results are written to this file after each profiled call (0 = only on request)
+	char* json_file_name;
+};
+
+extern void init_h_matrix_profile(struct h_matrix_profile* profile, const char* json_file_name);
+
+extern void destroy_h_matrix_profile(struct h_matrix_profile* profile);
+
+// forgets all recorded times (the block statistics are kept)
+extern void reset_h_matrix_profile(struct h_matrix_profile* profile);
+
+extern double profile_wall_time();
+
+// records the wall time between begin and end for the phase; no-ops for profile==0
+extern void profile_phase_begin(struct h_matrix_profile* profile, int phase);
+
+extern void profile_phase_end(struct h_matrix_profile* profile, int phase);
+
+extern void profile_add_phase_seconds(struct h_matrix_profile* profile, int phase, double seconds);
+
+// adds the wall times of the level_count levels of a block cluster tree traversal; no-op for profile==0
+extern void profile_add_traversal_level_seconds(struct h_matrix_profile* profile, double* level_seconds, int level_count);
+
+// counts blocks, entries, ranks, stored bytes and the MVP cost for the (host) block list; k_per_item
+// holds the ranks of the precomputed ACA blocks or is 0, then all ACA blocks have the rank uniform_rank (0 if the
+// ranks are unknown, in which case the MVP cost assumes the maximum rank k); with a block cache, ACA blocks that are
+// not stored have a negative rank and dense blocks that are not stored an empty range in dA_offsets (0 if all dense
+// blocks are stored); block_precision holds the storage precision of every work item (0 if all are stored in double)
+extern void profile_block_statistics(struct h_matrix_profile* profile, struct block_list* blocks, struct mat_vec_data_info* mat_vec_info, int* k_per_item, size_t* dA_offsets, char* block_precision, int uniform_rank, int k, bool dense_is_stored, bool aca_is_stored);
+
+extern const char* profile_phase_name(int phase);
+
+extern void write_h_matrix_profile_json(FILE* f, struct h_matrix_profile* profile, const char* backend_name);
+
+#endif
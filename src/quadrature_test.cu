@@ -173,7 +173,7 @@ int main( int argc, char* argv[])
 	cudaMalloc((void**)mat_vec_data, mat_vec_data_array_size*sizeof(struct work_item));
 
 	TIME_start;
-	traverse_with_dynamic_arrays_dynamic_output(root_h, mat_vec_data, &mat_vec_data_count, &mat_vec_data_array_size, morton_d, morton_d, points_d, points_d, eta, max_level, c_leaf, max_elements_in_array);
+	traverse_with_dynamic_arrays_dynamic_output(root_h, mat_vec_data, &mat_vec_data_count, &mat_vec_data_array_size, morton_d, morton_d, points_d, points_d, eta, max_level, c_leaf, max_elements_in_array, 0, 0);
 	TIME_stop("traverse_with_arrays");
 
 //	printf("mat_vec_data_count: %d\n", mat_vec_data_count);
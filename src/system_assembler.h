@@ -20,13 +20,28 @@
 
 #include "morton.h"
 
+// allow the assembler interface to be used from host-only translation units
+#ifndef __CUDACC__
+#define __host__
+#define __device__
+#endif
+
+// kernel types, allowing the host backend to use specialized assembly routines (cf. host_kernel_assembler.h)
+#define KT_GENERIC 0
+#define KT_GAUSSIAN 1
+#define KT_MATERN 2
+
 class system_assembler
 {
 
 	public:
 //		int max_row_count_per_dgemv;
 
-		virtual	__device__ double get_matrix_entry(int i, int j, struct point_set* point_set1_d, struct point_set* point_set2_d) =0;
+		int kernel_type;
+
+		__host__ __device__ system_assembler() : kernel_type(KT_GENERIC) {}
+
+		virtual	__host__ __device__ double get_matrix_entry(int i, int j, struct point_set* point_set1_d, struct point_set* point_set2_d) =0;
 //		virtual __device__ double get_rhs_entry(int i) =0;
 //
 };
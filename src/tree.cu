@@ -21,6 +21,7 @@
 #include <thrust/sort.h>
 
 #include "tree.h"
+#include "profiling.h"
 
 #ifndef CHECK_CUDA_ERROR
 #define CHECK_CUDA_ERROR
@@ -1426,7 +1427,7 @@ void compute_bounding_boxes_fun(struct work_item* current_level_data, int total_
 
 */
 
-void traverse_with_dynamic_arrays_dynamic_output(struct work_item root_h, struct work_item** mat_vec_data, int* mat_vec_data_count, int* mat_vec_data_array_size, struct morton_code* input_set1_codes, struct morton_code* input_set2_codes, struct point_set* input_set1, struct point_set* input_set2, double eta, int max_level, int c_leaf, int max_elements_in_array)
+void traverse_with_dynamic_arrays_dynamic_output(struct work_item root_h, struct work_item** mat_vec_data, int* mat_vec_data_count, int* mat_vec_data_array_size, struct morton_code* input_set1_codes, struct morton_code* input_set2_codes, struct point_set* input_set1, struct point_set* input_set2, double eta, int max_level, int c_leaf, int max_elements_in_array, double* level_seconds, int* level_count)
 {
 	struct work_item* current_level_data = 0;
 	struct work_item* next_level_data = 0;
@@ -1460,8 +1461,13 @@ void traverse_with_dynamic_arrays_dynamic_output(struct work_item root_h, struct
 	cudaThreadSynchronize();
 	checkCUDAError("init_tree_array_root");
 
+	if (level_count!=0)
+		*level_count = 0;
+
 	for (int current_level=0; current_level<max_level; current_level++)  // run over all arrays
 	{
+		double level_begin = profile_wall_time();
+
 //		TIME_sstart;
 //		compute_bounding_boxes_fun_old(current_level_data, total_children, input_set1, input_set2);
 		compute_bounding_boxes_fun(current_level_data, total_children, input_set1, input_set2);
@@ -1548,6 +1554,12 @@ void traverse_with_dynamic_arrays_dynamic_output(struct work_item root_h, struct
 		// compute new compute configuration for children computations
 		grid_size_for_children = (total_children + (block_size - 1)) / block_size;
 
+		// the level is finished, generate_new_level has been synchronized
+		if (level_seconds!=0)
+			level_seconds[current_level] = profile_wall_time()-level_begin;
+		if (level_count!=0)
+			*level_count = current_level+1;
+
 		if (total_children==0) // stopping when no more children are generated
 		{
 			cudaFree(current_level_data);
@@ -18,6 +18,8 @@
 #ifndef TREE_H
 #define TREE_H
 
+#include <stddef.h>
+
 #include "morton.h"
 
 
@@ -54,6 +56,98 @@ struct work_item
 	char level_2;  // level of the second set / cluster, where the full data set i is on level 0, the first splits leads to level 1, ...
 };
 
+// cluster table of the host backend: every cluster of the cluster tree(s) is stored once with its index range in the
+// Z order sorted point set, its level and its bounding box; the boxes take dim entries per cluster, i.e. there is no
+// upper bound on the dimension
+struct cluster_table
+{
+	int count;
+	int dim;
+	int* l;		// lower index bound of the points belonging to the cluster
+	int* u;		// upper index bound of the points belonging to the cluster
+	char* level;	// level of the cluster, where the full data set is on level 0
+	double* min;	// min part of the bounding boxes, dim entries per cluster
+	double* max;	// max part of the bounding boxes, dim entries per cluster
+};
+
+// block list of the host backend: every leaf of the block cluster tree is a (cluster1, cluster2, work type) triple,
+// stored as three separate arrays; cluster1 refers to a cluster of set 1, cluster2 to a cluster of set 2 (in symmetric
+// mode both refer to the single cluster tree)
+struct block_list
+{
+	int count;
+	int* cluster1;
+	int* cluster2;
+	char* work_type;	// WT_ACA or WT_DENSE
+	struct cluster_table clusters;
+};
+
+// index ranges and work type of a single block, looked up in the cluster table
+struct block_item
+{
+	int set1_l;
+	int set1_u;
+	int set2_l;
+	int set2_u;
+	int work_type;
+};
+
+static inline struct block_item get_block_item(struct block_list* blocks, int i)
+{
+	struct block_item item;
+	int c1 = blocks->cluster1[i];
+	int c2 = blocks->cluster2[i];
+
+	item.set1_l = blocks->clusters.l[c1];
+	item.set1_u = blocks->clusters.u[c1];
+	item.set2_l = blocks->clusters.l[c2];
+	item.set2_u = blocks->clusters.u[c2];
+	item.work_type = blocks->work_type[i];
+
+	return item;
+}
+
+// bytes taken by the block list and its cluster table
+static inline size_t block_list_size(struct block_list* blocks)
+{
+	size_t block_bytes = 2*sizeof(int) + sizeof(char);
+	size_t cluster_bytes = 2*sizeof(int) + sizeof(char) + 2*blocks->clusters.dim*sizeof(double);
+
+	return blocks->count*block_bytes + blocks->clusters.count*cluster_bytes;
+}
+
+struct mat_vec_data_info
+{
+	int dense_count;
+	int aca_count;
+	int total_count;
+
+	// 1 if only the blocks on and above the diagonal of a symmetric matrix are kept (BACKEND_HOST)
+	int symmetric;
+};
+
+// in a symmetric block partition, every block above the diagonal also stands for its transpose below the diagonal
+static inline bool is_mirrored_block(struct block_item* item, struct mat_vec_data_info* mat_vec_info)
+{
+	return (mat_vec_info->symmetric!=0) && (item->set1_l!=item->set2_l);
+}
+
+// storage precision of a precomputed block (BACKEND_HOST); the entries of a block in single precision or bfloat16
+// (ACA factors only) are packed into the double arrays of the precomputed data, padded to whole doubles
+#define BLOCK_PRECISION_DOUBLE 0
+#define BLOCK_PRECISION_SINGLE 1
+#define BLOCK_PRECISION_BFLOAT16 2
+
+// number of doubles taken by n entries in the given storage precision
+static inline size_t block_precision_doubles(size_t n, int precision)
+{
+	if (precision==BLOCK_PRECISION_SINGLE)
+		return (n+1)/2;
+	else if (precision==BLOCK_PRECISION_BFLOAT16)
+		return (n+3)/4;
+	return n;
+}
+
 
 
 extern void print_work_items(struct work_item* work_items, int work_item_count);
@@ -89,7 +183,9 @@ extern void compute_lookup_table(double*** lookup_table_min, double*** lookup_ta
 // tree level and sets the boxes as parameters in each work_item / node
 extern void compute_bounding_boxes_fun(struct work_item* current_level_data, int total_children, struct point_set* input_set1, struct point_set* input_set2);
 
-extern void traverse_with_dynamic_arrays_dynamic_output(struct work_item root_h, struct work_item** mat_vec_data, int* mat_vec_data_count, int* mat_vec_data_array_size, struct morton_code* input_set1_codes, struct morton_code* input_set2_codes, struct point_set* input_set1, struct point_set* input_set2, double eta, int max_level, int c_leaf, int max_elements_in_array);
+// the wall time of every tree level is stored in level_seconds (max_level entries, 0 = not recorded) and the number of
+// levels in level_count (0 = not recorded)
+extern void traverse_with_dynamic_arrays_dynamic_output(struct work_item root_h, struct work_item** mat_vec_data, int* mat_vec_data_count, int* mat_vec_data_array_size, struct morton_code* input_set1_codes, struct morton_code* input_set2_codes, struct point_set* input_set1, struct point_set* input_set2, double eta, int max_level, int c_leaf, int max_elements_in_array, double* level_seconds, int* level_count);
 
 
 #endif
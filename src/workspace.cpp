@@ -0,0 +1,248 @@
+// Copyright (C) 2016 Peter Zaspel
+//
+// This file is part of hmglib.
+//
+// hmglib is free software: you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// hmglib is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hmglib.  If not, see <http://www.gnu.org/licenses/>.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "workspace.h"
+
+static void* host_workspace_malloc(size_t size)
+{
+	void* p;
+	if (posix_memalign(&p, WORKSPACE_ALIGNMENT, size)!=0)
+	{
+		printf("Could not allocate %lu bytes of host workspace memory. Exiting...\n", (unsigned long)size);
+		exit(1);
+	}
+	return p;
+}
+
+static void host_workspace_free(void* p)
+{
+	free(p);
+}
+
+void init_workspace_arena(struct workspace_arena* arena, void* (*system_malloc)(size_t size), void (*system_free)(void* p))
+{
+	memset(arena, 0, sizeof(struct workspace_arena));
+	arena->system_malloc = system_malloc;
+	arena->system_free = system_free;
+}
+
+static void free_overflow_blocks(struct workspace_arena* arena)
+{
+	for (int i=0; i<arena->overflow_count; i++)
+		arena->system_free(arena->overflow_blocks[i]);
+	arena->overflow_count = 0;
+	arena->overflow_size = 0;
+}
+
+void destroy_workspace_arena(struct workspace_arena* arena)
+{
+	if (arena->system_free==0)
+		return;
+
+	free_overflow_blocks(arena);
+	free(arena->overflow_blocks);
+	if (arena->base!=0)
+		arena->system_free(arena->base);
+
+	memset(arena, 0, sizeof(struct workspace_arena));
+}
+
+void reserve_workspace_arena(struct workspace_arena* arena, size_t size)
+{
+	if (size<=arena->capacity)
+		return;
+
+	if ((arena->offset!=0)||(arena->overflow_count!=0))
+	{
+		printf("Workspace arena can only be grown while it is empty. Exiting...\n");
+		exit(1);
+	}
+
+	if (arena->base!=0)
+		arena->system_free(arena->base);
+	arena->base = (char*)arena->system_malloc(size);
+	arena->capacity = size;
+	arena->allocations++;
+}
+
+void* workspace_arena_malloc(struct workspace_arena* arena, size_t size)
+{
+	// every block starts at a multiple of WORKSPACE_ALIGNMENT
+	size = ((size + (WORKSPACE_ALIGNMENT-1)) / WORKSPACE_ALIGNMENT) * WORKSPACE_ALIGNMENT;
+	if (size==0)
+		size = WORKSPACE_ALIGNMENT;
+
+	char* p;
+
+	if (arena->offset+size<=arena->capacity)
+	{
+		p = arena->base + arena->offset;
+		arena->last_block = p;
+		arena->offset_before_last_block = arena->offset;
+		arena->offset += size;
+	}
+	else
+	{
+		// buffer is too small for this use, serve the request separately until the end of the use
+		if (arena->overflow_count==arena->overflow_array_size)
+		{
+			arena->overflow_array_size = (arena->overflow_array_size==0) ? 16 : 2*arena->overflow_array_size;
+			arena->overflow_blocks = (void**)realloc(arena->overflow_blocks, arena->overflow_array_size*sizeof(void*));
+			arena->allocations++;
+		}
+
+		p = (char*)arena->system_malloc(size);
+		arena->allocations++;
+		arena->overflow_blocks[arena->overflow_count] = p;
+		arena->overflow_count++;
+		arena->overflow_size += size;
+	}
+
+	if (arena->offset+arena->overflow_size>arena->high_water)
+		arena->high_water = arena->offset+arena->overflow_size;
+
+	return p;
+}
+
+void workspace_arena_free(struct workspace_arena* arena, void* p)
+{
+	if ((p!=0)&&(p==arena->last_block))
+	{
+		arena->offset = arena->offset_before_last_block;
+		arena->last_block = 0;
+	}
+}
+
+size_t workspace_arena_mark(struct workspace_arena* arena)
+{
+	return arena->offset;
+}
+
+void workspace_arena_release(struct workspace_arena* arena, size_t mark)
+{
+	arena->offset = mark;
+
+	// a block below the mark can still be given back directly
+	if ((arena->last_block!=0)&&((size_t)(arena->last_block-arena->base)>=mark))
+		arena->last_block = 0;
+}
+
+void finish_workspace_arena_use(struct workspace_arena* arena)
+{
+	free_overflow_blocks(arena);
+	arena->offset = 0;
+	arena->last_block = 0;
+
+	// the next use of the same size has to fit into the buffer
+	reserve_workspace_arena(arena, arena->high_water);
+}
+
+void init_mvp_workspace(struct mvp_workspace* workspace, int thread_count)
+{
+	memset(workspace, 0, sizeof(struct mvp_workspace));
+
+	workspace->thread_count = thread_count;
+	workspace->host_arenas = new struct workspace_arena[thread_count];
+	for (int t=0; t<thread_count; t++)
+		init_workspace_arena(&workspace->host_arenas[t], host_workspace_malloc, host_workspace_free);
+}
+
+void destroy_mvp_row_schedule(struct mvp_row_schedule* schedule)
+{
+	delete [] schedule->segment_begin;
+	delete [] schedule->contribution_offsets;
+	delete [] schedule->contributions;
+	delete [] schedule->local_offsets;
+	memset(schedule, 0, sizeof(struct mvp_row_schedule));
+}
+
+void invalidate_mvp_block_costs(struct mvp_workspace* workspace)
+{
+	if (workspace->block_costs==0)
+		return;
+
+	delete [] workspace->block_costs->cost;
+	delete [] workspace->block_costs->order;
+	delete workspace->block_costs;
+	workspace->block_costs = 0;
+}
+
+void destroy_mvp_workspace(struct mvp_workspace* workspace)
+{
+	for (int t=0; t<workspace->thread_count; t++)
+		destroy_workspace_arena(&workspace->host_arenas[t]);
+	delete [] workspace->host_arenas;
+
+	for (int d=0; d<2; d++)
+		if (workspace->row_schedules[d]!=0)
+		{
+			destroy_mvp_row_schedule(workspace->row_schedules[d]);
+			delete workspace->row_schedules[d];
+		}
+
+	invalidate_mvp_block_costs(workspace);
+
+	destroy_workspace_arena(&workspace->device_arena);
+	destroy_workspace_arena(&workspace->staging_arena);
+
+	memset(workspace, 0, sizeof(struct mvp_workspace));
+}
+
+long get_mvp_workspace_allocations(struct mvp_workspace* workspace)
+{
+	long allocations = workspace->other_allocations;
+
+	for (int t=0; t<workspace->thread_count; t++)
+		allocations += workspace->host_arenas[t].allocations;
+	allocations += workspace->device_arena.allocations;
+	allocations += workspace->staging_arena.allocations;
+
+	return allocations;
+}
+
+size_t get_mvp_workspace_size(struct mvp_workspace* workspace)
+{
+	size_t size = 0;
+
+	for (int t=0; t<workspace->thread_count; t++)
+		size += workspace->host_arenas[t].capacity;
+	size += workspace->device_arena.capacity;
+	size += workspace->staging_arena.capacity;
+
+	return size;
+}
+
+void begin_mvp_workspace_use(struct mvp_workspace* workspace)
+{
+	workspace->allocations_at_begin = get_mvp_workspace_allocations(workspace);
+}
+
+void end_mvp_workspace_use(struct mvp_workspace* workspace)
+{
+	for (int t=0; t<workspace->thread_count; t++)
+		finish_workspace_arena_use(&workspace->host_arenas[t]);
+	if (workspace->device_arena.system_malloc!=0)
+		finish_workspace_arena_use(&workspace->device_arena);
+	if (workspace->staging_arena.system_malloc!=0)
+		finish_workspace_arena_use(&workspace->staging_arena);
+
+	workspace->allocations_last_mvp = get_mvp_workspace_allocations(workspace) - workspace->allocations_at_begin;
+	workspace->mvp_count++;
+}
@@ -0,0 +1,176 @@
+// Copyright (C) 2016 Peter Zaspel
+//
+// This file is part of hmglib.
+//
+// hmglib is free software: you can redistribute it and/or modify it under the
+// terms of the GNU Lesser General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option) any
+// later version.
+//
+// hmglib is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+// A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+// details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with hmglib.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include <stddef.h>
+
+// alignment of all blocks handed out by a workspace arena (enough for coalesced device access and host cache lines)
+#define WORKSPACE_ALIGNMENT 256
+
+// bump allocator on top of one persistent buffer; memory is obtained from system_malloc (malloc, cudaMalloc, ...)
+// only when the buffer is too small, such requests are served by separate overflow blocks and the buffer is grown to
+// the high water mark at the end of the current use, such that the next use does not allocate at all
+struct workspace_arena
+{
+	char* base;
+	size_t capacity;
+	size_t offset;
+	size_t high_water;
+
+	// the most recent block can be given back directly (e.g. temporary storage of thrust algorithms)
+	char* last_block;
+	size_t offset_before_last_block;
+
+	void** overflow_blocks;
+	int overflow_count;
+	int overflow_array_size;
+	size_t overflow_size;
+
+	void* (*system_malloc)(size_t size);
+	void (*system_free)(void* p);
+
+	long allocations;	// number of calls to system_malloc since initialization
+
+	char padding[64];	// avoid false sharing between the arenas of different threads
+};
+
+// accumulation of the block results into y in the host MVP: atomic adds of every block (in the order the blocks
+// are finished) or row-owned, i.e. the block results are kept and every row of y is summed up by a single thread in
+// work item order (bitwise reproducible for any thread count)
+#define MVP_ACCUMULATE_ATOMIC 0
+#define MVP_ACCUMULATE_ROW_OWNED 1
+
+// order in which the host MVP hands out the blocks to the threads: work item order or decreasing estimated cost
+// (longest processing time first list scheduling, which keeps the expensive blocks off the end of the MVP)
+#define MVP_SCHEDULE_WORK_ITEM_ORDER 0
+#define MVP_SCHEDULE_COST_ORDERED 1
+
+// schedule of the row-owned accumulation for one partition and direction (y = H*x or y = H'*x): contribution c is
+// the result of block c/2 on the rows of set 1 (c even) or set 2 (c odd) and is stored at local_offsets[c]*nrhs in
+// the result buffer; the rows of y are split into segments at the row bounds of all contributions, segment s is the
+// sum of contributions[contribution_offsets[s]], ..., contributions[contribution_offsets[s+1]-1]
+struct mvp_row_schedule
+{
+	void* blocks;		// partition the schedule was built for
+	int total_count;
+	int symmetric;
+
+	int segment_count;
+	int* segment_begin;
+	int* contribution_offsets;
+	int* contributions;
+	size_t* local_offsets;
+	size_t local_size;
+};
+
+// estimated MVP costs of the blocks of one partition with one set of stored blocks and their order of decreasing cost
+// for the cost-ordered schedule (order is 0 until that schedule is used); built by the first MVP that needs them and
+// rebuilt when one of the keys changes or after invalidate_mvp_block_costs
+struct mvp_block_costs
+{
+	void* blocks;		// partition, stored blocks and product the costs were estimated for
+	int total_count;
+	int symmetric;
+	void* dA;
+	void* dA_offsets;
+	void* U;
+	void* k_per_item;
+	int k;
+	int nrhs;
+
+	double* cost;
+	int* order;
+};
+
+// persistent workspace of the H matrix-vector product, owned by h_matrix_data and set up with the H matrix
+struct mvp_workspace
+{
+	// host backend: one arena per thread
+	int thread_count;
+	struct workspace_arena* host_arenas;
+
+	// GPU backend: device scratch memory, host staging memory and the cuBLAS handle
+	struct workspace_arena device_arena;
+	struct workspace_arena staging_arena;
+	void* cublas_handle;
+	int point_count_1;
+	int dim;
+
+	// statistics
+	long mvp_count;
+	long allocations_at_begin;
+	long allocations_last_mvp;
+	long other_allocations;	// allocations of the set up (handles etc.), i.e. not made by the arenas
+
+	// phase timings of the MVPs (0 if profiling is disabled)
+	struct h_matrix_profile* profile;
+
+	// host backend: MVP_ACCUMULATE_ATOMIC or MVP_ACCUMULATE_ROW_OWNED and the schedules of the row-owned
+	// accumulation for H*x and H'*x (built by the first MVP on a partition)
+	int accumulation;
+	struct mvp_row_schedule* row_schedules[2];
+
+	// host backend: MVP_SCHEDULE_WORK_ITEM_ORDER or MVP_SCHEDULE_COST_ORDERED and the block costs of the cost-ordered
+	// schedule and of the predicted load balance of the profile
+	int scheduling;
+	struct mvp_block_costs* block_costs;
+};
+
+extern void init_workspace_arena(struct workspace_arena* arena, void* (*system_malloc)(size_t size), void (*system_free)(void* p));
+
+extern void destroy_workspace_arena(struct workspace_arena* arena);
+
+// makes sure that at least size bytes are available without any further allocation (only when the arena is empty)
+extern void reserve_workspace_arena(struct workspace_arena* arena, size_t size);
+
+extern void* workspace_arena_malloc(struct workspace_arena* arena, size_t size);
+
+// gives the block back if it is the most recent one, otherwise the memory is reclaimed by release / end of use
+extern void workspace_arena_free(struct workspace_arena* arena, void* p);
+
+// all blocks allocated after workspace_arena_mark are given back by workspace_arena_release
+extern size_t workspace_arena_mark(struct workspace_arena* arena);
+
+extern void workspace_arena_release(struct workspace_arena* arena, size_t mark);
+
+// empties the arena and grows its buffer to the high water mark of the finished use
+extern void finish_workspace_arena_use(struct workspace_arena* arena);
+
+// sets up the host arenas for thread_count threads (the GPU parts are set up in linear_algebra.cu)
+extern void init_mvp_workspace(struct mvp_workspace* workspace, int thread_count);
+
+extern void destroy_mvp_workspace(struct mvp_workspace* workspace);
+
+extern void destroy_mvp_row_schedule(struct mvp_row_schedule* schedule);
+
+// drops the block costs of workspace, which have to be invalidated whenever the stored blocks are changed in place
+// (e.g. ranks after a recompression)
+extern void invalidate_mvp_block_costs(struct mvp_workspace* workspace);
+
+// total number of allocations made by the workspace
+extern long get_mvp_workspace_allocations(struct mvp_workspace* workspace);
+
+// total size of the buffers held by the workspace in bytes
+extern size_t get_mvp_workspace_size(struct mvp_workspace* workspace);
+
+// brackets one MVP; end_mvp_workspace_use empties all arenas and records the allocations made during the MVP
+extern void begin_mvp_workspace_use(struct mvp_workspace* workspace);
+
+extern void end_mvp_workspace_use(struct mvp_workspace* workspace);
+
+#endif